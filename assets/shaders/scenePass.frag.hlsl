@@ -116,9 +116,11 @@ float3 CalcPerPixelNormal(float2 vTexcoord, float3 vVertNormal, float3 vVertTang
     float3x3 mTangentSpaceToWorldSpace = float3x3(vVertTangent, vVertBinormal, vVertNormal);
 
     // Compute per-pixel normal.
-    float3 vBumpNormal = TextureTable[normal_index].Sample(TextureSampler[sampler_normal_index], vTexcoord).xyz;
+    // normal maps are BC5 (two channels), rebuild z from the unit length
+    float3 vBumpNormal;
+    vBumpNormal.xy = 2.0f * TextureTable[normal_index].Sample(TextureSampler[sampler_normal_index], vTexcoord).xy - 1.0f;
+    vBumpNormal.z = sqrt(saturate(1.0f - dot(vBumpNormal.xy, vBumpNormal.xy)));
     //float3 vBumpNormal = (float3)normalMap.Sample(sampleWrap, vTexcoord);
-    vBumpNormal = 2.0f * vBumpNormal - 1.0f;
 
     return mul(vBumpNormal, mTangentSpaceToWorldSpace);
 }
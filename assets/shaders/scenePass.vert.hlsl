@@ -4,25 +4,25 @@
 
 struct VSInput
 {
-    float4 color : COLOR;
-
-    float4 position : POSITION;
-    //float3 position : POSITION;
-    //float padding0 : PADDING0;
+    float3 position : POSITION;
 
-    float4 normal : NORMAL;
-    //float3 normal : NORMAL;
-    //float padding1 : PADDING1;
+    // octahedral encoded, see OctahedralDecode
+    float2 normal : NORMAL;
+    float2 tangent : TANGENT;
 
-    float4 uv : TEXCOORD;
-    //float2 uv : TEXCOORD;
-    //float padding2 : PADDING2;
-
-    float4 tangent : TANGENT;
-    //float3 tangent : TANGENT;
-    //float padding3;
+    float2 uv : TEXCOORD;
+    float4 color : COLOR;
 };
 
+// Inverse of PackOctahedral in AnniUtils.cpp.
+float3 OctahedralDecode(float2 e)
+{
+    float3 v = float3(e.xy, 1.0f - abs(e.x) - abs(e.y));
+    float t = saturate(-v.z);
+    v.xy += (v.xy >= 0.0f) ? -t : t;
+    return normalize(v);
+}
+
 struct VSOutput
 {
     float4 position : SV_POSITION;
@@ -79,8 +79,8 @@ VSOutput main(VSInput vs_in)
 
     result.position = new_position;
     result.uv = vs_in.uv.xy;
-    result.normal = vs_in.normal.xyz;
-    result.tangent = vs_in.tangent.xyz;
+    result.normal = OctahedralDecode(vs_in.normal);
+    result.tangent = OctahedralDecode(vs_in.tangent);
 
     return result;
 }
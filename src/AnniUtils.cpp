@@ -1,5 +1,8 @@
 #include "AnniUtils.h"
 
+#include <intrin.h>
+#include <psapi.h>
+
 namespace Anni {
 
 namespace Constants {
@@ -8,20 +11,66 @@ namespace Constants {
 
     D3D12_INPUT_ELEMENT_DESC StandardVertexDescription[5] = {
 
-        { "COLOR", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, 0,
+        { "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, offsetof(StandardVertex, position),
             D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
-
-        { "POSITION", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, 16,
+        { "NORMAL", 0, DXGI_FORMAT_R16G16_SNORM, 0, offsetof(StandardVertex, normal),
             D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
-        { "NORMAL", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, 32,
+        { "TANGENT", 0, DXGI_FORMAT_R16G16_SNORM, 0, offsetof(StandardVertex, tangent),
             D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
-        { "TEXCOORD", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, 48,
+        { "TEXCOORD", 0, DXGI_FORMAT_R16G16_FLOAT, 0, offsetof(StandardVertex, uv),
             D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
-        { "TANGENT", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, 64,
+        { "COLOR", 0, DXGI_FORMAT_R8G8B8A8_UNORM, 0, offsetof(StandardVertex, color),
             D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
     };
 }
 
+static_assert(sizeof(StandardVertex) == 28, "StandardVertexDescription has to follow the vertex layout");
+
+UINT32 PackOctahedral(const glm::vec3& unit_vector)
+{
+    // project onto the octahedron, then fold the lower half over the diagonals
+    const float l1_norm = std::abs(unit_vector.x) + std::abs(unit_vector.y) + std::abs(unit_vector.z);
+    if (l1_norm == 0.0f) {
+        return glm::packSnorm2x16(glm::vec2(0.0f));
+    }
+    glm::vec2 p = glm::vec2(unit_vector) / l1_norm;
+    if (unit_vector.z < 0.0f) {
+        const glm::vec2 sign_not_zero(p.x >= 0.0f ? 1.0f : -1.0f, p.y >= 0.0f ? 1.0f : -1.0f);
+        p = (1.0f - glm::abs(glm::vec2(p.y, p.x))) * sign_not_zero;
+    }
+    return glm::packSnorm2x16(p);
+}
+
+glm::vec3 UnpackOctahedral(const UINT32 packed)
+{
+    const glm::vec2 e = glm::unpackSnorm2x16(packed);
+    glm::vec3 v(e.x, e.y, 1.0f - std::abs(e.x) - std::abs(e.y));
+    const float t = std::max(-v.z, 0.0f);
+    v.x += v.x >= 0.0f ? -t : t;
+    v.y += v.y >= 0.0f ? -t : t;
+    return glm::normalize(v);
+}
+
+UINT32 PackHalf2(const glm::vec2& v)
+{
+    return glm::packHalf2x16(v);
+}
+
+glm::vec2 UnpackHalf2(const UINT32 packed)
+{
+    return glm::unpackHalf2x16(packed);
+}
+
+UINT32 PackUNorm4(const glm::vec4& v)
+{
+    return glm::packUnorm4x8(v);
+}
+
+glm::vec4 UnpackUNorm4(const UINT32 packed)
+{
+    return glm::unpackUnorm4x8(packed);
+}
+
 WRL::ComPtr<IDxcBlob> DXC::LoadFileAsDxcBlob(const std::wstring& filename, IDxcUtils* dxc_utils)
 {
     const HANDLE h_file = CreateFileW(filename.c_str(), GENERIC_READ, 0, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
@@ -132,6 +181,146 @@ std::vector<char> ReadFileAsBytes(const std::string& filename)
     return buffer;
 }
 
+MappedFile::MappedFile(const std::filesystem::path& filename)
+    : m_file(INVALID_HANDLE_VALUE)
+    , m_mapping(nullptr)
+    , m_data(nullptr)
+    , m_size(0)
+    , m_tailSlack(0)
+{
+    m_file = CreateFileW(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (m_file == INVALID_HANDLE_VALUE) {
+        throw std::runtime_error("Failed to open file for mapping");
+    }
+
+    LARGE_INTEGER file_size;
+    if (!GetFileSizeEx(m_file, &file_size)) {
+        CloseHandle(m_file);
+        throw std::runtime_error("Failed to get file size");
+    }
+    m_size = static_cast<size_t>(file_size.QuadPart);
+
+    // an empty file can not be mapped, it is simply an empty view
+    if (m_size == 0) {
+        return;
+    }
+
+    m_mapping = CreateFileMappingW(m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!m_mapping) {
+        CloseHandle(m_file);
+        throw std::runtime_error("Failed to create file mapping");
+    }
+
+    m_data = static_cast<const std::byte*>(MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0));
+    if (!m_data) {
+        CloseHandle(m_mapping);
+        CloseHandle(m_file);
+        throw std::runtime_error("Failed to map view of file");
+    }
+
+    SYSTEM_INFO system_info;
+    GetSystemInfo(&system_info);
+    const size_t page_size = system_info.dwPageSize;
+    m_tailSlack = (page_size - m_size % page_size) % page_size;
+}
+
+MappedFile::~MappedFile()
+{
+    if (m_data) {
+        UnmapViewOfFile(m_data);
+    }
+    if (m_mapping) {
+        CloseHandle(m_mapping);
+    }
+    CloseHandle(m_file);
+}
+
+const std::byte* MappedFile::GetData() const
+{
+    return m_data;
+}
+
+size_t MappedFile::GetSize() const
+{
+    return m_size;
+}
+
+size_t MappedFile::GetTailSlack() const
+{
+    return m_tailSlack;
+}
+
+size_t GetPeakWorkingSetSize()
+{
+    PROCESS_MEMORY_COUNTERS counters = {};
+    if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+        return 0;
+    }
+    return counters.PeakWorkingSetSize;
+}
+
+uint64_t HashBytes(const void* data, const size_t size, const uint64_t seed)
+{
+    constexpr uint64_t prime = 1099511628211ull;
+
+    const auto* bytes = static_cast<const std::byte*>(data);
+    uint64_t hash = seed;
+    size_t i = 0;
+    for (; i + sizeof(uint64_t) <= size; i += sizeof(uint64_t)) {
+        uint64_t word;
+        memcpy(&word, bytes + i, sizeof(uint64_t));
+        hash = (hash ^ word) * prime;
+    }
+    for (; i < size; ++i) {
+        hash = (hash ^ static_cast<uint64_t>(bytes[i])) * prime;
+    }
+    // fold the high bits back in, multiplication only carries upwards
+    return hash ^ (hash >> 29);
+}
+
+SimdLevel GetSimdLevel()
+{
+    static const SimdLevel level = [] {
+        int leaf1[4];
+        int leaf7[4] {};
+        __cpuid(leaf1, 1);
+        if (leaf1[0] >= 7) {
+            __cpuidex(leaf7, 7, 0);
+        }
+        const bool sse41 = (leaf1[2] & (1 << 19)) != 0;
+        const bool fma = (leaf1[2] & (1 << 12)) != 0;
+        const bool f16c = (leaf1[2] & (1 << 29)) != 0;
+        const bool osxsave = (leaf1[2] & (1 << 27)) != 0;
+        const bool avx2 = (leaf7[1] & (1 << 5)) != 0;
+        const bool avx512f = (leaf7[1] & (1 << 16)) != 0;
+
+        // the OS has to save the ymm (and zmm, opmask) registers on context switches
+        const uint64_t xcr0 = osxsave ? _xgetbv(0) : 0;
+        const bool ymm_state = (xcr0 & 0x6) == 0x6;
+        const bool zmm_state = (xcr0 & 0xE6) == 0xE6;
+
+        if (avx2 && fma && f16c && ymm_state) {
+            return avx512f && zmm_state ? SimdLevel::AVX512 : SimdLevel::AVX2;
+        }
+        return sse41 ? SimdLevel::SSE41 : SimdLevel::Scalar;
+    }();
+    return level;
+}
+
+const char* GetSimdLevelName(const SimdLevel level)
+{
+    switch (level) {
+    case SimdLevel::SSE41:
+        return "SSE4.1";
+    case SimdLevel::AVX2:
+        return "AVX2";
+    case SimdLevel::AVX512:
+        return "AVX-512";
+    default:
+        return "scalar";
+    }
+}
+
 void ThrowIfFailed(HRESULT hr)
 {
     if (FAILED(hr)) {
@@ -1,7 +1,9 @@
 #pragma once
 #include "d3dx12.h"
+#include "glm/gtc/packing.hpp"
 #include "glm/gtx/compatibility.hpp"
 #include <cassert>
+#include <cstddef>
 #include <dxcapi.h>
 #include <dxgi.h>
 #include <filesystem>
@@ -39,28 +41,101 @@ constexpr UINT FRAME_INFLIGHT_COUNT = 2;
 constexpr UINT BACKBUFFER_COUNT = 3;
 constexpr DXGI_FORMAT BACKBUFFER_FORMAT = DXGI_FORMAT_R8G8B8A8_UNORM;
 constexpr DXGI_SWAP_EFFECT SWAP_CHAIN_SWAP_EFFECT = DXGI_SWAP_EFFECT_FLIP_DISCARD;
-
+// Threads used by model import, 0 means one per hardware thread and 1 keeps the whole import on the calling thread.
+constexpr UINT IMPORT_THREAD_COUNT = 0;
+// Size of the vertex and index buffers shared by all models (56 MB and 32 MB).
+constexpr UINT32 GEOMETRY_POOL_VERTEX_CAPACITY = 1 << 21;
+constexpr UINT32 GEOMETRY_POOL_INDEX_CAPACITY = 1 << 23;
+// Size of the ID3D12Heap blocks placed resources are carved from, larger resources get a heap of their own.
+constexpr UINT64 RESOURCE_HEAP_BLOCK_SIZE = 64ull * 1024 * 1024;
+// Draw only the meshlets the CPU finds inside a view and not back facing, instead of whole surfaces.
+constexpr bool CPU_CLUSTER_CULLING = true;
+// Frames every frame resource records before debug builds assert that recording one makes no heap allocation.
+constexpr UINT ALLOCATION_FREE_FRAME_WARMUP = 2;
+// Frames between two logs of the scene pass's object culling, 0 never logs.
+constexpr UINT OBJECT_CULL_LOG_INTERVAL = 600;
+// Error in pixels a simplified level of detail may show, shadow maps are sampled filtered and tolerate more.
+constexpr float LOD_MAX_SCREEN_ERROR = 1.0f;
+constexpr float SHADOW_LOD_MAX_SCREEN_ERROR = 2.0f;
+// Upload memory used while loading models, data larger than this streams through it in several submissions.
+constexpr UINT64 STAGING_RING_SIZE = 32ull * 1024 * 1024;
+// Time the loader's stages (LoadProfiler). The renderer writes the report after loading the scene, the Chrome trace
+// only when asked for, it holds every zone.
+constexpr bool LOAD_PROFILING = true;
+constexpr bool LOAD_PROFILE_CHROME_TRACE = false;
+constexpr const char* LOAD_PROFILE_REPORT_PATH = "load_profile.json";
+constexpr const char* LOAD_PROFILE_TRACE_PATH = "load_trace.json";
+
+// 28 bytes, see Constants::StandardVertexDescription for the formats. The vertex shaders unpack normal and tangent
+// with OctahedralDecode.
 struct StandardVertex {
 
-    glm::float4 color;
-
     glm::float3 position;
-    float padding0;
 
-    glm::float3 normal;
-    float padding1;
+    // octahedral encoded unit vectors
+    UINT32 normal;
+    UINT32 tangent;
 
-    glm::float2 uv;
-    float padding2;
-    float padding3;
+    // two halfs
+    UINT32 uv;
 
-    glm::float3 tangent;
-    float padding4;
+    UINT32 color;
 };
 
+// Vertex attribute packing
+UINT32 PackOctahedral(const glm::vec3& unit_vector);
+glm::vec3 UnpackOctahedral(UINT32 packed);
+UINT32 PackHalf2(const glm::vec2& v);
+glm::vec2 UnpackHalf2(UINT32 packed);
+UINT32 PackUNorm4(const glm::vec4& v);
+glm::vec4 UnpackUNorm4(UINT32 packed);
+
 // Common Utils
 std::vector<char> ReadFileAsBytes(const std::string& filename);
 
+// Read-only mapping of a whole file. Nothing is copied to the heap, pages are faulted in on first access.
+class MappedFile {
+public:
+    explicit MappedFile(const std::filesystem::path& filename);
+    MappedFile() = delete;
+    MappedFile(const MappedFile&) = delete;
+    MappedFile(MappedFile&&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    MappedFile& operator=(MappedFile&&) = delete;
+    ~MappedFile();
+
+    const std::byte* GetData() const;
+    size_t GetSize() const;
+    // Zero-filled bytes that are still readable after the end of the file (rest of the last page).
+    size_t GetTailSlack() const;
+
+private:
+    HANDLE m_file;
+    HANDLE m_mapping;
+    const std::byte* m_data;
+    size_t m_size;
+    size_t m_tailSlack;
+};
+
+// Peak working set of the process so far, in bytes.
+size_t GetPeakWorkingSetSize();
+
+// 64 bit FNV-1a style hash over 8 byte words, for content keys (not cryptographic). Chain calls through seed.
+uint64_t HashBytes(const void* data, size_t size, uint64_t seed = 14695981039346656037ull);
+
+// Widest instruction set the CPU and the OS support, kernels with several SIMD paths dispatch on it.
+// AVX2 implies FMA and F16C, AVX512 means AVX-512F on top of AVX2.
+enum class SimdLevel : uint8_t {
+    Scalar,
+    SSE41,
+    AVX2,
+    AVX512,
+};
+
+// Queried once, the first call.
+SimdLevel GetSimdLevel();
+const char* GetSimdLevelName(SimdLevel level);
+
 // Helper functions
 void ThrowIfFailed(HRESULT hr);
 
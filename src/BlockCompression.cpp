@@ -0,0 +1,415 @@
+#include "BlockCompression.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <climits>
+#include <cmath>
+#include <cstring>
+
+namespace Anni {
+
+namespace {
+
+    // 16 texels of one 4x4 block
+    struct BlockTexels {
+        uint8_t rgba[16][4];
+    };
+
+    void FetchBlock(const uint8_t* rgba, const UINT width, const UINT height, const UINT block_x, const UINT block_y, BlockTexels& block)
+    {
+        for (UINT y = 0; y < 4; ++y) {
+            const UINT src_y = std::min(block_y * 4 + y, height - 1);
+            for (UINT x = 0; x < 4; ++x) {
+                const UINT src_x = std::min(block_x * 4 + x, width - 1);
+                memcpy(block.rgba[y * 4 + x], rgba + (static_cast<size_t>(src_y) * width + src_x) * 4, 4);
+            }
+        }
+    }
+
+    // Principal axis of the block's first N channels by power iteration on the covariance matrix.
+    // Returns the texels with the smallest and largest projection on it, which become the endpoints.
+    template <int N>
+    void FindEndpoints(const BlockTexels& block, int& min_texel, int& max_texel)
+    {
+        float mean[N] = {};
+        for (const auto& texel : block.rgba) {
+            for (int c = 0; c < N; ++c) {
+                mean[c] += texel[c];
+            }
+        }
+        for (float& m : mean) {
+            m /= 16.0f;
+        }
+
+        float covariance[N][N] = {};
+        for (const auto& texel : block.rgba) {
+            for (int i = 0; i < N; ++i) {
+                for (int j = 0; j < N; ++j) {
+                    covariance[i][j] += (texel[i] - mean[i]) * (texel[j] - mean[j]);
+                }
+            }
+        }
+
+        float axis[N];
+        std::fill_n(axis, N, 1.0f);
+        for (int iteration = 0; iteration < 8; ++iteration) {
+            float next[N] = {};
+            float length = 0.0f;
+            for (int i = 0; i < N; ++i) {
+                for (int j = 0; j < N; ++j) {
+                    next[i] += covariance[i][j] * axis[j];
+                }
+                length = std::max(length, std::abs(next[i]));
+            }
+            // flat block, any axis works
+            if (length < 1e-6f) {
+                break;
+            }
+            for (int i = 0; i < N; ++i) {
+                axis[i] = next[i] / length;
+            }
+        }
+
+        float min_projection = FLT_MAX;
+        float max_projection = -FLT_MAX;
+        min_texel = 0;
+        max_texel = 0;
+        for (int t = 0; t < 16; ++t) {
+            float projection = 0.0f;
+            for (int c = 0; c < N; ++c) {
+                projection += block.rgba[t][c] * axis[c];
+            }
+            if (projection < min_projection) {
+                min_projection = projection;
+                min_texel = t;
+            }
+            if (projection > max_projection) {
+                max_projection = projection;
+                max_texel = t;
+            }
+        }
+    }
+
+    template <int N>
+    int SquaredDistance(const uint8_t* a, const int* b)
+    {
+        int distance = 0;
+        for (int c = 0; c < N; ++c) {
+            const int d = a[c] - b[c];
+            distance += d * d;
+        }
+        return distance;
+    }
+
+    //> BC4
+    double EncodeBC4(const uint8_t (&values)[16], uint8_t* out)
+    {
+        const auto [lo_it, hi_it] = std::minmax_element(std::begin(values), std::end(values));
+        const int lo = *lo_it;
+        const int hi = *hi_it;
+
+        // red_0 > red_1 selects the 8 value palette
+        out[0] = static_cast<uint8_t>(hi);
+        out[1] = static_cast<uint8_t>(lo);
+        memset(out + 2, 0, 6);
+        if (hi == lo) {
+            return 0.0;
+        }
+
+        int palette[8] = { hi, lo };
+        for (int i = 2; i < 8; ++i) {
+            palette[i] = ((8 - i) * hi + (i - 1) * lo + 3) / 7;
+        }
+
+        uint64_t bits = 0;
+        double error = 0.0;
+        for (int t = 0; t < 16; ++t) {
+            int best_index = 0;
+            int best_distance = INT_MAX;
+            for (int i = 0; i < 8; ++i) {
+                const int distance = std::abs(values[t] - palette[i]);
+                if (distance < best_distance) {
+                    best_distance = distance;
+                    best_index = i;
+                }
+            }
+            bits |= static_cast<uint64_t>(best_index) << (3 * t);
+            error += best_distance * best_distance;
+        }
+
+        for (int i = 0; i < 6; ++i) {
+            out[2 + i] = static_cast<uint8_t>(bits >> (8 * i));
+        }
+        return error;
+    }
+
+    double EncodeBC4Channel(const BlockTexels& block, const int channel, uint8_t* out)
+    {
+        uint8_t values[16];
+        for (int t = 0; t < 16; ++t) {
+            values[t] = block.rgba[t][channel];
+        }
+        return EncodeBC4(values, out);
+    }
+    //< bc4
+
+    //> BC1
+    uint16_t PackRGB565(const uint8_t* rgb)
+    {
+        const int r = (rgb[0] * 31 + 127) / 255;
+        const int g = (rgb[1] * 63 + 127) / 255;
+        const int b = (rgb[2] * 31 + 127) / 255;
+        return static_cast<uint16_t>((r << 11) | (g << 5) | b);
+    }
+
+    void UnpackRGB565(const uint16_t packed, int* rgb)
+    {
+        const int r = (packed >> 11) & 31;
+        const int g = (packed >> 5) & 63;
+        const int b = packed & 31;
+        rgb[0] = (r << 3) | (r >> 2);
+        rgb[1] = (g << 2) | (g >> 4);
+        rgb[2] = (b << 3) | (b >> 2);
+    }
+
+    double EncodeBC1(const BlockTexels& block, uint8_t* out)
+    {
+        int min_texel, max_texel;
+        FindEndpoints<3>(block, min_texel, max_texel);
+
+        uint16_t color0 = PackRGB565(block.rgba[max_texel]);
+        uint16_t color1 = PackRGB565(block.rgba[min_texel]);
+        // color0 > color1 selects the opaque 4 color palette
+        if (color0 < color1) {
+            std::swap(color0, color1);
+        }
+
+        int palette[4][3];
+        UnpackRGB565(color0, palette[0]);
+        UnpackRGB565(color1, palette[1]);
+        for (int c = 0; c < 3; ++c) {
+            palette[2][c] = (2 * palette[0][c] + palette[1][c] + 1) / 3;
+            palette[3][c] = (palette[0][c] + 2 * palette[1][c] + 1) / 3;
+        }
+        const int palette_size = color0 == color1 ? 1 : 4;
+
+        uint32_t bits = 0;
+        double error = 0.0;
+        for (int t = 0; t < 16; ++t) {
+            int best_index = 0;
+            int best_distance = INT_MAX;
+            for (int i = 0; i < palette_size; ++i) {
+                const int distance = SquaredDistance<3>(block.rgba[t], palette[i]);
+                if (distance < best_distance) {
+                    best_distance = distance;
+                    best_index = i;
+                }
+            }
+            bits |= static_cast<uint32_t>(best_index) << (2 * t);
+            error += best_distance;
+        }
+
+        out[0] = static_cast<uint8_t>(color0);
+        out[1] = static_cast<uint8_t>(color0 >> 8);
+        out[2] = static_cast<uint8_t>(color1);
+        out[3] = static_cast<uint8_t>(color1 >> 8);
+        memcpy(out + 4, &bits, 4);
+        return error;
+    }
+    //< bc1
+
+    //> BC7
+    // Mode 6 only: one subset, 7 bit RGBA endpoints with a p-bit each and 4 bit indices.
+    // It is the mode that suits smooth photographic albedo best and keeps the encoder simple.
+    constexpr int BC7_WEIGHTS_4[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+    class BitWriter128 {
+    public:
+        void Write(const uint32_t value, const int count)
+        {
+            for (int i = 0; i < count; ++i, ++m_position) {
+                if ((value >> i) & 1) {
+                    m_bytes[m_position / 8] |= static_cast<uint8_t>(1 << (m_position % 8));
+                }
+            }
+        }
+
+        void CopyTo(uint8_t* out) const
+        {
+            memcpy(out, m_bytes, 16);
+        }
+
+    private:
+        uint8_t m_bytes[16] = {};
+        int m_position = 0;
+    };
+
+    // best 7 bit + p-bit representation of one endpoint
+    void QuantizeEndpointMode6(const uint8_t* texel, int* quantized, int& p_bit)
+    {
+        int best_error = INT_MAX;
+        for (int p = 0; p < 2; ++p) {
+            int candidate[4];
+            int error = 0;
+            for (int c = 0; c < 4; ++c) {
+                candidate[c] = std::clamp((texel[c] - p + 1) / 2, 0, 127);
+                const int d = texel[c] - ((candidate[c] << 1) | p);
+                error += d * d;
+            }
+            if (error < best_error) {
+                best_error = error;
+                p_bit = p;
+                std::copy_n(candidate, 4, quantized);
+            }
+        }
+    }
+
+    double EncodeBC7(const BlockTexels& block, uint8_t* out)
+    {
+        int min_texel, max_texel;
+        FindEndpoints<4>(block, min_texel, max_texel);
+
+        int endpoints[2][4];
+        int p_bits[2];
+        QuantizeEndpointMode6(block.rgba[min_texel], endpoints[0], p_bits[0]);
+        QuantizeEndpointMode6(block.rgba[max_texel], endpoints[1], p_bits[1]);
+
+        int palette[16][4];
+        for (int c = 0; c < 4; ++c) {
+            const int e0 = (endpoints[0][c] << 1) | p_bits[0];
+            const int e1 = (endpoints[1][c] << 1) | p_bits[1];
+            for (int i = 0; i < 16; ++i) {
+                palette[i][c] = ((64 - BC7_WEIGHTS_4[i]) * e0 + BC7_WEIGHTS_4[i] * e1 + 32) >> 6;
+            }
+        }
+
+        int indices[16];
+        double error = 0.0;
+        for (int t = 0; t < 16; ++t) {
+            int best_distance = INT_MAX;
+            for (int i = 0; i < 16; ++i) {
+                const int distance = SquaredDistance<4>(block.rgba[t], palette[i]);
+                if (distance < best_distance) {
+                    best_distance = distance;
+                    indices[t] = i;
+                }
+            }
+            error += best_distance;
+        }
+
+        // the anchor index is stored without its top bit, so it has to be in the lower half
+        if (indices[0] & 8) {
+            std::swap(endpoints[0], endpoints[1]);
+            std::swap(p_bits[0], p_bits[1]);
+            for (int& index : indices) {
+                index = 15 - index;
+            }
+        }
+
+        BitWriter128 writer;
+        writer.Write(1u << 6, 7);
+        for (int c = 0; c < 4; ++c) {
+            writer.Write(endpoints[0][c], 7);
+            writer.Write(endpoints[1][c], 7);
+        }
+        writer.Write(p_bits[0], 1);
+        writer.Write(p_bits[1], 1);
+        writer.Write(indices[0], 3);
+        for (int t = 1; t < 16; ++t) {
+            writer.Write(indices[t], 4);
+        }
+        writer.CopyTo(out);
+        return error;
+    }
+    //< bc7
+
+}
+
+DXGI_FORMAT SelectBlockCompressedFormat(const TextureRole role)
+{
+    switch (role) {
+    case TextureRole::Occlusion:
+        return DXGI_FORMAT_BC4_UNORM;
+    case TextureRole::MetalRough:
+        return DXGI_FORMAT_BC1_UNORM;
+    case TextureRole::NormalMap:
+        return DXGI_FORMAT_BC5_UNORM;
+    case TextureRole::Color:
+    case TextureRole::Unused:
+    default:
+        return DXGI_FORMAT_BC7_UNORM;
+    }
+}
+
+bool CanBlockCompress(const UINT width, const UINT height)
+{
+    return width % 4 == 0 && height % 4 == 0;
+}
+
+UINT GetBlockBytes(const DXGI_FORMAT format)
+{
+    return format == DXGI_FORMAT_BC1_UNORM || format == DXGI_FORMAT_BC4_UNORM ? 8 : 16;
+}
+
+UINT GetBlockCompressedChannelCount(const DXGI_FORMAT format)
+{
+    switch (format) {
+    case DXGI_FORMAT_BC4_UNORM:
+        return 1;
+    case DXGI_FORMAT_BC5_UNORM:
+        return 2;
+    case DXGI_FORMAT_BC1_UNORM:
+        return 3;
+    default:
+        return 4;
+    }
+}
+
+UINT GetBlockCompressedRowPitch(const UINT width, const DXGI_FORMAT format)
+{
+    return (width + 3) / 4 * GetBlockBytes(format);
+}
+
+size_t GetBlockCompressedSize(const UINT width, const UINT height, const DXGI_FORMAT format)
+{
+    return static_cast<size_t>(GetBlockCompressedRowPitch(width, format)) * ((height + 3) / 4);
+}
+
+double BlockCompressLevel(const uint8_t* rgba, const UINT width, const UINT height, const DXGI_FORMAT format, uint8_t* blocks)
+{
+    const UINT blocks_wide = (width + 3) / 4;
+    const UINT blocks_high = (height + 3) / 4;
+    const UINT block_bytes = GetBlockBytes(format);
+
+    double error = 0.0;
+    BlockTexels block;
+    for (UINT block_y = 0; block_y < blocks_high; ++block_y) {
+        for (UINT block_x = 0; block_x < blocks_wide; ++block_x) {
+            FetchBlock(rgba, width, height, block_x, block_y, block);
+            uint8_t* out = blocks + (static_cast<size_t>(block_y) * blocks_wide + block_x) * block_bytes;
+
+            switch (format) {
+            case DXGI_FORMAT_BC1_UNORM:
+                error += EncodeBC1(block, out);
+                break;
+            case DXGI_FORMAT_BC4_UNORM:
+                error += EncodeBC4Channel(block, 0, out);
+                break;
+            case DXGI_FORMAT_BC5_UNORM:
+                error += EncodeBC4Channel(block, 0, out);
+                error += EncodeBC4Channel(block, 1, out + 8);
+                break;
+            case DXGI_FORMAT_BC7_UNORM:
+                error += EncodeBC7(block, out);
+                break;
+            default:
+                assert(false);
+            }
+        }
+    }
+
+    // partial blocks repeat edge texels, only count the real ones
+    return error * (static_cast<double>(width) * height) / (static_cast<double>(blocks_wide) * blocks_high * 16);
+}
+
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include "AnniUtils.h"
+
+#include <cstdint>
+
+namespace Anni {
+
+// CPU BC1/BC4/BC5/BC7 encoders for R8G8B8A8 images.
+
+// How materials use an image, ordered by precedence: an image shared by several roles is compressed for the
+// highest one.
+enum class TextureRole {
+    Unused,
+    Occlusion,
+    MetalRough,
+    NormalMap,
+    Color,
+};
+
+// Bump whenever the encoders change output, cached blocks of older versions are ignored.
+constexpr UINT32 BLOCK_COMPRESSION_VERSION = 1;
+
+// BC7 for color, BC5 for normal maps (the shader rebuilds z), BC1 for metal-rough, BC4 for occlusion.
+DXGI_FORMAT SelectBlockCompressedFormat(TextureRole role);
+
+// Block compressed textures need a base level made of whole blocks.
+bool CanBlockCompress(UINT width, UINT height);
+
+// Bytes per 4x4 block, 8 for BC1/BC4 and 16 for BC5/BC7.
+UINT GetBlockBytes(DXGI_FORMAT format);
+
+// Channels of the source an encoder keeps (BC4: r, BC5: rg, BC1: rgb, BC7: rgba).
+UINT GetBlockCompressedChannelCount(DXGI_FORMAT format);
+
+UINT GetBlockCompressedRowPitch(UINT width, DXGI_FORMAT format);
+size_t GetBlockCompressedSize(UINT width, UINT height, DXGI_FORMAT format);
+
+// Encodes one tightly packed level of any size (partial blocks repeat the edge texels).
+// Returns the summed squared error of the kept channels, for PSNR reporting.
+double BlockCompressLevel(const uint8_t* rgba, UINT width, UINT height, DXGI_FORMAT format, uint8_t* blocks);
+
+}
@@ -0,0 +1,112 @@
+#include "Bounds.h"
+
+#include <xmmintrin.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+
+namespace Anni {
+
+namespace {
+
+    static_assert(offsetof(StandardVertex, position) == 0 && sizeof(StandardVertex) >= 16, "LoadPosition reads the first 16 bytes of a vertex");
+
+    // x, y, z in the low lanes, the w lane holds the bits of the packed normal and is never used
+    __m128 LoadPosition(const StandardVertex& vertex)
+    {
+        return _mm_loadu_ps(&vertex.position.x);
+    }
+
+    float HorizontalMax(const __m128 v)
+    {
+        const __m128 pairs = _mm_max_ps(v, _mm_movehl_ps(v, v));
+        return _mm_cvtss_f32(_mm_max_ss(pairs, _mm_shuffle_ps(pairs, pairs, _MM_SHUFFLE(1, 1, 1, 1))));
+    }
+
+}
+
+Bounds ComputeBounds(const StandardVertex* vertices, const size_t count)
+{
+    assert(count > 0);
+
+    //> box
+    // four independent chains hide the latency of minps and maxps
+    __m128 min0 = LoadPosition(vertices[0]);
+    __m128 min1 = min0, min2 = min0, min3 = min0;
+    __m128 max0 = min0, max1 = min0, max2 = min0, max3 = min0;
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        const __m128 p0 = LoadPosition(vertices[i]);
+        const __m128 p1 = LoadPosition(vertices[i + 1]);
+        const __m128 p2 = LoadPosition(vertices[i + 2]);
+        const __m128 p3 = LoadPosition(vertices[i + 3]);
+        min0 = _mm_min_ps(min0, p0);
+        min1 = _mm_min_ps(min1, p1);
+        min2 = _mm_min_ps(min2, p2);
+        min3 = _mm_min_ps(min3, p3);
+        max0 = _mm_max_ps(max0, p0);
+        max1 = _mm_max_ps(max1, p1);
+        max2 = _mm_max_ps(max2, p2);
+        max3 = _mm_max_ps(max3, p3);
+    }
+    for (; i < count; ++i) {
+        const __m128 p = LoadPosition(vertices[i]);
+        min0 = _mm_min_ps(min0, p);
+        max0 = _mm_max_ps(max0, p);
+    }
+    alignas(16) float box_min[4];
+    alignas(16) float box_max[4];
+    _mm_store_ps(box_min, _mm_min_ps(_mm_min_ps(min0, min1), _mm_min_ps(min2, min3)));
+    _mm_store_ps(box_max, _mm_max_ps(_mm_max_ps(max0, max1), _mm_max_ps(max2, max3)));
+
+    Bounds bounds;
+    const glm::vec3 lo(box_min[0], box_min[1], box_min[2]);
+    const glm::vec3 hi(box_max[0], box_max[1], box_max[2]);
+    bounds.origin = (lo + hi) * 0.5f;
+    bounds.extents = (hi - lo) * 0.5f;
+    //< box
+
+    //> sphere
+    // Four positions are transposed into x, y and z registers so one register holds four squared distances.
+    const __m128 origin_x = _mm_set1_ps(bounds.origin.x);
+    const __m128 origin_y = _mm_set1_ps(bounds.origin.y);
+    const __m128 origin_z = _mm_set1_ps(bounds.origin.z);
+    __m128 max_distance = _mm_setzero_ps();
+    i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128 x = LoadPosition(vertices[i]);
+        __m128 y = LoadPosition(vertices[i + 1]);
+        __m128 z = LoadPosition(vertices[i + 2]);
+        __m128 w = LoadPosition(vertices[i + 3]);
+        _MM_TRANSPOSE4_PS(x, y, z, w);
+        const __m128 dx = _mm_sub_ps(x, origin_x);
+        const __m128 dy = _mm_sub_ps(y, origin_y);
+        const __m128 dz = _mm_sub_ps(z, origin_z);
+        const __m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+        max_distance = _mm_max_ps(max_distance, distance);
+    }
+    float radius_squared = HorizontalMax(max_distance);
+    for (; i < count; ++i) {
+        const glm::vec3 d = vertices[i].position - bounds.origin;
+        radius_squared = std::max(radius_squared, glm::dot(d, d));
+    }
+    bounds.sphereRadius = std::sqrt(radius_squared);
+    //< sphere
+
+    return bounds;
+}
+
+Bounds TransformBounds(const Bounds& bounds, const glm::mat4& transform)
+{
+    const glm::mat3 linear(transform);
+
+    Bounds result;
+    result.origin = glm::vec3(transform * glm::vec4(bounds.origin, 1.0f));
+    result.extents = glm::abs(linear[0]) * bounds.extents.x + glm::abs(linear[1]) * bounds.extents.y + glm::abs(linear[2]) * bounds.extents.z;
+    result.sphereRadius = bounds.sphereRadius * std::max({ glm::length(linear[0]), glm::length(linear[1]), glm::length(linear[2]) });
+    return result;
+}
+
+}
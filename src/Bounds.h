@@ -0,0 +1,15 @@
+#pragma once
+
+#include "ModelData.h"
+
+namespace Anni {
+
+// Axis aligned box and bounding sphere sharing one center, the box center.
+
+// Reduces the positions of count vertices, four at a time with SSE. count must not be 0.
+Bounds ComputeBounds(const StandardVertex* vertices, size_t count);
+
+// Bounds of the transformed box (Arvo 1990), the sphere grows with the largest scale of transform.
+Bounds TransformBounds(const Bounds& bounds, const glm::mat4& transform);
+
+}
@@ -1,4 +1,7 @@
 #include "Camera.h"
+
+#include "MatrixKernels.h"
+
 namespace Anni {
 
 Camera::Camera()
@@ -39,11 +42,9 @@ void Camera::Get3DViewProjMatricesForPointLight(std::array<glm::mat4, 6>* p_proj
 
     const float fovAngleY = glm::radians(fov_in_degrees);
 
-    for (auto& light_proj_matrix : proj_matrices) {
-        light_proj_matrix = glm::perspectiveFovLH_ZO(fovAngleY, screen_width, screen_height, znear, zfar);
-        // һdxУhlslϲߣû취ֻתһ
-        light_proj_matrix = glm::transpose(light_proj_matrix);
-    }
+    // the same projection for every face
+    // һdxУhlslϲߣû취ֻתһ
+    proj_matrices.fill(glm::transpose(glm::perspectiveFovLH_ZO(fovAngleY, screen_width, screen_height, znear, zfar)));
 
     view_matrices[0] = glm::lookAtLH(glm::vec3(eye), glm::vec3(eye) + glm::vec3(1.f, 0., 0.f), glm::vec3(0.f, 1.f, 0.f));
     view_matrices[1] = glm::lookAtLH(glm::vec3(eye), glm::vec3(eye) + glm::vec3(-1.f, 0., 0.f), glm::vec3(0.f, 1.f, 0.f));
@@ -54,11 +55,8 @@ void Camera::Get3DViewProjMatricesForPointLight(std::array<glm::mat4, 6>* p_proj
     view_matrices[4] = glm::lookAtLH(glm::vec3(eye), glm::vec3(eye) + glm::vec3(0.f, 0., 1.f), glm::vec3(0.f, 1.f, 0.f));
     view_matrices[5] = glm::lookAtLH(glm::vec3(eye), glm::vec3(eye) + glm::vec3(0.f, 0., -1.f), glm::vec3(0.f, 1.f, 0.f));
 
-	for (auto& light_view_matrix : view_matrices )
-	{
-        // һdxУhlslϲߣû취ֻתһ
-        light_view_matrix = glm::transpose(light_view_matrix);
-	}
+    // һdxУhlslϲߣû취ֻתһ
+    TransposeMatrices(view_matrices.data(), view_matrices.size());
 }
 
 // void Camera::RotateYaw(float deg)
@@ -0,0 +1,144 @@
+#include "ClusterCulling.h"
+
+#include <algorithm>
+#include <limits>
+
+namespace Anni {
+
+Frustum ExtractFrustum(const glm::mat4& view_proj)
+{
+    // rows of the matrix, glm stores columns
+    const auto row = [&](const int i) {
+        return glm::vec4(view_proj[0][i], view_proj[1][i], view_proj[2][i], view_proj[3][i]);
+    };
+
+    Frustum frustum;
+    frustum.planes[0] = row(3) + row(0); // left
+    frustum.planes[1] = row(3) - row(0); // right
+    frustum.planes[2] = row(3) + row(1); // bottom
+    frustum.planes[3] = row(3) - row(1); // top
+    frustum.planes[4] = row(2); // near, z >= 0
+    frustum.planes[5] = row(3) - row(2); // far
+
+    for (glm::vec4& plane : frustum.planes) {
+        plane /= glm::length(glm::vec3(plane));
+    }
+    return frustum;
+}
+
+void CullMeshlets(const Meshlet* meshlets, const size_t meshlet_count, const glm::mat4& world,
+    const std::span<const ClusterCullView> views, uint8_t* visibility_masks, ClusterCullStats& stats)
+{
+    assert(views.size() <= CLUSTER_CULL_MAX_VIEWS);
+
+    const glm::mat3 linear(world);
+    const float scale_x = glm::length(linear[0]);
+    const float scale_y = glm::length(linear[1]);
+    const float scale_z = glm::length(linear[2]);
+    const float max_scale = std::max({ scale_x, scale_y, scale_z });
+    const float min_scale = std::min({ scale_x, scale_y, scale_z });
+    // the cone only survives rotation, uniform scale and translation
+    const bool cone_test = max_scale - min_scale <= 0.01f * max_scale && glm::determinant(linear) > 0.0f;
+
+    for (size_t m = 0; m < meshlet_count; ++m) {
+        const Meshlet& meshlet = meshlets[m];
+        const glm::vec3 center = glm::vec3(world * glm::vec4(meshlet.center, 1.0f));
+        const float radius = meshlet.radius * max_scale;
+        const bool has_cone = cone_test && meshlet.cone_cutoff <= 1.0f;
+        glm::vec3 apex(0.0f);
+        glm::vec3 axis(0.0f);
+        if (has_cone) {
+            apex = glm::vec3(world * glm::vec4(meshlet.cone_apex, 1.0f));
+            axis = glm::normalize(linear * meshlet.cone_axis);
+        }
+
+        uint8_t mask = 0;
+        bool in_any_frustum = false;
+        for (size_t v = 0; v < views.size(); ++v) {
+            const ClusterCullView& view = views[v];
+
+            bool inside = true;
+            for (const glm::vec4& plane : view.frustum.planes) {
+                if (glm::dot(glm::vec3(plane), center) + plane.w < -radius) {
+                    inside = false;
+                    break;
+                }
+            }
+            if (!inside) {
+                continue;
+            }
+            in_any_frustum = true;
+
+            if (has_cone) {
+                const glm::vec3 to_apex = apex - view.eye;
+                const float distance = glm::length(to_apex);
+                if (distance > 0.0f && glm::dot(to_apex, axis) >= meshlet.cone_cutoff * distance) {
+                    continue;
+                }
+            }
+            mask |= static_cast<uint8_t>(1u << v);
+        }
+        visibility_masks[m] = mask;
+
+        ++stats.meshlets_tested;
+        if (mask != 0) {
+            ++stats.meshlets_visible;
+        } else if (!in_any_frustum) {
+            ++stats.frustum_culled;
+        } else {
+            ++stats.backface_culled;
+        }
+    }
+}
+
+uint32_t SelectLod(const SurfaceLod* lods, const uint32_t lod_count, const Bounds& world_bounds, const glm::mat4& world,
+    const std::span<const ClusterCullView> views)
+{
+    if (lod_count <= 1) {
+        return 0;
+    }
+
+    const glm::mat3 linear(world);
+    const float max_scale = std::max({ glm::length(linear[0]), glm::length(linear[1]), glm::length(linear[2]) });
+
+    // the largest error, in world units, every view accepts
+    float allowed_error = std::numeric_limits<float>::max();
+    for (const ClusterCullView& view : views) {
+        if (view.lod_error_scale <= 0.0f) {
+            return 0;
+        }
+        const float distance = glm::length(world_bounds.origin - view.eye) - world_bounds.sphereRadius;
+        if (distance <= 0.0f) {
+            return 0;
+        }
+        allowed_error = std::min(allowed_error, distance / view.lod_error_scale);
+    }
+
+    uint32_t level = 0;
+    while (level + 1 < lod_count && lods[level + 1].error * max_scale <= allowed_error) {
+        ++level;
+    }
+    return level;
+}
+
+void AppendVisibleRanges(const Meshlet* meshlets, const size_t meshlet_count, const uint8_t* visibility_masks,
+    std::vector<IndexRange>& ranges)
+{
+    const size_t first_range = ranges.size();
+    for (size_t m = 0; m < meshlet_count; ++m) {
+        if (visibility_masks[m] == 0) {
+            continue;
+        }
+        const uint32_t index_count = meshlets[m].triangle_count * 3;
+        if (ranges.size() > first_range) {
+            IndexRange& last = ranges.back();
+            if (last.first_index + last.index_count == meshlets[m].first_index) {
+                last.index_count += index_count;
+                continue;
+            }
+        }
+        ranges.push_back({ meshlets[m].first_index, index_count });
+    }
+}
+
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include "AnniMath.h"
+#include "ModelData.h"
+
+#include <array>
+#include <span>
+#include <vector>
+
+namespace Anni {
+
+// CPU culling of meshlets against a few views at once, the camera or the six faces of a point light's cube map.
+
+// Planes with the normal pointing inside, a point p is inside a plane when dot(plane.xyz, p) + plane.w >= 0.
+struct Frustum {
+    std::array<glm::vec4, 6> planes;
+};
+
+// view_proj maps to D3D clip space (0 <= z <= w), column vector convention (clip = view_proj * p).
+Frustum ExtractFrustum(const glm::mat4& view_proj);
+
+struct ClusterCullView {
+    Frustum frustum;
+    glm::vec3 eye;
+    // Pixels one unit covers at distance one, divided by the screen error the view tolerates. A level of detail is
+    // fine for the view while error * lod_error_scale / distance <= 1, 0 keeps the full surfaces.
+    float lod_error_scale { 0.0f };
+};
+
+// One bit per view.
+constexpr size_t CLUSTER_CULL_MAX_VIEWS = 8;
+
+struct ClusterCullStats {
+    uint32_t meshlets_tested { 0 };
+    uint32_t meshlets_visible { 0 };
+    // rejected by every view's frustum
+    uint32_t frustum_culled { 0 };
+    // inside some frustum but back facing from every view it is inside of
+    uint32_t backface_culled { 0 };
+};
+
+// A run of consecutive visible meshlets, relative to the surface's first index.
+struct IndexRange {
+    uint32_t first_index;
+    uint32_t index_count;
+};
+
+// Writes, for every meshlet, the mask of views it may be visible in. world transforms the meshlets into the space of
+// the views; the normal cone test is skipped when it has non uniform scale or mirrors, the bounds stay conservative.
+void CullMeshlets(const Meshlet* meshlets, size_t meshlet_count, const glm::mat4& world,
+    std::span<const ClusterCullView> views, uint8_t* visibility_masks, ClusterCullStats& stats);
+
+// Coarsest of the lod_count levels whose error, after world's scale, stays within the budget of every view at the
+// distance of world_bounds' sphere. 0 when a view is inside the sphere or keeps the full surfaces.
+uint32_t SelectLod(const SurfaceLod* lods, uint32_t lod_count, const Bounds& world_bounds, const glm::mat4& world,
+    std::span<const ClusterCullView> views);
+
+// Merges the visible meshlets (non zero mask) into as few index ranges as possible, appended to ranges.
+void AppendVisibleRanges(const Meshlet* meshlets, size_t meshlet_count, const uint8_t* visibility_masks,
+    std::vector<IndexRange>& ranges);
+
+}
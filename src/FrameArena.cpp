@@ -0,0 +1,60 @@
+#include "FrameArena.h"
+
+#include <cassert>
+#include <cstdint>
+
+namespace Anni {
+
+FrameArena::FrameArena(const size_t capacity)
+    : m_block(capacity > 0 ? std::make_unique_for_overwrite<std::byte[]>(capacity) : nullptr)
+    , m_capacity(capacity)
+    , m_offset(0)
+    , m_overflowBytes(0)
+{
+}
+
+void* FrameArena::Allocate(const size_t size, const size_t alignment)
+{
+    assert(alignment > 0 && (alignment & (alignment - 1)) == 0);
+
+    if (m_block) {
+        const uintptr_t base = reinterpret_cast<uintptr_t>(m_block.get());
+        const uintptr_t aligned = (base + m_offset + alignment - 1) & ~(uintptr_t(alignment) - 1);
+        const size_t end = aligned - base + size;
+        if (end <= m_capacity) {
+            m_offset = end;
+            return reinterpret_cast<void*>(aligned);
+        }
+    }
+
+    // with room to align inside the block
+    const size_t overflow_size = size + alignment - 1;
+    m_overflowBlocks.push_back(std::make_unique_for_overwrite<std::byte[]>(overflow_size));
+    m_overflowBytes += overflow_size;
+    const uintptr_t base = reinterpret_cast<uintptr_t>(m_overflowBlocks.back().get());
+    return reinterpret_cast<void*>((base + alignment - 1) & ~(uintptr_t(alignment) - 1));
+}
+
+void FrameArena::Reset()
+{
+    if (!m_overflowBlocks.empty()) {
+        // everything the frame used fits in one block from now on
+        m_capacity = m_offset + m_overflowBytes;
+        m_block = std::make_unique_for_overwrite<std::byte[]>(m_capacity);
+        m_overflowBlocks.clear();
+        m_overflowBytes = 0;
+    }
+    m_offset = 0;
+}
+
+size_t FrameArena::GetCapacity() const
+{
+    return m_capacity;
+}
+
+size_t FrameArena::GetUsed() const
+{
+    return m_offset + m_overflowBytes;
+}
+
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+namespace Anni {
+
+// Linear allocator for memory that lives for one frame. Allocations bump an offset into one block and are all freed
+// together by Reset. A frame that needs more than the block gets the rest from the heap, the next Reset grows the
+// block to what that frame used, so once the frames stop growing the arena no longer touches the heap.
+class FrameArena {
+public:
+    explicit FrameArena(size_t capacity = 0);
+    FrameArena(const FrameArena&) = delete;
+    FrameArena(FrameArena&&) = delete;
+    FrameArena& operator=(const FrameArena&) = delete;
+    FrameArena& operator=(FrameArena&&) = delete;
+    ~FrameArena() = default;
+
+    // size bytes aligned to alignment (a power of two), valid until the next Reset
+    void* Allocate(size_t size, size_t alignment);
+
+    // Uninitialized room for count objects, nothing is destroyed on Reset.
+    template <typename T>
+    T* AllocateArray(const size_t count)
+    {
+        static_assert(std::is_trivially_copyable_v<T> && std::is_trivially_destructible_v<T>);
+        return static_cast<T*>(Allocate(sizeof(T) * count, alignof(T)));
+    }
+
+    void Reset();
+
+    size_t GetCapacity() const;
+    // bytes allocated since the last Reset, alignment padding included
+    size_t GetUsed() const;
+
+private:
+    std::unique_ptr<std::byte[]> m_block;
+    size_t m_capacity;
+    size_t m_offset;
+
+    // allocations that did not fit, freed by the next Reset
+    std::vector<std::unique_ptr<std::byte[]>> m_overflowBlocks;
+    size_t m_overflowBytes;
+};
+
+}
@@ -1,5 +1,9 @@
 #include "FrameResource.h"
 
+#include "HeapAllocationCounter.h"
+
+#include <chrono>
+
 //**********************************************************************************
 // frames infight(2) < back buffer count(3)
 // frames           :0 1 2 3 4 5 6 7 8
@@ -17,6 +21,7 @@ namespace Anni {
 FrameResource::FrameResource(
     ID3D12Device* pp_device,
     IDXGISwapChain3* pp_swapChain,
+    ResourceHeapAllocator& heap_allocator,
 
     IDxcUtils* dxc_utils,
     IDxcCompiler* dxc_compiler,
@@ -28,9 +33,11 @@ FrameResource::FrameResource(
     GltfModel& sponza,
     GltfModel& METAX,
     const D3D12_VIEWPORT& viewport,
-    const D3D12_RECT& scissor_rect)
+    const D3D12_RECT& scissor_rect,
+    const UINT frame_index)
     : m_pp_device(pp_device)
     , m_pp_swapChain(pp_swapChain)
+    , m_heapAllocator(&heap_allocator)
     , m_dxcUtils(dxc_utils)
     , m_dxcCompiler(dxc_compiler)
     , m_includeHandler(include_handler)
@@ -39,8 +46,10 @@ FrameResource::FrameResource(
     , m_backBufferRenderTargetViews(back_buffer_rendertarget_views)
     , m_mappedSceneConstantBuffer(nullptr)
     , m_mappedLightConstantBuffer(nullptr)
+    , m_frameIndex(frame_index)
     , m_sponza(sponza)
     , m_METAX(METAX)
+    , m_recordedFrames(0)
     , m_viewPort(viewport)
     , m_scissorRect(scissor_rect)
     , m_cbvSrvUavIncrementSize(pp_device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV))
@@ -56,6 +65,14 @@ FrameResource::FrameResource(
     InitScenePass();
     SetupLights();
     SetupCamera();
+
+    // the cluster culling scratch never grows during a frame
+    uint32_t max_meshlet_count = 0;
+    for (const RenderObject& render_object : m_sponza.m_draw_ctx.OpaqueSurfaces) {
+        max_meshlet_count = std::max(max_meshlet_count, render_object.meshlet_count);
+    }
+    m_meshletVisibility.reserve(max_meshlet_count);
+    m_visibleRanges.reserve(max_meshlet_count);
 }
 
 void FrameResource::RecordCommandsAndExecute(ID3D12CommandQueue* direct_queue)
@@ -72,7 +89,34 @@ void FrameResource::RecordCommandsAndExecute(ID3D12CommandQueue* direct_queue)
         WaitForSingleObjectEx(m_fenceEventFrame, INFINITE, FALSE);  // CPU޵ȴ
     }
 
+    // after the first frames every list has the room it needs, recording one must not touch the heap anymore
+    const NoHeapAllocationScope frame_allocations("RecordCommandsAndExecute", m_recordedFrames >= ALLOCATION_FREE_FRAME_WARMUP);
+    ++m_recordedFrames;
+
     OnUpdatePerFrame();
+    // only the RenderObjects below nodes that moved are refreshed
+    m_sponza.UpdateTransforms(m_frameIndex);
+    m_clusterCullStats = {};
+
+    // RenderObject i of the frame's list is RenderObject i of the model, it uses the i-th local matrix CBV of the frame's slice
+    DrawContext& draw_ctx = m_sceneDrawList.Begin();
+    constexpr glm::mat4 top_matrix_on_model = glm::mat4(1.0);
+    m_sponza.Draw(top_matrix_on_model, draw_ctx);
+    assert(draw_ctx.OpaqueSurfaces.size() == m_sponza.GetNumberOfMatricesRenderObjects());
+
+    // the scene pass draws only the RenderObjects whose box reaches into the camera's frustum, in list order
+    uint32_t* visible_objects = draw_ctx.Scratch.AllocateArray<uint32_t>(draw_ctx.OpaqueBounds.size());
+    const auto cull_begin = std::chrono::steady_clock::now();
+    const size_t visible_object_count = CullBounds(draw_ctx.OpaqueBounds.data(), draw_ctx.OpaqueBounds.size(), m_cameraCullView.frustum, visible_objects);
+    const auto cull_end = std::chrono::steady_clock::now();
+
+    const uint32_t tested_objects = static_cast<uint32_t>(draw_ctx.OpaqueBounds.size());
+    m_objectCullStats = {
+        .objects_tested = tested_objects,
+        .objects_visible = static_cast<uint32_t>(visible_object_count),
+        .objects_culled = tested_objects - static_cast<uint32_t>(visible_object_count),
+        .ns_per_object = tested_objects > 0 ? std::chrono::duration<float, std::nano>(cull_end - cull_begin).count() / tested_objects : 0.0f,
+    };
 
     // GET BACK BUFFER INDEX:
     // GetCurrentBackBufferIndex: It's just a counter that increments every time you call Present()
@@ -158,14 +202,21 @@ void FrameResource::RecordCommandsAndExecute(ID3D12CommandQueue* direct_queue)
     //   objects per worker (i.e. every object such that objectnum %
     //   NumContexts == threadIndex).
 
-    for (auto&& [index, render_object] : std::ranges::views::enumerate(m_sponza.m_draw_ctx.OpaqueSurfaces)) {
+    // every model shares the geometry pool, its vertex buffer is bound once for the whole pass and its index buffer
+    // again whenever the index format changes
+    p_command_list->IASetVertexBuffers(0, 1, &m_sponza.GetGeometryPool().GetVertexBufferView());
+    DXGI_FORMAT bound_index_format = DXGI_FORMAT_UNKNOWN;
+
+    for (auto&& [index, render_object] : std::ranges::views::enumerate(draw_ctx.OpaqueSurfaces)) {
         // if (render_object.material_index == -1) {
         //     assert(false, "취һnull materialindexȫinvalidȻȫðɫȾ߾ҪٸһPSOרģͿȫɫ");
         // }
-        p_command_list->SetGraphicsRootDescriptorTable(0, m_sponza.GetGPUDescHandleToLocalMatricesBuffer().Offset(index, m_cbvSrvUavIncrementSize));
-        p_command_list->IASetVertexBuffers(0, 1, &render_object.vertex_buffer_view);
-        p_command_list->IASetIndexBuffer(&render_object.index_buffer_view);
-        p_command_list->DrawIndexedInstanced(render_object.index_count, 1, render_object.first_index, 0, 0);
+        p_command_list->SetGraphicsRootDescriptorTable(0, m_sponza.GetGPUDescHandleToLocalMatricesBuffer(m_frameIndex).Offset(index, m_cbvSrvUavIncrementSize));
+        if (render_object.index_format != bound_index_format) {
+            bound_index_format = render_object.index_format;
+            p_command_list->IASetIndexBuffer(&m_sponza.GetGeometryPool().GetIndexBufferView(bound_index_format));
+        }
+        DrawRenderObject(p_command_list, render_object, m_shadowCullViews);
     }
 
     // ************************************************************
@@ -215,6 +266,9 @@ void FrameResource::RecordCommandsAndExecute(ID3D12CommandQueue* direct_queue)
     //   objects per worker (i.e. every object such that objectnum %
     //   NumContexts == threadIndex).
 
+    p_command_list->IASetVertexBuffers(0, 1, &m_sponza.GetGeometryPool().GetVertexBufferView());
+    bound_index_format = DXGI_FORMAT_UNKNOWN;
+
     // sponza drawing
     {
         p_command_list->SetGraphicsRootDescriptorTable(2, m_sponza.GetGPUDescHandleToMaterialConstantsBuffer());
@@ -223,21 +277,23 @@ void FrameResource::RecordCommandsAndExecute(ID3D12CommandQueue* direct_queue)
         // bindless sampelrs for model
         p_command_list->SetGraphicsRootDescriptorTable(8, m_sponza.GetGPUDescHandleToSamplers());
 
-        for (auto&& [index, render_object] : std::ranges::views::enumerate(m_sponza.m_draw_ctx.OpaqueSurfaces)) {
+        for (const uint32_t index : std::span(visible_objects, visible_object_count)) {
+            const RenderObject& render_object = draw_ctx.OpaqueSurfaces[index];
             // if (render_object.material_index == -1) {
             //     assert(false, "취һnull materialindexȫinvalidȻȫðɫȾ߾ҪٸһPSOרģͿȫɫ");
             // }
-            p_command_list->IASetVertexBuffers(0, 1, &render_object.vertex_buffer_view);
-            p_command_list->IASetIndexBuffer(&render_object.index_buffer_view);
-
             // The change made to a root constant will **BE RECORDED INTO THE COMMAND LIST**, makes a root constant very suitable for samll, very dynamic data(changing very draw call)
             p_command_list->SetGraphicsRoot32BitConstant(0, render_object.material_index, 0);
             // material constant structured bindlss buffer
 
             // Local matrices buffer, change every draw call by creating as many views as number of the matrices. But we still only got on big buffer for all matrices
-            p_command_list->SetGraphicsRootDescriptorTable(1, m_sponza.GetGPUDescHandleToLocalMatricesBuffer().Offset(index, m_cbvSrvUavIncrementSize));
+            p_command_list->SetGraphicsRootDescriptorTable(1, m_sponza.GetGPUDescHandleToLocalMatricesBuffer(m_frameIndex).Offset(index, m_cbvSrvUavIncrementSize));
 
-            p_command_list->DrawIndexedInstanced(render_object.index_count, 1, render_object.first_index, 0, 0);
+            if (render_object.index_format != bound_index_format) {
+                bound_index_format = render_object.index_format;
+                p_command_list->IASetIndexBuffer(&m_sponza.GetGeometryPool().GetIndexBufferView(bound_index_format));
+            }
+            DrawRenderObject(p_command_list, render_object, std::span(&m_cameraCullView, 1));
         }
     }
 
@@ -245,7 +301,7 @@ void FrameResource::RecordCommandsAndExecute(ID3D12CommandQueue* direct_queue)
 
     ThrowIfFailed(p_command_list->Close());
 
-    const std::vector<ID3D12CommandList*> submitted_commands { m_commandLists[thread_index].Get() };
+    const std::array<ID3D12CommandList*, 1> submitted_commands { m_commandLists[thread_index].Get() };
     direct_queue->ExecuteCommandLists(1, submitted_commands.data());
 
     //  {
@@ -468,6 +524,53 @@ void FrameResource::OnUpdatePerFrame()
 
     memcpy(m_mappedLightConstantBuffer, &m_lightConstBufferCpuSide, sizeof(m_lightConstBufferCpuSide));
     memcpy(m_mappedSceneConstantBuffer, &m_sceneConstBufferCpuSide, sizeof(m_sceneConstBufferCpuSide));
+
+    // the constant buffers hold transposed matrices for hlsl
+    m_cameraCullView.frustum = ExtractFrustum(glm::transpose(m_sceneConstBufferCpuSide.projection) * glm::transpose(m_sceneConstBufferCpuSide.view));
+    m_cameraCullView.eye = glm::vec3(m_camera.eye);
+    // projection[1][1] is 1 / tan(fovy / 2), half the viewport height spans that many units at distance one
+    m_cameraCullView.lod_error_scale = m_sceneConstBufferCpuSide.projection[1][1] * 0.5f * m_viewPort.Height / LOD_MAX_SCREEN_ERROR;
+    for (size_t face = 0; face < m_shadowCullViews.size(); ++face) {
+        const LightState& light = m_lightConstBufferCpuSide.lights[0];
+        m_shadowCullViews[face].frustum = ExtractFrustum(glm::transpose(light.projection[face]) * glm::transpose(light.view[face]));
+        m_shadowCullViews[face].eye = glm::vec3(light.position);
+        m_shadowCullViews[face].lod_error_scale = light.projection[face][1][1] * 0.5f * ShadowMapDimension / SHADOW_LOD_MAX_SCREEN_ERROR;
+    }
+}
+
+const ClusterCullStats& FrameResource::GetClusterCullStats() const
+{
+    return m_clusterCullStats;
+}
+
+const ObjectCullStats& FrameResource::GetObjectCullStats() const
+{
+    return m_objectCullStats;
+}
+
+void FrameResource::DrawRenderObject(ID3D12GraphicsCommandList* p_command_list, const RenderObject& render_object, const std::span<const ClusterCullView> views)
+{
+    // the meshlets only cover the full surface, a simplified level is drawn whole
+    const uint32_t level = SelectLod(render_object.lods, render_object.lod_count, render_object.world_bounds, render_object.final_transform, views);
+    if (level > 0) {
+        const SurfaceLod& lod = render_object.lods[level];
+        p_command_list->DrawIndexedInstanced(lod.count, 1, render_object.first_index + lod.startIndex - render_object.lods[0].startIndex, render_object.base_vertex, 0);
+        return;
+    }
+
+    if (!CPU_CLUSTER_CULLING || render_object.meshlet_count == 0) {
+        p_command_list->DrawIndexedInstanced(render_object.index_count, 1, render_object.first_index, render_object.base_vertex, 0);
+        return;
+    }
+
+    m_meshletVisibility.resize(render_object.meshlet_count);
+    CullMeshlets(render_object.meshlets, render_object.meshlet_count, render_object.final_transform, views, m_meshletVisibility.data(), m_clusterCullStats);
+
+    m_visibleRanges.clear();
+    AppendVisibleRanges(render_object.meshlets, render_object.meshlet_count, m_meshletVisibility.data(), m_visibleRanges);
+    for (const IndexRange& range : m_visibleRanges) {
+        p_command_list->DrawIndexedInstanced(range.index_count, 1, render_object.first_index + range.first_index, render_object.base_vertex, 0);
+    }
 }
 
 void FrameResource::InitCommandLists()
@@ -515,7 +618,7 @@ void FrameResource::InitDescriptorHeap()
     {
         D3D12_DESCRIPTOR_HEAP_DESC cbv_srv_uav_desc = {};
         // shadow map SRV + unbouned material constants buffer(bunch of indices used by meshes) + unbouned number of SRVs of textures
-        cbv_srv_uav_desc.NumDescriptors = 1 + m_sponza.GetNumberOfTextures() + m_sponza.GetNumberOfMaterial() + TEMP_LOCAL_MATRICES_CBV_COUNT + m_METAX.GetNumberOfTextures() + m_METAX.GetNumberOfMaterial() + TEMP_LOCAL_MATRICES_CBV_COUNT;
+        cbv_srv_uav_desc.NumDescriptors = 1 + m_sponza.GetNumberOfTextures() + m_sponza.GetNumberOfMaterial() + FRAME_INFLIGHT_COUNT * TEMP_LOCAL_MATRICES_CBV_COUNT + m_METAX.GetNumberOfTextures() + m_METAX.GetNumberOfMaterial() + FRAME_INFLIGHT_COUNT * TEMP_LOCAL_MATRICES_CBV_COUNT;
 
         cbv_srv_uav_desc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
         cbv_srv_uav_desc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE;
@@ -559,13 +662,10 @@ void FrameResource::InitConstBuffer()
     {
         constexpr UINT scene_constant_buffer_size = (sizeof(SceneConstBuffer) + (D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT - 1)) & ~(D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT - 1); // must be a multiple 256 bytes
 
-        ThrowIfFailed(m_pp_device->CreateCommittedResource(
-            &CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
-            D3D12_HEAP_FLAG_NONE,
-            &CD3DX12_RESOURCE_DESC::Buffer(scene_constant_buffer_size),
-            D3D12_RESOURCE_STATE_GENERIC_READ,
-            nullptr,
-            IID_PPV_ARGS(m_sceneConstantBuffer.ReleaseAndGetAddressOf())));
+        m_sceneConstantBuffer = m_heapAllocator->CreateResource(
+            D3D12_HEAP_TYPE_UPLOAD,
+            CD3DX12_RESOURCE_DESC::Buffer(scene_constant_buffer_size),
+            D3D12_RESOURCE_STATE_GENERIC_READ);
 
         // Map the constant buffers and cache their heap pointers.
         const CD3DX12_RANGE read_range(0, 0); // We do not intend to read from this resource on the CPU.
@@ -577,13 +677,10 @@ void FrameResource::InitConstBuffer()
     {
         constexpr UINT light_constant_buffer_size = (sizeof(LightConstBuffer) + (D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT - 1)) & ~(D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT - 1); // must be a multiple 256 bytes
 
-        ThrowIfFailed(m_pp_device->CreateCommittedResource(
-            &CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
-            D3D12_HEAP_FLAG_NONE,
-            &CD3DX12_RESOURCE_DESC::Buffer(light_constant_buffer_size),
-            D3D12_RESOURCE_STATE_GENERIC_READ,
-            nullptr,
-            IID_PPV_ARGS(m_lightConstantBuffer.ReleaseAndGetAddressOf())));
+        m_lightConstantBuffer = m_heapAllocator->CreateResource(
+            D3D12_HEAP_TYPE_UPLOAD,
+            CD3DX12_RESOURCE_DESC::Buffer(light_constant_buffer_size),
+            D3D12_RESOURCE_STATE_GENERIC_READ);
 
         const CD3DX12_RANGE read_range(0, 0); // We do not intend to read from this resource on the CPU.
         ThrowIfFailed(m_lightConstantBuffer->Map(0, &read_range, reinterpret_cast<void**>(&m_mappedLightConstantBuffer)));
@@ -877,13 +974,11 @@ void FrameResource::InitSceneDepthBuffer()
     clear_value.DepthStencil.Depth = 1.0f;
     clear_value.DepthStencil.Stencil = 0;
 
-    ThrowIfFailed(m_pp_device->CreateCommittedResource(
-        &CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT),
-        D3D12_HEAP_FLAG_NONE,
-        &shadow_texture_desc,
+    m_scenePassDepthBuffer = m_heapAllocator->CreateResource(
+        D3D12_HEAP_TYPE_DEFAULT,
+        shadow_texture_desc,
         D3D12_RESOURCE_STATE_DEPTH_WRITE,
-        &clear_value,
-        IID_PPV_ARGS(m_scenePassDepthBuffer.ReleaseAndGetAddressOf())));
+        &clear_value);
 
     // NAME_D3D12_OBJECT(m_depthStencil);
 
@@ -1067,13 +1162,11 @@ void FrameResource::InitShadowMap()
     clear_value.DepthStencil.Depth = 1.0f;
     clear_value.DepthStencil.Stencil = 0;
 
-    ThrowIfFailed(m_pp_device->CreateCommittedResource(
-        &CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT),
-        D3D12_HEAP_FLAG_NONE,
-        &shadow_tex_desc,
+    m_shadowPassShadowCubeMap = m_heapAllocator->CreateResource(
+        D3D12_HEAP_TYPE_DEFAULT,
+        shadow_tex_desc,
         D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE,
-        &clear_value,
-        IID_PPV_ARGS(m_shadowPassShadowCubeMap.ReleaseAndGetAddressOf())));
+        &clear_value);
     m_shadowPassShadowCubeMap->SetName(L"ShadowPassShadowCubeMap");
 
     // CREATE THE SHADOW MAP DEPTH STENCIL VIEW.
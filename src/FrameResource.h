@@ -3,8 +3,10 @@
 #include "AnniMath.h"
 #include "AnniUtils.h"
 #include "Camera.h"
+#include "ClusterCulling.h"
 #include "CrossWindow/Graphics.h"
 #include "GltfModel.h"
+#include "ObjectCulling.h"
 
 namespace Anni {
 namespace Constants {
@@ -16,11 +18,16 @@ public:
     void RecordCommandsAndExecute(ID3D12CommandQueue* direct_queue);
     void OnUpdateGlobalState(const std::vector<xwin::KeyboardData>& keyboard_data);
     void OnUpdatePerFrame();
+    // Meshlet culling of the last recorded frame, both passes.
+    const ClusterCullStats& GetClusterCullStats() const;
+    // of the scene pass in the last recorded frame
+    const ObjectCullStats& GetObjectCullStats() const;
 
 public:
     FrameResource(
         ID3D12Device* pp_device,
         IDXGISwapChain3* pp_swapChain,
+        ResourceHeapAllocator& heap_allocator,
 
         IDxcUtils* dxc_utils,
         IDxcCompiler* dxc_compiler,
@@ -32,7 +39,9 @@ public:
         GltfModel& sponza,
         GltfModel& METAX,
         const D3D12_VIEWPORT& viewport,
-        const D3D12_RECT& scissor_rect);
+        const D3D12_RECT& scissor_rect,
+        // slot of the frame resource, picks its slice of the models' per frame buffers
+        UINT frame_index);
     FrameResource() = delete;
     FrameResource(const FrameResource&) = delete;
     FrameResource(FrameResource&&) = delete;
@@ -64,6 +73,11 @@ private:
     void InitShadowMapSampler();
     void InitScenePassPSO();
 
+private:
+    // With CPU_CLUSTER_CULLING only the meshlets visible from one of the views are drawn, as few index ranges as
+    // possible. The root parameters of the object have to be set already.
+    void DrawRenderObject(ID3D12GraphicsCommandList* p_command_list, const RenderObject& render_object, std::span<const ClusterCullView> views);
+
 private:
     static constexpr UINT NumContexts = 3;
     static constexpr UINT NumLights = 3;
@@ -96,6 +110,7 @@ private:
     // OBSERVER POINTER OF D3D COMPONENTS.
     ID3D12Device* m_pp_device;
     IDXGISwapChain3* m_pp_swapChain;
+    ResourceHeapAllocator* m_heapAllocator;
 
     IDxcUtils* m_dxcUtils;
     IDxcCompiler* m_dxcCompiler;
@@ -143,12 +158,12 @@ private:
     WRL::ComPtr<ID3D12PipelineState> m_scenePSO;
 
     // CONST BUFFER
-    WRL::ComPtr<ID3D12Resource> m_sceneConstantBuffer;
+    PlacedResource m_sceneConstantBuffer;
     SceneConstBuffer* m_mappedSceneConstantBuffer;
     SceneConstBuffer m_sceneConstBufferCpuSide;
     // D3D12_CPU_DESCRIPTOR_HANDLE m_sceneCbvHeapHandle;
 
-    WRL::ComPtr<ID3D12Resource> m_lightConstantBuffer;
+    PlacedResource m_lightConstantBuffer;
     LightConstBuffer* m_mappedLightConstantBuffer;
     LightConstBuffer m_lightConstBufferCpuSide;
     // D3D12_CPU_DESCRIPTOR_HANDLE m_lightCbvHeapHandle;
@@ -158,12 +173,15 @@ private:
     WRL::ComPtr<ID3D12GraphicsCommandList> m_commandLists[NumContexts];
 
     // CUBEMAP SHADOW MAP FOR SHADOW PASS AND DEPTH BUFFER FOR SCENE PASS
-    WRL::ComPtr<ID3D12Resource> m_shadowPassShadowCubeMap;
+    PlacedResource m_shadowPassShadowCubeMap;
     D3D12_CPU_DESCRIPTOR_HANDLE m_cpuHandleToShadowCubeMap;
 
-    WRL::ComPtr<ID3D12Resource> m_scenePassDepthBuffer;
+    PlacedResource m_scenePassDepthBuffer;
     D3D12_CPU_DESCRIPTOR_HANDLE m_cpuHandleToSceneDepthBuffer;
 
+    // 0 to FRAME_INFLIGHT_COUNT - 1
+    UINT m_frameIndex;
+
     // MODELS
     GltfModel& m_sponza;
     GltfModel& m_METAX;
@@ -172,6 +190,22 @@ private:
     Camera m_lightCameras[NumLights];
     Camera m_camera;
 
+    // CLUSTER CULLING
+    // refreshed with the matrices in OnUpdatePerFrame, the shadow pass only renders the first light
+    ClusterCullView m_cameraCullView;
+    std::array<ClusterCullView, 6> m_shadowCullViews;
+    // scratch, keeps its capacity between draws
+    std::vector<uint8_t> m_meshletVisibility;
+    std::vector<IndexRange> m_visibleRanges;
+    ClusterCullStats m_clusterCullStats;
+    ObjectCullStats m_objectCullStats;
+
+    // DRAW LISTS
+    // rebuilt every frame into the memory of the earlier frames
+    DrawListBuilder m_sceneDrawList;
+    // debug builds check that recording allocates nothing once this passes ALLOCATION_FREE_FRAME_WARMUP
+    UINT64 m_recordedFrames;
+
     // WINDOW RELATED
     const D3D12_VIEWPORT& m_viewPort;
     const D3D12_RECT& m_scissorRect;
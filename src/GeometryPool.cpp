@@ -0,0 +1,286 @@
+#include "GeometryPool.h"
+
+#include <algorithm>
+
+namespace Anni {
+
+namespace {
+
+    // the largest mesh whose indices still fit 16 bits, relative to its base vertex
+    constexpr UINT32 INDEX16_MAX_VERTEX_COUNT = 1 << 16;
+
+    UINT32 GetIndexSlotsPerIndex(const DXGI_FORMAT format)
+    {
+        return format == DXGI_FORMAT_R16_UINT ? 1 : 2;
+    }
+
+    // 16 bit ranges round up to whole 4 bytes, so every range, and with it every 32 bit range, starts 4 byte aligned
+    UINT32 GetIndexSlotCount(const UINT32 index_count, const DXGI_FORMAT format)
+    {
+        return format == DXGI_FORMAT_R16_UINT ? (index_count + 1) & ~1u : index_count * 2;
+    }
+
+}
+
+RangeAllocator::RangeAllocator(const UINT32 capacity)
+    : m_capacity(capacity)
+    , m_used(0)
+{
+    if (capacity > 0) {
+        m_freeRanges.emplace(0, capacity);
+    }
+}
+
+UINT32 RangeAllocator::Allocate(const UINT32 size)
+{
+    if (size == 0) {
+        return 0;
+    }
+
+    for (auto it = m_freeRanges.begin(); it != m_freeRanges.end(); ++it) {
+        if (it->second < size) {
+            continue;
+        }
+
+        const UINT32 offset = it->first;
+        const UINT32 remaining = it->second - size;
+        m_freeRanges.erase(it);
+        if (remaining > 0) {
+            m_freeRanges.emplace(offset + size, remaining);
+        }
+        m_used += size;
+        return offset;
+    }
+    return INVALID_OFFSET;
+}
+
+void RangeAllocator::Free(UINT32 offset, UINT32 size)
+{
+    if (size == 0) {
+        return;
+    }
+    assert(offset + size <= m_capacity);
+    m_used -= size;
+
+    auto next = m_freeRanges.lower_bound(offset);
+    assert(next == m_freeRanges.end() || offset + size <= next->first);
+
+    if (next != m_freeRanges.begin()) {
+        const auto prev = std::prev(next);
+        assert(prev->first + prev->second <= offset);
+        if (prev->first + prev->second == offset) {
+            offset = prev->first;
+            size += prev->second;
+            m_freeRanges.erase(prev);
+        }
+    }
+    if (next != m_freeRanges.end() && offset + size == next->first) {
+        size += next->second;
+        m_freeRanges.erase(next);
+    }
+    m_freeRanges.emplace(offset, size);
+}
+
+UINT32 RangeAllocator::GetCapacity() const
+{
+    return m_capacity;
+}
+
+UINT32 RangeAllocator::GetUsed() const
+{
+    return m_used;
+}
+
+UINT32 RangeAllocator::GetFreeRangeCount() const
+{
+    return static_cast<UINT32>(m_freeRanges.size());
+}
+
+UINT32 RangeAllocator::GetLargestFreeRange() const
+{
+    UINT32 largest = 0;
+    for (const auto& [offset, size] : m_freeRanges) {
+        largest = std::max(largest, size);
+    }
+    return largest;
+}
+
+float RangeAllocator::GetFragmentation() const
+{
+    const UINT32 free_space = m_capacity - m_used;
+    if (free_space == 0) {
+        return 0.0f;
+    }
+    return 1.0f - static_cast<float>(GetLargestFreeRange()) / static_cast<float>(free_space);
+}
+
+GeometryPool::GeometryPool(ResourceHeapAllocator& heap_allocator, const UINT32 vertex_capacity, const UINT32 index_capacity)
+    : m_heapAllocator(&heap_allocator)
+    , m_vertexRanges(vertex_capacity)
+    , m_indexRanges(index_capacity * 2)
+    , m_vertexBufferView()
+    , m_index16BufferView()
+    , m_index32BufferView()
+    , m_index16Meshes(0)
+    , m_index32Meshes(0)
+    , m_indexBytesSaved(0)
+{
+    const UINT64 vertex_buffer_size = static_cast<UINT64>(vertex_capacity) * sizeof(StandardVertex);
+    const UINT64 index_buffer_size = static_cast<UINT64>(index_capacity) * sizeof(uint32_t);
+    // views are limited to 32 bit sizes, the index ranges count 2 byte slots
+    assert(index_capacity <= UINT32_MAX / 2 && vertex_buffer_size <= UINT32_MAX && index_buffer_size <= UINT32_MAX);
+
+    // Created in the common state: the copy queue promotes them to copy dest and they decay back once the copies
+    // finished, from where the direct queue promotes them to vertex/index buffer reads.
+    m_vertexBuffer = m_heapAllocator->CreateResource(
+        D3D12_HEAP_TYPE_DEFAULT,
+        CD3DX12_RESOURCE_DESC::Buffer(vertex_buffer_size),
+        D3D12_RESOURCE_STATE_COMMON);
+    m_vertexBuffer->SetName(L"Geometry Pool Vertex Buffer");
+
+    m_indexBuffer = m_heapAllocator->CreateResource(
+        D3D12_HEAP_TYPE_DEFAULT,
+        CD3DX12_RESOURCE_DESC::Buffer(index_buffer_size),
+        D3D12_RESOURCE_STATE_COMMON);
+    m_indexBuffer->SetName(L"Geometry Pool Index Buffer");
+
+    m_vertexBufferView.BufferLocation = m_vertexBuffer->GetGPUVirtualAddress();
+    m_vertexBufferView.SizeInBytes = static_cast<UINT>(vertex_buffer_size);
+    m_vertexBufferView.StrideInBytes = sizeof(StandardVertex);
+
+    m_index32BufferView.BufferLocation = m_indexBuffer->GetGPUVirtualAddress();
+    m_index32BufferView.SizeInBytes = static_cast<UINT>(index_buffer_size);
+    m_index32BufferView.Format = DXGI_FORMAT_R32_UINT;
+
+    m_index16BufferView = m_index32BufferView;
+    m_index16BufferView.Format = DXGI_FORMAT_R16_UINT;
+}
+
+std::vector<GeometryAllocation> GeometryPool::UploadMeshes(StagingRing& staging_ring, const std::vector<MeshData>& meshes)
+{
+    //> ALLOCATE RANGES
+    std::vector<GeometryAllocation> allocations;
+    allocations.reserve(meshes.size());
+
+    for (const MeshData& mesh : meshes) {
+        GeometryAllocation allocation;
+        allocation.vertex_count = static_cast<UINT32>(mesh.vertices.size());
+        allocation.index_count = static_cast<UINT32>(mesh.indices.size());
+        allocation.index_format = allocation.vertex_count <= INDEX16_MAX_VERTEX_COUNT ? DXGI_FORMAT_R16_UINT : DXGI_FORMAT_R32_UINT;
+        const UINT32 index_slots = GetIndexSlotCount(allocation.index_count, allocation.index_format);
+        allocation.base_vertex = m_vertexRanges.Allocate(allocation.vertex_count);
+        const UINT32 first_index_slot = m_indexRanges.Allocate(index_slots);
+
+        if (allocation.base_vertex == RangeAllocator::INVALID_OFFSET || first_index_slot == RangeAllocator::INVALID_OFFSET) {
+            if (allocation.base_vertex != RangeAllocator::INVALID_OFFSET) {
+                m_vertexRanges.Free(allocation.base_vertex, allocation.vertex_count);
+            }
+            if (first_index_slot != RangeAllocator::INVALID_OFFSET) {
+                m_indexRanges.Free(first_index_slot, index_slots);
+            }
+            for (const GeometryAllocation& a : allocations) {
+                Free(a);
+            }
+            LogStats();
+            throw std::runtime_error("Geometry pool out of space for mesh " + mesh.name);
+        }
+
+        allocation.first_index = first_index_slot / GetIndexSlotsPerIndex(allocation.index_format);
+        allocations.push_back(allocation);
+        if (allocation.index_format == DXGI_FORMAT_R16_UINT) {
+            ++m_index16Meshes;
+            m_indexBytesSaved += static_cast<UINT64>(allocation.index_count) * sizeof(uint16_t);
+        } else {
+            ++m_index32Meshes;
+        }
+    }
+    //< allocate ranges
+
+    //> RECORD COPIES
+    // the ring copies the source right away, one narrowing buffer serves every mesh
+    std::vector<uint16_t> indices16;
+    for (const auto [mesh_index, mesh] : std::ranges::views::enumerate(meshes)) {
+        const GeometryAllocation& allocation = allocations[mesh_index];
+        if (!mesh.vertices.empty()) {
+            staging_ring.CopyBuffer(m_vertexBuffer.Get(), static_cast<UINT64>(allocation.base_vertex) * sizeof(StandardVertex),
+                mesh.vertices.data(), mesh.vertices.size() * sizeof(StandardVertex));
+        }
+        if (mesh.indices.empty()) {
+            continue;
+        }
+        if (allocation.index_format == DXGI_FORMAT_R16_UINT) {
+            indices16.resize(mesh.indices.size());
+            for (size_t i = 0; i < mesh.indices.size(); ++i) {
+                assert(mesh.indices[i] < INDEX16_MAX_VERTEX_COUNT);
+                indices16[i] = static_cast<uint16_t>(mesh.indices[i]);
+            }
+            staging_ring.CopyBuffer(m_indexBuffer.Get(), static_cast<UINT64>(allocation.first_index) * sizeof(uint16_t),
+                indices16.data(), indices16.size() * sizeof(uint16_t));
+        } else {
+            staging_ring.CopyBuffer(m_indexBuffer.Get(), static_cast<UINT64>(allocation.first_index) * sizeof(uint32_t),
+                mesh.indices.data(), mesh.indices.size() * sizeof(uint32_t));
+        }
+    }
+    //< record copies
+
+    return allocations;
+}
+
+void GeometryPool::Free(const GeometryAllocation& allocation)
+{
+    m_vertexRanges.Free(allocation.base_vertex, allocation.vertex_count);
+    m_indexRanges.Free(allocation.first_index * GetIndexSlotsPerIndex(allocation.index_format), GetIndexSlotCount(allocation.index_count, allocation.index_format));
+    if (allocation.index_format == DXGI_FORMAT_R16_UINT) {
+        --m_index16Meshes;
+        m_indexBytesSaved -= static_cast<UINT64>(allocation.index_count) * sizeof(uint16_t);
+    } else {
+        --m_index32Meshes;
+    }
+}
+
+const D3D12_VERTEX_BUFFER_VIEW& GeometryPool::GetVertexBufferView() const
+{
+    return m_vertexBufferView;
+}
+
+const D3D12_INDEX_BUFFER_VIEW& GeometryPool::GetIndexBufferView(const DXGI_FORMAT format) const
+{
+    assert(format == DXGI_FORMAT_R16_UINT || format == DXGI_FORMAT_R32_UINT);
+    return format == DXGI_FORMAT_R16_UINT ? m_index16BufferView : m_index32BufferView;
+}
+
+GeometryPoolStats GeometryPool::GetStats() const
+{
+    GeometryPoolStats stats;
+    stats.vertex_capacity = m_vertexRanges.GetCapacity();
+    stats.vertices_used = m_vertexRanges.GetUsed();
+    stats.vertex_free_ranges = m_vertexRanges.GetFreeRangeCount();
+    stats.largest_free_vertex_range = m_vertexRanges.GetLargestFreeRange();
+    stats.vertex_fragmentation = m_vertexRanges.GetFragmentation();
+
+    stats.index_capacity = m_indexRanges.GetCapacity();
+    stats.indices_used = m_indexRanges.GetUsed();
+    stats.index_free_ranges = m_indexRanges.GetFreeRangeCount();
+    stats.largest_free_index_range = m_indexRanges.GetLargestFreeRange();
+    stats.index_fragmentation = m_indexRanges.GetFragmentation();
+
+    stats.index16_meshes = m_index16Meshes;
+    stats.index32_meshes = m_index32Meshes;
+    stats.index_bytes_saved = m_indexBytesSaved;
+    return stats;
+}
+
+void GeometryPool::LogStats() const
+{
+    const GeometryPoolStats stats = GetStats();
+    std::cout << "[GeometryPool] vertices " << stats.vertices_used << " / " << stats.vertex_capacity
+              << ", " << stats.vertex_free_ranges << " free ranges, largest " << stats.largest_free_vertex_range
+              << ", fragmentation " << stats.vertex_fragmentation * 100.0f << "%" << '\n';
+    std::cout << "[GeometryPool] index memory " << stats.indices_used * sizeof(uint16_t) / 1024 << " / " << stats.index_capacity * sizeof(uint16_t) / 1024
+              << " KB, " << stats.index_free_ranges << " free ranges, largest " << stats.largest_free_index_range * sizeof(uint16_t) / 1024
+              << " KB, fragmentation " << stats.index_fragmentation * 100.0f << "%" << '\n';
+    std::cout << "[GeometryPool] " << stats.index16_meshes << " meshes with 16 bit indices, " << stats.index32_meshes
+              << " with 32 bit, " << stats.index_bytes_saved / 1024 << " KB saved" << '\n';
+}
+
+}
@@ -0,0 +1,113 @@
+#pragma once
+
+#include "AnniUtils.h"
+#include "ModelData.h"
+#include "ResourceHeapAllocator.h"
+#include "StagingRing.h"
+
+#include <map>
+
+namespace Anni {
+
+// First fit suballocation of [0, capacity), neighbouring free ranges are merged on free.
+// Offsets and sizes are in elements (vertices or 2 byte index slots), not bytes.
+class RangeAllocator {
+public:
+    static constexpr UINT32 INVALID_OFFSET = UINT32_MAX;
+
+    explicit RangeAllocator(UINT32 capacity);
+
+    // Returns INVALID_OFFSET when no free range is large enough.
+    UINT32 Allocate(UINT32 size);
+    void Free(UINT32 offset, UINT32 size);
+
+    UINT32 GetCapacity() const;
+    UINT32 GetUsed() const;
+    UINT32 GetFreeRangeCount() const;
+    UINT32 GetLargestFreeRange() const;
+    // 1 - largest free range / all free space, 0 while the free space is in one piece.
+    float GetFragmentation() const;
+
+private:
+    // offset -> size
+    std::map<UINT32, UINT32> m_freeRanges;
+    UINT32 m_capacity;
+    UINT32 m_used;
+};
+
+// Where a mesh lives inside the geometry pool.
+struct GeometryAllocation {
+    UINT32 base_vertex { 0 };
+    UINT32 vertex_count { 0 };
+    // in indices of index_format, draws bind GetIndexBufferView(index_format)
+    UINT32 first_index { 0 };
+    UINT32 index_count { 0 };
+    DXGI_FORMAT index_format { DXGI_FORMAT_R32_UINT };
+};
+
+struct GeometryPoolStats {
+    UINT32 vertex_capacity;
+    UINT32 vertices_used;
+    UINT32 vertex_free_ranges;
+    UINT32 largest_free_vertex_range;
+    float vertex_fragmentation;
+
+    // in 2 byte slots
+    UINT32 index_capacity;
+    UINT32 indices_used;
+    UINT32 index_free_ranges;
+    UINT32 largest_free_index_range;
+    float index_fragmentation;
+
+    UINT32 index16_meshes;
+    UINT32 index32_meshes;
+    // index memory the 16 bit meshes would take on top with 32 bit indices
+    UINT64 index_bytes_saved;
+};
+
+// One vertex buffer and one index buffer shared by the meshes of every model. A pass binds them once and the draws
+// only differ in base vertex and first index. Meshes of up to 65536 vertices store 16 bit indices, the index buffer
+// has a 16 and a 32 bit view and a draw rebinds it when its format differs from the previous draw's.
+class GeometryPool {
+public:
+    // index_capacity counts 32 bit indices, twice as many 16 bit ones fit.
+    GeometryPool(ResourceHeapAllocator& heap_allocator, UINT32 vertex_capacity, UINT32 index_capacity);
+    GeometryPool() = delete;
+    GeometryPool(const GeometryPool&) = delete;
+    GeometryPool(GeometryPool&&) = delete;
+    GeometryPool& operator=(const GeometryPool&) = delete;
+    GeometryPool& operator=(GeometryPool&&) = delete;
+    ~GeometryPool() = default;
+
+    // Allocates one range per mesh and copies the vertices and indices through the staging ring. Throws
+    // std::runtime_error when the pool is full, nothing stays allocated in that case.
+    std::vector<GeometryAllocation> UploadMeshes(StagingRing& staging_ring, const std::vector<MeshData>& meshes);
+    void Free(const GeometryAllocation& allocation);
+
+    const D3D12_VERTEX_BUFFER_VIEW& GetVertexBufferView() const;
+    // R16_UINT or R32_UINT
+    const D3D12_INDEX_BUFFER_VIEW& GetIndexBufferView(DXGI_FORMAT format) const;
+
+    GeometryPoolStats GetStats() const;
+    void LogStats() const;
+
+private:
+    // Outlives the pool (observer pointer)
+    ResourceHeapAllocator* m_heapAllocator;
+
+    RangeAllocator m_vertexRanges;
+    RangeAllocator m_indexRanges;
+
+    PlacedResource m_vertexBuffer;
+    PlacedResource m_indexBuffer;
+
+    D3D12_VERTEX_BUFFER_VIEW m_vertexBufferView;
+    D3D12_INDEX_BUFFER_VIEW m_index16BufferView;
+    D3D12_INDEX_BUFFER_VIEW m_index32BufferView;
+
+    UINT32 m_index16Meshes;
+    UINT32 m_index32Meshes;
+    UINT64 m_indexBytesSaved;
+};
+
+}
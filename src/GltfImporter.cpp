@@ -0,0 +1,1085 @@
+#include "GltfImporter.h"
+#include "BlockCompression.h"
+#include "Bounds.h"
+#include "LoadProfiler.h"
+#include "MeshOptimizer.h"
+#include "MipGenerator.h"
+#include "TextureContainer.h"
+#include "VertexConversion.h"
+
+#include <fastgltf/glm_element_traits.hpp>
+#include <fastgltf/parser.hpp>
+#include <fastgltf/tools.hpp>
+#include <fastgltf/types.hpp>
+#include <fastgltf/util.hpp>
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <format>
+#include <span>
+#include <unordered_map>
+
+namespace Anni {
+
+namespace {
+
+    D3D12_FILTER ExtractFilterAndMipMapMode(const fastgltf::Filter min_filter, const fastgltf::Filter mag_filter, const fastgltf::Filter mip_map_mode)
+    {
+        const bool min_linear = min_filter == fastgltf::Filter::Linear
+            || min_filter == fastgltf::Filter::LinearMipMapNearest
+            || min_filter == fastgltf::Filter::LinearMipMapLinear;
+        const bool mag_linear = mag_filter == fastgltf::Filter::Linear;
+        // textures now carry a full mip chain, so the mip mode of the min filter matters
+        const bool mip_linear = mip_map_mode == fastgltf::Filter::NearestMipMapLinear
+            || mip_map_mode == fastgltf::Filter::LinearMipMapLinear;
+
+        return D3D12_ENCODE_BASIC_FILTER(
+            min_linear ? D3D12_FILTER_TYPE_LINEAR : D3D12_FILTER_TYPE_POINT,
+            mag_linear ? D3D12_FILTER_TYPE_LINEAR : D3D12_FILTER_TYPE_POINT,
+            mip_linear ? D3D12_FILTER_TYPE_LINEAR : D3D12_FILTER_TYPE_POINT,
+            D3D12_FILTER_REDUCTION_TYPE_STANDARD);
+    }
+
+    D3D12_TEXTURE_ADDRESS_MODE ExtractAddressMode(const fastgltf::Wrap warp)
+    {
+        switch (warp) {
+        case fastgltf::Wrap::ClampToEdge:
+            return D3D12_TEXTURE_ADDRESS_MODE_CLAMP;
+
+        case fastgltf::Wrap::MirroredRepeat:
+            return D3D12_TEXTURE_ADDRESS_MODE_MIRROR;
+
+        case fastgltf::Wrap::Repeat:
+            return D3D12_TEXTURE_ADDRESS_MODE_WRAP;
+        default:
+            assert(false);
+        }
+        return {};
+    }
+
+    // Buffers are a Vector when they were copied to the heap (LoadExternalBuffers)
+    // and a ByteView when they are memory mapped.
+    const std::byte* GetBufferBytes(const fastgltf::Buffer& buffer)
+    {
+        return std::visit(
+            fastgltf::visitor {
+                [](auto&) -> const std::byte* { return nullptr; },
+                [](const fastgltf::sources::Vector& vector) -> const std::byte* {
+                    return reinterpret_cast<const std::byte*>(vector.bytes.data());
+                },
+                [](const fastgltf::sources::ByteView& byte_view) -> const std::byte* {
+                    return byte_view.bytes.data();
+                } },
+            buffer.data);
+    }
+
+    //> ACCESSOR STREAMS
+    // Points stream at the elements of accessor inside its buffer. Fails for sparse accessors, accessors without a
+    // buffer view and component types the conversion kernels don't read.
+    bool GetAttributeStream(const fastgltf::Asset& gltf, const fastgltf::Accessor& accessor, AttributeStream& stream)
+    {
+        if (accessor.sparse.has_value() || !accessor.bufferViewIndex.has_value()) {
+            return false;
+        }
+        switch (accessor.componentType) {
+        case fastgltf::ComponentType::Float:
+            stream.component = AttributeComponent::Float;
+            break;
+        case fastgltf::ComponentType::UnsignedByte:
+            stream.component = accessor.normalized ? AttributeComponent::UNorm8 : AttributeComponent::UInt8;
+            break;
+        case fastgltf::ComponentType::UnsignedShort:
+            stream.component = accessor.normalized ? AttributeComponent::UNorm16 : AttributeComponent::UInt16;
+            break;
+        case fastgltf::ComponentType::Byte:
+            stream.component = accessor.normalized ? AttributeComponent::SNorm8 : AttributeComponent::SInt8;
+            break;
+        case fastgltf::ComponentType::Short:
+            stream.component = accessor.normalized ? AttributeComponent::SNorm16 : AttributeComponent::SInt16;
+            break;
+        default:
+            return false;
+        }
+
+        const fastgltf::BufferView& buffer_view = gltf.bufferViews[accessor.bufferViewIndex.value()];
+        const std::byte* buffer_bytes = GetBufferBytes(gltf.buffers[buffer_view.bufferIndex]);
+        if (!buffer_bytes) {
+            return false;
+        }
+        stream.data = buffer_bytes + buffer_view.byteOffset + accessor.byteOffset;
+        stream.stride = buffer_view.byteStride.value_or(fastgltf::getElementByteSize(accessor.type, accessor.componentType));
+        stream.component_count = fastgltf::getNumComponents(accessor.type);
+        return true;
+    }
+
+    // Copies the elements out as floats through fastgltf, for the accessors GetAttributeStream can't point at.
+    template <typename Vec>
+    AttributeStream CopyAttributeStream(const fastgltf::Asset& gltf, const fastgltf::Accessor& accessor, std::vector<float>& scratch)
+    {
+        constexpr uint32_t component_count = Vec::length();
+        scratch.resize(accessor.count * component_count);
+        fastgltf::iterateAccessorWithIndex<Vec>(
+            gltf, accessor,
+            [&](const Vec& v, const size_t index) {
+                for (uint32_t component = 0; component < component_count; ++component) {
+                    scratch[index * component_count + component] = v[component];
+                }
+            });
+        return { reinterpret_cast<const std::byte*>(scratch.data()), component_count * sizeof(float), AttributeComponent::Float, component_count };
+    }
+    //< accessor streams
+
+    //> BLOCK COMPRESSION CACHE
+    // Encoding BC7 is far slower than decoding the source, so compressed chains are cached on disk keyed by the
+    // base level pixels, the target format and the encoder version.
+    struct CompressedTextureHeader {
+        char magic[4];
+        UINT32 version;
+        UINT32 format;
+        UINT32 width;
+        UINT32 height;
+        UINT32 mip_levels;
+    };
+
+    constexpr char COMPRESSED_TEXTURE_MAGIC[4] = { 'A', 'N', 'B', 'C' };
+
+    size_t GetCompressedChainSize(const UINT width, const UINT height, const UINT16 mip_levels, const DXGI_FORMAT format)
+    {
+        size_t size = 0;
+        for (UINT16 level = 0; level < mip_levels; ++level) {
+            size += GetBlockCompressedSize(std::max(1u, width >> level), std::max(1u, height >> level), format);
+        }
+        return size;
+    }
+
+    // Points the texture's subresources at consecutive levels inside blocks.
+    void SetCompressedSubresources(TextureData& texture, const DXGI_FORMAT format, const uint8_t* blocks)
+    {
+        texture.format = format;
+        texture.subresources.resize(texture.mip_levels);
+        for (UINT16 level = 0; level < texture.mip_levels; ++level) {
+            const UINT level_width = std::max(1u, texture.width >> level);
+            const UINT level_height = std::max(1u, texture.height >> level);
+
+            D3D12_SUBRESOURCE_DATA& subresource = texture.subresources[level];
+            subresource.pData = blocks;
+            subresource.RowPitch = GetBlockCompressedRowPitch(level_width, format);
+            subresource.SlicePitch = GetBlockCompressedSize(level_width, level_height, format);
+            blocks += subresource.SlicePitch;
+        }
+    }
+
+    bool ReadCompressedTexture(const std::filesystem::path& cache_path, const DXGI_FORMAT format, TextureData& texture)
+    {
+        if (!std::filesystem::exists(cache_path)) {
+            return false;
+        }
+
+        auto file_bytes = std::make_shared<std::vector<char>>(ReadFileAsBytes(cache_path.string()));
+        const size_t chain_size = GetCompressedChainSize(texture.width, texture.height, texture.mip_levels, format);
+        if (file_bytes->size() != sizeof(CompressedTextureHeader) + chain_size) {
+            return false;
+        }
+
+        CompressedTextureHeader header;
+        memcpy(&header, file_bytes->data(), sizeof(header));
+        if (memcmp(header.magic, COMPRESSED_TEXTURE_MAGIC, sizeof(COMPRESSED_TEXTURE_MAGIC)) != 0
+            || header.version != BLOCK_COMPRESSION_VERSION || header.format != format
+            || header.width != texture.width || header.height != texture.height || header.mip_levels != texture.mip_levels) {
+            return false;
+        }
+
+        SetCompressedSubresources(texture, format, reinterpret_cast<const uint8_t*>(file_bytes->data() + sizeof(header)));
+        texture.storage = std::move(file_bytes);
+        return true;
+    }
+
+    void WriteCompressedTexture(const std::filesystem::path& cache_path, const TextureData& texture)
+    {
+        CompressedTextureHeader header = {};
+        memcpy(header.magic, COMPRESSED_TEXTURE_MAGIC, sizeof(COMPRESSED_TEXTURE_MAGIC));
+        header.version = BLOCK_COMPRESSION_VERSION;
+        header.format = texture.format;
+        header.width = texture.width;
+        header.height = texture.height;
+        header.mip_levels = texture.mip_levels;
+
+        // identical images may be cached by two jobs at once, so write aside and move into place
+        std::filesystem::path temp_path = cache_path;
+        temp_path += std::format(".{}.tmp", std::hash<std::thread::id> {}(std::this_thread::get_id()));
+        {
+            std::ofstream file(temp_path, std::ios::binary | std::ios::trunc);
+            file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+            for (const D3D12_SUBRESOURCE_DATA& subresource : texture.subresources) {
+                file.write(static_cast<const char*>(subresource.pData), subresource.SlicePitch);
+            }
+            if (!file) {
+                std::cerr << "Failed to write block compression cache " << temp_path << '\n';
+                return;
+            }
+        }
+
+        std::error_code error;
+        std::filesystem::rename(temp_path, cache_path, error);
+        if (error) {
+            std::filesystem::remove(temp_path, error);
+        }
+    }
+    //< block compression cache
+
+    // Replaces the RGBA8 chain of texture with its block compressed version.
+    // Returns the squared error of the base level over the channels the format keeps.
+    double CompressTexture(TextureData& texture, const DXGI_FORMAT format)
+    {
+        auto blocks = std::make_shared<std::vector<uint8_t>>(GetCompressedChainSize(texture.width, texture.height, texture.mip_levels, format));
+
+        double base_level_error = 0.0;
+        uint8_t* level_blocks = blocks->data();
+        for (UINT16 level = 0; level < texture.mip_levels; ++level) {
+            const UINT level_width = std::max(1u, texture.width >> level);
+            const UINT level_height = std::max(1u, texture.height >> level);
+
+            const double error = BlockCompressLevel(static_cast<const uint8_t*>(texture.subresources[level].pData),
+                level_width, level_height, format, level_blocks);
+            if (level == 0) {
+                base_level_error = error;
+            }
+            level_blocks += GetBlockCompressedSize(level_width, level_height, format);
+        }
+
+        SetCompressedSubresources(texture, format, blocks->data());
+        // drops the RGBA8 pixels
+        texture.storage = std::move(blocks);
+        return base_level_error;
+    }
+
+    //> deduplication
+    UINT64 HashTexture(const TextureData& texture)
+    {
+        const UINT64 description[] { texture.width, texture.height, texture.mip_levels, static_cast<UINT64>(texture.format) };
+        UINT64 hash = HashBytes(description, sizeof(description));
+        for (const D3D12_SUBRESOURCE_DATA& subresource : texture.subresources) {
+            hash = HashBytes(subresource.pData, subresource.SlicePitch, hash);
+        }
+        return hash;
+    }
+
+    bool SameTexture(const TextureData& a, const TextureData& b)
+    {
+        if (a.width != b.width || a.height != b.height || a.mip_levels != b.mip_levels || a.format != b.format
+            || a.subresources.size() != b.subresources.size()) {
+            return false;
+        }
+        for (size_t i = 0; i < a.subresources.size(); ++i) {
+            const D3D12_SUBRESOURCE_DATA& sa = a.subresources[i];
+            const D3D12_SUBRESOURCE_DATA& sb = b.subresources[i];
+            if (sa.RowPitch != sb.RowPitch || sa.SlicePitch != sb.SlicePitch || memcmp(sa.pData, sb.pData, sa.SlicePitch) != 0) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Moves the first of every group of equal items to the front, in order, and drops the others.
+    // Returns the new index of every old index.
+    template <typename T, typename Hash, typename Equal>
+    std::vector<INT32> CollapseDuplicates(std::vector<T>& items, const Hash& hash, const Equal& equal)
+    {
+        std::vector<INT32> remap(items.size());
+        std::unordered_multimap<UINT64, INT32> kept_by_hash;
+        INT32 kept = 0;
+        for (size_t i = 0; i < items.size(); ++i) {
+            const UINT64 h = hash(items[i]);
+            INT32 match = -1;
+            for (auto [it, end] = kept_by_hash.equal_range(h); it != end; ++it) {
+                if (equal(items[it->second], items[i])) {
+                    match = it->second;
+                    break;
+                }
+            }
+            if (match < 0) {
+                if (static_cast<size_t>(kept) != i) {
+                    items[kept] = std::move(items[i]);
+                }
+                kept_by_hash.emplace(h, kept);
+                match = kept++;
+            }
+            remap[i] = match;
+        }
+        items.resize(kept);
+        return remap;
+    }
+
+    void RemapIndex(INT32& index, const std::vector<INT32>& remap)
+    {
+        if (index >= 0) {
+            index = remap[index];
+        }
+    }
+    //< deduplication
+
+}
+
+void ImportGltf(const std::string& gltf_file_path, ThreadPool& thread_pool, const BufferLoadMode buffer_load_mode, ModelData& model_data)
+{
+    const ProfileZone import_zone("ImportGltf");
+
+    // the DDS and KTX2 sources of a texture sit in these extensions, next to its plain image
+    fastgltf::Parser parser { fastgltf::Extensions::MSFT_texture_dds | fastgltf::Extensions::KHR_texture_basisu };
+
+    // When memory mapping, the parser leaves external buffers as URIs and the GLB binary chunk as a view into
+    // the data buffer, we map the external buffers ourselves right after parsing.
+    constexpr auto copy_gltf_options = fastgltf::Options::DontRequireValidAssetMember | fastgltf::Options::AllowDouble | fastgltf::Options::LoadGLBBuffers | fastgltf::Options::LoadExternalBuffers;
+    constexpr auto mapped_gltf_options = fastgltf::Options::DontRequireValidAssetMember | fastgltf::Options::AllowDouble;
+    const auto gltfOptions = buffer_load_mode == BufferLoadMode::CopyToHeap ? copy_gltf_options : mapped_gltf_options;
+    // fastgltf::Options::LoadExternalImages;
+
+    // every view handed to fastgltf points into these, so they must outlive the asset
+    std::vector<std::unique_ptr<MappedFile>> mapped_files;
+
+    fastgltf::Asset gltf;
+    std::filesystem::path path_filesys = gltf_file_path;
+
+    ProfileZone parse_zone("ParseGltf");
+    fastgltf::GltfDataBuffer data;
+    if (buffer_load_mode == BufferLoadMode::MemoryMapped) {
+        const auto& gltf_file = mapped_files.emplace_back(std::make_unique<MappedFile>(path_filesys));
+
+        // simdjson reads a few padding bytes past the end of the json. The zeroed tail of the last mapped page
+        // usually covers that; fastgltf falls back to a copy by itself when it doesn't.
+        data.fromByteView(
+            const_cast<std::uint8_t*>(reinterpret_cast<const std::uint8_t*>(gltf_file->GetData())),
+            gltf_file->GetSize(),
+            gltf_file->GetSize() + gltf_file->GetTailSlack());
+    } else {
+        data.loadFromFile(gltf_file_path);
+    }
+
+    //> LOAD_RAW GLTF RAW FILE LOADING
+    auto type = determineGltfFileType(&data);
+    if (type == fastgltf::GltfType::glTF) {
+        auto load = parser.loadGLTF(&data, path_filesys.parent_path(), gltfOptions);
+        if (load) {
+            gltf = std::move(load.get());
+        } else {
+            std::cerr << "Failed to load glTF: " << to_underlying(load.error())
+                      << '\n';
+            assert(false);
+        }
+    } else if (type == fastgltf::GltfType::GLB) {
+        auto load = parser.loadBinaryGLTF(&data, path_filesys.parent_path(),
+            gltfOptions);
+        if (load) {
+            gltf = std::move(load.get());
+        } else {
+            std::cerr << "Failed to load glTF: " << to_underlying(load.error())
+                      << '\n';
+            assert(false);
+        }
+    } else {
+        std::cerr << "Failed to determine glTF container" << '\n';
+        assert(false);
+    }
+    parse_zone.End();
+    //< load_raw
+
+    //> MAP_EXTERNAL_BUFFERS
+    ProfileZone map_zone("MapBuffers");
+    if (buffer_load_mode == BufferLoadMode::MemoryMapped) {
+        for (fastgltf::Buffer& buffer : gltf.buffers) {
+            const fastgltf::sources::URI* p_buffer_uri = std::get_if<fastgltf::sources::URI>(&buffer.data);
+            // the GLB binary chunk is already a ByteView into the mapped file
+            if (!p_buffer_uri) {
+                continue;
+            }
+            assert(p_buffer_uri->uri.isLocalPath()); // We're only capable of loading local files.
+
+            const std::string buffer_local_path(
+                p_buffer_uri->uri.path().begin(),
+                p_buffer_uri->uri.path().end());
+            const auto& buffer_file = mapped_files.emplace_back(
+                std::make_unique<MappedFile>(path_filesys.parent_path().append(buffer_local_path)));
+            assert(p_buffer_uri->fileByteOffset + buffer.byteLength <= buffer_file->GetSize());
+
+            // accessors are iterated straight out of the mapping through the default buffer data adapter
+            fastgltf::sources::ByteView byte_view;
+            byte_view.bytes = fastgltf::span<const std::byte>(buffer_file->GetData() + p_buffer_uri->fileByteOffset, buffer.byteLength);
+            byte_view.mimeType = fastgltf::MimeType::GltfBuffer;
+            buffer.data = byte_view;
+        }
+    }
+    map_zone.End();
+    //< map_external_buffers
+
+    //> LOAD_SAMPLERS
+    model_data.samplers.reserve(gltf.samplers.size());
+    for (fastgltf::Sampler& sampler : gltf.samplers) {
+        // Describe the wrapping sampler, which is used for
+        // sampling diffuse/normal maps.
+        D3D12_SAMPLER_DESC sampler_desc = {};
+        sampler_desc.Filter = ExtractFilterAndMipMapMode(
+            sampler.minFilter.value_or(fastgltf::Filter::Nearest),
+            sampler.magFilter.value_or(fastgltf::Filter::Nearest),
+            sampler.minFilter.value_or(fastgltf::Filter::Nearest));
+
+        sampler_desc.AddressU = ExtractAddressMode(sampler.wrapS);
+        sampler_desc.AddressV = ExtractAddressMode(sampler.wrapT);
+        sampler_desc.AddressW = sampler_desc.AddressU;
+
+        sampler_desc.MinLOD = 0;
+        sampler_desc.MaxLOD = D3D12_FLOAT32_MAX;
+        sampler_desc.MipLODBias = 0.0f;
+        sampler_desc.MaxAnisotropy = 1;
+        sampler_desc.ComparisonFunc = D3D12_COMPARISON_FUNC_NEVER;
+        sampler_desc.BorderColor[0] = sampler_desc.BorderColor[1] = sampler_desc.BorderColor[2] = sampler_desc.BorderColor[3] = 0;
+        model_data.samplers.push_back(sampler_desc);
+    }
+    //< load_SAMPLERS
+
+    //> DECODE IMAGES
+    ProfileZone decode_zone("DecodeImages");
+    // A texture may list a DDS (MSFT_texture_dds) or KTX2 (KHR_texture_basisu) source next to its plain image. The
+    // containers are loaded first, the plain image of a texture is only decoded when none of them could be used.
+    std::vector<bool> container_sources(gltf.images.size(), false);
+    std::vector<bool> referenced_images(gltf.images.size(), false);
+    for (const fastgltf::Texture& gltf_texture : gltf.textures) {
+        for (const auto& image_index : { gltf_texture.ddsImageIndex, gltf_texture.basisuImageIndex }) {
+            if (image_index.has_value()) {
+                container_sources[image_index.value()] = true;
+                referenced_images[image_index.value()] = true;
+            }
+        }
+        if (gltf_texture.imageIndex.has_value()) {
+            referenced_images[gltf_texture.imageIndex.value()] = true;
+        }
+    }
+
+    const std::filesystem::path compression_cache_directory = path_filesys.parent_path() / "BlockCompressionCache";
+    std::error_code cache_directory_error;
+    std::filesystem::create_directories(compression_cache_directory, cache_directory_error);
+
+    // stbi's allocation is the base level, the rest of the chain follows in one block
+    struct PixelStorage {
+        std::unique_ptr<stbi_uc, decltype(&stbi_image_free)> base { nullptr, stbi_image_free };
+        std::vector<uint8_t> mip_chain;
+    };
+
+    struct ImageTiming {
+        double decode_ms { 0.0 };
+        double mips_ms { 0.0 };
+        double compress_ms { 0.0 };
+        // RGBA8 bytes of the whole chain, only counted when it was encoded rather than read from the cache
+        size_t encoded_bytes { 0 };
+        double psnr { 0.0 };
+        bool cached { false };
+        // uploaded as stored in a DDS or KTX2 file
+        bool container { false };
+    };
+    std::vector<ImageTiming> image_timings(gltf.images.size());
+
+    // Bytes of an encoded image. Files are mapped and owner keeps the mapping, the bytes of buffer views live as long
+    // as the asset and owner stays empty.
+    const auto get_image_bytes = [&](const fastgltf::Image& image, std::string& name, std::shared_ptr<const void>& owner) {
+        std::span<const std::byte> bytes;
+
+        if (const fastgltf::sources::URI* p_img_loca_Path_URI = std::get_if<fastgltf::sources::URI>(&image.data)) {
+            assert(p_img_loca_Path_URI->fileByteOffset == 0); // We don't support offsets into image files.
+            assert(p_img_loca_Path_URI->uri.isLocalPath()); // We're only capable of loading local files.
+
+            const std::string img_local_path(
+                p_img_loca_Path_URI->uri.path().begin(),
+                p_img_loca_Path_URI->uri.path().end()); // Thanks C++.
+            const std::filesystem::path absolute_path = path_filesys.parent_path().append(img_local_path);
+
+            name = img_local_path;
+            // MappedFile throws on a missing file, a missing image only gets a null SRV
+            if (!std::filesystem::exists(absolute_path)) {
+                return bytes;
+            }
+            const auto file = std::make_shared<MappedFile>(absolute_path);
+            bytes = { file->GetData(), file->GetSize() };
+            owner = file;
+        } else if (const fastgltf::sources::Vector* p_vector = std::get_if<fastgltf::sources::Vector>(&image.data)) {
+            bytes = { reinterpret_cast<const std::byte*>(p_vector->bytes.data()), p_vector->bytes.size() };
+        } else if (const fastgltf::sources::BufferView* p_view = std::get_if<fastgltf::sources::BufferView>(&image.data)) {
+            const auto& buffer_view = gltf.bufferViews[p_view->bufferViewIndex];
+            const auto& buffer = gltf.buffers[buffer_view.bufferIndex];
+
+            const std::byte* buffer_bytes = GetBufferBytes(buffer);
+
+            if (buffer_bytes) {
+                bytes = { buffer_bytes + buffer_view.byteOffset, buffer_view.byteLength };
+            }
+        }
+        return bytes;
+    };
+
+    // Decoding is the slowest part of the import and every image is independent, so all images are decoded,
+    // mipmapped and compressed on the thread pool. Every job only writes its own TextureData, the GPU side later
+    // consumes them in image order.
+    model_data.textures.resize(gltf.images.size());
+
+    // How the materials use an image decides its mip filter and its block compressed format. The roles are marked once
+    // the containers are parsed, which picks the source of every texture, and only read by the plain images decoded
+    // after that.
+    std::vector<TextureRole> image_roles(gltf.images.size(), TextureRole::Unused);
+
+    const auto decode_image = [&](const size_t img_index) {
+        const ProfileZone image_zone("DecodeImage");
+        const fastgltf::Image& image = gltf.images[img_index];
+        TextureData& texture = model_data.textures[img_index];
+        texture.name = std::string(image.name.begin(), image.name.end());
+
+        const auto image_begin = std::chrono::steady_clock::now();
+        ImageTiming& timing = image_timings[img_index];
+
+        std::shared_ptr<const void> owner;
+        std::span<const std::byte> bytes = get_image_bytes(image, texture.name, owner);
+
+        //> container
+        // DDS and KTX2 levels are uploaded straight from the file bytes, no decode, mips or compression
+        if (IsTextureContainer(bytes.data(), bytes.size())) {
+            if (!owner) {
+                // the buffer goes away with the asset
+                const auto copy = std::make_shared<std::vector<std::byte>>(bytes.begin(), bytes.end());
+                bytes = *copy;
+                owner = copy;
+            }
+            std::string error;
+            if (!ParseTextureContainer(bytes.data(), bytes.size(), texture, error)) {
+                std::cerr << "Failed to load image " << img_index << " of " << gltf_file_path << ": " << error << '\n';
+                return;
+            }
+            // zstd supercompressed levels were inflated into storage of their own, the file bytes can go
+            if (!texture.storage) {
+                texture.storage = std::move(owner);
+            }
+            timing.container = true;
+            timing.decode_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - image_begin).count();
+            return;
+        }
+        //< container
+
+        if (bytes.empty()) {
+            std::cerr << "Failed to read image " << img_index << " of " << gltf_file_path << '\n';
+            return;
+        }
+        int width, height, nrChannels;
+        stbi_uc* pixels = stbi_load_from_memory(
+            reinterpret_cast<const stbi_uc*>(bytes.data()), static_cast<int>(bytes.size()),
+            &width, &height, &nrChannels, 4);
+
+        if (!pixels) {
+            std::cerr << "Failed to decode image " << img_index << " of " << gltf_file_path << ": " << stbi_failure_reason() << '\n';
+            return;
+        }
+        assert(nrChannels == 4 || nrChannels == 3);
+
+        const auto storage = std::make_shared<PixelStorage>();
+        storage->base.reset(pixels);
+        const auto mips_begin = std::chrono::steady_clock::now();
+
+        // stbi always expands to the 4 channels we asked for
+        texture.width = static_cast<UINT>(width);
+        texture.height = static_cast<UINT>(height);
+        texture.mip_levels = CountMipLevels(texture.width, texture.height);
+        texture.format = DXGI_FORMAT_R8G8B8A8_UNORM; // TODO: sRGB
+
+        D3D12_SUBRESOURCE_DATA texture_data = {};
+        texture_data.pData = pixels;
+        texture_data.RowPitch = static_cast<LONG_PTR>(width) * 4;
+        texture_data.SlicePitch = texture_data.RowPitch * height;
+        texture.subresources.push_back(texture_data);
+
+        // albedo and emissive maps hold sRGB encoded colors, their mips have to be averaged in linear light
+        const MipFilter mip_filter = image_roles[img_index] == TextureRole::Color ? MipFilter::SRGB : MipFilter::Linear;
+        storage->mip_chain.resize(GetMipChainSize(texture.width, texture.height));
+        GenerateMipChain(pixels, texture.width, texture.height, mip_filter, storage->mip_chain.data(), texture.subresources);
+        assert(texture.subresources.size() == texture.mip_levels);
+        texture.storage = storage;
+
+        const auto compress_begin = std::chrono::steady_clock::now();
+
+        // odd sized images stay RGBA8
+        const DXGI_FORMAT compressed_format = SelectBlockCompressedFormat(image_roles[img_index]);
+        if (CanBlockCompress(texture.width, texture.height)) {
+            // the mips are encoded too, so what made them is part of the key: color and data textures share BC7
+            const UINT32 cache_key[] = { static_cast<UINT32>(compressed_format), BLOCK_COMPRESSION_VERSION,
+                static_cast<UINT32>(mip_filter), MIP_GENERATOR_VERSION };
+            const uint64_t content_hash = HashBytes(pixels, texture_data.SlicePitch, HashBytes(cache_key, sizeof(cache_key)));
+            const std::filesystem::path cache_path = compression_cache_directory / std::format("{:016x}.bctex", content_hash);
+
+            timing.cached = ReadCompressedTexture(cache_path, compressed_format, texture);
+            if (!timing.cached) {
+                for (const D3D12_SUBRESOURCE_DATA& subresource : texture.subresources) {
+                    timing.encoded_bytes += subresource.SlicePitch;
+                }
+
+                const double squared_error = CompressTexture(texture, compressed_format);
+                const double mean_squared_error = squared_error / (static_cast<double>(texture.width) * texture.height * GetBlockCompressedChannelCount(compressed_format));
+                timing.psnr = mean_squared_error > 0.0 ? 10.0 * std::log10(255.0 * 255.0 / mean_squared_error) : INFINITY;
+
+                WriteCompressedTexture(cache_path, texture);
+            }
+        }
+
+        const auto image_end = std::chrono::steady_clock::now();
+        timing.decode_ms = std::chrono::duration<double, std::milli>(mips_begin - image_begin).count();
+        timing.mips_ms = std::chrono::duration<double, std::milli>(compress_begin - mips_begin).count();
+        timing.compress_ms = std::chrono::duration<double, std::milli>(image_end - compress_begin).count();
+    };
+
+    const auto decode_begin = std::chrono::steady_clock::now();
+    std::vector<size_t> container_images;
+    for (size_t img_index = 0; img_index < gltf.images.size(); ++img_index) {
+        if (container_sources[img_index]) {
+            container_images.push_back(img_index);
+        }
+    }
+    thread_pool.ParallelFor(container_images.size(), [&](const size_t i) { decode_image(container_images[i]); });
+
+    // first source of every texture that loaded, gltf.images.size() when it has none
+    std::vector<size_t> texture_images(gltf.textures.size(), gltf.images.size());
+    for (const auto [tex_index, gltf_texture] : std::ranges::views::enumerate(gltf.textures)) {
+        for (const auto& image_index : { gltf_texture.ddsImageIndex, gltf_texture.basisuImageIndex, gltf_texture.imageIndex }) {
+            if (image_index.has_value() && (!container_sources[image_index.value()] || !model_data.textures[image_index.value()].subresources.empty())) {
+                texture_images[tex_index] = image_index.value();
+                break;
+            }
+        }
+    }
+    const auto texture_image_index = [&](const size_t tex_index) {
+        return texture_images[tex_index] < gltf.images.size() ? static_cast<INT32>(texture_images[tex_index]) : -1;
+    };
+
+    // the roles of the images the textures ended up with
+    const auto mark_role = [&](const auto& texture_info, const TextureRole role) {
+        if (texture_info.has_value() && texture_image_index(texture_info.value().textureIndex) >= 0) {
+            TextureRole& image_role = image_roles[texture_images[texture_info.value().textureIndex]];
+            image_role = std::max(image_role, role);
+        }
+    };
+    for (const fastgltf::Material& mat : gltf.materials) {
+        mark_role(mat.pbrData.baseColorTexture, TextureRole::Color);
+        mark_role(mat.emissiveTexture, TextureRole::Color);
+        mark_role(mat.normalTexture, TextureRole::NormalMap);
+        mark_role(mat.pbrData.metallicRoughnessTexture, TextureRole::MetalRough);
+        mark_role(mat.occlusionTexture, TextureRole::Occlusion);
+    }
+
+    // plain images no texture falls back to are skipped, images no texture references are decoded as before
+    std::vector<bool> used_images(gltf.images.size(), false);
+    for (const size_t img_index : texture_images) {
+        if (img_index < gltf.images.size()) {
+            used_images[img_index] = true;
+        }
+    }
+    std::vector<size_t> plain_images;
+    for (size_t img_index = 0; img_index < gltf.images.size(); ++img_index) {
+        if (!container_sources[img_index] && (used_images[img_index] || !referenced_images[img_index])) {
+            plain_images.push_back(img_index);
+        }
+    }
+    thread_pool.ParallelFor(plain_images.size(), [&](const size_t i) { decode_image(plain_images[i]); });
+    const auto decode_end = std::chrono::steady_clock::now();
+    decode_zone.End();
+
+    // every image is encoded by a single thread, so bytes over encode time is the per core throughput
+    size_t total_encoded_bytes = 0;
+    double total_encode_ms = 0.0;
+    for (const auto [img_index, timing] : std::ranges::views::enumerate(image_timings)) {
+        const TextureData& texture = model_data.textures[img_index];
+        // failed, or a fallback no texture needed
+        if (texture.subresources.empty()) {
+            continue;
+        }
+        std::cout << "[GltfImporter]   " << texture.name << " " << texture.width << "x" << texture.height
+                  << (image_roles[img_index] == TextureRole::Color ? " srgb" : " linear")
+                  << ": decode " << timing.decode_ms << " ms, " << texture.mip_levels << " mips " << timing.mips_ms << " ms";
+        if (timing.container) {
+            std::cout << ", format " << texture.format << " from container";
+        } else if (timing.cached) {
+            std::cout << ", format " << texture.format << " from cache " << timing.compress_ms << " ms";
+        } else if (timing.encoded_bytes > 0) {
+            std::cout << ", format " << texture.format << " encoded in " << timing.compress_ms << " ms ("
+                      << timing.encoded_bytes / (1024.0 * 1024.0) / (timing.compress_ms / 1000.0) << " MB/s, PSNR "
+                      << timing.psnr << " dB)";
+            total_encoded_bytes += timing.encoded_bytes;
+            total_encode_ms += timing.compress_ms;
+        }
+        std::cout << '\n';
+    }
+    if (total_encoded_bytes > 0) {
+        std::cout << "[GltfImporter] block compression " << total_encoded_bytes / (1024.0 * 1024.0) / (total_encode_ms / 1000.0)
+                  << " MB/s per core" << '\n';
+    }
+    std::cout << "[GltfImporter] decoded " << gltf.images.size() << " images of " << gltf_file_path
+              << " on " << thread_pool.GetThreadCount() << " thread(s) in "
+              << std::chrono::duration<double, std::milli>(decode_end - decode_begin).count() << " ms" << '\n';
+    //< decode images
+
+    //> LOAD_MATERIAL AND FILL MATERIAL CONST DATA
+    model_data.materials.resize(gltf.materials.size());
+    for (const auto [mat_index, mat] :
+        std::ranges::views::enumerate(gltf.materials)) {
+        MaterialConstants& constants = model_data.materials[mat_index];
+        constants.colorFactors.x = mat.pbrData.baseColorFactor[0];
+        constants.colorFactors.y = mat.pbrData.baseColorFactor[1];
+        constants.colorFactors.z = mat.pbrData.baseColorFactor[2];
+        constants.colorFactors.w = mat.pbrData.baseColorFactor[3];
+
+        constants.metalRoughFactors.x = mat.pbrData.metallicFactor;
+        constants.metalRoughFactors.y = mat.pbrData.roughnessFactor;
+
+        // TODO: alpha blending, emissve, blooming
+        //  auto passType = MaterialPassType::MainColor;
+        //   if (mat.alphaMode == fastgltf::AlphaMode::Blend) {
+        //     passType = MaterialPassType::Transparent;
+        //   }
+
+        // install textures index
+        if (mat.pbrData.baseColorTexture.has_value()) {
+            constants.albedoIndex = texture_image_index(mat.pbrData.baseColorTexture.value().textureIndex);
+            constants.albedoSamplerIndex = gltf.textures[mat.pbrData.baseColorTexture.value().textureIndex]
+                                               .samplerIndex.value();
+        }
+
+        if (mat.pbrData.metallicRoughnessTexture.has_value()) {
+            constants.metalRoughIndex = texture_image_index(mat.pbrData.metallicRoughnessTexture.value().textureIndex);
+            constants.metalRoughSamplerIndex = gltf.textures[mat.pbrData.metallicRoughnessTexture.value()
+                                                                 .textureIndex]
+                                                   .samplerIndex.value();
+        }
+
+        if (mat.normalTexture.has_value()) {
+            constants.normalIndex = texture_image_index(mat.normalTexture.value().textureIndex);
+            constants.normalSamplerIndex = gltf.textures[mat.normalTexture.value().textureIndex]
+                                               .samplerIndex.value();
+        }
+
+        if (mat.emissiveTexture.has_value()) {
+            constants.emissiveIndex = texture_image_index(mat.emissiveTexture.value().textureIndex);
+            constants.emissiveSamplerIndex = gltf.textures[mat.emissiveTexture.value().textureIndex]
+                                                 .samplerIndex.value();
+        }
+
+        if (mat.occlusionTexture.has_value()) {
+            constants.occlusionIndex = texture_image_index(mat.occlusionTexture.value().textureIndex);
+            constants.occlusionSamplerIndex = gltf.textures[mat.occlusionTexture.value().textureIndex]
+                                                  .samplerIndex.value();
+        }
+    }
+    //< load_material
+
+    //> LOAD_MESHES
+    // Every primitive is read into arrays of its own by a job on the pool, the arrays of a mesh are then concatenated
+    // in primitive order, so the result doesn't depend on which thread read what.
+    struct PrimitiveData {
+        GeoSurface surface;
+        // relative to the first vertex of the primitive
+        std::vector<uint32_t> indices;
+        std::vector<StandardVertex> vertices;
+    };
+
+    // primitives of mesh i are [first_primitives[i], first_primitives[i + 1])
+    std::vector<size_t> first_primitives(gltf.meshes.size() + 1, 0);
+    std::vector<size_t> primitive_meshes;
+    for (const auto [mesh_index, mesh] : std::ranges::views::enumerate(gltf.meshes)) {
+        first_primitives[mesh_index + 1] = first_primitives[mesh_index] + mesh.primitives.size();
+        primitive_meshes.insert(primitive_meshes.end(), mesh.primitives.size(), mesh_index);
+    }
+    std::vector<PrimitiveData> primitives(primitive_meshes.size());
+
+    ProfileZone read_zone("ReadPrimitives");
+    const auto ingest_begin = std::chrono::steady_clock::now();
+    thread_pool.ParallelFor(primitives.size(), [&](const size_t primitive_index) {
+        const ProfileZone primitive_zone("ReadPrimitive");
+        const size_t mesh_index = primitive_meshes[primitive_index];
+        fastgltf::Primitive& p = gltf.meshes[mesh_index].primitives[primitive_index - first_primitives[mesh_index]];
+
+        PrimitiveData& primitive = primitives[primitive_index];
+        std::vector<uint32_t>& indices = primitive.indices;
+        std::vector<StandardVertex>& vertices = primitive.vertices;
+        GeoSurface& newSurface = primitive.surface;
+        newSurface.count = static_cast<uint32_t>(
+            gltf.accessors[p.indicesAccessor.value()].count);
+
+        // load indexes
+        {
+            const fastgltf::Accessor& indexaccessor = gltf.accessors[p.indicesAccessor.value()];
+            indices.resize(indexaccessor.count);
+
+            AttributeStream index_stream;
+            const uint32_t index_size = static_cast<uint32_t>(fastgltf::getElementByteSize(indexaccessor.type, indexaccessor.componentType));
+            if (GetAttributeStream(gltf, indexaccessor, index_stream) && index_stream.stride == index_size) {
+                ConvertIndices(index_stream.data, index_size, indices.size(), indices.data());
+            } else {
+                fastgltf::iterateAccessorWithIndex<std::uint32_t>(
+                    gltf, indexaccessor,
+                    [&](std::uint32_t idx, size_t index) {
+                        indices[index] = idx;
+                    });
+            }
+        }
+
+        // load vertices, every attribute of a vertex is read and packed in one pass
+        {
+            VertexStreams streams;
+            std::vector<float> scratch[5];
+            const auto bind_attribute = [&](const std::string_view name, AttributeStream& stream, std::vector<float>& attribute_scratch) {
+                const auto attribute = p.findAttribute(name);
+                if (attribute == p.attributes.end()) {
+                    return;
+                }
+                const fastgltf::Accessor& accessor = gltf.accessors[attribute->second];
+                if (GetAttributeStream(gltf, accessor, stream)) {
+                    return;
+                }
+                switch (fastgltf::getNumComponents(accessor.type)) {
+                case 2:
+                    stream = CopyAttributeStream<glm::vec2>(gltf, accessor, attribute_scratch);
+                    break;
+                case 3:
+                    stream = CopyAttributeStream<glm::vec3>(gltf, accessor, attribute_scratch);
+                    break;
+                default:
+                    stream = CopyAttributeStream<glm::vec4>(gltf, accessor, attribute_scratch);
+                    break;
+                }
+            };
+            bind_attribute("POSITION", streams.position, scratch[0]);
+            bind_attribute("NORMAL", streams.normal, scratch[1]);
+            bind_attribute("TANGENT", streams.tangent, scratch[2]);
+            bind_attribute("TEXCOORD_0", streams.uv, scratch[3]);
+            bind_attribute("COLOR_0", streams.color, scratch[4]);
+
+            vertices.resize(gltf.accessors[p.findAttribute("POSITION")->second].count);
+            ConvertVertices(streams, vertices.size(), vertices.data());
+        }
+
+        // welding later only merges identical vertices, the positions of the primitive stay what they are here
+        if (!vertices.empty()) {
+            newSurface.bounds = ComputeBounds(vertices.data(), vertices.size());
+        }
+
+        // load material index
+        if (p.materialIndex.has_value()) {
+            newSurface.materialIndex = p.materialIndex.value();
+        } else {
+            assert(false);
+            newSurface.materialIndex = UINT32_MAX;
+        }
+    });
+
+    read_zone.End();
+
+    //> merge
+    ProfileZone merge_zone("MergePrimitives");
+    model_data.meshes.resize(gltf.meshes.size());
+    thread_pool.ParallelFor(gltf.meshes.size(), [&](const size_t mesh_index) {
+        MeshData& mesh_data = model_data.meshes[mesh_index];
+        mesh_data.name = gltf.meshes[mesh_index].name.append(std::to_string(mesh_index));
+
+        size_t vertex_count = 0;
+        size_t index_count = 0;
+        for (size_t primitive_index = first_primitives[mesh_index]; primitive_index < first_primitives[mesh_index + 1]; ++primitive_index) {
+            vertex_count += primitives[primitive_index].vertices.size();
+            index_count += primitives[primitive_index].indices.size();
+        }
+        mesh_data.vertices.reserve(vertex_count);
+        mesh_data.indices.reserve(index_count);
+        mesh_data.surfaces.reserve(first_primitives[mesh_index + 1] - first_primitives[mesh_index]);
+
+        for (size_t primitive_index = first_primitives[mesh_index]; primitive_index < first_primitives[mesh_index + 1]; ++primitive_index) {
+            PrimitiveData& primitive = primitives[primitive_index];
+            const uint32_t first_vertex = static_cast<uint32_t>(mesh_data.vertices.size());
+            primitive.surface.startIndex = static_cast<uint32_t>(mesh_data.indices.size());
+
+            mesh_data.vertices.insert(mesh_data.vertices.end(), primitive.vertices.begin(), primitive.vertices.end());
+            for (const uint32_t index : primitive.indices) {
+                mesh_data.indices.push_back(index + first_vertex);
+            }
+            mesh_data.surfaces.push_back(primitive.surface);
+
+            // the merged copy is all that's needed from here on
+            primitive = PrimitiveData {};
+        }
+    });
+    merge_zone.End();
+    //< merge
+    const auto ingest_end = std::chrono::steady_clock::now();
+    std::cout << "[GltfImporter] read " << primitives.size() << " primitives of " << gltf.meshes.size() << " meshes with "
+              << GetSimdLevelName(GetSimdLevel()) << " kernels on " << thread_pool.GetThreadCount() << " thread(s) in "
+              << std::chrono::duration<double, std::milli>(ingest_end - ingest_begin).count() << " ms" << '\n';
+    //< load_meshes
+
+    //> OPTIMIZE MESHES
+    // welds duplicate vertices, reorders triangles for the post-transform cache and overdraw, splits the surfaces into
+    // meshlets, simplifies the levels of detail, then orders the vertices for fetch locality
+    ProfileZone optimize_zone("OptimizeMeshes");
+    const auto optimize_begin = std::chrono::steady_clock::now();
+    std::vector<MeshOptimizationStats> mesh_stats(model_data.meshes.size());
+    thread_pool.ParallelFor(model_data.meshes.size(), [&](const size_t mesh_index) {
+        const ProfileZone mesh_zone("OptimizeMesh");
+        mesh_stats[mesh_index] = OptimizeMesh(model_data.meshes[mesh_index]);
+    });
+    const auto optimize_end = std::chrono::steady_clock::now();
+    optimize_zone.End();
+
+    size_t vertex_count_before = 0;
+    size_t vertex_count_after = 0;
+    size_t meshlet_count = 0;
+    size_t meshlet_vertices = 0;
+    size_t meshlet_triangles = 0;
+    size_t lod_triangles[SURFACE_LOD_COUNT] {};
+    float lod_error[SURFACE_LOD_COUNT] {};
+    for (const auto [mesh_index, stats] : std::ranges::views::enumerate(mesh_stats)) {
+        std::cout << "[GltfImporter]   " << model_data.meshes[mesh_index].name
+                  << ": vertices " << stats.vertex_count_before << " -> " << stats.vertex_count_after
+                  << ", ACMR " << stats.before.acmr << " -> " << stats.after.acmr
+                  << ", ATVR " << stats.before.atvr << " -> " << stats.after.atvr
+                  << ", " << stats.meshlet_count << " meshlets" << '\n';
+        vertex_count_before += stats.vertex_count_before;
+        vertex_count_after += stats.vertex_count_after;
+        meshlet_count += stats.meshlet_count;
+        meshlet_vertices += stats.meshlet_vertices;
+        meshlet_triangles += stats.meshlet_triangles;
+        for (uint32_t level = 0; level < SURFACE_LOD_COUNT; ++level) {
+            lod_triangles[level] += stats.lod_triangles[level];
+            lod_error[level] = std::max(lod_error[level], stats.lod_error[level]);
+        }
+    }
+    std::cout << "[GltfImporter] optimized " << model_data.meshes.size() << " meshes for a " << VERTEX_CACHE_SIZE
+              << " entry vertex cache in " << std::chrono::duration<double, std::milli>(optimize_end - optimize_begin).count()
+              << " ms, welded " << vertex_count_before << " vertices into " << vertex_count_after << " ("
+              << (vertex_count_before - vertex_count_after) * sizeof(StandardVertex) / 1024 << " KB saved)" << '\n';
+    if (meshlet_count > 0) {
+        std::cout << "[GltfImporter] " << meshlet_count << " meshlets, on average "
+                  << static_cast<double>(meshlet_vertices) / meshlet_count << " / " << MESHLET_MAX_VERTICES << " vertices and "
+                  << static_cast<double>(meshlet_triangles) / meshlet_count << " / " << MESHLET_MAX_TRIANGLES << " triangles" << '\n';
+    }
+    for (uint32_t level = 1; level < SURFACE_LOD_COUNT && lod_triangles[level] > 0; ++level) {
+        std::cout << "[GltfImporter] LOD " << level << ": " << lod_triangles[level] << " triangles, max error "
+                  << lod_error[level] << '\n';
+    }
+    //< optimize meshes
+
+    //> DEDUPLICATE
+    // Identical images, samplers and materials collapse into one, each is one descriptor less in the model's tables.
+    // The textures keep their content hash, so TextureCache can share them with other models too.
+    ProfileZone dedupe_zone("Deduplicate");
+    thread_pool.ParallelFor(model_data.textures.size(), [&](const size_t img_index) {
+        model_data.textures[img_index].content_hash = HashTexture(model_data.textures[img_index]);
+    });
+
+    const size_t texture_count = model_data.textures.size();
+    const size_t sampler_count = model_data.samplers.size();
+    const size_t material_count = model_data.materials.size();
+    size_t texture_bytes = 0;
+    for (const TextureData& texture : model_data.textures) {
+        for (const D3D12_SUBRESOURCE_DATA& subresource : texture.subresources) {
+            texture_bytes += subresource.SlicePitch;
+        }
+    }
+
+    const std::vector<INT32> texture_remap = CollapseDuplicates(
+        model_data.textures,
+        [](const TextureData& texture) { return texture.content_hash; },
+        SameTexture);
+    const std::vector<INT32> sampler_remap = CollapseDuplicates(
+        model_data.samplers,
+        [](const D3D12_SAMPLER_DESC& sampler) { return HashBytes(&sampler, sizeof(sampler)); },
+        [](const D3D12_SAMPLER_DESC& a, const D3D12_SAMPLER_DESC& b) { return memcmp(&a, &b, sizeof(a)) == 0; });
+
+    // materials only compare equal once they point at the surviving textures and samplers
+    for (MaterialConstants& constants : model_data.materials) {
+        RemapIndex(constants.albedoIndex, texture_remap);
+        RemapIndex(constants.metalRoughIndex, texture_remap);
+        RemapIndex(constants.normalIndex, texture_remap);
+        RemapIndex(constants.emissiveIndex, texture_remap);
+        RemapIndex(constants.occlusionIndex, texture_remap);
+        RemapIndex(constants.albedoSamplerIndex, sampler_remap);
+        RemapIndex(constants.metalRoughSamplerIndex, sampler_remap);
+        RemapIndex(constants.normalSamplerIndex, sampler_remap);
+        RemapIndex(constants.emissiveSamplerIndex, sampler_remap);
+        RemapIndex(constants.occlusionSamplerIndex, sampler_remap);
+    }
+    // value initialized, so the padding compares equal too
+    const std::vector<INT32> material_remap = CollapseDuplicates(
+        model_data.materials,
+        [](const MaterialConstants& constants) { return HashBytes(&constants, sizeof(constants)); },
+        [](const MaterialConstants& a, const MaterialConstants& b) { return memcmp(&a, &b, sizeof(a)) == 0; });
+    for (MeshData& mesh : model_data.meshes) {
+        for (GeoSurface& surface : mesh.surfaces) {
+            if (surface.materialIndex != UINT32_MAX) {
+                surface.materialIndex = static_cast<uint32_t>(material_remap[surface.materialIndex]);
+            }
+        }
+    }
+
+    for (const TextureData& texture : model_data.textures) {
+        for (const D3D12_SUBRESOURCE_DATA& subresource : texture.subresources) {
+            texture_bytes -= subresource.SlicePitch;
+        }
+    }
+    const size_t textures_saved = texture_count - model_data.textures.size();
+    const size_t samplers_saved = sampler_count - model_data.samplers.size();
+    const size_t materials_saved = material_count - model_data.materials.size();
+    std::cout << "[GltfImporter] deduplicated " << textures_saved << " textures (" << texture_bytes / 1024 << " KB), "
+              << samplers_saved << " samplers and " << materials_saved << " materials, "
+              << textures_saved + samplers_saved + materials_saved << " descriptors saved" << '\n';
+    dedupe_zone.End();
+    //< deduplicate
+
+    //> LOAD_NODES
+    const ProfileZone nodes_zone("ImportNodes");
+    model_data.nodes.resize(gltf.nodes.size());
+    for (auto [node_index, node] : std::ranges::views::enumerate(gltf.nodes)) {
+        NodeData& node_data = model_data.nodes[node_index];
+
+        // hook the node to its mesh, if it has one
+        if (node.meshIndex.has_value()) {
+            node_data.mesh_index = static_cast<INT32>(*node.meshIndex);
+        }
+
+        std::visit(
+            fastgltf::visitor {
+                [&](const fastgltf::Node::TransformMatrix& matrix) {
+                    memcpy(&node_data.local_transform, matrix.data(),
+                        sizeof(matrix));
+                },
+
+                [&](const fastgltf::Node::TRS& transform) {
+                    const glm::vec3 tl(transform.translation[0],
+                        transform.translation[1],
+                        transform.translation[2]);
+                    const glm::quat rot(
+                        transform.rotation[3], transform.rotation[0],
+                        transform.rotation[1], transform.rotation[2]);
+                    const glm::vec3 sc(transform.scale[0], transform.scale[1],
+                        transform.scale[2]);
+
+                    const glm::mat4 tm = translate(glm::mat4(1.f), tl);
+                    const glm::mat4 rm = glm::toMat4(rot);
+                    const glm::mat4 sm = scale(glm::mat4(1.f), sc);
+                    node_data.local_transform = tm * rm * sm;
+                } },
+            node.transform);
+    }
+    //< load_nodes
+
+    //> LOAD_SCENE_GRAPH
+    for (auto [node_index, node] : std::ranges::views::enumerate(gltf.nodes)) {
+        for (auto& c : node.children) {
+            model_data.nodes[node_index].children.push_back(static_cast<uint32_t>(c));
+            model_data.nodes[c].parent_index = static_cast<INT32>(node_index);
+        }
+    }
+    //< load_scene_graph
+}
+
+}
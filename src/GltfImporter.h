@@ -0,0 +1,22 @@
+#pragma once
+
+#include "ModelData.h"
+#include "ThreadPool.h"
+
+#include <string>
+
+namespace Anni {
+
+// How the .gltf/.glb and its buffers get into memory during the import.
+enum class BufferLoadMode {
+    // fastgltf reads the files into heap vectors
+    CopyToHeap,
+    // files are mapped read-only and accessors are read straight from the mapping
+    MemoryMapped,
+};
+
+// Parses a glTF file, decodes its images and converts meshes, materials, samplers and nodes into ModelData.
+// Nothing here touches the GPU, so the scene cooker runs exactly the same import as the renderer.
+void ImportGltf(const std::string& gltf_file_path, ThreadPool& thread_pool, BufferLoadMode buffer_load_mode, ModelData& model_data);
+
+}
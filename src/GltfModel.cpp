@@ -1,16 +1,33 @@
 #include "GltfModel.h"
-#define STB_IMAGE_IMPLEMENTATION
-#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include "LoadProfiler.h"
 
-#include "stb_image.h"
+#include <chrono>
 
 namespace Anni {
 
+namespace {
+
+    // one CBV per RenderObject, each holds its final matrix
+    constexpr UINT LOCAL_MATRIX_CBV_SIZE = (sizeof(glm::mat4) + (D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT - 1)) & ~(D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT - 1);
+
+}
+
 void GltfModel::Draw(const glm::mat4& top_matrix, DrawContext& ctx)
 {
+    // room for every surface up front, a context that is built every frame keeps it
+    ctx.OpaqueSurfaces.reserve(ctx.OpaqueSurfaces.size() + m_num_render_objects);
+    ctx.OpaqueBounds.reserve(ctx.OpaqueBounds.size() + m_num_render_objects);
+
+    // the node matrices of all mesh nodes in one batch
+    glm::mat4* node_matrices = ctx.Scratch.AllocateArray<glm::mat4>(m_meshNodes.size());
+    for (size_t i = 0; i < m_meshNodes.size(); ++i) {
+        node_matrices[i] = m_hierarchy.GetWorldTransform(m_meshNodes[i].node);
+    }
+    MultiplyMatrices(top_matrix, node_matrices, m_meshNodes.size(), node_matrices);
+
     // create renderables from the scenenodes
-    for (const auto& n : m_topNodes) {
-        n->Draw(top_matrix, ctx);
+    for (size_t i = 0; i < m_meshNodes.size(); ++i) {
+        m_meshNodes[i].Draw(node_matrices[i], ctx);
     }
 }
 
@@ -39,9 +56,10 @@ CD3DX12_GPU_DESCRIPTOR_HANDLE GltfModel::GetGPUDescHandleToMaterialConstantsBuff
     return m_gpu_desc_handle_to_mat_consts_srvs;
 }
 
-CD3DX12_GPU_DESCRIPTOR_HANDLE GltfModel::GetGPUDescHandleToLocalMatricesBuffer() const
+CD3DX12_GPU_DESCRIPTOR_HANDLE GltfModel::GetGPUDescHandleToLocalMatricesBuffer(const UINT frame_index) const
 {
-    return m_gpu_desc_handle_to_local_matrices_cbv;
+    assert(frame_index < FRAME_INFLIGHT_COUNT);
+    return CD3DX12_GPU_DESCRIPTOR_HANDLE(m_gpu_desc_handle_to_local_matrices_cbv, frame_index * m_num_render_objects, m_cbvSrvUavDescriptorSize);
 }
 
 CD3DX12_GPU_DESCRIPTOR_HANDLE GltfModel::GetGPUDescHandleToTexturesTable() const
@@ -54,6 +72,11 @@ CD3DX12_GPU_DESCRIPTOR_HANDLE GltfModel::GetGPUDescHandleToSamplers() const
     return m_gpu_desc_handle_to_sampler;
 }
 
+const GeometryPool& GltfModel::GetGeometryPool() const
+{
+    return *m_geometryPool;
+}
+
 void GltfModel::CopyAllDescriptorsTo(ID3D12DescriptorHeap* shader_visible_cbv_srv_uva_heap, ID3D12DescriptorHeap* shader_visible_sampler_heap, CD3DX12_CPU_DESCRIPTOR_HANDLE* dest_shader_visible_cbv_srv_uav_heap_handle, CD3DX12_CPU_DESCRIPTOR_HANDLE* dest_shader_visible_sampler_heap_handle)
 {
 
@@ -90,7 +113,7 @@ void GltfModel::CopyAllDescriptorsTo(ID3D12DescriptorHeap* shader_visible_cbv_sr
     // ��copy ���е� cbv srv uav��Ȼ���ټ�������
 
     ////////                    bindless                  bindless          ÿ��draw call��index���������滻,TEMP_LOCAL_MATRICES_CBV_COUNT��magic number
-    const UINT copy_cout = m_texturesImages.size() + m_num_material_views + TEMP_LOCAL_MATRICES_CBV_COUNT;
+    const UINT copy_cout = m_texturesImages.size() + m_num_material_views + FRAME_INFLIGHT_COUNT * TEMP_LOCAL_MATRICES_CBV_COUNT;
     {
         m_pp_device->CopyDescriptorsSimple(
             copy_cout,
@@ -129,46 +152,27 @@ void GltfModel::CopyAllDescriptorsTo(ID3D12DescriptorHeap* shader_visible_cbv_sr
 
 GltfModel::~GltfModel()
 {
-    for (const auto& p_tex : m_4_com_tex_temp_buffers) {
-        stbi_image_free(p_tex);
-    }
-}
-
-D3D12_FILTER GltfModel::ExtractFilterAndMipMapMode(const fastgltf::Filter min_filter, const fastgltf::Filter mag_filter, const fastgltf::Filter mip_map_mode)
-{
-    // TODO:
-    return D3D12_FILTER_MIN_MAG_MIP_POINT;
-}
-
-D3D12_TEXTURE_ADDRESS_MODE GltfModel::ExtractAddressMode(const fastgltf::Wrap warp)
-{
-    switch (warp) {
-    case fastgltf::Wrap::ClampToEdge:
-        return D3D12_TEXTURE_ADDRESS_MODE_CLAMP;
-
-    case fastgltf::Wrap::MirroredRepeat:
-        return D3D12_TEXTURE_ADDRESS_MODE_MIRROR;
-
-    case fastgltf::Wrap::Repeat:
-        return D3D12_TEXTURE_ADDRESS_MODE_WRAP;
-    default:
-        assert(false);
+    for (size_t i = 0; i < m_num_meshes; ++i) {
+        m_geometryPool->Free(m_meshes[i].geometry);
     }
-    return {};
 }
 
-GltfModel::GltfModel(ID3D12Device* pp_device, ID3D12GraphicsCommandList* pp_copy_cmd_list)
+GltfModel::GltfModel(ID3D12Device* pp_device, ResourceHeapAllocator& heap_allocator, GeometryPool& geometry_pool, TextureCache& texture_cache)
     : IRenderable()
     , m_num_samplers(0)
     , m_num_material_views(0)
     , m_samplerDescriptorSize(0)
     , m_cbvSrvUavDescriptorSize(0)
     , m_pp_device(pp_device)
-    , m_copyCommandList(pp_copy_cmd_list)
+    , m_heapAllocator(&heap_allocator)
+    , m_geometryPool(&geometry_pool)
+    , m_textureCache(&texture_cache)
     , m_materialConstantDataBuffer()
     , materialConstBufferMappedGPUAddress(nullptr)
     , m_localMatricesDataBuffer()
     , localMatricesBufferMappedGPUAddress(nullptr)
+    , m_num_render_objects(0)
+    , m_num_meshes(0)
     , m_gpu_desc_handle_to_texture_srvs()
     , m_gpu_desc_handle_to_mat_consts_srvs()
     , m_gpu_desc_handle_to_local_matrices_cbv()
@@ -181,48 +185,47 @@ GltfModel::GltfModel(ID3D12Device* pp_device, ID3D12GraphicsCommandList* pp_copy
         D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
 }
 
-void GltfModel::LoadFromFile(const std::string gltf_file_path)
+void GltfModel::LoadFromFile(const std::string gltf_file_path, ThreadPool& thread_pool, StagingRing& staging_ring, const BufferLoadMode buffer_load_mode)
 {
-    fastgltf::Parser parser {};
-
-    constexpr auto gltfOptions = fastgltf::Options::DontRequireValidAssetMember | fastgltf::Options::AllowDouble | fastgltf::Options::LoadGLBBuffers | fastgltf::Options::LoadExternalBuffers;
-    // fastgltf::Options::LoadExternalImages;
-
-    fastgltf::Asset gltf;
-    std::filesystem::path path_filesys = gltf_file_path;
-
-    fastgltf::GltfDataBuffer data;
-    data.loadFromFile(gltf_file_path);
-
-    //> LOAD_RAW GLTF RAW FILE LOADING
-    auto type = determineGltfFileType(&data);
-    if (type == fastgltf::GltfType::glTF) {
-        auto load = parser.loadGLTF(&data, path_filesys.parent_path(), gltfOptions);
-        if (load) {
-            gltf = std::move(load.get());
-        } else {
-            std::cerr << "Failed to load glTF: " << to_underlying(load.error())
-                      << '\n';
-            assert(false);
-        }
-    } else if (type == fastgltf::GltfType::GLB) {
-        auto load = parser.loadBinaryGLTF(&data, path_filesys.parent_path(),
-            gltfOptions);
-        if (load) {
-            gltf = std::move(load.get());
-        } else {
-            std::cerr << "Failed to load glTF: " << to_underlying(load.error())
-                      << '\n';
-            assert(false);
-        }
-    } else {
-        std::cerr << "Failed to determine glTF container" << '\n';
-        assert(false);
+    const ProfileAsset profile_asset(gltf_file_path);
+    const auto load_begin = std::chrono::steady_clock::now();
+
+    ModelData model_data;
+    ImportGltf(gltf_file_path, thread_pool, buffer_load_mode, model_data);
+    CreateResources(std::move(model_data), staging_ring);
+
+    const auto load_end = std::chrono::steady_clock::now();
+    std::cout << "[GltfModel] loaded " << gltf_file_path
+              << (buffer_load_mode == BufferLoadMode::MemoryMapped ? " (memory mapped)" : " (copied to heap)")
+              << " in " << std::chrono::duration<double, std::milli>(load_end - load_begin).count() << " ms"
+              << ", peak working set " << GetPeakWorkingSetSize() / (1024 * 1024) << " MB" << '\n';
+}
+
+bool GltfModel::LoadFromPack(const std::string& pack_file_path, const std::string& gltf_file_path, StagingRing& staging_ring)
+{
+    const ProfileAsset profile_asset(pack_file_path);
+    const auto load_begin = std::chrono::steady_clock::now();
+
+    ModelData model_data;
+    if (!ReadScenePack(pack_file_path, gltf_file_path, model_data)) {
+        return false;
     }
-    //< load_raw
+    CreateResources(std::move(model_data), staging_ring);
 
-    //> LOAD_SAMPLERS
-    m_num_samplers = gltf.samplers.size();
+    const auto load_end = std::chrono::steady_clock::now();
+    std::cout << "[GltfModel] loaded " << pack_file_path << " (scene pack)"
+              << " in " << std::chrono::duration<double, std::milli>(load_end - load_begin).count() << " ms"
+              << ", peak working set " << GetPeakWorkingSetSize() / (1024 * 1024) << " MB" << '\n';
+    return true;
+}
+
+void GltfModel::CreateResources(ModelData&& model_data, StagingRing& staging_ring)
+{
+    const ProfileZone create_zone("CreateResources");
+
+    //> CREATE_SAMPLERS
+    ProfileZone samplers_zone("CreateSamplers");
+    m_num_samplers = model_data.samplers.size();
 
     // Describe and create a sampler descriptor heap.
     D3D12_DESCRIPTOR_HEAP_DESC samplerHeapDesc = {};
@@ -240,37 +243,21 @@ void GltfModel::LoadFromFile(const std::string gltf_file_path)
     CD3DX12_CPU_DESCRIPTOR_HANDLE samplerHandle(
         m_samplerHeap->GetCPUDescriptorHandleForHeapStart());
 
-    for (fastgltf::Sampler& sampler : gltf.samplers) {
-        // Describe and create the wrapping sampler, which is used for
-        // sampling diffuse/normal maps.
-        D3D12_SAMPLER_DESC sampler_desc = {};
-        sampler_desc.Filter = ExtractFilterAndMipMapMode(
-            sampler.minFilter.value_or(fastgltf::Filter::Nearest),
-            sampler.magFilter.value_or(fastgltf::Filter::Nearest),
-            sampler.minFilter.value_or(fastgltf::Filter::Nearest));
-
-        sampler_desc.AddressU = ExtractAddressMode(sampler.wrapS);
-        sampler_desc.AddressV = ExtractAddressMode(sampler.wrapT);
-        sampler_desc.AddressW = sampler_desc.AddressU;
-
-        sampler_desc.MinLOD = 0;
-        sampler_desc.MaxLOD = D3D12_FLOAT32_MAX;
-        sampler_desc.MipLODBias = 0.0f;
-        sampler_desc.MaxAnisotropy = 1;
-        sampler_desc.ComparisonFunc = D3D12_COMPARISON_FUNC_NEVER;
-        sampler_desc.BorderColor[0] = sampler_desc.BorderColor[1] = sampler_desc.BorderColor[2] = sampler_desc.BorderColor[3] = 0;
+    for (const D3D12_SAMPLER_DESC& sampler_desc : model_data.samplers) {
         m_pp_device->CreateSampler(&sampler_desc, samplerHandle);
 
         // Move the handle to the next slot in the descriptor heap.
         samplerHandle.Offset(m_samplerDescriptorSize);
     }
-    //< load_SAMPLERS
+    samplers_zone.End();
+    //< create_samplers
 
-    //> LOAD ALL TEXTURES
+    //> CREATE ALL TEXTURES
+    ProfileZone textures_zone("CreateTextures");
     // Describe and create a cbvSrvUav descriptor heap.
     D3D12_DESCRIPTOR_HEAP_DESC cbv_srv_uav_heap_desc = {};
     // TODO: �޸�cbv����Ŀ��Ŀǰ��ʱ����200
-    cbv_srv_uav_heap_desc.NumDescriptors = gltf.images.size() + gltf.materials.size() + TEMP_LOCAL_MATRICES_CBV_COUNT; // 200 extra for cbv
+    cbv_srv_uav_heap_desc.NumDescriptors = model_data.textures.size() + model_data.materials.size() + FRAME_INFLIGHT_COUNT * TEMP_LOCAL_MATRICES_CBV_COUNT; // 200 extra for cbv, per frame in flight
     cbv_srv_uav_heap_desc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
     cbv_srv_uav_heap_desc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_NONE;
     ThrowIfFailed(m_pp_device->CreateDescriptorHeap(
@@ -281,538 +268,56 @@ void GltfModel::LoadFromFile(const std::string gltf_file_path)
     CD3DX12_CPU_DESCRIPTOR_HANDLE cbvSrvUavHandle(
         m_cbvSrvUavHeap->GetCPUDescriptorHandleForHeapStart());
 
-    m_texturesImages.resize(gltf.images.size());
-    m_textureImageUploads.resize(gltf.images.size());
-
-    for (const auto [img_index, image] :
-        std::ranges::views::enumerate(gltf.images)) {
-        int width, height, nrChannels;
-        // std::string img_name = image.name.c_str();
-
-        constexpr auto loading_format_of_image = DXGI_FORMAT_R8G8B8A8_UNORM; // TODO: �ѱ�����ô��UNORM����
-        //
-        //        const auto img_visitor = fastgltf::visitor {
-        //            [](auto& arg) {},
-        //
-        //            [&](const fastgltf::sources::URI& img_loca_Path_URI) {
-        //                assert(img_loca_Path_URI.fileByteOffset == 0); // We don't support offsets with stbi.
-        //                assert(img_loca_Path_URI.uri
-        //                           .isLocalPath()); // We're only capable of loading
-        //                                            // local files.
-        //
-        //                const std::string img_local_path(
-        //                    img_loca_Path_URI.uri.path().begin(),
-        //                    img_loca_Path_URI.uri.path().end()); // Thanks C++.
-        //
-        //                const std::filesystem::path absolute_path = path_filesys.parent_path().append(img_local_path);
-        //
-        //                unsigned char* const tex_data = stbi_load(absolute_path.generic_string().c_str(), &width,
-        //                    &height, &nrChannels, 4);
-        //
-        //                if (tex_data) {
-        //
-        //                    const UINT64 t_width = width;
-        //                    const UINT t_height = height;
-        //                    constexpr UINT16 depthOrArraySize = 1;
-        //
-        //                    constexpr auto format_of_image = loading_format_of_image;
-        //
-        //                    constexpr UINT16 dummy_mip_levels = 1;
-        //                    const CD3DX12_RESOURCE_DESC tex_desc(
-        //                        D3D12_RESOURCE_DIMENSION_TEXTURE2D, 0, t_width,
-        //                        t_height, depthOrArraySize, dummy_mip_levels,
-        //                        format_of_image, 1, 0, D3D12_TEXTURE_LAYOUT_UNKNOWN,
-        //                        D3D12_RESOURCE_FLAG_NONE);
-        //
-        //                    ThrowIfFailed(m_pp_device->CreateCommittedResource(
-        //                        &CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT),
-        //                        D3D12_HEAP_FLAG_NONE, &tex_desc,
-        //                        D3D12_RESOURCE_STATE_COPY_DEST, nullptr,
-        //                        IID_PPV_ARGS(m_texturesImages[img_index]
-        //                                         .ReleaseAndGetAddressOf())));
-        //
-        //                    // NAME_D3D12_OBJECT_INDEXED(m_texturesImages, i);
-        //
-        //                    {
-        //                        const UINT subresourceCount = tex_desc.DepthOrArraySize * tex_desc.MipLevels;
-        //                        const UINT64 uploadBufferSize = GetRequiredIntermediateSize(
-        //                            m_texturesImages[img_index].Get(), 0,
-        //                            subresourceCount);
-        //
-        //                        ThrowIfFailed(m_pp_device->CreateCommittedResource(
-        //                            &CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
-        //                            D3D12_HEAP_FLAG_NONE,
-        //                            &CD3DX12_RESOURCE_DESC::Buffer(uploadBufferSize),
-        //                            D3D12_RESOURCE_STATE_GENERIC_READ, nullptr,
-        //                            IID_PPV_ARGS(m_textureImageUploads[img_index]
-        //                                             .ReleaseAndGetAddressOf())));
-        //
-        //                        // Copy data to the intermediate upload heap and then
-        //                        // schedule a copy from the upload heap to the
-        //                        // Texture2D.
-        //                        D3D12_SUBRESOURCE_DATA texture_data = {};
-        //                        texture_data.pData = tex_data;
-        //                        texture_data.RowPitch = width * nrChannels;
-        //                        texture_data.SlicePitch = width * height * nrChannels;
-        //
-        //                        UpdateSubresources(
-        //                            m_copyCommandList,
-        //                            m_texturesImages[img_index].Get(),
-        //                            m_textureImageUploads[img_index].Get(), 0, 0,
-        //                            subresourceCount, &texture_data);
-        //                        // m_copyCommandList->ResourceBarrier(
-        //                        //     1, &CD3DX12_RESOURCE_BARRIER::Transition(m_texturesImages[img_index].Get(), D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE));
-        //                    }
-        //
-        //                    stbi_image_free(tex_data);
-        //                }
-        //            },
-        //            [&](const fastgltf::sources::Vector& vector) {
-        //                unsigned char* tex_data = stbi_load_from_memory(
-        //                    vector.bytes.data(), static_cast<int>(vector.bytes.size()),
-        //                    &width, &height, &nrChannels, 4);
-        //                if (tex_data) {
-        //                    const UINT64 t_width = width;
-        //                    const UINT t_height = height;
-        //                    constexpr UINT16 depthOrArraySize = 1;
-        //                    constexpr UINT16 dummy_mip_levels = 1;
-        //
-        //                    constexpr auto format_of_image = loading_format_of_image;
-        //
-        //                    const CD3DX12_RESOURCE_DESC tex_desc(
-        //                        D3D12_RESOURCE_DIMENSION_TEXTURE2D, 0, t_width,
-        //                        t_height, depthOrArraySize, dummy_mip_levels,
-        //                        format_of_image, 1, 0, D3D12_TEXTURE_LAYOUT_UNKNOWN,
-        //                        D3D12_RESOURCE_FLAG_NONE);
-        //
-        //                    ThrowIfFailed(m_pp_device->CreateCommittedResource(
-        //                        &CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT),
-        //                        D3D12_HEAP_FLAG_NONE, &tex_desc,
-        //                        D3D12_RESOURCE_STATE_COPY_DEST, nullptr,
-        //                        IID_PPV_ARGS(m_texturesImages[img_index]
-        //                                         .ReleaseAndGetAddressOf())));
-        //
-        //                    // NAME_D3D12_OBJECT_INDEXED(m_texturesImages, i);
-        //
-        //                    {
-        //                        const UINT subresourceCount = tex_desc.DepthOrArraySize * tex_desc.MipLevels;
-        //                        const UINT64 uploadBufferSize = GetRequiredIntermediateSize(
-        //                            m_texturesImages[img_index].Get(), 0,
-        //                            subresourceCount);
-        //
-        //                        ThrowIfFailed(m_pp_device->CreateCommittedResource(
-        //                            &CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
-        //                            D3D12_HEAP_FLAG_NONE,
-        //                            &CD3DX12_RESOURCE_DESC::Buffer(uploadBufferSize),
-        //                            D3D12_RESOURCE_STATE_GENERIC_READ, nullptr,
-        //                            IID_PPV_ARGS(m_textureImageUploads[img_index]
-        //                                             .ReleaseAndGetAddressOf())));
-        //
-        //                        // Copy data to the intermediate upload heap and then
-        //                        // schedule a copy from the upload heap to the
-        //                        // Texture2D.
-        //                        D3D12_SUBRESOURCE_DATA texture_data = {};
-        //                        texture_data.pData = tex_data;
-        //                        texture_data.RowPitch = width * nrChannels;
-        //                        texture_data.SlicePitch = width * height * nrChannels;
-        //
-        //                        UpdateSubresources(
-        //                            m_copyCommandList,
-        //                            m_texturesImages[img_index].Get(),
-        //                            m_textureImageUploads[img_index].Get(), 0, 0,
-        //                            subresourceCount, &texture_data);
-        //                        // m_copyCommandList->ResourceBarrier(
-        //                        //     1, &CD3DX12_RESOURCE_BARRIER::Transition(m_texturesImages[img_index].Get(), D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE));
-        //                    }
-        //
-        //                    stbi_image_free(tex_data);
-        //                }
-        //            },
-        //
-        //            [&](const fastgltf::sources::BufferView& view) {
-        //                auto& asset = gltf;
-        //
-        //                const auto& bufferView = asset.bufferViews[view.bufferViewIndex];
-        //                auto& buffer = asset.buffers[bufferView.bufferIndex];
-        //
-        //                std::visit(
-        //                    fastgltf::visitor {
-        //                        // We only care about VectorWithMime here, because we
-        //                        // specify LoadExternalBuffers, meaning all buffers
-        //                        // are already loaded into a vector.
-        //                        [](auto&) {},
-        //                        [&](const fastgltf::sources::Vector& vector) {
-        //                            unsigned char* tex_data = stbi_load_from_memory(
-        //                                vector.bytes.data() + bufferView.byteOffset,
-        //                                static_cast<int>(bufferView.byteLength), &width,
-        //                                &height, &nrChannels, 4);
-        //                            if (tex_data) {
-        //                                const UINT64 t_width = width;
-        //                                const UINT t_height = height;
-        //                                constexpr UINT16 depthOrArraySize = 1;
-        //                                constexpr UINT16 dummy_mip_levels = 1;
-        //
-        //                                constexpr auto format_of_image = loading_format_of_image;
-        //
-        //                                const CD3DX12_RESOURCE_DESC tex_desc(
-        //                                    D3D12_RESOURCE_DIMENSION_TEXTURE2D, 0,
-        //                                    t_width, t_height, depthOrArraySize,
-        //                                    dummy_mip_levels, format_of_image, 1, 0,
-        //                                    D3D12_TEXTURE_LAYOUT_UNKNOWN,
-        //                                    D3D12_RESOURCE_FLAG_NONE);
-        //
-        //                                ThrowIfFailed(
-        //                                    m_pp_device->CreateCommittedResource(
-        //                                        &CD3DX12_HEAP_PROPERTIES(
-        //                                            D3D12_HEAP_TYPE_DEFAULT),
-        //                                        D3D12_HEAP_FLAG_NONE, &tex_desc,
-        //                                        D3D12_RESOURCE_STATE_COPY_DEST, nullptr,
-        //                                        IID_PPV_ARGS(
-        //                                            m_texturesImages[img_index]
-        //                                                .ReleaseAndGetAddressOf())));
-        //
-        //                                // NAME_D3D12_OBJECT_INDEXED(m_texturesImages,
-        //                                // i);
-        //
-        //                                {
-        //                                    const UINT subresourceCount = tex_desc.DepthOrArraySize * tex_desc.MipLevels;
-        //                                    const UINT64 uploadBufferSize = GetRequiredIntermediateSize(
-        //                                        m_texturesImages[img_index].Get(),
-        //                                        0, subresourceCount);
-        //
-        //                                    ThrowIfFailed(
-        //                                        m_pp_device->CreateCommittedResource(
-        //                                            &CD3DX12_HEAP_PROPERTIES(
-        //                                                D3D12_HEAP_TYPE_UPLOAD),
-        //                                            D3D12_HEAP_FLAG_NONE,
-        //                                            &CD3DX12_RESOURCE_DESC::Buffer(
-        //                                                uploadBufferSize),
-        //                                            D3D12_RESOURCE_STATE_GENERIC_READ,
-        //                                            nullptr,
-        //                                            IID_PPV_ARGS(
-        //                                                m_textureImageUploads[img_index]
-        //                                                    .ReleaseAndGetAddressOf())));
-        //
-        //                                    // Copy data to the intermediate upload heap
-        //                                    // and then schedule a copy from the upload
-        //                                    // heap to the Texture2D.
-        //                                    D3D12_SUBRESOURCE_DATA texture_data = {};
-        //                                    texture_data.pData = tex_data;
-        //                                    texture_data.RowPitch = width * nrChannels;
-        //                                    texture_data.SlicePitch = width * height * nrChannels;
-        //
-        //                                    UpdateSubresources(
-        //                                        m_copyCommandList,
-        //                                        m_texturesImages[img_index].Get(),
-        //                                        m_textureImageUploads[img_index].Get(),
-        //                                        0, 0, subresourceCount, &texture_data);
-        //
-        //                                    /*
-        //*       m_copyCommandList->ResourceBarrier(
-        //   1,
-        //   &CD3DX12_RESOURCE_BARRIER::Transition(
-        //       m_texturesImages[img_index].Get(),
-        //       D3D12_RESOURCE_STATE_COPY_DEST,
-        //       D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE));*/
-        //                                }
-        //
-        //                                stbi_image_free(tex_data);
-        //                            }
-        //                        } },
-        //                    buffer.data);
-        //            }
-        //        };
-        //
-        //        // image.data�����;���
-        //        // using DataSource = std::variant<std::monostate, sources::BufferView, sources::URI, sources::Vector, sources::CustomBuffer, sources::ByteView, sources::Fallback>;
-        //        std::visit(img_visitor, image.data);
-
-        {
-            const fastgltf::sources::URI* p_img_loca_Path_URI = std::get_if<fastgltf::sources::URI>(&image.data);
-            if (p_img_loca_Path_URI) {
-                const auto& img_loca_Path_URI = *p_img_loca_Path_URI;
-
-                assert(img_loca_Path_URI.fileByteOffset == 0); // We don't support offsets with stbi.
-                assert(img_loca_Path_URI.uri
-                           .isLocalPath()); // We're only capable of loading
-                                            // local files.
-
-                const std::string img_local_path(
-                    img_loca_Path_URI.uri.path().begin(),
-                    img_loca_Path_URI.uri.path().end()); // Thanks C++.
-
-                const std::filesystem::path absolute_path = path_filesys.parent_path().append(img_local_path);
-
-                unsigned char* temp_tex_data = stbi_load(absolute_path.generic_string().c_str(), &width,
-                    &height, &nrChannels, 4);
-
-                assert(nrChannels == 4 || nrChannels == 3);
-                if (temp_tex_data) {
-                    const UINT64 t_width = width;
-                    const UINT t_height = height;
-                    constexpr UINT16 depth_or_array_size = 1;
-                    constexpr auto format_of_image = loading_format_of_image;
-
-                    m_4_com_tex_temp_buffers.push_back(temp_tex_data);
-
-                    constexpr UINT16 dummy_mip_levels = 1;
-                    const CD3DX12_RESOURCE_DESC tex_desc(
-                        D3D12_RESOURCE_DIMENSION_TEXTURE2D, 0, t_width,
-                        t_height, depth_or_array_size, dummy_mip_levels,
-                        format_of_image, 1, 0, D3D12_TEXTURE_LAYOUT_UNKNOWN,
-                        D3D12_RESOURCE_FLAG_NONE);
-
-                    ThrowIfFailed(m_pp_device->CreateCommittedResource(
-                        &CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT),
-                        D3D12_HEAP_FLAG_NONE, &tex_desc,
-                        D3D12_RESOURCE_STATE_COPY_DEST, nullptr,
-                        IID_PPV_ARGS(m_texturesImages[img_index].ReleaseAndGetAddressOf())));
-
-                    // Convert std::string to std::wstring
-                    std::wstring_convert<std::codecvt_utf8<wchar_t>> converter;
-                    std::wstring wide_string = converter.from_bytes(img_local_path);
-                    m_texturesImages[img_index]->SetName(wide_string.c_str());
-
-                    {
-                        const UINT subresourceCount = tex_desc.DepthOrArraySize * tex_desc.MipLevels;
-                        const UINT64 uploadBufferSize = GetRequiredIntermediateSize(
-                            m_texturesImages[img_index].Get(), 0,
-                            subresourceCount);
-
-                        ThrowIfFailed(m_pp_device->CreateCommittedResource(
-                            &CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
-                            D3D12_HEAP_FLAG_NONE,
-                            &CD3DX12_RESOURCE_DESC::Buffer(uploadBufferSize),
-                            D3D12_RESOURCE_STATE_GENERIC_READ, nullptr,
-                            IID_PPV_ARGS(m_textureImageUploads[img_index]
-                                             .ReleaseAndGetAddressOf())));
-
-                        // Copy data to the intermediate upload heap and then
-                        // schedule a copy from the upload heap to the
-                        // Texture2D.
-                        D3D12_SUBRESOURCE_DATA texture_data = {};
-                        texture_data.pData = m_4_com_tex_temp_buffers.back();
-                        texture_data.RowPitch = t_width * 4;
-                        texture_data.SlicePitch = t_width * t_height * 4;
-
-                        UpdateSubresources(
-                            m_copyCommandList,
-                            m_texturesImages[img_index].Get(),
-                            m_textureImageUploads[img_index].Get(), 0, 0,
-                            subresourceCount, &texture_data);
-                    }
-                }
-            }
-        }
-
-        {
-            fastgltf::sources::Vector* p_vector = std::get_if<fastgltf::sources::Vector>(&image.data);
-            if (p_vector) {
-                assert(false, "channel number is wrong!");
-                fastgltf::sources::Vector& vector = *p_vector;
-
-                unsigned char* tex_data = stbi_load_from_memory(
-                    vector.bytes.data(), static_cast<int>(vector.bytes.size()),
-                    &width, &height, &nrChannels, 4);
-                if (tex_data) {
-                    const UINT64 t_width = width;
-                    const UINT t_height = height;
-                    constexpr UINT16 depthOrArraySize = 1;
-                    constexpr UINT16 dummy_mip_levels = 1;
-
-                    constexpr auto format_of_image = loading_format_of_image;
-
-                    const CD3DX12_RESOURCE_DESC tex_desc(
-                        D3D12_RESOURCE_DIMENSION_TEXTURE2D, 0, t_width,
-                        t_height, depthOrArraySize, dummy_mip_levels,
-                        format_of_image, 1, 0, D3D12_TEXTURE_LAYOUT_UNKNOWN,
-                        D3D12_RESOURCE_FLAG_NONE);
-
-                    ThrowIfFailed(m_pp_device->CreateCommittedResource(
-                        &CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT),
-                        D3D12_HEAP_FLAG_NONE, &tex_desc,
-                        D3D12_RESOURCE_STATE_COPY_DEST, nullptr,
-                        IID_PPV_ARGS(m_texturesImages[img_index]
-                                         .ReleaseAndGetAddressOf())));
-
-                    // NAME_D3D12_OBJECT_INDEXED(m_texturesImages, i);
-
-                    {
-                        const UINT subresourceCount = tex_desc.DepthOrArraySize * tex_desc.MipLevels;
-                        const UINT64 uploadBufferSize = GetRequiredIntermediateSize(
-                            m_texturesImages[img_index].Get(), 0,
-                            subresourceCount);
-
-                        ThrowIfFailed(m_pp_device->CreateCommittedResource(
-                            &CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
-                            D3D12_HEAP_FLAG_NONE,
-                            &CD3DX12_RESOURCE_DESC::Buffer(uploadBufferSize),
-                            D3D12_RESOURCE_STATE_GENERIC_READ, nullptr,
-                            IID_PPV_ARGS(m_textureImageUploads[img_index]
-                                             .ReleaseAndGetAddressOf())));
-
-                        // Copy data to the intermediate upload heap and then
-                        // schedule a copy from the upload heap to the
-                        // Texture2D.
-                        D3D12_SUBRESOURCE_DATA texture_data = {};
-                        texture_data.pData = tex_data;
-                        texture_data.RowPitch = width * nrChannels;
-                        texture_data.SlicePitch = width * height * nrChannels;
-
-                        UpdateSubresources(
-                            m_copyCommandList,
-                            m_texturesImages[img_index].Get(),
-                            m_textureImageUploads[img_index].Get(), 0, 0,
-                            subresourceCount, &texture_data);
-                        // m_copyCommandList->ResourceBarrier(
-                        //     1, &CD3DX12_RESOURCE_BARRIER::Transition(m_texturesImages[img_index].Get(), D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE));
-                    }
-                }
-            }
-        }
+    m_texturesImages.resize(model_data.textures.size());
 
-        {
-            fastgltf::sources::BufferView* p_view = std::get_if<fastgltf::sources::BufferView>(&image.data);
-            if (p_view) {
-                assert(false, "channel number is wrong!");
-                fastgltf::sources::BufferView& view = *p_view;
-
-                auto& asset = gltf;
-
-                const auto& bufferView = asset.bufferViews[view.bufferViewIndex];
-                auto& buffer = asset.buffers[bufferView.bufferIndex];
-
-                std::visit(
-                    fastgltf::visitor {
-                        // We only care about VectorWithMime here, because we
-                        // specify LoadExternalBuffers, meaning all buffers
-                        // are already loaded into a vector.
-                        [](auto&) {},
-                        [&](const fastgltf::sources::Vector& vector) {
-                            unsigned char* tex_data = stbi_load_from_memory(
-                                vector.bytes.data() + bufferView.byteOffset,
-                                static_cast<int>(bufferView.byteLength), &width,
-                                &height, &nrChannels, 4);
-                            if (tex_data) {
-                                const UINT64 t_width = width;
-                                const UINT t_height = height;
-                                constexpr UINT16 depthOrArraySize = 1;
-                                constexpr UINT16 dummy_mip_levels = 1;
-
-                                constexpr auto format_of_image = loading_format_of_image;
-
-                                const CD3DX12_RESOURCE_DESC tex_desc(
-                                    D3D12_RESOURCE_DIMENSION_TEXTURE2D, 0,
-                                    t_width, t_height, depthOrArraySize,
-                                    dummy_mip_levels, format_of_image, 1, 0,
-                                    D3D12_TEXTURE_LAYOUT_UNKNOWN,
-                                    D3D12_RESOURCE_FLAG_NONE);
-
-                                ThrowIfFailed(
-                                    m_pp_device->CreateCommittedResource(
-                                        &CD3DX12_HEAP_PROPERTIES(
-                                            D3D12_HEAP_TYPE_DEFAULT),
-                                        D3D12_HEAP_FLAG_NONE, &tex_desc,
-                                        D3D12_RESOURCE_STATE_COPY_DEST, nullptr,
-                                        IID_PPV_ARGS(
-                                            m_texturesImages[img_index]
-                                                .ReleaseAndGetAddressOf())));
-
-                                // NAME_D3D12_OBJECT_INDEXED(m_texturesImages,
-                                // i);
-
-                                {
-                                    const UINT subresourceCount = tex_desc.DepthOrArraySize * tex_desc.MipLevels;
-                                    const UINT64 uploadBufferSize = GetRequiredIntermediateSize(
-                                        m_texturesImages[img_index].Get(),
-                                        0, subresourceCount);
-
-                                    ThrowIfFailed(
-                                        m_pp_device->CreateCommittedResource(
-                                            &CD3DX12_HEAP_PROPERTIES(
-                                                D3D12_HEAP_TYPE_UPLOAD),
-                                            D3D12_HEAP_FLAG_NONE,
-                                            &CD3DX12_RESOURCE_DESC::Buffer(
-                                                uploadBufferSize),
-                                            D3D12_RESOURCE_STATE_GENERIC_READ,
-                                            nullptr,
-                                            IID_PPV_ARGS(
-                                                m_textureImageUploads[img_index]
-                                                    .ReleaseAndGetAddressOf())));
-
-                                    // Copy data to the intermediate upload heap
-                                    // and then schedule a copy from the upload
-                                    // heap to the Texture2D.
-                                    D3D12_SUBRESOURCE_DATA texture_data = {};
-                                    texture_data.pData = tex_data;
-                                    texture_data.RowPitch = width * nrChannels;
-                                    texture_data.SlicePitch = width * height * nrChannels;
-
-                                    UpdateSubresources(
-                                        m_copyCommandList,
-                                        m_texturesImages[img_index].Get(),
-                                        m_textureImageUploads[img_index].Get(),
-                                        0, 0, subresourceCount, &texture_data);
-
-                                    /*
-*       m_copyCommandList->ResourceBarrier(
-   1,
-   &CD3DX12_RESOURCE_BARRIER::Transition(
-       m_texturesImages[img_index].Get(),
-       D3D12_RESOURCE_STATE_COPY_DEST,
-       D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE));*/
-                                }
-                            }
-                        } },
-                    buffer.data);
-            }
+    for (auto [img_index, texture] :
+        std::ranges::views::enumerate(model_data.textures)) {
+        // images that failed to decode keep a null resource, which still gets a (null) SRV below. Content another
+        // model already loaded is shared, only the SRV is this model's own.
+        bool created = false;
+        m_texturesImages[img_index] = m_textureCache->Acquire(texture, staging_ring, created);
+        if (created) {
+            m_createdTextures.push_back(m_texturesImages[img_index]);
         }
 
-        // put it into a std::map
-        // assert(m_namesToTextures
-        //           .try_emplace(img_name, m_texturesImages[img_index].Get())
-        //           .second);
+        // The pixels are in the staging ring once Acquire returns, the CPU side copy is not needed anymore.
+        texture.subresources.clear();
+        texture.storage.reset();
 
         // Describe and create an SRV.
-        UINT dummy_mip_levels = 1;
         D3D12_SHADER_RESOURCE_VIEW_DESC srv_desc = {};
         srv_desc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
         srv_desc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
-        srv_desc.Format = loading_format_of_image;
-        srv_desc.Texture2D.MipLevels = dummy_mip_levels;
+        srv_desc.Format = texture.format;
+        srv_desc.Texture2D.MipLevels = texture.mip_levels;
         srv_desc.Texture2D.MostDetailedMip = 0;
         srv_desc.Texture2D.ResourceMinLODClamp = 0.0f;
-        m_pp_device->CreateShaderResourceView(m_texturesImages[img_index].Get(), &srv_desc, cbvSrvUavHandle);
+        m_pp_device->CreateShaderResourceView(m_texturesImages[img_index], &srv_desc, cbvSrvUavHandle);
 
         cbvSrvUavHandle.Offset(m_cbvSrvUavDescriptorSize);
     }
+    textures_zone.End();
+    //< create all textures
 
     //> LOAD_MATERIAL_CONST_BUFFER
+    ProfileZone materials_zone("CreateMaterials");
     // create material const buffer to hold material constants data
-    m_num_material_views = gltf.materials.size();
-    ThrowIfFailed(m_pp_device->CreateCommittedResource(
-        &CD3DX12_HEAP_PROPERTIES(
-            D3D12_HEAP_TYPE_UPLOAD),
-
-        D3D12_HEAP_FLAG_NONE, // no flags
-        &CD3DX12_RESOURCE_DESC::Buffer(
-            (sizeof(MaterialConstants) * gltf.materials.size() + (D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT - 1)) & ~(D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT - 1)),
-
-        // size of the resource heap. Must be a multiple of 64KB
-        // for single-textures and constant buffers
-        D3D12_RESOURCE_STATE_GENERIC_READ, // will be data that is read from, so
-                                           // we keep it in the generic read
-                                           // state
-        nullptr, // we do not have use an optimized clear value for constant
-                 // buffers
-        IID_PPV_ARGS(m_materialConstBuffer.ReleaseAndGetAddressOf())));
+    m_num_material_views = model_data.materials.size();
+    m_materialConstBuffer = m_heapAllocator->CreateResource(
+        D3D12_HEAP_TYPE_UPLOAD,
+        CD3DX12_RESOURCE_DESC::Buffer(
+            (sizeof(MaterialConstants) * model_data.materials.size() + (D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT - 1)) & ~(D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT - 1)),
+
+        D3D12_RESOURCE_STATE_GENERIC_READ); // will be data that is read from, so
+                                            // we keep it in the generic read
+                                            // state
 
     // m_materialConstBuffer->SetName(L"Structured Buffer for Upload Resource Heap");
 
     m_materialConstantDataBuffer = cbvSrvUavHandle;
 
     // ��bindless������Ҳ������һ��structured buffer��element����0 �� element����materials.size() - 1;�ķ�Χ��������ֻ��һ��srv slot��ÿ�λ�ģ�;ͻ���
-    for (auto i = 0; i < gltf.materials.size(); i++) {
+    for (auto i = 0; i < model_data.materials.size(); i++) {
         D3D12_SHADER_RESOURCE_VIEW_DESC srv_desc = {};
         srv_desc.Format = DXGI_FORMAT_UNKNOWN;
         srv_desc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
@@ -835,413 +340,90 @@ void GltfModel::LoadFromFile(const std::string gltf_file_path)
 
     //< load_material_const_buffer
 
-    //> LOAD_MATERIAL AND FILL MATERIAL CONST DATA
-    for (const auto [mat_index, mat] :
-        std::ranges::views::enumerate(gltf.materials)) {
-        // auto newMat = std::make_shared<GLTFMaterialInstance>();
-        // materials.push_back(newMat);
-        // result_gltf.materials[mat.name.c_str() + std::to_string(mat_index)] =
-        // newMat;
-
-        MaterialConstants constants;
-        constants.colorFactors.x = mat.pbrData.baseColorFactor[0];
-        constants.colorFactors.y = mat.pbrData.baseColorFactor[1];
-        constants.colorFactors.z = mat.pbrData.baseColorFactor[2];
-        constants.colorFactors.w = mat.pbrData.baseColorFactor[3];
-
-        constants.metalRoughFactors.x = mat.pbrData.metallicFactor;
-        constants.metalRoughFactors.y = mat.pbrData.roughnessFactor;
-
-        // TODO: alpha blending, emissve, blooming
-        //  auto passType = MaterialPassType::MainColor;
-        //   if (mat.alphaMode == fastgltf::AlphaMode::Blend) {
-        //     passType = MaterialPassType::Transparent;
-        //   }
-
-        // install textures index
-        if (mat.pbrData.baseColorTexture.has_value()) {
-            constants.albedoIndex = gltf.textures[mat.pbrData.baseColorTexture.value().textureIndex]
-                                        .imageIndex.value();
-            constants.albedoSamplerIndex = gltf.textures[mat.pbrData.baseColorTexture.value().textureIndex]
-                                               .samplerIndex.value();
-        }
-
-        if (mat.pbrData.metallicRoughnessTexture.has_value()) {
-            constants.metalRoughIndex = gltf.textures[mat.pbrData.metallicRoughnessTexture.value()
-                                                          .textureIndex]
-                                            .imageIndex.value();
-            constants.metalRoughSamplerIndex = gltf.textures[mat.pbrData.metallicRoughnessTexture.value()
-                                                                 .textureIndex]
-                                                   .samplerIndex.value();
-        }
-
-        if (mat.normalTexture.has_value()) {
-            constants.normalIndex = gltf.textures[mat.normalTexture.value().textureIndex]
-                                        .imageIndex.value();
-            constants.normalSamplerIndex = gltf.textures[mat.normalTexture.value().textureIndex]
-                                               .samplerIndex.value();
-        }
-
-        if (mat.emissiveTexture.has_value()) {
-            constants.emissiveIndex = gltf.textures[mat.emissiveTexture.value().textureIndex]
-                                          .imageIndex.value();
-            constants.emissiveSamplerIndex = gltf.textures[mat.emissiveTexture.value().textureIndex]
-                                                 .samplerIndex.value();
-        }
-
-        if (mat.occlusionTexture.has_value()) {
-            constants.occlusionIndex = gltf.textures[mat.occlusionTexture.value().textureIndex]
-                                           .imageIndex.value();
-            constants.occlusionSamplerIndex = gltf.textures[mat.occlusionTexture.value().textureIndex]
-                                                  .samplerIndex.value();
-        }
-
-        // write current material parameters to buffer
-        memcpy((materialConstBufferMappedGPUAddress + mat_index * sizeof(MaterialConstants)),
-            &constants, sizeof(MaterialConstants));
-    }
+    //> FILL MATERIAL CONST DATA
+    memcpy(materialConstBufferMappedGPUAddress, model_data.materials.data(),
+        model_data.materials.size() * sizeof(MaterialConstants));
     m_materialConstBuffer->Unmap(0, nullptr);
-    //< load_material
-
-    //> LOAD_NODES
-    // use the same vectors for all meshes so that the memory doesn't reallocate
-    // as often
-    std::vector<uint32_t> indices;
-    std::vector<StandardVertex> vertices;
-
-    m_meshes = std::make_unique<MeshAsset[]>(gltf.meshes.size());
-    for (auto [mesh_index, mesh] : std::ranges::views::enumerate(gltf.meshes)) {
-        // auto newmesh = std::make_shared<MeshAsset>();
-        // meshes.push_back(newmesh);
-        // result_gltf.x6c xzvn26cxmesh.name.c_str() +
-        // std::to_string(mesh_index)] = newmesh;
-        m_meshes[mesh_index].name = mesh.name.append(std::to_string(mesh_index));
-
-        // clear the mesh_asset arrays each mesh_asset, we don't want to merge them by error
-        indices.clear();
-        vertices.clear();
-
-        // process geosurface
-        for (auto&& p : mesh.primitives) {
-            MeshAsset::GeoSurface newSurface;
-            newSurface.startIndex = static_cast<uint32_t>(indices.size());
-            newSurface.count = static_cast<uint32_t>(
-                gltf.accessors[p.indicesAccessor.value()].count);
-
-            size_t initial_vtx = vertices.size();
-
-            // load indexes
-            {
-                fastgltf::Accessor& indexaccessor = gltf.accessors[p.indicesAccessor.value()];
-                indices.reserve(indices.size() + indexaccessor.count);
-
-                fastgltf::iterateAccessor<std::uint32_t>(
-                    gltf, indexaccessor,
-                    [&](std::uint32_t idx) {
-                        indices.push_back(idx + initial_vtx);
-                    });
-            }
-
-            // load vertex positions
-            {
-                fastgltf::Accessor& posAccessor = gltf.accessors[p.findAttribute("POSITION")->second];
-                vertices.resize(vertices.size() + posAccessor.count);
-
-                fastgltf::iterateAccessorWithIndex<glm::vec3>(
-                    gltf, posAccessor,
-                    [&](glm::vec3 v, size_t index) -> void {
-                        StandardVertex newvtx;
-                        newvtx.position = v;
-                        newvtx.normal = { 0, 1, 0 };
-                        newvtx.color = glm::vec4 { 1.f };
-                        newvtx.uv = glm::float2 { 0.f, 0.f };
-                        newvtx.tangent = { 1, 0, 0 };
-                        vertices[initial_vtx + index] = newvtx;
-                    });
-            }
-
-            // load vertex normals
-            auto normals = p.findAttribute("NORMAL");
-            if (normals != p.attributes.end()) {
-                fastgltf::iterateAccessorWithIndex<glm::vec3>(
-                    gltf, gltf.accessors[normals->second],
-                    [&](glm::vec3 v, size_t index) {
-                        vertices[initial_vtx + index].normal = v;
-                    });
-            }
-
-            // load UVs
-            auto uv = p.findAttribute("TEXCOORD_0");
-            if (uv != p.attributes.end()) {
-                fastgltf::iterateAccessorWithIndex<glm::vec2>(
-                    gltf, gltf.accessors[uv->second],
-                    [&](glm::vec2 v, size_t index) {
-                        vertices[initial_vtx + index].uv.x = v.x;
-                        vertices[initial_vtx + index].uv.y = v.y;
-                    });
-            }
-
-            // load vertex colors
-            auto colors = p.findAttribute("COLOR_0");
-            if (colors != p.attributes.end()) {
-                fastgltf::iterateAccessorWithIndex<glm::vec4>(
-                    gltf, gltf.accessors[colors->second],
-                    [&](glm::vec4 v, size_t index) {
-                        vertices[initial_vtx + index].color = v;
-                    });
-            }
-
-            // load tangent
-            auto tangent = p.findAttribute("TANGENT");
-            if (tangent != p.attributes.end()) {
-                fastgltf::iterateAccessorWithIndex<glm::vec3>(
-                    gltf, gltf.accessors[tangent->second],
-                    [&](glm::vec3 v, size_t index) {
-                        vertices[initial_vtx + index].tangent = v;
-                    });
-            }
-
-            // load material index
-            if (p.materialIndex.has_value()) {
-                newSurface.materialIndex = p.materialIndex.value();
-            } else {
-                assert(false);
-                newSurface.materialIndex = UINT32_MAX;
-            }
-
-            // glm::vec3 minpos = vertices[initial_vtx].position;
-            // glm::vec3 maxpos = vertices[initial_vtx].position;
-            // for (auto i = initial_vtx; i < vertices.size(); i++)
-            //{
-            //     minpos = min(minpos, vertices[i].position);
-            //     maxpos = max(maxpos, vertices[i].position);
-            // }
-
-            // newSurface.bounds.origin = (maxpos + minpos) / 2.f;
-            // newSurface.bounds.extents = (maxpos - minpos) / 2.f;
-            // newSurface.bounds.sphereRadius =
-            // length(newSurface.bounds.extents);
-
-            m_meshes[mesh_index].surfaces.push_back(newSurface);
-        }
-
-        // Create the vertex buffer.
-        {
-            const UINT32 vertex_data_size = vertices.size() * sizeof(StandardVertex);
-
-            ThrowIfFailed(m_pp_device->CreateCommittedResource(
-                &CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT),
-                D3D12_HEAP_FLAG_NONE,
-                &CD3DX12_RESOURCE_DESC::Buffer(vertex_data_size),
-                D3D12_RESOURCE_STATE_COMMON, nullptr,
-                IID_PPV_ARGS(
-                    m_meshes[mesh_index]
-                        .mesh_buffers.m_vertexBuffer.ReleaseAndGetAddressOf())));
-
-            // NAME_D3D12_OBJECT(m_vertexBuffer);
-            {
-                ThrowIfFailed(m_pp_device->CreateCommittedResource(
-                    &CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
-                    D3D12_HEAP_FLAG_NONE,
-                    &CD3DX12_RESOURCE_DESC::Buffer(vertex_data_size),
-                    D3D12_RESOURCE_STATE_GENERIC_READ, nullptr,
-                    IID_PPV_ARGS(m_meshes[mesh_index]
-                                     .mesh_buffers.m_vertexBufferUpload
-                                     .ReleaseAndGetAddressOf())));
-
-                // Copy data to the upload heap and then schedule a copy
-                // from the upload heap to the vertex buffer.
-                m_meshes[mesh_index].mesh_buffers.m_cpuVertices = std::move(vertices);
-                D3D12_SUBRESOURCE_DATA vertex_data = {};
-                vertex_data.pData = m_meshes[mesh_index].mesh_buffers.m_cpuVertices.data();
-                vertex_data.RowPitch = vertex_data_size;
-                vertex_data.SlicePitch = vertex_data.RowPitch;
-
-                // PIXBeginEvent(
-                //     commandList.Get(), 0,
-                //     L"Copy vertex buffer data to default resource...");
-
-                UpdateSubresources<1>(
-                    m_copyCommandList,
-                    m_meshes[mesh_index].mesh_buffers.m_vertexBuffer.Get(),
-                    m_meshes[mesh_index].mesh_buffers.m_vertexBufferUpload.Get(),
-                    0, 0, 1, &vertex_data);
-
-                // fdsaklfdsa
-                // m_copyCommandList->ResourceBarrier(
-                //     1,
-                //     &CD3DX12_RESOURCE_BARRIER::Transition(
-                //         m_meshes[mesh_index].mesh_buffers.m_vertexBuffer.Get(),
-                //         D3D12_RESOURCE_STATE_COPY_DEST,
-                //         D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER));
-
-                // PIXEndEvent(commandList.Get());
-            }
-
-            // Initialize the vertex buffer view.
-            m_meshes[mesh_index].mesh_buffers.m_vertexBufferView.BufferLocation = m_meshes[mesh_index]
-                                                                                      .mesh_buffers.m_vertexBuffer->GetGPUVirtualAddress();
-            m_meshes[mesh_index].mesh_buffers.m_vertexBufferView.SizeInBytes = vertex_data_size;
-            m_meshes[mesh_index].mesh_buffers.m_vertexBufferView.StrideInBytes = sizeof(StandardVertex);
-        }
-
-        // Create the index buffer.
-        {
-            const UINT32 indices_data_size = indices.size() * sizeof(uint32_t);
-
-            ThrowIfFailed(m_pp_device->CreateCommittedResource(
-                &CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT),
-                D3D12_HEAP_FLAG_NONE,
-                &CD3DX12_RESOURCE_DESC::Buffer(indices_data_size),
-                D3D12_RESOURCE_STATE_COMMON, nullptr,
-                IID_PPV_ARGS(
-                    m_meshes[mesh_index]
-                        .mesh_buffers.m_indexBuffer.ReleaseAndGetAddressOf())));
-
-            // NAME_D3D12_OBJECT(m_indexBuffer);
-            {
-                ThrowIfFailed(m_pp_device->CreateCommittedResource(
-                    &CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
-                    D3D12_HEAP_FLAG_NONE,
-                    &CD3DX12_RESOURCE_DESC::Buffer(indices_data_size),
-                    D3D12_RESOURCE_STATE_GENERIC_READ, nullptr,
-                    IID_PPV_ARGS(m_meshes[mesh_index]
-                                     .mesh_buffers.m_indexBufferUpload
-                                     .ReleaseAndGetAddressOf())));
-
-                // Copy data to the upload heap and then schedule a copy
-                // from the upload heap to the index buffer.
-
-                m_meshes[mesh_index].mesh_buffers.m_cpuIndices = std::move(indices);
-
-                D3D12_SUBRESOURCE_DATA index_data = {};
-                index_data.pData = m_meshes[mesh_index].mesh_buffers.m_cpuIndices.data();
-                index_data.RowPitch = indices_data_size;
-                index_data.SlicePitch = index_data.RowPitch;
-
-                // PIXBeginEvent(m_copyCommandList.Get(), 0,
-                //               L"Copy index buffer data to default
-                //               resource...");
-
-                UpdateSubresources<1>(
-                    m_copyCommandList,
-                    m_meshes[mesh_index].mesh_buffers.m_indexBuffer.Get(),
-                    m_meshes[mesh_index].mesh_buffers.m_indexBufferUpload.Get(),
-                    0, 0, 1, &index_data);
-
-                // m_copyCommandList->ResourceBarrier(
-                //     1, &CD3DX12_RESOURCE_BARRIER::Transition(m_meshes[mesh_index].mesh_buffers.m_indexBuffer.Get(), D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_INDEX_BUFFER));
-
-                // PIXEndEvent(commandList.Get());
-            }
-
-            // Initialize the index buffer view.
-            m_meshes[mesh_index].mesh_buffers.m_indexBufferView.BufferLocation = m_meshes[mesh_index]
-                                                                                     .mesh_buffers.m_indexBuffer->GetGPUVirtualAddress();
-            m_meshes[mesh_index].mesh_buffers.m_indexBufferView.SizeInBytes = indices_data_size;
-            m_meshes[mesh_index].mesh_buffers.m_indexBufferView.Format = DXGI_FORMAT_R32_UINT;
+    materials_zone.End();
+    //< fill material const data
+
+    //> CREATE_MESH_BUFFERS
+    ProfileZone meshes_zone("UploadMeshes");
+    // the vertices and indices are copied into the staging ring right away
+    const std::vector<GeometryAllocation> geometry = m_geometryPool->UploadMeshes(staging_ring, model_data.meshes);
+
+    m_meshes = std::make_unique<MeshAsset[]>(model_data.meshes.size());
+    m_num_meshes = model_data.meshes.size();
+    for (auto [mesh_index, mesh] : std::ranges::views::enumerate(model_data.meshes)) {
+        m_meshes[mesh_index].name = std::move(mesh.name);
+        m_meshes[mesh_index].surfaces = std::move(mesh.surfaces);
+        m_meshes[mesh_index].meshlets = std::move(mesh.meshlets);
+        for (const GeoSurface& surface : m_meshes[mesh_index].surfaces) {
+            m_meshes[mesh_index].surface_bounds.push_back(surface.bounds);
         }
+        m_meshes[mesh_index].geometry = geometry[mesh_index];
+        std::vector<StandardVertex>().swap(mesh.vertices);
+        std::vector<uint32_t>().swap(mesh.indices);
     }
-    //> load_nodes
-
-    // LOAD ALL NODES AND THEIR MESHES
-    for (auto [node_index, node] : std::ranges::views::enumerate(gltf.nodes)) {
-        std::shared_ptr<Node> new_node;
-
-        // find if the node has a mesh_asset, and if it does then hook it to the mesh_asset
-        // pointer and allocate it with the meshnode class
-        if (node.meshIndex.has_value()) {
-            new_node = std::make_shared<MeshNode>();
-            dynamic_cast<MeshNode*>(new_node.get())->mesh_asset = &m_meshes[*node.meshIndex];
-        } else {
-            new_node = std::make_shared<Node>();
-        }
+    meshes_zone.End();
+    //< create_mesh_buffers
 
-        m_nodes.push_back(new_node);
-        // result_gltf.nodes[node.name.c_str() + std::to_string(node_index)] =
-        // newNode;
-
-        std::visit(
-            fastgltf::visitor {
-                [&](const fastgltf::Node::TransformMatrix& matrix) {
-                    memcpy(&new_node->local_transform, matrix.data(),
-                        sizeof(matrix));
-                },
-
-                [&](const fastgltf::Node::TRS& transform) {
-                    const glm::vec3 tl(transform.translation[0],
-                        transform.translation[1],
-                        transform.translation[2]);
-                    const glm::quat rot(
-                        transform.rotation[3], transform.rotation[0],
-                        transform.rotation[1], transform.rotation[2]);
-                    const glm::vec3 sc(transform.scale[0], transform.scale[1],
-                        transform.scale[2]);
-
-                    const glm::mat4 tm = translate(glm::mat4(1.f), tl);
-                    const glm::mat4 rm = glm::toMat4(rot);
-                    const glm::mat4 sm = scale(glm::mat4(1.f), sc);
-                    new_node->local_transform = tm * rm * sm;
-                } },
-            node.transform);
-    }
-    //< load_nodes
+    //> CREATE ALL NODES AND THEIR MESHES
+    ProfileZone nodes_zone("CreateNodes");
+    m_nodeIndices = m_hierarchy.Build(model_data.nodes);
+    //< create all nodes
 
     //> LOAD_SCENE_GRAPH
-    // run loop again to setup final_transform hierarchy
-    for (auto i = 0; i < gltf.nodes.size(); i++) {
-        fastgltf::Node& node_from_gltf = gltf.nodes[i];
-        std::shared_ptr<Node>& node_to_node = m_nodes[i];
-
-        for (auto& c : node_from_gltf.children) {
-            node_to_node->children.push_back(m_nodes[c]);
-            m_nodes[c]->parent = node_to_node;
+    // hook the nodes that have a mesh_asset to it
+    for (const auto [node_index, node_data] : std::ranges::views::enumerate(model_data.nodes)) {
+        if (node_data.mesh_index >= 0) {
+            m_meshNodes.push_back({ .node = m_nodeIndices[node_index], .first_render_object = 0, .mesh_asset = &m_meshes[node_data.mesh_index] });
         }
     }
+    std::ranges::sort(m_meshNodes, {}, &MeshNode::node);
 
-    // find the top nodes, with no parents
-    for (auto& node : m_nodes) {
-        if (node->parent.lock() == nullptr) {
-            m_topNodes.push_back(node.get());
-            node->RefreshTransform(glm::mat4 { 1.f });
-        }
+    UINT32 first_render_object = 0;
+    for (MeshNode& mesh_node : m_meshNodes) {
+        mesh_node.first_render_object = first_render_object;
+        first_render_object += static_cast<UINT32>(mesh_node.mesh_asset->surfaces.size());
     }
+    m_num_render_objects = first_render_object;
+    // UpdateTransforms never grows it past this
+    m_changedRenderObjects.reserve(m_num_render_objects);
+    nodes_zone.End();
     //< load_scene_graph
 
     //> PRE RECORD DRAW CONTEXT
+    const ProfileZone draw_context_zone("CreateDrawContext");
     constexpr glm::mat4 top_matrix_on_model = glm::mat4(1.0);
     this->Draw(top_matrix_on_model, m_draw_ctx);
     //< pre record draw context
 
     //> CREATE LOCAL MATRIX BUFFER
     // ÿһ����Ⱦ��¼����һ��final matrix
-    constexpr UINT aligned_size_cbuffer = (sizeof(glm::mat4) + (D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT - 1)) & ~(D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT - 1);
-    const UINT size_of_local_matrices_buffer = aligned_size_cbuffer * m_draw_ctx.OpaqueSurfaces.size();
-
-    ThrowIfFailed(m_pp_device->CreateCommittedResource(
-        &CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
-        D3D12_HEAP_FLAG_NONE, // no flags
-        //&CD3DX12_RESOURCE_DESC::Buffer((size_of_local_matrices_buffer + (D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT - 1)) & ~(D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT - 1)),
-        &CD3DX12_RESOURCE_DESC::Buffer((size_of_local_matrices_buffer)),
-
-        // size of the resource heap. Must be a multiple of 64KB
-        // for single-textures and constant buffers
-        D3D12_RESOURCE_STATE_GENERIC_READ, // will be data that is read from, so
-                                           // we keep it in the generic read
-                                           // state
-        nullptr, // we do not have use an optimized clear value for constant
-                 // buffers
-        IID_PPV_ARGS(m_localMatricesBuffer.ReleaseAndGetAddressOf())));
+    // one slice per frame in flight, a frame only writes its own while the GPU may still read the others
+    assert(m_num_render_objects <= TEMP_LOCAL_MATRICES_CBV_COUNT);
+    const UINT size_of_local_matrices_slice = LOCAL_MATRIX_CBV_SIZE * m_num_render_objects;
+    const UINT size_of_local_matrices_buffer = size_of_local_matrices_slice * FRAME_INFLIGHT_COUNT;
+
+    // placed buffers are 64KB aligned inside the heap, every CBV offset below stays 256 byte aligned
+    m_localMatricesBuffer = m_heapAllocator->CreateResource(
+        D3D12_HEAP_TYPE_UPLOAD,
+        CD3DX12_RESOURCE_DESC::Buffer((size_of_local_matrices_buffer)),
+        D3D12_RESOURCE_STATE_GENERIC_READ); // will be data that is read from, so
+                                            // we keep it in the generic read
+                                            // state
 
     // m_localMatricesBuffer->SetName(L"Constant Buffer Upload Resource Heap");
 
     m_localMatricesDataBuffer = cbvSrvUavHandle;
 
-    for (auto i = 0; i < m_draw_ctx.OpaqueSurfaces.size(); i++) {
+    // the views of slice 0, then the ones of slice 1...
+    for (UINT i = 0; i < m_num_render_objects * FRAME_INFLIGHT_COUNT; i++) {
         // Describe and create the local matrices buffer view (CBV) and cache the GPU descriptor handle.
         D3D12_CONSTANT_BUFFER_VIEW_DESC cbv_desc = {};
-        cbv_desc.SizeInBytes = aligned_size_cbuffer;
-        cbv_desc.BufferLocation = m_localMatricesBuffer->GetGPUVirtualAddress() + (i * aligned_size_cbuffer);
+        cbv_desc.SizeInBytes = LOCAL_MATRIX_CBV_SIZE;
+        cbv_desc.BufferLocation = m_localMatricesBuffer->GetGPUVirtualAddress() + (i * LOCAL_MATRIX_CBV_SIZE);
 
         m_pp_device->CreateConstantBufferView(&cbv_desc, cbvSrvUavHandle);
         cbvSrvUavHandle.Offset(m_cbvSrvUavDescriptorSize);
@@ -1254,20 +436,85 @@ void GltfModel::LoadFromFile(const std::string gltf_file_path)
         0, &read_range_0,
         reinterpret_cast<void**>(&localMatricesBufferMappedGPUAddress)));
 
-    for (auto i = 0; i < m_draw_ctx.OpaqueSurfaces.size(); i++) {
-        memcpy((localMatricesBufferMappedGPUAddress + (i * aligned_size_cbuffer)), &m_draw_ctx.OpaqueSurfaces[i].final_transform, sizeof(glm::mat4));
+    for (UINT frame_index = 0; frame_index < FRAME_INFLIGHT_COUNT; frame_index++) {
+        for (UINT i = 0; i < m_num_render_objects; i++) {
+            WriteLocalMatrix(frame_index, i);
+        }
+    }
+
+    // every slice starts up to date, each one only ever holds this many stale matrices
+    m_renderObjectStaleSlices.assign(m_num_render_objects, 0);
+    for (std::vector<uint32_t>& stale_render_objects : m_staleRenderObjects) {
+        stale_render_objects.reserve(m_num_render_objects);
     }
 
-    m_localMatricesBuffer->Unmap(0, nullptr);
+    // upload heap, stays mapped for UpdateTransforms
     //> create local matrix buffer
 }
 
+void GltfModel::SetNodeLocalTransform(const uint32_t node, const glm::mat4& local_transform)
+{
+    m_hierarchy.SetLocalTransform(m_nodeIndices[node], local_transform);
+}
+
+void GltfModel::WriteLocalMatrix(const UINT frame_index, const uint32_t render_object_index)
+{
+    UINT8* const slice = localMatricesBufferMappedGPUAddress + frame_index * m_num_render_objects * LOCAL_MATRIX_CBV_SIZE;
+    memcpy(slice + render_object_index * LOCAL_MATRIX_CBV_SIZE, &m_draw_ctx.OpaqueSurfaces[render_object_index].final_transform, sizeof(glm::mat4));
+}
+
+const std::vector<uint32_t>& GltfModel::UpdateTransforms(const UINT frame_index)
+{
+    assert(frame_index < FRAME_INFLIGHT_COUNT);
+    m_changedRenderObjects.clear();
+
+    // first the matrices that changed while the GPU was still reading this slice
+    const uint8_t slice_bit = uint8_t(1) << frame_index;
+    for (const uint32_t render_object_index : m_staleRenderObjects[frame_index]) {
+        WriteLocalMatrix(frame_index, render_object_index);
+        m_renderObjectStaleSlices[render_object_index] &= ~slice_bit;
+    }
+    m_staleRenderObjects[frame_index].clear();
+
+    // the mesh nodes are in hierarchy order, the ones of a subtree are a run of them
+    for (const TransformHierarchy::NodeRange& range : m_hierarchy.UpdateDirtyWorldTransforms()) {
+        auto mesh_node = std::ranges::lower_bound(m_meshNodes, range.begin, {}, &MeshNode::node);
+        for (; mesh_node != m_meshNodes.end() && mesh_node->node < range.end; ++mesh_node) {
+            // the draw context is recorded with an identity top matrix
+            const glm::mat4& node_matrix = m_hierarchy.GetWorldTransform(mesh_node->node);
+            const std::vector<Bounds>& surface_bounds = mesh_node->mesh_asset->surface_bounds;
+            TransformBounds(surface_bounds.data(), surface_bounds.size(), node_matrix, m_draw_ctx.OpaqueBounds.data() + mesh_node->first_render_object);
+
+            for (uint32_t surface_index = 0; surface_index < surface_bounds.size(); ++surface_index) {
+                const uint32_t render_object_index = mesh_node->first_render_object + surface_index;
+                RenderObject& render_object = m_draw_ctx.OpaqueSurfaces[render_object_index];
+                render_object.final_transform = node_matrix;
+                render_object.world_bounds = m_draw_ctx.OpaqueBounds[render_object_index];
+
+                WriteLocalMatrix(frame_index, render_object_index);
+                // the other slices catch up the next time their frame updates
+                for (UINT other_frame = 0; other_frame < FRAME_INFLIGHT_COUNT; ++other_frame) {
+                    const uint8_t other_bit = uint8_t(1) << other_frame;
+                    if (other_frame != frame_index && (m_renderObjectStaleSlices[render_object_index] & other_bit) == 0) {
+                        m_renderObjectStaleSlices[render_object_index] |= other_bit;
+                        m_staleRenderObjects[other_frame].push_back(render_object_index);
+                    }
+                }
+                m_changedRenderObjects.push_back(render_object_index);
+            }
+        }
+    }
+
+    return m_changedRenderObjects;
+}
+
 void GltfModel::TransitionResrouceStateFromCopyToGraphics(ID3D12GraphicsCommandList* pp_direct_cmd_list)
 {
     // note: the caller have to make sure copy has finished, or else data racing happen.
-    for (auto& tex_image : m_texturesImages) {
+    // shared textures are transitioned by the model that created them
+    for (ID3D12Resource* tex_image : m_createdTextures) {
         pp_direct_cmd_list->ResourceBarrier(1,
-            &CD3DX12_RESOURCE_BARRIER::Transition(tex_image.Get(), D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE));
+            &CD3DX12_RESOURCE_BARRIER::Transition(tex_image, D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE));
     }
 }
 
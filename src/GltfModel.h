@@ -2,11 +2,16 @@
 
 #include "AnniMath.h"
 #include "AnniUtils.h"
-#include <fastgltf/glm_element_traits.hpp>
-#include <fastgltf/parser.hpp>
-#include <fastgltf/tools.hpp>
-#include <fastgltf/types.hpp>
-#include <fastgltf/util.hpp>
+#include "Bounds.h"
+#include "FrameArena.h"
+#include "GeometryPool.h"
+#include "GltfImporter.h"
+#include "MatrixKernels.h"
+#include "ScenePack.h"
+#include "StagingRing.h"
+#include "TextureCache.h"
+#include "TransformHierarchy.h"
+#include <array>
 #include <unordered_map>
 #include <codecvt>
 
@@ -15,113 +20,117 @@ namespace Anni {
 struct MeshAsset // εļϣģ͵һһ֣һ棩Щιһvertex
                  // bufferindex buffer
 {
-    struct GeoSurface // ͬеεļ
-    {
-        uint32_t startIndex;
-        uint32_t count;
-        uint32_t materialIndex; // ʵindexҪ
-    };
-
-    struct GPUMeshBuffers // һmeshõbuffer
-    {
-        WRL::ComPtr<ID3D12Resource> m_vertexBuffer;
-        WRL::ComPtr<ID3D12Resource> m_indexBuffer;
-        WRL::ComPtr<ID3D12Resource> m_vertexBufferUpload;
-        WRL::ComPtr<ID3D12Resource> m_indexBufferUpload;
-
-        D3D12_VERTEX_BUFFER_VIEW m_vertexBufferView;
-        D3D12_INDEX_BUFFER_VIEW m_indexBufferView;
-
-        std::vector<uint32_t> m_cpuIndices;
-        std::vector<StandardVertex> m_cpuVertices;
-    };
+    using GeoSurface = Anni::GeoSurface;
 
     // holds the resources needed for a mesh_asset
     std::string name;
     std::vector<GeoSurface> surfaces; // ͬμ
-    GPUMeshBuffers mesh_buffers; // all buffer
+    // vertices and indices inside the geometry pool
+    GeometryAllocation geometry;
+    // GeoSurface::meshletOffset and meshletCount index into these
+    std::vector<Meshlet> meshlets;
+    // surfaces[i].bounds, packed for the batched TransformBounds
+    std::vector<Bounds> surface_bounds;
 };
 
 // ¼յȾ
 struct RenderObject {
     uint32_t index_count;
+    // both already offset into the geometry pool buffers
     uint32_t first_index;
+    int32_t base_vertex;
+    // R16_UINT or R32_UINT, the geometry pool's index buffer view of that format has to be bound
+    DXGI_FORMAT index_format;
 
     glm::mat4 final_transform;
     uint32_t material_index;
+    // the surface's bounds transformed by final_transform
+    Bounds world_bounds;
+
+    // meshlets of the surface, their first_index is relative to first_index above (observer pointer)
+    const Meshlet* meshlets;
+    uint32_t meshlet_count;
 
-    D3D12_VERTEX_BUFFER_VIEW vertex_buffer_view;
-    D3D12_INDEX_BUFFER_VIEW index_buffer_view;
+    // levels of detail of the surface, lods[0] is the range above. Their startIndex is relative to the mesh, a level
+    // starts at first_index + lods[level].startIndex - lods[0].startIndex (observer pointer)
+    const SurfaceLod* lods;
+    uint32_t lod_count;
 };
 
 struct DrawContext {
     std::vector<RenderObject> OpaqueSurfaces;
+    // OpaqueSurfaces[i].world_bounds, packed for the batched bounds and culling kernels
+    std::vector<Bounds> OpaqueBounds;
     // TODO: process TransparentSurfaces
     std::vector<RenderObject> TransparentSurfaces;
+    // memory a Draw needs only while it runs
+    FrameArena Scratch;
 };
 
-class IRenderable {
+// Rebuilds a DrawContext every frame. Begin empties the lists and the scratch arena without releasing their memory,
+// once the scene stopped growing building the context again does not touch the heap.
+class DrawListBuilder {
 public:
-    IRenderable() = default;
-
-    virtual void Draw(const glm::mat4& top_matrix, DrawContext& ctx) = 0;
-    virtual ~IRenderable() = default;
-};
-
-struct Node : public IRenderable {
-
-public:
-    Node()
-        : IRenderable()
+    DrawListBuilder() = default;
+    DrawListBuilder(const DrawListBuilder&) = delete;
+    DrawListBuilder(DrawListBuilder&&) = delete;
+    DrawListBuilder& operator=(const DrawListBuilder&) = delete;
+    DrawListBuilder& operator=(DrawListBuilder&&) = delete;
+    ~DrawListBuilder() = default;
+
+    // The context to Draw into, valid until the next Begin.
+    DrawContext& Begin()
     {
+        m_ctx.OpaqueSurfaces.clear();
+        m_ctx.OpaqueBounds.clear();
+        m_ctx.TransparentSurfaces.clear();
+        m_ctx.Scratch.Reset();
+        return m_ctx;
     }
-    virtual ~Node() override = default;
-
-    // parent pointer must be a weak pointer to avoid circular dependencies
-    std::weak_ptr<Node> parent;
-    std::vector<std::shared_ptr<Node>> children;
 
-    glm::mat4 local_transform;
-    glm::mat4 world_transform;
-
-    void RefreshTransform(const glm::mat4& parent_matrix)
+    const DrawContext& GetDrawContext() const
     {
-
-        world_transform = parent_matrix * local_transform;
-        for (const auto c : children) {
-            c->RefreshTransform(world_transform);
-        }
+        return m_ctx;
     }
 
-    virtual void Draw(const glm::mat4& top_matrix, DrawContext& ctx) override
-    {
-        // draw children
-        for (const auto& c : children) {
-            c->Draw(top_matrix, ctx);
-        }
-    }
+private:
+    DrawContext m_ctx;
 };
 
-struct MeshNode : public Node {
+class IRenderable {
 public:
-    MeshNode() = default;
+    IRenderable() = default;
 
-    virtual ~MeshNode() override = default;
+    virtual void Draw(const glm::mat4& top_matrix, DrawContext& ctx) = 0;
+    virtual ~IRenderable() = default;
+};
+
+// A node with a mesh. Its transforms live in the model's TransformHierarchy, node indexes into it.
+struct MeshNode {
+    uint32_t node;
+    // Draw emits the surfaces of the node to OpaqueSurfaces[first_render_object] onwards, in surface order
+    uint32_t first_render_object;
 
     // observer pointer
     const MeshAsset* mesh_asset;
-    virtual void Draw(const glm::mat4& top_matrix, DrawContext& ctx) override
-    {
-        const glm::mat4 node_matrix = top_matrix * world_transform;
 
+    // node_matrix is the top matrix times the node's world transform. Appends without allocating when the lists have
+    // the room.
+    void Draw(const glm::mat4& node_matrix, DrawContext& ctx) const
+    {
+        const size_t first_surface = ctx.OpaqueSurfaces.size();
         for (auto& s : mesh_asset->surfaces) {
             RenderObject def;
             def.index_count = s.count;
-            def.first_index = s.startIndex;
-            def.index_buffer_view = mesh_asset->mesh_buffers.m_indexBufferView;
-            def.vertex_buffer_view = mesh_asset->mesh_buffers.m_vertexBufferView;
+            def.first_index = mesh_asset->geometry.first_index + s.startIndex;
+            def.base_vertex = static_cast<int32_t>(mesh_asset->geometry.base_vertex);
+            def.index_format = mesh_asset->geometry.index_format;
             def.material_index = s.materialIndex;
             def.final_transform = node_matrix;
+            def.meshlets = mesh_asset->meshlets.data() + s.meshletOffset;
+            def.meshlet_count = s.meshletCount;
+            def.lods = s.lods;
+            def.lod_count = s.lodCount;
 
             // if (s.material->data.passType == MaterialPassType::Transparent)
             //{
@@ -133,8 +142,11 @@ public:
             }
         }
 
-        // recurse down(call Draw() as Node(e.g. base class's virtual function), which iterate the Node's all children Nodes.)
-        Node::Draw(top_matrix, ctx);
+        ctx.OpaqueBounds.resize(ctx.OpaqueSurfaces.size());
+        TransformBounds(mesh_asset->surface_bounds.data(), mesh_asset->surface_bounds.size(), node_matrix, ctx.OpaqueBounds.data() + first_surface);
+        for (size_t i = first_surface; i < ctx.OpaqueSurfaces.size(); ++i) {
+            ctx.OpaqueSurfaces[i].world_bounds = ctx.OpaqueBounds[i];
+        }
     }
 };
 
@@ -151,19 +163,33 @@ public:
     DrawContext m_draw_ctx;
 
 public:
-    void LoadFromFile(std::string gltf_file_path);
+    // Uploads go through staging_ring, call its Flush before the resources are used.
+    void LoadFromFile(std::string gltf_file_path, ThreadPool& thread_pool, StagingRing& staging_ring, BufferLoadMode buffer_load_mode = BufferLoadMode::MemoryMapped);
+    // Loads a pack written by SceneCooker from gltf_file_path, returns false when it is missing, corrupt or stale.
+    bool LoadFromPack(const std::string& pack_file_path, const std::string& gltf_file_path, StagingRing& staging_ring);
     void TransitionResrouceStateFromCopyToGraphics(ID3D12GraphicsCommandList* pp_direct_cmd_list);
     void Draw(const glm::mat4& top_matrix, DrawContext& ctx) final;
 
+    // Moves a node, node is its index in the glTF file. Takes effect with the next UpdateTransforms.
+    void SetNodeLocalTransform(uint32_t node, const glm::mat4& local_transform);
+    // Recomputes the world transforms below the nodes moved since the last call, refreshes the RenderObjects of m_draw_ctx
+    // they affect and writes their matrices to the local matrices buffer. Returns the indices of the changed
+    // RenderObjects in ascending order, valid until the next call. Only the slice of frame_index is written, the GPU must
+    // be done with the last frame that used it. The matrices that changed since that frame are written to it as well.
+    const std::vector<uint32_t>& UpdateTransforms(UINT frame_index);
+
     UINT32 GetNumberOfSamplers() const;
     UINT32 GetNumberOfTextures() const;
     UINT32 GetNumberOfMaterial() const;
     UINT32 GetNumberOfMatricesRenderObjects() const;
 
     CD3DX12_GPU_DESCRIPTOR_HANDLE GetGPUDescHandleToMaterialConstantsBuffer() const;
-    CD3DX12_GPU_DESCRIPTOR_HANDLE GetGPUDescHandleToLocalMatricesBuffer() const;
+    // The CBVs of the slice of frame_index, one per RenderObject.
+    CD3DX12_GPU_DESCRIPTOR_HANDLE GetGPUDescHandleToLocalMatricesBuffer(UINT frame_index) const;
     CD3DX12_GPU_DESCRIPTOR_HANDLE GetGPUDescHandleToTexturesTable() const;
     CD3DX12_GPU_DESCRIPTOR_HANDLE GetGPUDescHandleToSamplers() const;
+    // Every mesh of the model lives in this pool, bind its buffers once per pass.
+    const GeometryPool& GetGeometryPool() const;
 
     void CopyAllDescriptorsTo(
         ID3D12DescriptorHeap* shader_visible_cbv_srv_uva_heap,
@@ -171,7 +197,7 @@ public:
         CD3DX12_CPU_DESCRIPTOR_HANDLE* dest_shader_visible_cbv_srv_uav_heap_handle,
         CD3DX12_CPU_DESCRIPTOR_HANDLE* dest_shader_visible_sampler_heap_handle);
 
-    GltfModel(ID3D12Device* pp_device, ID3D12GraphicsCommandList* pp_copy_cmd_list);
+    GltfModel(ID3D12Device* pp_device, ResourceHeapAllocator& heap_allocator, GeometryPool& geometry_pool, TextureCache& texture_cache);
     GltfModel() = delete;
     ~GltfModel();
 
@@ -257,34 +283,11 @@ public:
     //}
 
 private:
-    static D3D12_FILTER ExtractFilterAndMipMapMode(const fastgltf::Filter min_filter,
-        const fastgltf::Filter mag_filter,
-        const fastgltf::Filter mip_map_mode);
-
-    static D3D12_TEXTURE_ADDRESS_MODE ExtractAddressMode(const fastgltf::Wrap warp);
-
-    struct MaterialConstants {
-        glm::vec4 colorFactors;
-        glm::vec4 metalRoughFactors;
-
-        INT32 albedoIndex { -1 };
-        INT32 albedoSamplerIndex { -1 };
-
-        INT32 metalRoughIndex { -1 };
-        INT32 metalRoughSamplerIndex { -1 };
-
-        INT32 normalIndex { -1 };
-        INT32 normalSamplerIndex { -1 };
-
-        INT32 emissiveIndex { -1 };
-        INT32 emissiveSamplerIndex { -1 };
-
-        INT32 occlusionIndex { -1 };
-        INT32 occlusionSamplerIndex { -1 };
-        INT32 padding0;
-        INT32 padding1;
-        //glm::vec4 extra[11];
-    };
+    // GPU half of the loading, shared by LoadFromFile and LoadFromPack. The CPU copy of every texture and mesh is
+    // released as soon as its upload is recorded on the staging ring.
+    void CreateResources(ModelData&& model_data, StagingRing& staging_ring);
+    // final matrix of the RenderObject into the slice of frame_index
+    void WriteLocalMatrix(UINT frame_index, uint32_t render_object_index);
 
 private:
     UINT m_num_samplers;
@@ -299,40 +302,51 @@ private:
     ID3D12Device* m_pp_device;
 
 private:
-    // For copy command list(observer pointer)
-    ID3D12GraphicsCommandList* m_copyCommandList;
+    // Shared with the other models, both outlive the model (observer pointers)
+    ResourceHeapAllocator* m_heapAllocator;
+    GeometryPool* m_geometryPool;
+    TextureCache* m_textureCache;
 
     // CPU readable sampler heap
     WRL::ComPtr<ID3D12DescriptorHeap> m_samplerHeap;
     // CPU readable cbv srv uav heap
     WRL::ComPtr<ID3D12DescriptorHeap> m_cbvSrvUavHeap;
 
-    // Texture Images
-    std::vector<unsigned char*>  m_4_com_tex_temp_buffers;
-
-    std::vector<WRL::ComPtr<ID3D12Resource>> m_texturesImages;
-    std::vector<WRL::ComPtr<ID3D12Resource>> m_textureImageUploads;
-    std::unordered_map<std::string, ID3D12Resource*> m_namesToTextures;
+    // Texture Images, owned by the texture cache and possibly shared with other models (observer pointers)
+    std::vector<ID3D12Resource*> m_texturesImages;
+    // the ones this model created, it transitions them out of COPY_DEST (observer pointers)
+    std::vector<ID3D12Resource*> m_createdTextures;
 
 
     // Material Constants Buffer
-    WRL::ComPtr<ID3D12Resource> m_materialConstBuffer;
+    PlacedResource m_materialConstBuffer;
     CD3DX12_CPU_DESCRIPTOR_HANDLE m_materialConstantDataBuffer;
     UINT8* materialConstBufferMappedGPUAddress;
 
-    // Local Matrices Buffer
-    WRL::ComPtr<ID3D12Resource> m_localMatricesBuffer;
+    // Local Matrices Buffer, FRAME_INFLIGHT_COUNT slices of one matrix per RenderObject
+    PlacedResource m_localMatricesBuffer;
     CD3DX12_CPU_DESCRIPTOR_HANDLE m_localMatricesDataBuffer;
     UINT8* localMatricesBufferMappedGPUAddress;
+    // bit i is set when slice i still holds an old matrix of the RenderObject
+    std::vector<uint8_t> m_renderObjectStaleSlices;
+    // the RenderObjects whose bit of the slice is set, written by the slice's next UpdateTransforms
+    std::array<std::vector<uint32_t>, FRAME_INFLIGHT_COUNT> m_staleRenderObjects;
+    static_assert(FRAME_INFLIGHT_COUNT <= 8, "one bit per slice in m_renderObjectStaleSlices");
 
     // Nodes
-    std::vector<std::shared_ptr<Node>> m_nodes;
+    TransformHierarchy m_hierarchy;
+    // hierarchy index of every glTF node
+    std::vector<uint32_t> m_nodeIndices;
+    // in hierarchy order, so the surfaces are drawn parents first like the node tree used to be walked
+    std::vector<MeshNode> m_meshNodes;
+    // UpdateTransforms result, keeps its capacity across frames
+    std::vector<uint32_t> m_changedRenderObjects;
+    // surfaces of all mesh nodes, Draw emits this many RenderObjects
+    UINT32 m_num_render_objects;
 
     // Meshes
     std::unique_ptr<MeshAsset[]> m_meshes;
-
-    // Array of observer pointers
-    std::vector<Node*> m_topNodes;
+    size_t m_num_meshes;
 
     // Installed GPU descriptor handle
     CD3DX12_GPU_DESCRIPTOR_HANDLE m_gpu_desc_handle_to_texture_srvs;
@@ -0,0 +1,190 @@
+#include "HeapAllocationCounter.h"
+
+#include <cassert>
+#include <cstdlib>
+#include <iostream>
+#include <malloc.h>
+#include <new>
+
+namespace Anni {
+
+namespace {
+
+    // per thread, the loader's worker threads do not disturb a frame recorded on the main thread
+    thread_local uint64_t heap_allocation_count = 0;
+
+}
+
+#if defined(_DEBUG)
+
+namespace {
+
+    void* CountedAllocate(const size_t size) noexcept
+    {
+        ++heap_allocation_count;
+        return std::malloc(size == 0 ? 1 : size);
+    }
+
+    void* CountedAllocateAligned(const size_t size, const std::align_val_t alignment) noexcept
+    {
+        ++heap_allocation_count;
+        return _aligned_malloc(size == 0 ? 1 : size, static_cast<size_t>(alignment));
+    }
+
+    void* ThrowIfNull(void* p)
+    {
+        if (!p) {
+            throw std::bad_alloc();
+        }
+        return p;
+    }
+
+}
+
+uint64_t GetHeapAllocationCount()
+{
+    return heap_allocation_count;
+}
+
+#else
+
+uint64_t GetHeapAllocationCount()
+{
+    return 0;
+}
+
+#endif
+
+NoHeapAllocationScope::NoHeapAllocationScope(const char* name, const bool enabled)
+    : m_name(name)
+    , m_begin(GetHeapAllocationCount())
+    , m_ended(!enabled)
+{
+}
+
+NoHeapAllocationScope::~NoHeapAllocationScope()
+{
+    End();
+}
+
+void NoHeapAllocationScope::End()
+{
+    if (m_ended) {
+        return;
+    }
+    m_ended = true;
+
+    const uint64_t allocations = GetHeapAllocationCount() - m_begin;
+    if (allocations != 0) {
+        std::cout << "[HeapAllocationCounter] " << m_name << " made " << allocations << " heap allocation(s)" << '\n';
+    }
+    assert(allocations == 0);
+}
+
+}
+
+#if defined(_DEBUG)
+
+// the replaceable global allocation functions, all of them so that every delete matches its new
+
+void* operator new(const size_t size)
+{
+    return Anni::ThrowIfNull(Anni::CountedAllocate(size));
+}
+
+void* operator new[](const size_t size)
+{
+    return Anni::ThrowIfNull(Anni::CountedAllocate(size));
+}
+
+void* operator new(const size_t size, const std::nothrow_t&) noexcept
+{
+    return Anni::CountedAllocate(size);
+}
+
+void* operator new[](const size_t size, const std::nothrow_t&) noexcept
+{
+    return Anni::CountedAllocate(size);
+}
+
+void* operator new(const size_t size, const std::align_val_t alignment)
+{
+    return Anni::ThrowIfNull(Anni::CountedAllocateAligned(size, alignment));
+}
+
+void* operator new[](const size_t size, const std::align_val_t alignment)
+{
+    return Anni::ThrowIfNull(Anni::CountedAllocateAligned(size, alignment));
+}
+
+void* operator new(const size_t size, const std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+    return Anni::CountedAllocateAligned(size, alignment);
+}
+
+void* operator new[](const size_t size, const std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+    return Anni::CountedAllocateAligned(size, alignment);
+}
+
+void operator delete(void* p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete[](void* p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void* p, size_t) noexcept
+{
+    std::free(p);
+}
+
+void operator delete[](void* p, size_t) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void* p, const std::nothrow_t&) noexcept
+{
+    std::free(p);
+}
+
+void operator delete[](void* p, const std::nothrow_t&) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void* p, std::align_val_t) noexcept
+{
+    _aligned_free(p);
+}
+
+void operator delete[](void* p, std::align_val_t) noexcept
+{
+    _aligned_free(p);
+}
+
+void operator delete(void* p, size_t, std::align_val_t) noexcept
+{
+    _aligned_free(p);
+}
+
+void operator delete[](void* p, size_t, std::align_val_t) noexcept
+{
+    _aligned_free(p);
+}
+
+void operator delete(void* p, std::align_val_t, const std::nothrow_t&) noexcept
+{
+    _aligned_free(p);
+}
+
+void operator delete[](void* p, std::align_val_t, const std::nothrow_t&) noexcept
+{
+    _aligned_free(p);
+}
+
+#endif
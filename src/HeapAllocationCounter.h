@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstdint>
+
+namespace Anni {
+
+// Debug builds replace the global operator new to count the heap allocations of every thread. Release builds count
+// nothing and the checks below always pass.
+
+// Heap allocations the calling thread made so far, always 0 in release builds.
+uint64_t GetHeapAllocationCount();
+
+// Asserts that the calling thread does not allocate from construction to destruction (or End), for code that is meant
+// to run off memory it reserved up front, like a steady-state frame. A disabled scope checks nothing.
+class NoHeapAllocationScope {
+public:
+    explicit NoHeapAllocationScope(const char* name, bool enabled = true);
+    NoHeapAllocationScope(const NoHeapAllocationScope&) = delete;
+    NoHeapAllocationScope(NoHeapAllocationScope&&) = delete;
+    NoHeapAllocationScope& operator=(const NoHeapAllocationScope&) = delete;
+    NoHeapAllocationScope& operator=(NoHeapAllocationScope&&) = delete;
+    ~NoHeapAllocationScope();
+
+    void End();
+
+private:
+    const char* m_name;
+    uint64_t m_begin;
+    bool m_ended;
+};
+
+}
@@ -0,0 +1,297 @@
+#include "LoadProfiler.h"
+
+#include "AnniUtils.h"
+
+#include <algorithm>
+#include <atomic>
+#include <iomanip>
+#include <string_view>
+#include <unordered_map>
+
+namespace Anni {
+
+namespace {
+
+    // Small and stable per thread, the trace viewer draws one row per id.
+    uint32_t GetProfileThreadId()
+    {
+        static std::atomic<uint32_t> next_thread_id { 0 };
+        thread_local const uint32_t thread_id = next_thread_id.fetch_add(1, std::memory_order_relaxed);
+        return thread_id;
+    }
+
+    void WriteJsonString(std::ostream& out, const std::string& s)
+    {
+        out << '"';
+        for (const char c : s) {
+            switch (c) {
+            case '"':
+                out << "\\\"";
+                break;
+            case '\\':
+                out << "\\\\";
+                break;
+            case '\n':
+                out << "\\n";
+                break;
+            case '\t':
+                out << "\\t";
+                break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20) {
+                    out << "\\u" << std::hex << std::setw(4) << std::setfill('0') << static_cast<int>(c) << std::dec << std::setfill(' ');
+                } else {
+                    out << c;
+                }
+            }
+        }
+        out << '"';
+    }
+
+    std::ofstream OpenReportFile(const std::filesystem::path& path)
+    {
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        if (!out) {
+            throw std::runtime_error("Failed to open " + path.string() + " for writing");
+        }
+        out << std::fixed << std::setprecision(3);
+        return out;
+    }
+
+}
+
+LoadProfiler& LoadProfiler::Get()
+{
+    static LoadProfiler profiler;
+    return profiler;
+}
+
+LoadProfiler::LoadProfiler()
+    : m_origin(std::chrono::steady_clock::now())
+    , m_assets { "" }
+    , m_currentAsset(0)
+{
+}
+
+uint32_t LoadProfiler::BeginAsset(const std::string& asset)
+{
+    std::lock_guard lock(m_mutex);
+    const uint32_t previous_asset = m_currentAsset;
+
+    const auto found = std::ranges::find(m_assets, asset);
+    m_currentAsset = static_cast<uint32_t>(found - m_assets.begin());
+    if (found == m_assets.end()) {
+        m_assets.push_back(asset);
+    }
+    return previous_asset;
+}
+
+void LoadProfiler::EndAsset(const uint32_t previous_asset)
+{
+    std::lock_guard lock(m_mutex);
+    m_currentAsset = previous_asset;
+}
+
+void LoadProfiler::Record(const char* name, const uint32_t asset, const std::chrono::steady_clock::time_point begin, const std::chrono::steady_clock::time_point end)
+{
+    const Zone zone {
+        .name = name,
+        .asset = asset,
+        .thread = GetProfileThreadId(),
+        .begin_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(begin - m_origin).count(),
+        .duration_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count(),
+    };
+
+    std::lock_guard lock(m_mutex);
+    m_zones.push_back(zone);
+}
+
+uint32_t LoadProfiler::GetCurrentAsset() const
+{
+    std::lock_guard lock(m_mutex);
+    return m_currentAsset;
+}
+
+std::vector<LoadProfiler::StageTotal> LoadProfiler::SumStages(const std::vector<Zone>& zones)
+{
+    std::vector<StageTotal> stages;
+    // by content, the same literal may have a different address in every translation unit
+    std::unordered_map<std::string_view, size_t> stage_indices;
+    std::vector<std::pair<int64_t, int64_t>> spans;
+
+    for (const Zone& zone : zones) {
+        const auto [it, inserted] = stage_indices.try_emplace(zone.name, stages.size());
+        if (inserted) {
+            stages.push_back({ .name = zone.name, .count = 0, .total_ms = 0.0, .wall_ms = 0.0 });
+            spans.emplace_back(INT64_MAX, INT64_MIN);
+        }
+
+        StageTotal& stage = stages[it->second];
+        ++stage.count;
+        stage.total_ms += zone.duration_ns * 1e-6;
+
+        auto& [first_begin, last_end] = spans[it->second];
+        first_begin = std::min(first_begin, zone.begin_ns);
+        last_end = std::max(last_end, zone.begin_ns + zone.duration_ns);
+    }
+
+    for (size_t i = 0; i < stages.size(); ++i) {
+        stages[i].wall_ms = (spans[i].second - spans[i].first) * 1e-6;
+    }
+    std::ranges::stable_sort(stages, std::ranges::greater {}, &StageTotal::total_ms);
+    return stages;
+}
+
+void LoadProfiler::WriteReport(const std::filesystem::path& report_path) const
+{
+    std::vector<Zone> zones;
+    std::vector<std::string> assets;
+    {
+        std::lock_guard lock(m_mutex);
+        zones = m_zones;
+        assets = m_assets;
+    }
+
+    std::ofstream out = OpenReportFile(report_path);
+
+    const auto write_stages = [&out](const std::vector<StageTotal>& stages, const char* indent) {
+        for (size_t i = 0; i < stages.size(); ++i) {
+            out << indent << "{ \"name\": ";
+            WriteJsonString(out, stages[i].name);
+            out << ", \"count\": " << stages[i].count
+                << ", \"total_ms\": " << stages[i].total_ms
+                << ", \"wall_ms\": " << stages[i].wall_ms << " }"
+                << (i + 1 < stages.size() ? ",\n" : "\n");
+        }
+    };
+
+    out << "{\n";
+    out << "  \"simd_level\": ";
+    WriteJsonString(out, GetSimdLevelName(GetSimdLevel()));
+    out << ",\n";
+
+    out << "  \"stages\": [\n";
+    write_stages(SumStages(zones), "    ");
+    out << "  ],\n";
+
+    // zones outside of any asset (asset 0) only show up in the stage totals
+    out << "  \"assets\": [";
+    bool first_asset = true;
+    for (uint32_t asset = 1; asset < assets.size(); ++asset) {
+        std::vector<Zone> asset_zones;
+        std::ranges::copy_if(zones, std::back_inserter(asset_zones), [asset](const Zone& zone) { return zone.asset == asset; });
+        if (asset_zones.empty()) {
+            continue;
+        }
+
+        out << (first_asset ? "\n" : ",\n");
+        first_asset = false;
+
+        out << "    {\n      \"asset\": ";
+        WriteJsonString(out, assets[asset]);
+        out << ",\n      \"stages\": [\n";
+        write_stages(SumStages(asset_zones), "        ");
+        out << "      ]\n    }";
+    }
+    out << (first_asset ? "]\n" : "\n  ]\n");
+    out << "}\n";
+
+    std::cout << "[LoadProfiler] wrote " << zones.size() << " zones of " << assets.size() - 1 << " asset(s) to "
+              << report_path.string() << '\n';
+}
+
+void LoadProfiler::WriteChromeTrace(const std::filesystem::path& trace_path) const
+{
+    std::vector<Zone> zones;
+    std::vector<std::string> assets;
+    {
+        std::lock_guard lock(m_mutex);
+        zones = m_zones;
+        assets = m_assets;
+    }
+
+    std::ofstream out = OpenReportFile(trace_path);
+
+    out << "{ \"displayTimeUnit\": \"ms\", \"traceEvents\": [\n";
+    for (size_t i = 0; i < zones.size(); ++i) {
+        const Zone& zone = zones[i];
+        out << "  { \"name\": ";
+        WriteJsonString(out, zone.name);
+        out << ", \"cat\": \"load\", \"ph\": \"X\", \"pid\": 0, \"tid\": " << zone.thread
+            << ", \"ts\": " << zone.begin_ns * 1e-3
+            << ", \"dur\": " << zone.duration_ns * 1e-3;
+        if (zone.asset != 0) {
+            out << ", \"args\": { \"asset\": ";
+            WriteJsonString(out, assets[zone.asset]);
+            out << " }";
+        }
+        out << " }" << (i + 1 < zones.size() ? ",\n" : "\n");
+    }
+    out << "] }\n";
+
+    std::cout << "[LoadProfiler] wrote the trace of " << zones.size() << " zones to " << trace_path.string() << '\n';
+}
+
+void LoadProfiler::LogStats() const
+{
+    std::vector<Zone> zones;
+    {
+        std::lock_guard lock(m_mutex);
+        zones = m_zones;
+    }
+
+    for (const StageTotal& stage : SumStages(zones)) {
+        std::cout << "[LoadProfiler] " << stage.name << ": " << stage.total_ms << " ms in " << stage.count
+                  << " zone(s), " << stage.wall_ms << " ms wall" << '\n';
+    }
+}
+
+void LoadProfiler::Clear()
+{
+    std::lock_guard lock(m_mutex);
+    m_zones.clear();
+    m_assets.resize(1);
+    m_currentAsset = 0;
+}
+
+ProfileZone::ProfileZone(const char* name)
+    : m_name(name)
+    , m_asset(LOAD_PROFILING ? LoadProfiler::Get().GetCurrentAsset() : 0)
+    , m_begin(LOAD_PROFILING ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point {})
+    , m_ended(!LOAD_PROFILING)
+{
+}
+
+ProfileZone::~ProfileZone()
+{
+    End();
+}
+
+void ProfileZone::End()
+{
+    if (!m_ended) {
+        LoadProfiler::Get().Record(m_name, m_asset, m_begin, std::chrono::steady_clock::now());
+        m_ended = true;
+    }
+}
+
+ProfileAsset::ProfileAsset(const std::string& asset)
+    : m_previousAsset(0)
+    , m_asset(0)
+{
+    if constexpr (LOAD_PROFILING) {
+        m_previousAsset = LoadProfiler::Get().BeginAsset(asset);
+        m_asset = LoadProfiler::Get().GetCurrentAsset();
+        m_begin = std::chrono::steady_clock::now();
+    }
+}
+
+ProfileAsset::~ProfileAsset()
+{
+    if constexpr (LOAD_PROFILING) {
+        LoadProfiler::Get().Record("Asset", m_asset, m_begin, std::chrono::steady_clock::now());
+        LoadProfiler::Get().EndAsset(m_previousAsset);
+    }
+}
+
+}
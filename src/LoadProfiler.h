@@ -0,0 +1,115 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace Anni {
+
+// Scoped timers for model loading. A zone is two steady_clock reads and one short locked push, cheap next to the
+// work the loader times (a stage, an image, a primitive). Zones may run on any thread, each remembers the asset that
+// was current when it began, loading goes one asset at a time so jobs on pool threads get attributed correctly.
+//
+// The report sums the zones per stage name and per asset, the Chrome trace (chrome://tracing, Perfetto) shows every
+// zone on its thread.
+class LoadProfiler {
+public:
+    // Process wide, the importer runs in the renderer and in SceneCooker.
+    static LoadProfiler& Get();
+
+    LoadProfiler();
+    LoadProfiler(const LoadProfiler&) = delete;
+    LoadProfiler(LoadProfiler&&) = delete;
+    LoadProfiler& operator=(const LoadProfiler&) = delete;
+    LoadProfiler& operator=(LoadProfiler&&) = delete;
+    ~LoadProfiler() = default;
+
+    // Zones begun between the calls belong to asset, returns the previous current asset to restore.
+    uint32_t BeginAsset(const std::string& asset);
+    void EndAsset(uint32_t previous_asset);
+
+    // name must outlive the profiler, zones are named with string literals.
+    void Record(const char* name, uint32_t asset, std::chrono::steady_clock::time_point begin, std::chrono::steady_clock::time_point end);
+    uint32_t GetCurrentAsset() const;
+
+    // {"stages": [...], "assets": [...]}, times in milliseconds. Throws std::runtime_error when the file can't be
+    // written.
+    void WriteReport(const std::filesystem::path& report_path) const;
+    // Trace Event Format, complete events with microsecond timestamps relative to the profiler's creation.
+    void WriteChromeTrace(const std::filesystem::path& trace_path) const;
+    // One line per stage, slowest first.
+    void LogStats() const;
+
+    void Clear();
+
+private:
+    struct Zone {
+        const char* name;
+        uint32_t asset;
+        uint32_t thread;
+        // from m_origin
+        int64_t begin_ns;
+        int64_t duration_ns;
+    };
+
+    struct StageTotal {
+        const char* name;
+        uint32_t count;
+        // sum over the zones, above the wall time when they ran in parallel
+        double total_ms;
+        // first begin to last end
+        double wall_ms;
+    };
+
+    static std::vector<StageTotal> SumStages(const std::vector<Zone>& zones);
+
+    std::chrono::steady_clock::time_point m_origin;
+
+    mutable std::mutex m_mutex;
+    std::vector<Zone> m_zones;
+    std::vector<std::string> m_assets;
+    uint32_t m_currentAsset;
+};
+
+// Times its own lifetime as a zone of the current asset, or up to End() for stages that aren't a scope of their own.
+class ProfileZone {
+public:
+    explicit ProfileZone(const char* name);
+    ProfileZone() = delete;
+    ProfileZone(const ProfileZone&) = delete;
+    ProfileZone(ProfileZone&&) = delete;
+    ProfileZone& operator=(const ProfileZone&) = delete;
+    ProfileZone& operator=(ProfileZone&&) = delete;
+    ~ProfileZone();
+
+    // Records the zone, later calls and the destructor do nothing.
+    void End();
+
+private:
+    const char* m_name;
+    uint32_t m_asset;
+    std::chrono::steady_clock::time_point m_begin;
+    bool m_ended;
+};
+
+// Makes asset current for its lifetime and times it as a whole (zone "Asset").
+class ProfileAsset {
+public:
+    explicit ProfileAsset(const std::string& asset);
+    ProfileAsset() = delete;
+    ProfileAsset(const ProfileAsset&) = delete;
+    ProfileAsset(ProfileAsset&&) = delete;
+    ProfileAsset& operator=(const ProfileAsset&) = delete;
+    ProfileAsset& operator=(ProfileAsset&&) = delete;
+    ~ProfileAsset();
+
+private:
+    uint32_t m_previousAsset;
+    uint32_t m_asset;
+    std::chrono::steady_clock::time_point m_begin;
+};
+
+}
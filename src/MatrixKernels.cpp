@@ -0,0 +1,285 @@
+#include "MatrixKernels.h"
+
+#include <immintrin.h>
+
+#include <algorithm>
+
+namespace Anni {
+
+namespace {
+
+    static_assert(sizeof(glm::mat4) == 64, "the kernels read a mat4 as 16 consecutive floats");
+    static_assert(sizeof(Bounds) == 28 && offsetof(Bounds, origin) == 0 && offsetof(Bounds, extents) == 12 && offsetof(Bounds, sphereRadius) == 24,
+        "LoadBounds reads origin and extents as 16 bytes each, both stay inside the struct");
+
+    //> isa
+    // A register holds COLUMNS matrix columns or the origins or extents of COLUMNS bounds, one per 128 bit lane.
+    struct Sse41 {
+        static constexpr size_t COLUMNS = 1;
+        using Float = __m128;
+
+        static Float Add(const Float a, const Float b) { return _mm_add_ps(a, b); }
+        static Float Mul(const Float a, const Float b) { return _mm_mul_ps(a, b); }
+        static Float Abs(const Float a) { return _mm_andnot_ps(_mm_set1_ps(-0.0f), a); }
+        // component k of every lane's column
+        template <int k>
+        static Float Splat(const Float a) { return _mm_shuffle_ps(a, a, _MM_SHUFFLE(k, k, k, k)); }
+
+        static Float BroadcastColumn(const float* p) { return _mm_loadu_ps(p); }
+        // lane j from p + j * stride
+        static Float LoadLanes(const float* p, size_t) { return _mm_loadu_ps(p); }
+        static void StoreLanes(float* lanes, const Float a) { _mm_storeu_ps(lanes, a); }
+
+        static void Transpose(float* m)
+        {
+            __m128 c0 = _mm_loadu_ps(m);
+            __m128 c1 = _mm_loadu_ps(m + 4);
+            __m128 c2 = _mm_loadu_ps(m + 8);
+            __m128 c3 = _mm_loadu_ps(m + 12);
+            _MM_TRANSPOSE4_PS(c0, c1, c2, c3);
+            _mm_storeu_ps(m, c0);
+            _mm_storeu_ps(m + 4, c1);
+            _mm_storeu_ps(m + 8, c2);
+            _mm_storeu_ps(m + 12, c3);
+        }
+    };
+
+    // only the transpose, the products and bounds measured slower than glm and SSE4.1 on two columns
+    struct Avx2 {
+        // [c0.x c1.x c0.y c1.y | c0.z c1.z c0.w c1.w] and the same for c2 and c3, then pairs of them make the rows
+        static void Transpose(float* m)
+        {
+            const __m256i interleave = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+            const __m256 c01 = _mm256_permutevar8x32_ps(_mm256_loadu_ps(m), interleave);
+            const __m256 c23 = _mm256_permutevar8x32_ps(_mm256_loadu_ps(m + 8), interleave);
+            const __m256 rows02 = _mm256_castpd_ps(_mm256_unpacklo_pd(_mm256_castps_pd(c01), _mm256_castps_pd(c23)));
+            const __m256 rows13 = _mm256_castpd_ps(_mm256_unpackhi_pd(_mm256_castps_pd(c01), _mm256_castps_pd(c23)));
+            _mm256_storeu_ps(m, _mm256_permute2f128_ps(rows02, rows13, 0x20));
+            _mm256_storeu_ps(m + 8, _mm256_permute2f128_ps(rows02, rows13, 0x31));
+        }
+    };
+
+    struct Avx512 {
+        static constexpr size_t COLUMNS = 4;
+        using Float = __m512;
+
+        static Float Add(const Float a, const Float b) { return _mm512_add_ps(a, b); }
+        static Float Mul(const Float a, const Float b) { return _mm512_mul_ps(a, b); }
+        template <int k>
+        static Float Splat(const Float a) { return _mm512_permute_ps(a, _MM_SHUFFLE(k, k, k, k)); }
+
+        static Float LoadColumns(const float* p) { return _mm512_loadu_ps(p); }
+        static void StoreColumns(float* p, const Float a) { _mm512_storeu_ps(p, a); }
+        static Float BroadcastColumn(const float* p) { return _mm512_broadcast_f32x4(_mm_loadu_ps(p)); }
+
+        static void Transpose(float* m)
+        {
+            const __m512i rows = _mm512_setr_epi32(0, 4, 8, 12, 1, 5, 9, 13, 2, 6, 10, 14, 3, 7, 11, 15);
+            _mm512_storeu_ps(m, _mm512_permutexvar_ps(rows, _mm512_loadu_ps(m)));
+        }
+    };
+    //< isa
+
+    //> multiply
+    const float* Floats(const glm::mat4& m)
+    {
+        return reinterpret_cast<const float*>(&m);
+    }
+
+    float* Floats(glm::mat4& m)
+    {
+        return reinterpret_cast<float*>(&m);
+    }
+
+    // The left matrix's columns, each repeated in every lane.
+    template <typename Isa>
+    struct LeftMatrix {
+        typename Isa::Float c0, c1, c2, c3;
+
+        explicit LeftMatrix(const glm::mat4& m)
+            : c0(Isa::BroadcastColumn(Floats(m)))
+            , c1(Isa::BroadcastColumn(Floats(m) + 4))
+            , c2(Isa::BroadcastColumn(Floats(m) + 8))
+            , c3(Isa::BroadcastColumn(Floats(m) + 12))
+        {
+        }
+
+        // ((c0 * b.x + c1 * b.y) + c2 * b.z) + c3 * b.w for every lane's column b, like glm's operator*
+        typename Isa::Float Transform(const typename Isa::Float b) const
+        {
+            return Isa::Add(Isa::Add(Isa::Add(
+                                         Isa::Mul(c0, Isa::template Splat<0>(b)),
+                                         Isa::Mul(c1, Isa::template Splat<1>(b))),
+                                Isa::Mul(c2, Isa::template Splat<2>(b))),
+                Isa::Mul(c3, Isa::template Splat<3>(b)));
+        }
+    };
+
+    template <typename Isa>
+    void Multiply(const LeftMatrix<Isa>& a, const glm::mat4& b, glm::mat4& out)
+    {
+        constexpr size_t groups = 4 / Isa::COLUMNS;
+        typename Isa::Float result[groups];
+        for (size_t g = 0; g < groups; ++g) {
+            result[g] = a.Transform(Isa::LoadColumns(Floats(b) + 4 * Isa::COLUMNS * g));
+        }
+        for (size_t g = 0; g < groups; ++g) {
+            Isa::StoreColumns(Floats(out) + 4 * Isa::COLUMNS * g, result[g]);
+        }
+    }
+
+    template <typename Isa>
+    void MultiplyEach(const glm::mat4* left, const glm::mat4* right, const size_t count, glm::mat4* out)
+    {
+        for (size_t i = 0; i < count; ++i) {
+            Multiply(LeftMatrix<Isa>(left[i]), right[i], out[i]);
+        }
+    }
+
+    template <typename Isa>
+    void MultiplyByLeft(const glm::mat4& left, const glm::mat4* right, const size_t count, glm::mat4* out)
+    {
+        const LeftMatrix<Isa> a(left);
+        for (size_t i = 0; i < count; ++i) {
+            Multiply(a, right[i], out[i]);
+        }
+    }
+
+    template <typename Isa>
+    void MultiplyByRight(const glm::mat4* left, const glm::mat4& right, const size_t count, glm::mat4* out)
+    {
+        // the splats of right are cheap next to the products, they are not hoisted
+        for (size_t i = 0; i < count; ++i) {
+            Multiply(LeftMatrix<Isa>(left[i]), right, out[i]);
+        }
+    }
+    //< multiply
+
+    //> bounds
+    // glm: origin ((c0 * x + c1 * y) + (c2 * z + c3)), extents (|c0| * x + |c1| * y) + |c2| * z
+    template <typename Isa>
+    size_t TransformBoundsSimd(const Bounds* bounds, const size_t count, const glm::mat4& transform, const float scale, Bounds* out)
+    {
+        using Float = typename Isa::Float;
+        constexpr size_t stride = sizeof(Bounds) / sizeof(float);
+
+        const Float c0 = Isa::BroadcastColumn(Floats(transform));
+        const Float c1 = Isa::BroadcastColumn(Floats(transform) + 4);
+        const Float c2 = Isa::BroadcastColumn(Floats(transform) + 8);
+        const Float c3 = Isa::BroadcastColumn(Floats(transform) + 12);
+        const Float abs_c0 = Isa::Abs(c0);
+        const Float abs_c1 = Isa::Abs(c1);
+        const Float abs_c2 = Isa::Abs(c2);
+
+        size_t i = 0;
+        for (; i + Isa::COLUMNS <= count; i += Isa::COLUMNS) {
+            const Float origin = Isa::LoadLanes(&bounds[i].origin.x, stride);
+            const Float extents = Isa::LoadLanes(&bounds[i].extents.x, stride);
+            float radii[Isa::COLUMNS];
+            for (size_t j = 0; j < Isa::COLUMNS; ++j) {
+                radii[j] = bounds[i + j].sphereRadius * scale;
+            }
+
+            const Float new_origin = Isa::Add(
+                Isa::Add(Isa::Mul(c0, Isa::template Splat<0>(origin)), Isa::Mul(c1, Isa::template Splat<1>(origin))),
+                Isa::Add(Isa::Mul(c2, Isa::template Splat<2>(origin)), c3));
+            const Float new_extents = Isa::Add(
+                Isa::Add(Isa::Mul(abs_c0, Isa::template Splat<0>(extents)), Isa::Mul(abs_c1, Isa::template Splat<1>(extents))),
+                Isa::Mul(abs_c2, Isa::template Splat<2>(extents)));
+
+            float origins[4 * Isa::COLUMNS];
+            float extents_out[4 * Isa::COLUMNS];
+            Isa::StoreLanes(origins, new_origin);
+            Isa::StoreLanes(extents_out, new_extents);
+            for (size_t j = 0; j < Isa::COLUMNS; ++j) {
+                Bounds& result = out[i + j];
+                result.origin = glm::vec3(origins[4 * j], origins[4 * j + 1], origins[4 * j + 2]);
+                result.extents = glm::vec3(extents_out[4 * j], extents_out[4 * j + 1], extents_out[4 * j + 2]);
+                result.sphereRadius = radii[j];
+            }
+        }
+        return i;
+    }
+    //< bounds
+
+}
+
+// The products go through glm below AVX-512, the compiler vectorizes it well enough that the 1 and 2 column kernels
+// measured slower.
+void MultiplyMatrices(const glm::mat4* left, const glm::mat4* right, const size_t count, glm::mat4* out, const SimdLevel level)
+{
+    if (level >= SimdLevel::AVX512) {
+        MultiplyEach<Avx512>(left, right, count, out);
+    } else {
+        for (size_t i = 0; i < count; ++i) {
+            out[i] = left[i] * right[i];
+        }
+    }
+}
+
+void MultiplyMatrices(const glm::mat4& left, const glm::mat4* right, const size_t count, glm::mat4* out, const SimdLevel level)
+{
+    if (level >= SimdLevel::AVX512) {
+        MultiplyByLeft<Avx512>(left, right, count, out);
+    } else {
+        const glm::mat4 a = left;
+        for (size_t i = 0; i < count; ++i) {
+            out[i] = a * right[i];
+        }
+    }
+}
+
+void MultiplyMatrices(const glm::mat4* left, const glm::mat4& right, const size_t count, glm::mat4* out, const SimdLevel level)
+{
+    if (level >= SimdLevel::AVX512) {
+        MultiplyByRight<Avx512>(left, right, count, out);
+    } else {
+        const glm::mat4 b = right;
+        for (size_t i = 0; i < count; ++i) {
+            out[i] = left[i] * b;
+        }
+    }
+}
+
+// The chain through the parents leaves nothing to batch, one product at a time is as fast as glm gets and AVX-512
+// measured slower.
+void ConcatenateTransforms(const INT32* parents, const glm::mat4* local, const size_t begin, const size_t end, glm::mat4* world)
+{
+    for (size_t i = begin; i < end; ++i) {
+        world[i] = parents[i] < 0 ? local[i] : world[parents[i]] * local[i];
+    }
+}
+
+void TransposeMatrices(glm::mat4* matrices, const size_t count, const SimdLevel level)
+{
+    for (size_t i = 0; i < count; ++i) {
+        float* m = Floats(matrices[i]);
+        if (level >= SimdLevel::AVX512) {
+            Avx512::Transpose(m);
+        } else if (level == SimdLevel::AVX2) {
+            Avx2::Transpose(m);
+        } else if (level == SimdLevel::SSE41) {
+            Sse41::Transpose(m);
+        } else {
+            matrices[i] = glm::transpose(matrices[i]);
+        }
+    }
+}
+
+void TransformBounds(const Bounds* bounds, const size_t count, const glm::mat4& transform, Bounds* out, const SimdLevel level)
+{
+    // the sphere grows with the largest scale, the same for every bounds
+    const glm::mat3 linear(transform);
+    const float scale = std::max({ glm::length(linear[0]), glm::length(linear[1]), glm::length(linear[2]) });
+
+    // SSE4.1 at every level, gathering 2 or 4 bounds into the wider registers and scattering them back measured slower
+    size_t i = 0;
+    if (level >= SimdLevel::SSE41) {
+        i = TransformBoundsSimd<Sse41>(bounds, count, transform, scale, out);
+    }
+    for (; i < count; ++i) {
+        out[i] = TransformBounds(bounds[i], transform);
+    }
+}
+
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include "AnniUtils.h"
+#include "Bounds.h"
+
+#include <cstddef>
+
+namespace Anni {
+
+// Batched math on glm's column major mat4. The SIMD paths evaluate every product in glm's order with separate
+// multiplies and adds, so they return the same bits as the scalar path, which is plain glm. Each operation only takes
+// the paths that measured faster than glm (tools/MatrixBench): products with AVX-512, transposes with SSE4.1 and up,
+// bounds with SSE4.1 whatever the level above it.
+// out may be the same array as an input, every matrix or bounds is read before its result is written.
+
+// out[i] = left[i] * right[i]
+void MultiplyMatrices(const glm::mat4* left, const glm::mat4* right, size_t count, glm::mat4* out, SimdLevel level = GetSimdLevel());
+// out[i] = left * right[i]
+void MultiplyMatrices(const glm::mat4& left, const glm::mat4* right, size_t count, glm::mat4* out, SimdLevel level = GetSimdLevel());
+// out[i] = left[i] * right
+void MultiplyMatrices(const glm::mat4* left, const glm::mat4& right, size_t count, glm::mat4* out, SimdLevel level = GetSimdLevel());
+
+// For i in [begin, end): world[i] = local[i] for a negative parents[i], world[parents[i]] * local[i] otherwise.
+// parents[i] < i, the parent's product is finished before it is read. Always glm.
+void ConcatenateTransforms(const INT32* parents, const glm::mat4* local, size_t begin, size_t end, glm::mat4* world);
+
+void TransposeMatrices(glm::mat4* matrices, size_t count, SimdLevel level = GetSimdLevel());
+
+// out[i] = TransformBounds(bounds[i], transform)
+void TransformBounds(const Bounds* bounds, size_t count, const glm::mat4& transform, Bounds* out, SimdLevel level = GetSimdLevel());
+
+}
@@ -0,0 +1,714 @@
+#include "MeshOptimizer.h"
+
+#include "MeshSimplifier.h"
+
+#include <emmintrin.h>
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <numeric>
+
+namespace Anni {
+
+namespace {
+
+    constexpr uint32_t INVALID_VERTEX = UINT32_MAX;
+
+    // A FIFO cache is a window over the last cache_size insertions, so a vertex hits when it was inserted less than
+    // cache_size misses ago. Timestamps start at 0, the clock starts past the window so every vertex misses once.
+    class FifoCache {
+    public:
+        FifoCache(const size_t vertex_count, const uint32_t cache_size)
+            : m_timestamps(vertex_count, 0)
+            , m_cacheSize(cache_size)
+            , m_time(cache_size + 1)
+        {
+        }
+
+        // Returns true on a miss, which inserts the vertex.
+        bool Touch(const uint32_t vertex)
+        {
+            if (m_time - m_timestamps[vertex] > m_cacheSize) {
+                m_timestamps[vertex] = m_time++;
+                return true;
+            }
+            return false;
+        }
+
+        uint32_t Age(const uint32_t vertex) const
+        {
+            return m_time - m_timestamps[vertex];
+        }
+
+        void Clear()
+        {
+            m_time += m_cacheSize + 1;
+        }
+
+    private:
+        std::vector<uint32_t> m_timestamps;
+        uint32_t m_cacheSize;
+        uint32_t m_time;
+    };
+
+    // Surface indices point into the vertices of the whole mesh, the work arrays only cover the range used.
+    struct VertexRange {
+        uint32_t first { 0 };
+        uint32_t count { 0 };
+    };
+
+    VertexRange GetVertexRange(const uint32_t* indices, const size_t index_count)
+    {
+        if (index_count == 0) {
+            return {};
+        }
+        const auto [min_it, max_it] = std::minmax_element(indices, indices + index_count);
+        return { *min_it, *max_it - *min_it + 1 };
+    }
+
+    // Triangles using each vertex, offsets[v] .. offsets[v + 1] in triangles.
+    struct VertexAdjacency {
+        std::vector<uint32_t> offsets;
+        std::vector<uint32_t> triangles;
+    };
+
+    VertexAdjacency BuildAdjacency(const std::vector<uint32_t>& local_indices, const uint32_t vertex_count)
+    {
+        VertexAdjacency adjacency;
+        adjacency.offsets.assign(vertex_count + 1, 0);
+        for (const uint32_t v : local_indices) {
+            ++adjacency.offsets[v + 1];
+        }
+        std::partial_sum(adjacency.offsets.begin(), adjacency.offsets.end(), adjacency.offsets.begin());
+
+        adjacency.triangles.resize(local_indices.size());
+        std::vector<uint32_t> fill(adjacency.offsets.begin(), adjacency.offsets.end() - 1);
+        for (size_t i = 0; i < local_indices.size(); ++i) {
+            adjacency.triangles[fill[local_indices[i]]++] = static_cast<uint32_t>(i / 3);
+        }
+        return adjacency;
+    }
+
+    static_assert(sizeof(StandardVertex) == 28, "HashVertex reads the vertex as bytes 0..15 and 12..27");
+
+    // Two overlapping 16 byte loads cover the vertex, each 32 bit lane is multiplied into a 64 bit product and the
+    // four products are folded into one value.
+    uint64_t HashVertex(const StandardVertex& vertex)
+    {
+        const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&vertex);
+        const __m128i lo = _mm_loadu_si128(reinterpret_cast<const __m128i*>(bytes));
+        const __m128i hi = _mm_loadu_si128(reinterpret_cast<const __m128i*>(bytes + 12));
+
+        const __m128i mixed = _mm_xor_si128(lo, _mm_shuffle_epi32(hi, _MM_SHUFFLE(0, 3, 2, 1)));
+        const __m128i k0 = _mm_set1_epi32(static_cast<int>(0x9E3779B1u));
+        const __m128i k1 = _mm_set1_epi32(static_cast<int>(0x85EBCA77u));
+        const __m128i even = _mm_mul_epu32(_mm_add_epi32(mixed, k1), k0);
+        const __m128i odd = _mm_mul_epu32(_mm_add_epi32(_mm_srli_epi64(mixed, 32), k0), k1);
+        const __m128i folded = _mm_xor_si128(even, _mm_shuffle_epi32(odd, _MM_SHUFFLE(1, 0, 3, 2)));
+
+        uint64_t h = static_cast<uint64_t>(_mm_cvtsi128_si64(folded)) ^ static_cast<uint64_t>(_mm_cvtsi128_si64(_mm_unpackhi_epi64(folded, folded)));
+        h ^= h >> 31;
+        h *= 0xBF58476D1CE4E5B9ull;
+        h ^= h >> 29;
+        return h;
+    }
+
+    // Misses of each triangle with a cache that starts empty at the first one.
+    uint32_t CountMisses(FifoCache& cache, const uint32_t* triangle)
+    {
+        uint32_t misses = 0;
+        for (int k = 0; k < 3; ++k) {
+            misses += cache.Touch(triangle[k]) ? 1 : 0;
+        }
+        return misses;
+    }
+
+}
+
+void WeldVertices(std::vector<uint32_t>& indices, std::vector<StandardVertex>& vertices)
+{
+    if (vertices.empty()) {
+        return;
+    }
+
+    // -0 and +0 are the same position but not the same bits
+    for (StandardVertex& vertex : vertices) {
+        for (int c = 0; c < 3; ++c) {
+            if (vertex.position[c] == 0.0f) {
+                vertex.position[c] = 0.0f;
+            }
+        }
+    }
+
+    //> HASH TABLE
+    // open addressing with linear probing, at most half full
+    const size_t table_size = std::bit_ceil(vertices.size() * 2);
+    std::vector<uint32_t> table(table_size, INVALID_VERTEX);
+    std::vector<uint32_t> remap(vertices.size());
+    uint32_t unique_count = 0;
+
+    for (uint32_t v = 0; v < vertices.size(); ++v) {
+        size_t slot = HashVertex(vertices[v]) & (table_size - 1);
+        for (;;) {
+            const uint32_t existing = table[slot];
+            if (existing == INVALID_VERTEX) {
+                // unique vertices move down in their original order
+                table[slot] = unique_count;
+                vertices[unique_count] = vertices[v];
+                remap[v] = unique_count++;
+                break;
+            }
+            if (memcmp(&vertices[existing], &vertices[v], sizeof(StandardVertex)) == 0) {
+                remap[v] = existing;
+                break;
+            }
+            slot = (slot + 1) & (table_size - 1);
+        }
+    }
+    //< hash table
+
+    for (uint32_t& index : indices) {
+        index = remap[index];
+    }
+    vertices.resize(unique_count);
+}
+
+VertexCacheStats AnalyzeVertexCache(const uint32_t* indices, const size_t index_count, const uint32_t cache_size)
+{
+    VertexCacheStats stats;
+    const size_t triangle_count = index_count / 3;
+    if (triangle_count == 0) {
+        return stats;
+    }
+
+    const VertexRange range = GetVertexRange(indices, index_count);
+    FifoCache cache(range.count, cache_size);
+    std::vector<bool> referenced(range.count, false);
+
+    size_t misses = 0;
+    size_t unique_vertices = 0;
+    for (size_t i = 0; i < triangle_count * 3; ++i) {
+        const uint32_t v = indices[i] - range.first;
+        misses += cache.Touch(v) ? 1 : 0;
+        if (!referenced[v]) {
+            referenced[v] = true;
+            ++unique_vertices;
+        }
+    }
+
+    stats.acmr = static_cast<float>(misses) / static_cast<float>(triangle_count);
+    stats.atvr = static_cast<float>(misses) / static_cast<float>(unique_vertices);
+    return stats;
+}
+
+void OptimizeVertexCache(uint32_t* indices, const size_t index_count, const uint32_t cache_size)
+{
+    const size_t triangle_count = index_count / 3;
+    if (triangle_count < 2) {
+        return;
+    }
+
+    const VertexRange range = GetVertexRange(indices, index_count);
+    std::vector<uint32_t> local_indices(triangle_count * 3);
+    for (size_t i = 0; i < local_indices.size(); ++i) {
+        local_indices[i] = indices[i] - range.first;
+    }
+
+    const VertexAdjacency adjacency = BuildAdjacency(local_indices, range.count);
+    // triangles not emitted yet per vertex
+    std::vector<uint32_t> live_triangles(range.count);
+    for (uint32_t v = 0; v < range.count; ++v) {
+        live_triangles[v] = adjacency.offsets[v + 1] - adjacency.offsets[v];
+    }
+
+    FifoCache cache(range.count, cache_size);
+    std::vector<bool> emitted(triangle_count, false);
+    std::vector<uint32_t> dead_end_stack;
+    std::vector<uint32_t> candidates;
+    size_t written = 0;
+
+    // the range starts at a referenced vertex
+    uint32_t fanning_vertex = 0;
+    uint32_t next_unvisited = 1;
+
+    while (fanning_vertex != INVALID_VERTEX) {
+        //> EMIT FAN
+        candidates.clear();
+        for (uint32_t a = adjacency.offsets[fanning_vertex]; a < adjacency.offsets[fanning_vertex + 1]; ++a) {
+            const uint32_t t = adjacency.triangles[a];
+            if (emitted[t]) {
+                continue;
+            }
+            emitted[t] = true;
+
+            for (int k = 0; k < 3; ++k) {
+                const uint32_t v = local_indices[t * 3 + k];
+                indices[written++] = v + range.first;
+                dead_end_stack.push_back(v);
+                candidates.push_back(v);
+                --live_triangles[v];
+                cache.Touch(v);
+            }
+        }
+        //< emit fan
+
+        //> NEXT FANNING VERTEX
+        // the oldest candidate that is still in the cache after its remaining triangles are emitted, any candidate
+        // with triangles left otherwise
+        uint32_t best = INVALID_VERTEX;
+        int64_t best_priority = -1;
+        for (const uint32_t v : candidates) {
+            if (live_triangles[v] == 0) {
+                continue;
+            }
+            int64_t priority = 0;
+            if (cache.Age(v) + 2 * live_triangles[v] <= cache_size) {
+                priority = cache.Age(v);
+            }
+            if (priority > best_priority) {
+                best_priority = priority;
+                best = v;
+            }
+        }
+
+        // dead end: the most recently used vertex with triangles left, then the next one in input order
+        while (best == INVALID_VERTEX && !dead_end_stack.empty()) {
+            const uint32_t v = dead_end_stack.back();
+            dead_end_stack.pop_back();
+            if (live_triangles[v] > 0) {
+                best = v;
+            }
+        }
+        while (best == INVALID_VERTEX && next_unvisited < range.count) {
+            if (live_triangles[next_unvisited] > 0) {
+                best = next_unvisited;
+            }
+            ++next_unvisited;
+        }
+        fanning_vertex = best;
+        //< next fanning vertex
+    }
+
+    assert(written == triangle_count * 3);
+}
+
+void OptimizeOverdraw(uint32_t* indices, const size_t index_count, const StandardVertex* vertices, const float threshold,
+    const uint32_t cache_size)
+{
+    const size_t triangle_count = index_count / 3;
+    if (triangle_count < 2) {
+        return;
+    }
+
+    const VertexRange range = GetVertexRange(indices, index_count);
+    FifoCache cache(range.count, cache_size);
+    std::vector<uint32_t> local_indices(triangle_count * 3);
+    for (size_t i = 0; i < local_indices.size(); ++i) {
+        local_indices[i] = indices[i] - range.first;
+    }
+
+    //> HARD BOUNDARIES
+    // a triangle missing on all three vertices starts a new fan, the cache order doesn't carry over it
+    std::vector<size_t> hard_clusters { 0 };
+    for (size_t t = 0; t < triangle_count; ++t) {
+        if (CountMisses(cache, &local_indices[t * 3]) == 3 && t > 0) {
+            hard_clusters.push_back(t);
+        }
+    }
+    hard_clusters.push_back(triangle_count);
+    //< hard boundaries
+
+    //> SOFT BOUNDARIES
+    // split every hard cluster further as soon as the part so far is about as cache friendly as the whole cluster
+    std::vector<size_t> clusters;
+    for (size_t c = 0; c + 1 < hard_clusters.size(); ++c) {
+        const size_t begin = hard_clusters[c];
+        const size_t end = hard_clusters[c + 1];
+
+        cache.Clear();
+        uint32_t cluster_misses = 0;
+        for (size_t t = begin; t < end; ++t) {
+            cluster_misses += CountMisses(cache, &local_indices[t * 3]);
+        }
+        const float cluster_threshold = threshold * static_cast<float>(cluster_misses) / static_cast<float>(end - begin);
+
+        cache.Clear();
+        clusters.push_back(begin);
+        uint32_t running_misses = 0;
+        size_t running_triangles = 0;
+        for (size_t t = begin; t < end; ++t) {
+            running_misses += CountMisses(cache, &local_indices[t * 3]);
+            ++running_triangles;
+
+            if (t + 1 < end && static_cast<float>(running_misses) / static_cast<float>(running_triangles) <= cluster_threshold) {
+                clusters.push_back(t + 1);
+                cache.Clear();
+                running_misses = 0;
+                running_triangles = 0;
+            }
+        }
+    }
+    clusters.push_back(triangle_count);
+    //< soft boundaries
+
+    //> SORT CLUSTERS
+    // area weighted centroid and normal per cluster, clusters far out along their own normal go first
+    const size_t cluster_count = clusters.size() - 1;
+    std::vector<glm::vec3> cluster_centroids(cluster_count, glm::vec3(0.0f));
+    std::vector<glm::vec3> cluster_normals(cluster_count, glm::vec3(0.0f));
+    glm::vec3 mesh_centroid(0.0f);
+    float mesh_area = 0.0f;
+
+    for (size_t c = 0; c < cluster_count; ++c) {
+        float cluster_area = 0.0f;
+        for (size_t t = clusters[c]; t < clusters[c + 1]; ++t) {
+            const glm::vec3 p0 = vertices[indices[t * 3 + 0]].position;
+            const glm::vec3 p1 = vertices[indices[t * 3 + 1]].position;
+            const glm::vec3 p2 = vertices[indices[t * 3 + 2]].position;
+            const glm::vec3 n = glm::cross(p1 - p0, p2 - p0);
+            const float area = glm::length(n);
+
+            cluster_centroids[c] += (p0 + p1 + p2) * (area / 3.0f);
+            cluster_normals[c] += n;
+            cluster_area += area;
+        }
+        mesh_centroid += cluster_centroids[c];
+        mesh_area += cluster_area;
+        if (cluster_area > 0.0f) {
+            cluster_centroids[c] /= cluster_area;
+        }
+    }
+    if (mesh_area > 0.0f) {
+        mesh_centroid /= mesh_area;
+    }
+
+    std::vector<float> sort_keys(cluster_count, 0.0f);
+    for (size_t c = 0; c < cluster_count; ++c) {
+        const float normal_length = glm::length(cluster_normals[c]);
+        if (normal_length > 0.0f) {
+            sort_keys[c] = glm::dot(cluster_centroids[c] - mesh_centroid, cluster_normals[c] / normal_length);
+        }
+    }
+
+    std::vector<uint32_t> cluster_order(cluster_count);
+    std::iota(cluster_order.begin(), cluster_order.end(), 0u);
+    // stable, so the result doesn't depend on the sort implementation
+    std::stable_sort(cluster_order.begin(), cluster_order.end(),
+        [&](const uint32_t a, const uint32_t b) { return sort_keys[a] > sort_keys[b]; });
+    //< sort clusters
+
+    size_t written = 0;
+    for (const uint32_t c : cluster_order) {
+        for (size_t t = clusters[c]; t < clusters[c + 1]; ++t) {
+            for (int k = 0; k < 3; ++k) {
+                indices[written++] = local_indices[t * 3 + k] + range.first;
+            }
+        }
+    }
+    assert(written == triangle_count * 3);
+}
+
+void BuildMeshlets(uint32_t* indices, const size_t index_count, const StandardVertex* vertices, std::vector<Meshlet>& meshlets)
+{
+    const size_t triangle_count = index_count / 3;
+    if (triangle_count == 0) {
+        return;
+    }
+
+    const VertexRange range = GetVertexRange(indices, index_count);
+    std::vector<uint32_t> local_indices(triangle_count * 3);
+    for (size_t i = 0; i < local_indices.size(); ++i) {
+        local_indices[i] = indices[i] - range.first;
+    }
+    const VertexAdjacency adjacency = BuildAdjacency(local_indices, range.count);
+
+    std::vector<bool> used(triangle_count, false);
+    // id of the meshlet a vertex was last added to, so the membership never has to be cleared
+    std::vector<uint32_t> vertex_meshlet(range.count, INVALID_VERTEX);
+    uint32_t meshlet_id = 0;
+
+    std::vector<uint32_t> meshlet_vertices;
+    std::vector<uint32_t> meshlet_triangles;
+    // unused triangles touching the meshlet, may hold duplicates and triangles used since
+    std::vector<uint32_t> candidates;
+    glm::vec3 position_sum(0.0f);
+
+    std::vector<uint32_t> reordered;
+    reordered.reserve(triangle_count * 3);
+    size_t next_in_order = 0;
+
+    const auto count_new_vertices = [&](const uint32_t t) {
+        const uint32_t* tri = &local_indices[t * 3];
+        uint32_t count = 0;
+        for (int k = 0; k < 3; ++k) {
+            // degenerate triangles repeat a vertex, it is only new once
+            const bool repeated = (k > 0 && tri[k] == tri[0]) || (k > 1 && tri[k] == tri[1]);
+            count += (vertex_meshlet[tri[k]] != meshlet_id && !repeated) ? 1 : 0;
+        }
+        return count;
+    };
+
+    const auto add_triangle = [&](const uint32_t t) {
+        used[t] = true;
+        meshlet_triangles.push_back(t);
+        for (int k = 0; k < 3; ++k) {
+            const uint32_t v = local_indices[t * 3 + k];
+            if (vertex_meshlet[v] == meshlet_id) {
+                continue;
+            }
+            vertex_meshlet[v] = meshlet_id;
+            meshlet_vertices.push_back(v);
+            position_sum += glm::vec3(vertices[v + range.first].position);
+            for (uint32_t a = adjacency.offsets[v]; a < adjacency.offsets[v + 1]; ++a) {
+                if (!used[adjacency.triangles[a]]) {
+                    candidates.push_back(adjacency.triangles[a]);
+                }
+            }
+        }
+    };
+
+    while (reordered.size() < triangle_count * 3) {
+        while (used[next_in_order]) {
+            ++next_in_order;
+        }
+        add_triangle(static_cast<uint32_t>(next_in_order));
+
+        //> GROW MESHLET
+        while (meshlet_triangles.size() < MESHLET_MAX_TRIANGLES) {
+            const glm::vec3 centroid = position_sum / static_cast<float>(meshlet_vertices.size());
+
+            uint32_t best = INVALID_VERTEX;
+            uint32_t best_new_vertices = 4;
+            float best_distance = std::numeric_limits<float>::max();
+            size_t kept = 0;
+            for (const uint32_t t : candidates) {
+                if (used[t]) {
+                    continue;
+                }
+                candidates[kept++] = t;
+
+                const uint32_t new_vertices = count_new_vertices(t);
+                if (meshlet_vertices.size() + new_vertices > MESHLET_MAX_VERTICES || new_vertices > best_new_vertices) {
+                    continue;
+                }
+                const glm::vec3 p0 = vertices[local_indices[t * 3 + 0] + range.first].position;
+                const glm::vec3 p1 = vertices[local_indices[t * 3 + 1] + range.first].position;
+                const glm::vec3 p2 = vertices[local_indices[t * 3 + 2] + range.first].position;
+                const glm::vec3 offset = (p0 + p1 + p2) / 3.0f - centroid;
+                const float distance = glm::dot(offset, offset);
+                if (new_vertices < best_new_vertices || distance < best_distance) {
+                    best = t;
+                    best_new_vertices = new_vertices;
+                    best_distance = distance;
+                }
+            }
+            candidates.resize(kept);
+
+            // nothing connected fits, the cache order keeps the next unused triangle close by
+            if (best == INVALID_VERTEX) {
+                while (next_in_order < triangle_count && used[next_in_order]) {
+                    ++next_in_order;
+                }
+                if (next_in_order == triangle_count
+                    || meshlet_vertices.size() + count_new_vertices(static_cast<uint32_t>(next_in_order)) > MESHLET_MAX_VERTICES) {
+                    break;
+                }
+                best = static_cast<uint32_t>(next_in_order);
+            }
+            add_triangle(best);
+        }
+        //< grow meshlet
+
+        Meshlet meshlet;
+        meshlet.first_index = static_cast<uint32_t>(reordered.size());
+        meshlet.triangle_count = static_cast<uint32_t>(meshlet_triangles.size());
+        meshlet.vertex_count = static_cast<uint32_t>(meshlet_vertices.size());
+        for (const uint32_t t : meshlet_triangles) {
+            for (int k = 0; k < 3; ++k) {
+                reordered.push_back(local_indices[t * 3 + k] + range.first);
+            }
+        }
+        meshlets.push_back(meshlet);
+
+        meshlet_vertices.clear();
+        meshlet_triangles.clear();
+        candidates.clear();
+        position_sum = glm::vec3(0.0f);
+        ++meshlet_id;
+    }
+
+    std::copy(reordered.begin(), reordered.end(), indices);
+    for (size_t m = meshlets.size() - meshlet_id; m < meshlets.size(); ++m) {
+        Meshlet& meshlet = meshlets[m];
+        ComputeMeshletBounds(indices + meshlet.first_index, meshlet.triangle_count * 3, vertices, meshlet);
+    }
+}
+
+void ComputeMeshletBounds(const uint32_t* indices, const size_t index_count, const StandardVertex* vertices, Meshlet& meshlet)
+{
+    //> BOUNDING SPHERE
+    // centered on the box, a little looser than the minimal sphere
+    glm::vec3 box_min(std::numeric_limits<float>::max());
+    glm::vec3 box_max(std::numeric_limits<float>::lowest());
+    for (size_t i = 0; i < index_count; ++i) {
+        box_min = glm::min(box_min, glm::vec3(vertices[indices[i]].position));
+        box_max = glm::max(box_max, glm::vec3(vertices[indices[i]].position));
+    }
+    meshlet.center = (box_min + box_max) * 0.5f;
+    meshlet.radius = 0.0f;
+    for (size_t i = 0; i < index_count; ++i) {
+        meshlet.radius = std::max(meshlet.radius, glm::length(glm::vec3(vertices[indices[i]].position) - meshlet.center));
+    }
+    //< bounding sphere
+
+    //> NORMAL CONE
+    meshlet.cone_apex = meshlet.center;
+    meshlet.cone_axis = glm::vec3(0.0f, 0.0f, 1.0f);
+    meshlet.cone_cutoff = 2.0f;
+
+    std::vector<glm::vec3> normals;
+    normals.reserve(index_count / 3);
+    glm::vec3 normal_sum(0.0f);
+    for (size_t i = 0; i + 2 < index_count; i += 3) {
+        const glm::vec3 p0 = vertices[indices[i + 0]].position;
+        const glm::vec3 n = glm::cross(glm::vec3(vertices[indices[i + 1]].position) - p0, glm::vec3(vertices[indices[i + 2]].position) - p0);
+        const float length = glm::length(n);
+        // degenerate triangles are never visible
+        normals.push_back(length > 0.0f ? n / length : glm::vec3(0.0f));
+        normal_sum += normals.back();
+    }
+
+    const float axis_length = glm::length(normal_sum);
+    if (axis_length == 0.0f) {
+        return;
+    }
+    const glm::vec3 axis = normal_sum / axis_length;
+
+    float min_dot = 1.0f;
+    for (const glm::vec3& n : normals) {
+        if (n != glm::vec3(0.0f)) {
+            min_dot = std::min(min_dot, glm::dot(n, axis));
+        }
+    }
+    // a cone this wide would almost never cull
+    if (min_dot <= 0.1f) {
+        return;
+    }
+
+    // move the apex back along the axis until it is behind every triangle plane, the test is conservative from there
+    float max_t = 0.0f;
+    for (size_t t = 0; t < normals.size(); ++t) {
+        if (normals[t] != glm::vec3(0.0f)) {
+            const glm::vec3 p0 = vertices[indices[t * 3]].position;
+            max_t = std::max(max_t, glm::dot(normals[t], meshlet.center - p0) / glm::dot(normals[t], axis));
+        }
+    }
+
+    meshlet.cone_apex = meshlet.center - axis * max_t;
+    meshlet.cone_axis = axis;
+    meshlet.cone_cutoff = std::sqrt(1.0f - min_dot * min_dot);
+    //< normal cone
+}
+
+void OptimizeVertexFetch(std::vector<uint32_t>& indices, std::vector<StandardVertex>& vertices)
+{
+    std::vector<uint32_t> remap(vertices.size(), INVALID_VERTEX);
+    std::vector<StandardVertex> fetch_ordered;
+    fetch_ordered.reserve(vertices.size());
+
+    for (uint32_t& index : indices) {
+        if (remap[index] == INVALID_VERTEX) {
+            remap[index] = static_cast<uint32_t>(fetch_ordered.size());
+            fetch_ordered.push_back(vertices[index]);
+        }
+        index = remap[index];
+    }
+    vertices = std::move(fetch_ordered);
+}
+
+void BuildSurfaceLods(GeoSurface& surface, std::vector<uint32_t>& indices, const StandardVertex* vertices)
+{
+    surface.lods[0] = { surface.startIndex, surface.count, 0.0f };
+    surface.lodCount = 1;
+    if (surface.count == 0) {
+        return;
+    }
+
+    glm::vec3 bounds_min = vertices[indices[surface.startIndex]].position;
+    glm::vec3 bounds_max = bounds_min;
+    for (uint32_t i = surface.startIndex; i < surface.startIndex + surface.count; ++i) {
+        bounds_min = glm::min(bounds_min, vertices[indices[i]].position);
+        bounds_max = glm::max(bounds_max, vertices[indices[i]].position);
+    }
+    const glm::vec3 extent = bounds_max - bounds_min;
+    const float error_budget = LOD_MAX_RELATIVE_ERROR * std::max({ extent.x, extent.y, extent.z });
+
+    // copied, appending to indices may reallocate it
+    std::vector<uint32_t> previous(indices.begin() + surface.startIndex, indices.begin() + surface.startIndex + surface.count);
+    std::vector<uint32_t> simplified;
+    float error = 0.0f;
+    while (surface.lodCount < SURFACE_LOD_COUNT) {
+        const size_t target_index_count = static_cast<size_t>(previous.size() / 3 * LOD_TRIANGLE_RATIO) * 3;
+        // the error of a level built from a simplified one adds up with the error of that one
+        const float level_error = SimplifySurface(previous.data(), previous.size(), vertices, target_index_count,
+            error_budget - error, simplified);
+        if (simplified.empty() || simplified.size() > previous.size() * LOD_MIN_REDUCTION) {
+            break;
+        }
+        error += level_error;
+
+        OptimizeVertexCache(simplified.data(), simplified.size());
+        surface.lods[surface.lodCount++] = {
+            static_cast<uint32_t>(indices.size()),
+            static_cast<uint32_t>(simplified.size()),
+            error,
+        };
+        indices.insert(indices.end(), simplified.begin(), simplified.end());
+        std::swap(previous, simplified);
+    }
+}
+
+MeshOptimizationStats OptimizeMesh(MeshData& mesh)
+{
+    MeshOptimizationStats stats;
+    stats.before = AnalyzeVertexCache(mesh.indices.data(), mesh.indices.size());
+    stats.vertex_count_before = static_cast<uint32_t>(mesh.vertices.size());
+
+    WeldVertices(mesh.indices, mesh.vertices);
+
+    mesh.meshlets.clear();
+    for (GeoSurface& surface : mesh.surfaces) {
+        uint32_t* surface_indices = mesh.indices.data() + surface.startIndex;
+        OptimizeVertexCache(surface_indices, surface.count);
+        OptimizeOverdraw(surface_indices, surface.count, mesh.vertices.data());
+
+        surface.meshletOffset = static_cast<uint32_t>(mesh.meshlets.size());
+        BuildMeshlets(surface_indices, surface.count, mesh.vertices.data(), mesh.meshlets);
+        surface.meshletCount = static_cast<uint32_t>(mesh.meshlets.size()) - surface.meshletOffset;
+    }
+    for (const Meshlet& meshlet : mesh.meshlets) {
+        stats.meshlet_vertices += meshlet.vertex_count;
+        stats.meshlet_triangles += meshlet.triangle_count;
+    }
+    stats.meshlet_count = static_cast<uint32_t>(mesh.meshlets.size());
+
+    // the full surfaces stay in front, the statistics only cover them
+    const size_t full_index_count = mesh.indices.size();
+    for (GeoSurface& surface : mesh.surfaces) {
+        BuildSurfaceLods(surface, mesh.indices, mesh.vertices.data());
+        for (uint32_t level = 0; level < surface.lodCount; ++level) {
+            stats.lod_triangles[level] += surface.lods[level].count / 3;
+            stats.lod_error[level] = std::max(stats.lod_error[level], surface.lods[level].error);
+        }
+    }
+    OptimizeVertexFetch(mesh.indices, mesh.vertices);
+
+    stats.after = AnalyzeVertexCache(mesh.indices.data(), full_index_count);
+    stats.vertex_count_after = static_cast<uint32_t>(mesh.vertices.size());
+    return stats;
+}
+
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include "ModelData.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace Anni {
+
+// Import time index and vertex reordering. Only the order of triangles and vertices changes, never the geometry.
+
+// Post-transform cache size the optimization targets and the statistics assume.
+constexpr uint32_t VERTEX_CACHE_SIZE = 16;
+// Overdraw clusters are split where the running ACMR is within this factor of the whole cluster's ACMR, larger values
+// give more clusters and so more freedom for the overdraw order at the cost of vertex cache hits.
+constexpr float OVERDRAW_ACMR_THRESHOLD = 1.05f;
+// Meshlet limits, 124 triangles keep the primitive indices of a meshlet in 372 bytes.
+constexpr uint32_t MESHLET_MAX_VERTICES = 64;
+constexpr uint32_t MESHLET_MAX_TRIANGLES = 124;
+
+struct VertexCacheStats {
+    // transformed vertices per triangle, 0.5 is the best case for a regular grid and 3 the worst
+    float acmr { 0.0f };
+    // transformed vertices per referenced vertex, 1 is the best case
+    float atvr { 0.0f };
+};
+
+struct MeshOptimizationStats {
+    VertexCacheStats before;
+    VertexCacheStats after;
+    uint32_t vertex_count_before { 0 };
+    uint32_t vertex_count_after { 0 };
+    uint32_t meshlet_count { 0 };
+    // summed over the meshlets, for the average fill
+    uint32_t meshlet_vertices { 0 };
+    uint32_t meshlet_triangles { 0 };
+    // summed over the surfaces that have the level, and the largest error of the level
+    uint32_t lod_triangles[SURFACE_LOD_COUNT] {};
+    float lod_error[SURFACE_LOD_COUNT] {};
+};
+
+// Collapses bitwise identical vertices (after -0 is folded into +0) and rewrites the indices, the first occurrence of
+// every vertex is kept in place. The attributes other than position are already quantized by the import.
+void WeldVertices(std::vector<uint32_t>& indices, std::vector<StandardVertex>& vertices);
+
+// Simulates a FIFO cache of cache_size entries over a triangle list.
+VertexCacheStats AnalyzeVertexCache(const uint32_t* indices, size_t index_count, uint32_t cache_size = VERTEX_CACHE_SIZE);
+
+// Reorders the triangles for vertex cache reuse with Tipsy (Sander et al. 2007), linear in the number of triangles.
+void OptimizeVertexCache(uint32_t* indices, size_t index_count, uint32_t cache_size = VERTEX_CACHE_SIZE);
+
+// Splits a cache optimized triangle list into clusters and draws the clusters facing away from the mesh center first,
+// so they occlude the rest from most view directions. Run it after OptimizeVertexCache.
+void OptimizeOverdraw(uint32_t* indices, size_t index_count, const StandardVertex* vertices,
+    float threshold = OVERDRAW_ACMR_THRESHOLD, uint32_t cache_size = VERTEX_CACHE_SIZE);
+
+// Greedily grows meshlets from the surface's triangle order, preferring triangles that add the fewest new vertices and
+// then the ones closest to the meshlet. Triangles are rewritten in meshlet order and the meshlets, bounds included, are
+// appended to meshlets.
+void BuildMeshlets(uint32_t* indices, size_t index_count, const StandardVertex* vertices, std::vector<Meshlet>& meshlets);
+
+// Bounding sphere and normal cone of the triangles in indices.
+void ComputeMeshletBounds(const uint32_t* indices, size_t index_count, const StandardVertex* vertices, Meshlet& meshlet);
+
+// Moves vertices into first use order and rewrites the indices, unreferenced vertices are dropped.
+void OptimizeVertexFetch(std::vector<uint32_t>& indices, std::vector<StandardVertex>& vertices);
+
+// Builds the levels of detail of a surface, each simplified from the one before (see MeshSimplifier.h), and appends
+// their cache ordered indices to indices. surface.startIndex and count must already point at the full surface.
+void BuildSurfaceLods(GeoSurface& surface, std::vector<uint32_t>& indices, const StandardVertex* vertices);
+
+// Welds the vertices of all surfaces, then cache and overdraw order, meshlets and levels of detail per surface and
+// fetch order for the whole mesh. Surfaces keep their index ranges, the levels of detail follow every full surface.
+MeshOptimizationStats OptimizeMesh(MeshData& mesh);
+
+}
@@ -0,0 +1,405 @@
+#include "MeshSimplifier.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numeric>
+
+namespace Anni {
+
+namespace {
+
+    // Border edges add a plane perpendicular to their triangle, weighted this much more than the triangles' own planes.
+    constexpr float BORDER_PLANE_WEIGHT = 10.0f;
+
+    // Symmetric 4x4 matrix of a weighted sum of squared plane distances, w is the summed weight.
+    struct Quadric {
+        float a00 { 0.0f }, a11 { 0.0f }, a22 { 0.0f };
+        float a01 { 0.0f }, a02 { 0.0f }, a12 { 0.0f };
+        float b0 { 0.0f }, b1 { 0.0f }, b2 { 0.0f };
+        float c { 0.0f };
+        float w { 0.0f };
+
+        void AddPlane(const glm::vec3& normal, const float distance, const float weight)
+        {
+            a00 += weight * normal.x * normal.x;
+            a11 += weight * normal.y * normal.y;
+            a22 += weight * normal.z * normal.z;
+            a01 += weight * normal.x * normal.y;
+            a02 += weight * normal.x * normal.z;
+            a12 += weight * normal.y * normal.z;
+            b0 += weight * normal.x * distance;
+            b1 += weight * normal.y * distance;
+            b2 += weight * normal.z * distance;
+            c += weight * distance * distance;
+            w += weight;
+        }
+
+        void Add(const Quadric& other)
+        {
+            a00 += other.a00;
+            a11 += other.a11;
+            a22 += other.a22;
+            a01 += other.a01;
+            a02 += other.a02;
+            a12 += other.a12;
+            b0 += other.b0;
+            b1 += other.b1;
+            b2 += other.b2;
+            c += other.c;
+            w += other.w;
+        }
+
+        // Weighted mean of the squared distances from p to the planes.
+        float Error(const glm::vec3& p) const
+        {
+            if (w <= 0.0f) {
+                return 0.0f;
+            }
+            const float rx = a00 * p.x + a01 * p.y + a02 * p.z + 2.0f * b0;
+            const float ry = a01 * p.x + a11 * p.y + a12 * p.z + 2.0f * b1;
+            const float rz = a02 * p.x + a12 * p.y + a22 * p.z + 2.0f * b2;
+            const float error = rx * p.x + ry * p.y + rz * p.z + c;
+            return std::max(error, 0.0f) / w;
+        }
+    };
+
+    enum class VertexKind : uint8_t {
+        // every edge has a triangle on both sides, collapses onto any neighbour
+        Manifold,
+        // on exactly one open border loop, collapses onto its border neighbours only
+        Border,
+        // attribute seam, border corner or non manifold, never moves
+        Locked,
+    };
+
+    struct Collapse {
+        uint32_t from;
+        uint32_t to;
+        float cost;
+    };
+
+    uint64_t EdgeKey(const uint32_t a, const uint32_t b)
+    {
+        return (static_cast<uint64_t>(a) << 32) | b;
+    }
+
+    bool HasEdge(const std::vector<uint64_t>& sorted_edges, const uint32_t a, const uint32_t b)
+    {
+        return std::binary_search(sorted_edges.begin(), sorted_edges.end(), EdgeKey(a, b));
+    }
+
+    glm::vec3 TriangleNormal(const glm::vec3& p0, const glm::vec3& p1, const glm::vec3& p2)
+    {
+        return glm::cross(p1 - p0, p2 - p0);
+    }
+
+}
+
+float SimplifySurface(const uint32_t* indices, const size_t index_count, const StandardVertex* vertices,
+    const size_t target_index_count, const float max_error, std::vector<uint32_t>& result)
+{
+    result.clear();
+    if (index_count == 0) {
+        return 0.0f;
+    }
+
+    //> local vertices
+    // Surface indices point into the vertices of the whole mesh, the work arrays only cover the range used.
+    const auto [min_it, max_it] = std::minmax_element(indices, indices + index_count);
+    const uint32_t first_vertex = *min_it;
+    const uint32_t vertex_count = *max_it - first_vertex + 1;
+
+    std::vector<uint32_t> triangles(index_count);
+    for (size_t i = 0; i < index_count; ++i) {
+        triangles[i] = indices[i] - first_vertex;
+    }
+
+    // Positions are rescaled into the unit cube so the quadrics keep their precision far from the origin.
+    glm::vec3 bounds_min(std::numeric_limits<float>::max());
+    glm::vec3 bounds_max(std::numeric_limits<float>::lowest());
+    for (const uint32_t v : triangles) {
+        bounds_min = glm::min(bounds_min, vertices[first_vertex + v].position);
+        bounds_max = glm::max(bounds_max, vertices[first_vertex + v].position);
+    }
+    const glm::vec3 extent = bounds_max - bounds_min;
+    const float scale = std::max({ extent.x, extent.y, extent.z });
+    if (target_index_count >= index_count || scale <= 0.0f) {
+        result.assign(indices, indices + index_count);
+        return 0.0f;
+    }
+
+    std::vector<glm::vec3> positions(vertex_count, glm::vec3(0.0f));
+    for (const uint32_t v : triangles) {
+        positions[v] = (vertices[first_vertex + v].position - bounds_min) / scale;
+    }
+    //< local vertices
+
+    //> classify vertices
+    std::vector<uint64_t> half_edges;
+    half_edges.reserve(index_count);
+    for (size_t t = 0; t < index_count; t += 3) {
+        for (int k = 0; k < 3; ++k) {
+            half_edges.push_back(EdgeKey(triangles[t + k], triangles[t + (k + 1) % 3]));
+        }
+    }
+    std::sort(half_edges.begin(), half_edges.end());
+
+    // An edge without its opposite half edge is on an open border.
+    std::vector<uint32_t> border_next(vertex_count, UINT32_MAX);
+    std::vector<uint32_t> border_prev(vertex_count, UINT32_MAX);
+    std::vector<uint8_t> border_edges(vertex_count, 0);
+    for (size_t i = 0; i < half_edges.size(); ++i) {
+        if (i > 0 && half_edges[i] == half_edges[i - 1]) {
+            continue;
+        }
+        const uint32_t a = static_cast<uint32_t>(half_edges[i] >> 32);
+        const uint32_t b = static_cast<uint32_t>(half_edges[i]);
+        if (!HasEdge(half_edges, b, a)) {
+            border_next[a] = b;
+            border_prev[b] = a;
+            border_edges[a] = static_cast<uint8_t>(std::min(border_edges[a] + 1, 255));
+            border_edges[b] = static_cast<uint8_t>(std::min(border_edges[b] + 1, 255));
+        }
+    }
+
+    std::vector<VertexKind> kinds(vertex_count, VertexKind::Manifold);
+    for (uint32_t v = 0; v < vertex_count; ++v) {
+        if (border_edges[v] == 0) {
+            kinds[v] = VertexKind::Manifold;
+        } else if (border_edges[v] == 2 && border_next[v] != UINT32_MAX && border_prev[v] != UINT32_MAX) {
+            kinds[v] = VertexKind::Border;
+        } else {
+            kinds[v] = VertexKind::Locked;
+        }
+    }
+
+    // Vertices sharing a position differ in their other attributes, moving one of them would open a crack.
+    std::vector<uint32_t> by_position(triangles);
+    std::sort(by_position.begin(), by_position.end());
+    by_position.erase(std::unique(by_position.begin(), by_position.end()), by_position.end());
+    std::sort(by_position.begin(), by_position.end(), [&](const uint32_t a, const uint32_t b) {
+        const glm::vec3& pa = positions[a];
+        const glm::vec3& pb = positions[b];
+        if (pa.x != pb.x) {
+            return pa.x < pb.x;
+        }
+        if (pa.y != pb.y) {
+            return pa.y < pb.y;
+        }
+        if (pa.z != pb.z) {
+            return pa.z < pb.z;
+        }
+        return a < b;
+    });
+    for (size_t i = 1; i < by_position.size(); ++i) {
+        if (positions[by_position[i]] == positions[by_position[i - 1]]) {
+            kinds[by_position[i]] = VertexKind::Locked;
+            kinds[by_position[i - 1]] = VertexKind::Locked;
+        }
+    }
+    //< classify vertices
+
+    //> quadrics
+    std::vector<Quadric> quadrics(vertex_count);
+    for (size_t t = 0; t < index_count; t += 3) {
+        const uint32_t* tri = &triangles[t];
+        const glm::vec3 normal = TriangleNormal(positions[tri[0]], positions[tri[1]], positions[tri[2]]);
+        const float length = glm::length(normal);
+        if (length <= 0.0f) {
+            continue;
+        }
+        const glm::vec3 unit_normal = normal / length;
+        const float area = 0.5f * length;
+        const float distance = -glm::dot(unit_normal, positions[tri[0]]);
+        for (int k = 0; k < 3; ++k) {
+            quadrics[tri[k]].AddPlane(unit_normal, distance, area);
+        }
+
+        for (int k = 0; k < 3; ++k) {
+            const uint32_t a = tri[k];
+            const uint32_t b = tri[(k + 1) % 3];
+            if (HasEdge(half_edges, b, a)) {
+                continue;
+            }
+            const glm::vec3 edge = positions[b] - positions[a];
+            const float edge_length = glm::length(edge);
+            if (edge_length <= 0.0f) {
+                continue;
+            }
+            const glm::vec3 border_normal = glm::normalize(glm::cross(edge, unit_normal));
+            const float border_distance = -glm::dot(border_normal, positions[a]);
+            const float weight = edge_length * edge_length * BORDER_PLANE_WEIGHT;
+            quadrics[a].AddPlane(border_normal, border_distance, weight);
+            quadrics[b].AddPlane(border_normal, border_distance, weight);
+        }
+    }
+    //< quadrics
+
+    //> collapse passes
+    const float max_cost = (max_error / scale) * (max_error / scale);
+    float reached_cost = 0.0f;
+
+    std::vector<uint32_t> remap(vertex_count);
+    std::iota(remap.begin(), remap.end(), 0u);
+    std::vector<uint8_t> pass_locked(vertex_count);
+    std::vector<uint32_t> adjacency_offsets(vertex_count + 1);
+    std::vector<uint32_t> adjacency;
+    std::vector<Collapse> collapses;
+
+    const auto can_collapse = [&](const uint32_t from, const uint32_t to) {
+        switch (kinds[from]) {
+        case VertexKind::Manifold:
+            return true;
+        case VertexKind::Border:
+            return border_next[from] == to || border_prev[from] == to;
+        default:
+            return false;
+        }
+    };
+
+    while (triangles.size() > target_index_count) {
+        //> candidates
+        // Every edge once, interior edges from the triangle where a < b, in its cheaper allowed direction.
+        collapses.clear();
+        for (size_t t = 0; t < triangles.size(); t += 3) {
+            for (int k = 0; k < 3; ++k) {
+                const uint32_t a = triangles[t + k];
+                const uint32_t b = triangles[t + (k + 1) % 3];
+                if (a > b && HasEdge(half_edges, b, a)) {
+                    continue;
+                }
+                const bool ab = can_collapse(a, b);
+                const bool ba = can_collapse(b, a);
+                if (!ab && !ba) {
+                    continue;
+                }
+                const float cost_ab = ab ? quadrics[a].Error(positions[b]) : std::numeric_limits<float>::max();
+                const float cost_ba = ba ? quadrics[b].Error(positions[a]) : std::numeric_limits<float>::max();
+                if (cost_ab <= cost_ba) {
+                    collapses.push_back({ a, b, cost_ab });
+                } else {
+                    collapses.push_back({ b, a, cost_ba });
+                }
+            }
+        }
+        if (collapses.empty()) {
+            break;
+        }
+        std::sort(collapses.begin(), collapses.end(), [](const Collapse& x, const Collapse& y) {
+            if (x.cost != y.cost) {
+                return x.cost < y.cost;
+            }
+            return x.from != y.from ? x.from < y.from : x.to < y.to;
+        });
+
+        // A collapse removes about two triangles. Only the cheapest candidates that may be needed take part in the
+        // pass, the others wait for the next pass where cheaper edges next to them may have opened up.
+        const size_t triangle_count = triangles.size() / 3;
+        const size_t triangles_to_remove = triangle_count - target_index_count / 3;
+        const size_t needed = std::min(collapses.size() - 1, (triangles_to_remove + 1) / 2);
+        const float pass_cost = collapses[needed].cost;
+        //< candidates
+
+        // triangles around each vertex, they change with every pass
+        std::fill(adjacency_offsets.begin(), adjacency_offsets.end(), 0u);
+        for (const uint32_t v : triangles) {
+            ++adjacency_offsets[v + 1];
+        }
+        std::partial_sum(adjacency_offsets.begin(), adjacency_offsets.end(), adjacency_offsets.begin());
+        adjacency.resize(triangles.size());
+        {
+            std::vector<uint32_t> fill(adjacency_offsets.begin(), adjacency_offsets.end() - 1);
+            for (size_t i = 0; i < triangles.size(); ++i) {
+                adjacency[fill[triangles[i]]++] = static_cast<uint32_t>(i / 3);
+            }
+        }
+        std::fill(pass_locked.begin(), pass_locked.end(), uint8_t { 0 });
+
+        size_t removed = 0;
+        size_t collapsed = 0;
+        for (const Collapse& collapse : collapses) {
+            if (collapse.cost > max_cost || removed >= triangles_to_remove) {
+                break;
+            }
+            // past the pass limit only while every cheaper candidate was rejected
+            if (collapse.cost > pass_cost && collapsed > 0) {
+                break;
+            }
+            const uint32_t from = collapse.from;
+            const uint32_t to = collapse.to;
+            if (pass_locked[from] || pass_locked[to]) {
+                continue;
+            }
+
+            // Reject the collapse when a remaining triangle around from would flip or become degenerate. Vertices
+            // collapsed earlier in this pass resolve in one step, their targets are locked for the pass.
+            bool flips = false;
+            size_t degenerate = 0;
+            for (uint32_t i = adjacency_offsets[from]; i < adjacency_offsets[from + 1] && !flips; ++i) {
+                const uint32_t* tri = &triangles[adjacency[i] * 3];
+                const uint32_t r0 = remap[tri[0]];
+                const uint32_t r1 = remap[tri[1]];
+                const uint32_t r2 = remap[tri[2]];
+                if (r0 == r1 || r1 == r2 || r2 == r0) {
+                    continue;
+                }
+                if (r0 == to || r1 == to || r2 == to) {
+                    ++degenerate;
+                    continue;
+                }
+                const glm::vec3 before = TriangleNormal(positions[r0], positions[r1], positions[r2]);
+                const glm::vec3 after = TriangleNormal(
+                    positions[r0 == from ? to : r0], positions[r1 == from ? to : r1], positions[r2 == from ? to : r2]);
+                flips = glm::dot(before, after) <= 0.0f;
+            }
+            if (flips) {
+                continue;
+            }
+
+            remap[from] = to;
+            quadrics[to].Add(quadrics[from]);
+            pass_locked[from] = 1;
+            pass_locked[to] = 1;
+            if (kinds[from] == VertexKind::Border) {
+                // the border loop skips from
+                if (border_next[from] == to) {
+                    border_prev[to] = border_prev[from];
+                    border_next[border_prev[from]] = to;
+                } else {
+                    border_next[to] = border_next[from];
+                    border_prev[border_next[from]] = to;
+                }
+            }
+            reached_cost = std::max(reached_cost, collapse.cost);
+            removed += degenerate;
+            ++collapsed;
+        }
+        if (collapsed == 0) {
+            break;
+        }
+
+        size_t write = 0;
+        for (size_t t = 0; t < triangles.size(); t += 3) {
+            const uint32_t r0 = remap[triangles[t]];
+            const uint32_t r1 = remap[triangles[t + 1]];
+            const uint32_t r2 = remap[triangles[t + 2]];
+            if (r0 == r1 || r1 == r2 || r2 == r0) {
+                continue;
+            }
+            triangles[write++] = r0;
+            triangles[write++] = r1;
+            triangles[write++] = r2;
+        }
+        triangles.resize(write);
+    }
+    //< collapse passes
+
+    result.resize(triangles.size());
+    for (size_t i = 0; i < triangles.size(); ++i) {
+        result[i] = triangles[i] + first_vertex;
+    }
+    return std::sqrt(reached_cost) * scale;
+}
+
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include "ModelData.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace Anni {
+
+// Quadric error metric simplification (Garland and Heckbert 1997) restricted to collapsing edges onto existing
+// vertices, so every level of detail indexes the same vertex buffer as the full surface.
+
+// Every level aims at this fraction of the previous level's triangles.
+constexpr float LOD_TRIANGLE_RATIO = 0.5f;
+// The chain stops at a level that keeps more than this fraction of the previous level's triangles.
+constexpr float LOD_MIN_REDUCTION = 0.85f;
+// Largest error a level may reach, relative to the largest extent of the surface.
+constexpr float LOD_MAX_RELATIVE_ERROR = 0.05f;
+
+// Collapses edges of a triangle list until at most target_index_count indices are left, no collapse below max_error
+// remains or nothing can collapse without flipping a triangle. Vertices on open borders only slide along the border
+// and vertices shared with another vertex position (attribute seams) never move, so no cracks open up.
+// The surviving triangles go to result. Returns the geometric error reached, a distance in mesh units.
+float SimplifySurface(const uint32_t* indices, size_t index_count, const StandardVertex* vertices,
+    size_t target_index_count, float max_error, std::vector<uint32_t>& result);
+
+}
@@ -0,0 +1,219 @@
+#include "MipGenerator.h"
+
+#include <emmintrin.h>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+
+namespace Anni {
+
+namespace {
+
+    // linear values are quantized to 16 bit for the way back, fine enough for the steepest part of the sRGB curve
+    constexpr size_t LINEAR_TO_SRGB_LUT_SIZE = 1 << 16;
+
+    float SRGBToLinear(const float c)
+    {
+        return c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+    }
+
+    float LinearToSRGB(const float c)
+    {
+        return c <= 0.0031308f ? c * 12.92f : 1.055f * std::pow(c, 1.0f / 2.4f) - 0.055f;
+    }
+
+    uint8_t ToUNorm8(const float c)
+    {
+        return static_cast<uint8_t>(std::clamp(c, 0.0f, 1.0f) * 255.0f + 0.5f);
+    }
+
+    struct SRGBTables {
+        std::array<float, 256> to_linear;
+        std::vector<uint8_t> to_srgb;
+
+        SRGBTables()
+            : to_srgb(LINEAR_TO_SRGB_LUT_SIZE)
+        {
+            for (size_t i = 0; i < to_linear.size(); ++i) {
+                to_linear[i] = SRGBToLinear(static_cast<float>(i) / 255.0f);
+            }
+            for (size_t i = 0; i < to_srgb.size(); ++i) {
+                to_srgb[i] = ToUNorm8(LinearToSRGB(static_cast<float>(i) / (LINEAR_TO_SRGB_LUT_SIZE - 1)));
+            }
+        }
+    };
+
+    // built once, the textures are filtered from several import threads
+    const SRGBTables& GetSRGBTables()
+    {
+        static const SRGBTables tables;
+        return tables;
+    }
+
+    void DownsamplePixelLinear(const uint8_t* p00, const uint8_t* p01, const uint8_t* p10, const uint8_t* p11, uint8_t* dst)
+    {
+        for (int c = 0; c < 4; ++c) {
+            dst[c] = static_cast<uint8_t>((p00[c] + p01[c] + p10[c] + p11[c] + 2) >> 2);
+        }
+    }
+
+    __m128 DecodeSRGBPixel(const uint8_t* p, const SRGBTables& tables)
+    {
+        return _mm_setr_ps(tables.to_linear[p[0]], tables.to_linear[p[1]], tables.to_linear[p[2]], static_cast<float>(p[3]));
+    }
+
+    void DownsamplePixelSRGB(const uint8_t* p00, const uint8_t* p01, const uint8_t* p10, const uint8_t* p11, uint8_t* dst,
+        const SRGBTables& tables)
+    {
+        const __m128 sum = _mm_add_ps(
+            _mm_add_ps(DecodeSRGBPixel(p00, tables), DecodeSRGBPixel(p01, tables)),
+            _mm_add_ps(DecodeSRGBPixel(p10, tables), DecodeSRGBPixel(p11, tables)));
+
+        // rgb to lookup table indices, alpha straight back to 8 bit
+        const __m128 scale = _mm_setr_ps(0.25f * (LINEAR_TO_SRGB_LUT_SIZE - 1), 0.25f * (LINEAR_TO_SRGB_LUT_SIZE - 1),
+            0.25f * (LINEAR_TO_SRGB_LUT_SIZE - 1), 0.25f);
+        alignas(16) int32_t indices[4];
+        _mm_store_si128(reinterpret_cast<__m128i*>(indices), _mm_cvtps_epi32(_mm_mul_ps(sum, scale)));
+
+        dst[0] = tables.to_srgb[indices[0]];
+        dst[1] = tables.to_srgb[indices[1]];
+        dst[2] = tables.to_srgb[indices[2]];
+        dst[3] = static_cast<uint8_t>(indices[3]);
+    }
+
+    // 4 destination pixels per iteration, row0 and row1 hold 8 source pixels each
+    void DownsampleRowLinearSSE2(const uint8_t* row0, const uint8_t* row1, uint8_t* dst, const UINT dst_count)
+    {
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i round = _mm_set1_epi16(2);
+
+        for (UINT x = 0; x < dst_count; x += 4) {
+            const __m128i a0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row0 + x * 8));
+            const __m128i a1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row0 + x * 8 + 16));
+            const __m128i b0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row1 + x * 8));
+            const __m128i b1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row1 + x * 8 + 16));
+
+            // vertical sums in 16 bit, two source pixels per register
+            const __m128i v01 = _mm_add_epi16(_mm_unpacklo_epi8(a0, zero), _mm_unpacklo_epi8(b0, zero));
+            const __m128i v23 = _mm_add_epi16(_mm_unpackhi_epi8(a0, zero), _mm_unpackhi_epi8(b0, zero));
+            const __m128i v45 = _mm_add_epi16(_mm_unpacklo_epi8(a1, zero), _mm_unpacklo_epi8(b1, zero));
+            const __m128i v67 = _mm_add_epi16(_mm_unpackhi_epi8(a1, zero), _mm_unpackhi_epi8(b1, zero));
+
+            // horizontal neighbours sit in the two 64 bit halves
+            __m128i d01 = _mm_add_epi16(_mm_unpacklo_epi64(v01, v23), _mm_unpackhi_epi64(v01, v23));
+            __m128i d23 = _mm_add_epi16(_mm_unpacklo_epi64(v45, v67), _mm_unpackhi_epi64(v45, v67));
+            d01 = _mm_srli_epi16(_mm_add_epi16(d01, round), 2);
+            d23 = _mm_srli_epi16(_mm_add_epi16(d23, round), 2);
+
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + x * 4), _mm_packus_epi16(d01, d23));
+        }
+    }
+
+}
+
+UINT16 CountMipLevels(UINT width, UINT height)
+{
+    UINT16 levels = 1;
+    while (width > 1 || height > 1) {
+        width = std::max(1u, width / 2);
+        height = std::max(1u, height / 2);
+        ++levels;
+    }
+    return levels;
+}
+
+size_t GetMipChainSize(UINT width, UINT height)
+{
+    size_t size = 0;
+    while (width > 1 || height > 1) {
+        width = std::max(1u, width / 2);
+        height = std::max(1u, height / 2);
+        size += static_cast<size_t>(width) * height * 4;
+    }
+    return size;
+}
+
+void DownsampleRGBA8(const uint8_t* src, const UINT src_width, const UINT src_height, uint8_t* dst, const MipFilter filter)
+{
+    const UINT dst_width = std::max(1u, src_width / 2);
+    const UINT dst_height = std::max(1u, src_height / 2);
+    const SRGBTables& tables = GetSRGBTables();
+
+    for (UINT y = 0; y < dst_height; ++y) {
+        // an odd last row/column is dropped, a source of size 1 is reused for both taps
+        const uint8_t* row0 = src + static_cast<size_t>(2 * y) * src_width * 4;
+        const uint8_t* row1 = src + static_cast<size_t>(std::min(2 * y + 1, src_height - 1)) * src_width * 4;
+        uint8_t* dst_row = dst + static_cast<size_t>(y) * dst_width * 4;
+
+        UINT x = 0;
+        if (filter == MipFilter::Linear && src_width > 1) {
+            x = dst_width & ~3u;
+            DownsampleRowLinearSSE2(row0, row1, dst_row, x);
+        }
+
+        for (; x < dst_width; ++x) {
+            const UINT x0 = 2 * x;
+            const UINT x1 = std::min(2 * x + 1, src_width - 1);
+            if (filter == MipFilter::Linear) {
+                DownsamplePixelLinear(row0 + x0 * 4, row0 + x1 * 4, row1 + x0 * 4, row1 + x1 * 4, dst_row + x * 4);
+            } else {
+                DownsamplePixelSRGB(row0 + x0 * 4, row0 + x1 * 4, row1 + x0 * 4, row1 + x1 * 4, dst_row + x * 4, tables);
+            }
+        }
+    }
+}
+
+void DownsampleRGBA8Reference(const uint8_t* src, const UINT src_width, const UINT src_height, uint8_t* dst, const MipFilter filter)
+{
+    const UINT dst_width = std::max(1u, src_width / 2);
+    const UINT dst_height = std::max(1u, src_height / 2);
+
+    for (UINT y = 0; y < dst_height; ++y) {
+        for (UINT x = 0; x < dst_width; ++x) {
+            const uint8_t* taps[4] = {
+                src + (static_cast<size_t>(2 * y) * src_width + 2 * x) * 4,
+                src + (static_cast<size_t>(2 * y) * src_width + std::min(2 * x + 1, src_width - 1)) * 4,
+                src + (static_cast<size_t>(std::min(2 * y + 1, src_height - 1)) * src_width + 2 * x) * 4,
+                src + (static_cast<size_t>(std::min(2 * y + 1, src_height - 1)) * src_width + std::min(2 * x + 1, src_width - 1)) * 4,
+            };
+            uint8_t* out = dst + (static_cast<size_t>(y) * dst_width + x) * 4;
+
+            for (int c = 0; c < 4; ++c) {
+                if (filter == MipFilter::SRGB && c < 3) {
+                    float sum = 0.0f;
+                    for (const uint8_t* tap : taps) {
+                        sum += SRGBToLinear(tap[c] / 255.0f);
+                    }
+                    out[c] = ToUNorm8(LinearToSRGB(sum * 0.25f));
+                } else {
+                    out[c] = static_cast<uint8_t>((taps[0][c] + taps[1][c] + taps[2][c] + taps[3][c] + 2) >> 2);
+                }
+            }
+        }
+    }
+}
+
+void GenerateMipChain(const uint8_t* base, UINT width, UINT height, const MipFilter filter, uint8_t* chain,
+    std::vector<D3D12_SUBRESOURCE_DATA>& subresources)
+{
+    const uint8_t* src = base;
+    while (width > 1 || height > 1) {
+        const UINT dst_width = std::max(1u, width / 2);
+        const UINT dst_height = std::max(1u, height / 2);
+        DownsampleRGBA8(src, width, height, chain, filter);
+
+        D3D12_SUBRESOURCE_DATA level = {};
+        level.pData = chain;
+        level.RowPitch = static_cast<LONG_PTR>(dst_width) * 4;
+        level.SlicePitch = level.RowPitch * dst_height;
+        subresources.push_back(level);
+
+        src = chain;
+        chain += level.SlicePitch;
+        width = dst_width;
+        height = dst_height;
+    }
+}
+
+}
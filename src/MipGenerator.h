@@ -0,0 +1,39 @@
+#pragma once
+
+#include "AnniUtils.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace Anni {
+
+// CPU mip chain generation for tightly packed R8G8B8A8 images, 2x2 box filter per level.
+
+enum class MipFilter {
+    // plain average of the stored values, for data textures (normals, metal-rough, occlusion)
+    Linear,
+    // color channels are averaged in linear light and encoded back to sRGB, alpha stays linear
+    SRGB,
+};
+
+// Bump whenever the generated mips change, block compressed textures cached from older mips are ignored.
+constexpr UINT32 MIP_GENERATOR_VERSION = 1;
+
+// Levels of the full chain down to 1x1, including the base level.
+UINT16 CountMipLevels(UINT width, UINT height);
+
+// Bytes needed for every level below the base level.
+size_t GetMipChainSize(UINT width, UINT height);
+
+// Halves src into dst (max(1, width / 2) x max(1, height / 2)). SSE2 for the linear filter, lookup tables for sRGB.
+void DownsampleRGBA8(const uint8_t* src, UINT src_width, UINT src_height, uint8_t* dst, MipFilter filter);
+
+// Scalar, exact float version of DownsampleRGBA8 to validate the fast path against.
+// Linear results match bit for bit, sRGB results are within one step.
+void DownsampleRGBA8Reference(const uint8_t* src, UINT src_width, UINT src_height, uint8_t* dst, MipFilter filter);
+
+// Writes levels 1..n of base into chain (GetMipChainSize bytes) and appends one subresource per level.
+void GenerateMipChain(const uint8_t* base, UINT width, UINT height, MipFilter filter, uint8_t* chain,
+    std::vector<D3D12_SUBRESOURCE_DATA>& subresources);
+
+}
@@ -0,0 +1,137 @@
+#pragma once
+
+#include "AnniMath.h"
+#include "AnniUtils.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace Anni {
+
+// CPU side content of a model, everything GltfModel needs to create its GPU resources.
+// It is produced either by importing a glTF file (GltfImporter.h) or by mapping a cooked scene pack (ScenePack.h).
+
+struct MaterialConstants {
+    glm::vec4 colorFactors;
+    glm::vec4 metalRoughFactors;
+
+    INT32 albedoIndex { -1 };
+    INT32 albedoSamplerIndex { -1 };
+
+    INT32 metalRoughIndex { -1 };
+    INT32 metalRoughSamplerIndex { -1 };
+
+    INT32 normalIndex { -1 };
+    INT32 normalSamplerIndex { -1 };
+
+    INT32 emissiveIndex { -1 };
+    INT32 emissiveSamplerIndex { -1 };
+
+    INT32 occlusionIndex { -1 };
+    INT32 occlusionSamplerIndex { -1 };
+    INT32 padding0;
+    INT32 padding1;
+    // glm::vec4 extra[11];
+};
+
+// Levels of detail of a surface, the full surface included.
+constexpr uint32_t SURFACE_LOD_COUNT = 4;
+
+// A simplified version of a surface (see MeshSimplifier.h), it indexes the same vertices as the full surface.
+struct SurfaceLod {
+    uint32_t startIndex { 0 };
+    uint32_t count { 0 };
+    // largest distance, in mesh units, the simplified triangles may be off the full surface
+    float error { 0.0f };
+};
+
+// Box and sphere around the same center, see Bounds.h.
+struct Bounds {
+    glm::vec3 origin { 0.0f };
+    // half size of the box
+    glm::vec3 extents { 0.0f };
+    float sphereRadius { 0.0f };
+};
+
+// triangles of a mesh sharing one material
+struct GeoSurface {
+    uint32_t startIndex;
+    uint32_t count;
+    uint32_t materialIndex;
+    // range in MeshData::meshlets
+    uint32_t meshletOffset { 0 };
+    uint32_t meshletCount { 0 };
+    // lods[0] is the full surface, coarser levels follow with growing error. The meshlets only cover lods[0].
+    uint32_t lodCount { 1 };
+    SurfaceLod lods[SURFACE_LOD_COUNT] {};
+    // mesh space
+    Bounds bounds;
+};
+
+// A cluster of at most MESHLET_MAX_VERTICES vertices and MESHLET_MAX_TRIANGLES triangles of one surface (see
+// MeshOptimizer.h). Its triangles are contiguous in the index buffer, so a culled surface is drawn as index ranges.
+struct Meshlet {
+    // relative to the startIndex of the surface
+    uint32_t first_index;
+    uint32_t triangle_count;
+    uint32_t vertex_count;
+
+    // mesh space bounding sphere
+    glm::vec3 center;
+    float radius;
+
+    // Every triangle faces away from an eye with dot(normalize(cone_apex - eye), cone_axis) >= cone_cutoff.
+    // cone_cutoff is above 1 when the triangles face too many ways for the test to ever pass.
+    glm::vec3 cone_apex;
+    glm::vec3 cone_axis;
+    float cone_cutoff;
+};
+
+struct TextureData {
+    std::string name;
+
+    UINT width { 0 };
+    UINT height { 0 };
+    UINT16 mip_levels { 1 };
+    DXGI_FORMAT format { DXGI_FORMAT_R8G8B8A8_UNORM };
+
+    // one entry per subresource (mip level), empty when the image failed to decode.
+    // The pointers stay valid as long as storage is alive.
+    std::vector<D3D12_SUBRESOURCE_DATA> subresources;
+    std::shared_ptr<const void> storage;
+
+    // hash of the description and every subresource, TextureCache shares the GPU texture of equal content by it
+    UINT64 content_hash { 0 };
+};
+
+struct MeshData {
+    std::string name;
+    std::vector<GeoSurface> surfaces;
+
+    // every surface of the mesh shares these
+    std::vector<StandardVertex> vertices;
+    std::vector<uint32_t> indices;
+    std::vector<Meshlet> meshlets;
+};
+
+struct NodeData {
+    // -1 for top nodes
+    INT32 parent_index { -1 };
+    // -1 when the node has no mesh
+    INT32 mesh_index { -1 };
+    std::vector<uint32_t> children;
+
+    // world transforms are resolved by the model's TransformHierarchy
+    glm::mat4 local_transform;
+};
+
+struct ModelData {
+    std::vector<D3D12_SAMPLER_DESC> samplers;
+    std::vector<TextureData> textures;
+    std::vector<MaterialConstants> materials;
+    std::vector<MeshData> meshes;
+    std::vector<NodeData> nodes;
+};
+
+}
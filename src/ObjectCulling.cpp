@@ -0,0 +1,182 @@
+#include "ObjectCulling.h"
+
+#include <immintrin.h>
+
+#include <bit>
+#include <cmath>
+
+namespace Anni {
+
+namespace {
+
+    static_assert(sizeof(Bounds) == 28 && offsetof(Bounds, origin) == 0 && offsetof(Bounds, extents) == 12,
+        "the gathers read a box as origin and extents in the first six of seven floats");
+
+    constexpr int32_t BOUNDS_STRIDE = sizeof(Bounds) / sizeof(float);
+
+    // A plane and the absolute values of its normal, the distance of a box is ((n.x * c.x + n.y * c.y) + n.z * c.z) + w,
+    // the radius it projects to ((|n.x| * e.x + |n.y| * e.y) + |n.z| * e.z). The box is behind the plane when
+    // distance + radius < 0, every path evaluates it in this order.
+    struct CullPlane {
+        float nx, ny, nz, w;
+        float ax, ay, az;
+    };
+
+    std::array<CullPlane, 6> MakeCullPlanes(const Frustum& frustum)
+    {
+        std::array<CullPlane, 6> planes;
+        for (size_t p = 0; p < planes.size(); ++p) {
+            const glm::vec4& plane = frustum.planes[p];
+            planes[p] = { plane.x, plane.y, plane.z, plane.w, std::abs(plane.x), std::abs(plane.y), std::abs(plane.z) };
+        }
+        return planes;
+    }
+
+    bool IsBoxVisible(const Bounds& bounds, const std::array<CullPlane, 6>& planes)
+    {
+        for (const CullPlane& p : planes) {
+            const float distance = ((p.nx * bounds.origin.x + p.ny * bounds.origin.y) + p.nz * bounds.origin.z) + p.w;
+            const float radius = (p.ax * bounds.extents.x + p.ay * bounds.extents.y) + p.az * bounds.extents.z;
+            if (!(distance + radius >= 0.0f)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    //> isa
+    // LANES boxes per register, Gather loads one float of each box starting at component c of the first.
+    struct Sse41 {
+        static constexpr size_t LANES = 4;
+        using Float = __m128;
+
+        static Float Splat(const float a) { return _mm_set1_ps(a); }
+        static Float Add(const Float a, const Float b) { return _mm_add_ps(a, b); }
+        static Float Mul(const Float a, const Float b) { return _mm_mul_ps(a, b); }
+        static Float Gather(const float* c)
+        {
+            return _mm_setr_ps(c[0], c[BOUNDS_STRIDE], c[2 * BOUNDS_STRIDE], c[3 * BOUNDS_STRIDE]);
+        }
+        // one bit per lane that is >= 0
+        static uint32_t NotNegative(const Float a)
+        {
+            return static_cast<uint32_t>(_mm_movemask_ps(_mm_cmpge_ps(a, _mm_setzero_ps())));
+        }
+
+        static size_t StoreIndices(const uint32_t first, uint32_t mask, uint32_t* out)
+        {
+            size_t written = 0;
+            for (; mask != 0; mask &= mask - 1) {
+                out[written++] = first + static_cast<uint32_t>(std::countr_zero(mask));
+            }
+            return written;
+        }
+    };
+
+    struct Avx2 {
+        static constexpr size_t LANES = 8;
+        using Float = __m256;
+
+        static Float Splat(const float a) { return _mm256_set1_ps(a); }
+        static Float Add(const Float a, const Float b) { return _mm256_add_ps(a, b); }
+        static Float Mul(const Float a, const Float b) { return _mm256_mul_ps(a, b); }
+        static Float Gather(const float* c)
+        {
+            const __m256i offsets = _mm256_mullo_epi32(_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7), _mm256_set1_epi32(BOUNDS_STRIDE));
+            return _mm256_i32gather_ps(c, offsets, sizeof(float));
+        }
+        static uint32_t NotNegative(const Float a)
+        {
+            return static_cast<uint32_t>(_mm256_movemask_ps(_mm256_cmp_ps(a, _mm256_setzero_ps(), _CMP_GE_OQ)));
+        }
+
+        static size_t StoreIndices(const uint32_t first, const uint32_t mask, uint32_t* out)
+        {
+            return Sse41::StoreIndices(first, mask, out);
+        }
+    };
+
+    struct Avx512 {
+        static constexpr size_t LANES = 16;
+        using Float = __m512;
+
+        static Float Splat(const float a) { return _mm512_set1_ps(a); }
+        static Float Add(const Float a, const Float b) { return _mm512_add_ps(a, b); }
+        static Float Mul(const Float a, const Float b) { return _mm512_mul_ps(a, b); }
+        static Float Gather(const float* c)
+        {
+            const __m512i offsets = _mm512_mullo_epi32(_mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15), _mm512_set1_epi32(BOUNDS_STRIDE));
+            return _mm512_i32gather_ps(offsets, c, sizeof(float));
+        }
+        static uint32_t NotNegative(const Float a)
+        {
+            return _mm512_cmp_ps_mask(a, _mm512_setzero_ps(), _CMP_GE_OQ);
+        }
+
+        // the visible lanes' indices packed together with one compress store
+        static size_t StoreIndices(const uint32_t first, const uint32_t mask, uint32_t* out)
+        {
+            const __m512i indices = _mm512_add_epi32(_mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15), _mm512_set1_epi32(static_cast<int>(first)));
+            _mm512_mask_compressstoreu_epi32(out, static_cast<__mmask16>(mask), indices);
+            return static_cast<size_t>(std::popcount(mask));
+        }
+    };
+    //< isa
+
+    // Whole batches from begin on, returns where they stopped and appends their visible boxes.
+    template <typename Isa>
+    size_t CullBoundsSimd(const Bounds* bounds, const size_t begin, const size_t count, const std::array<CullPlane, 6>& planes, uint32_t* visible_indices, size_t& visible_count)
+    {
+        using Float = typename Isa::Float;
+        constexpr uint32_t all_lanes = static_cast<uint32_t>((uint64_t(1) << Isa::LANES) - 1);
+
+        size_t i = begin;
+        for (; i + Isa::LANES <= count; i += Isa::LANES) {
+            const float* first = &bounds[i].origin.x;
+            const Float cx = Isa::Gather(first);
+            const Float cy = Isa::Gather(first + 1);
+            const Float cz = Isa::Gather(first + 2);
+            const Float ex = Isa::Gather(first + 3);
+            const Float ey = Isa::Gather(first + 4);
+            const Float ez = Isa::Gather(first + 5);
+
+            uint32_t visible = all_lanes;
+            for (const CullPlane& p : planes) {
+                const Float distance = Isa::Add(Isa::Add(Isa::Add(Isa::Mul(Isa::Splat(p.nx), cx), Isa::Mul(Isa::Splat(p.ny), cy)), Isa::Mul(Isa::Splat(p.nz), cz)), Isa::Splat(p.w));
+                const Float radius = Isa::Add(Isa::Add(Isa::Mul(Isa::Splat(p.ax), ex), Isa::Mul(Isa::Splat(p.ay), ey)), Isa::Mul(Isa::Splat(p.az), ez));
+                visible &= Isa::NotNegative(Isa::Add(distance, radius));
+                if (visible == 0) {
+                    break;
+                }
+            }
+            visible_count += Isa::StoreIndices(static_cast<uint32_t>(i), visible, visible_indices + visible_count);
+        }
+        return i;
+    }
+
+}
+
+size_t CullBounds(const Bounds* bounds, const size_t count, const Frustum& frustum, uint32_t* visible_indices, const SimdLevel level)
+{
+    const std::array<CullPlane, 6> planes = MakeCullPlanes(frustum);
+
+    size_t visible_count = 0;
+    size_t i = 0;
+    if (level >= SimdLevel::AVX512) {
+        i = CullBoundsSimd<Avx512>(bounds, i, count, planes, visible_indices, visible_count);
+    } else if (level == SimdLevel::AVX2) {
+        i = CullBoundsSimd<Avx2>(bounds, i, count, planes, visible_indices, visible_count);
+    }
+    // the rest of the wider paths
+    if (level >= SimdLevel::SSE41) {
+        i = CullBoundsSimd<Sse41>(bounds, i, count, planes, visible_indices, visible_count);
+    }
+    for (; i < count; ++i) {
+        if (IsBoxVisible(bounds[i], planes)) {
+            visible_indices[visible_count++] = static_cast<uint32_t>(i);
+        }
+    }
+    return visible_count;
+}
+
+}
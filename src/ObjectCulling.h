@@ -0,0 +1,29 @@
+#pragma once
+
+#include "AnniUtils.h"
+#include "ClusterCulling.h"
+
+#include <cstddef>
+#include <cstdint>
+
+namespace Anni {
+
+// Frustum culling of whole objects on their world space boxes, before any of their meshlets are looked at.
+
+struct ObjectCullStats {
+    uint32_t objects_tested { 0 };
+    uint32_t objects_visible { 0 };
+    uint32_t objects_culled { 0 };
+    // wall time of the culling divided by objects_tested
+    float ns_per_object { 0.0f };
+};
+
+// Writes the indices of the boxes that are at least partly inside frustum to visible_indices in ascending order and
+// returns their number, visible_indices has room for count of them. A box is culled when it is entirely behind one of
+// the planes, so a box next to a corner of the frustum may be kept. The boxes go in batches of 16 (AVX-512), 8 (AVX2)
+// or 4 (SSE4.1), one lane per box with every component of the batch gathered into a register of its own. All paths
+// keep the same boxes as the scalar one.
+size_t CullBounds(const Bounds* bounds, size_t count, const Frustum& frustum, uint32_t* visible_indices,
+    SimdLevel level = GetSimdLevel());
+
+}
@@ -1,4 +1,5 @@
 #include "Renderer.h"
+#include "LoadProfiler.h"
 
 // Renderer
 namespace Anni {
@@ -43,9 +44,9 @@ void Renderer::initializeAPI(xwin::Window& window)
 void Renderer::initializeFrameResources()
 {
     for (auto&& [frame_index, p_frame_resource] : std::views::enumerate(m_frame_resources)) {
-        p_frame_resource = std::make_unique<FrameResource>(m_Device.Get(), m_Swapchain.Get(), m_dxcUtils.Get(), m_dxcCompiler.Get(), m_includeHandler.Get(),
+        p_frame_resource = std::make_unique<FrameResource>(m_Device.Get(), m_Swapchain.Get(), *m_heapAllocator, m_dxcUtils.Get(), m_dxcCompiler.Get(), m_includeHandler.Get(),
 
-            m_BackBuffer, m_BackBufferRenderTargetViews, *m_sponza, *m_METAX, m_Viewport, m_ScissorRect);
+            m_BackBuffer, m_BackBufferRenderTargetViews, *m_sponza, *m_METAX, m_Viewport, m_ScissorRect, static_cast<UINT>(frame_index));
     }
 }
 
@@ -62,26 +63,13 @@ void Renderer::initializeGlobalCommands()
         IID_PPV_ARGS(m_MainDirectCommandList.ReleaseAndGetAddressOf())));
 
     m_MainDirectCommandList->Close();
-
-    //***********************************************************
-    ThrowIfFailed(m_Device->CreateCommandAllocator(
-        D3D12_COMMAND_LIST_TYPE_COPY,
-        IID_PPV_ARGS(m_CopyCommandAllocator.ReleaseAndGetAddressOf())));
-
-    ThrowIfFailed(m_Device->CreateCommandList(
-        0, D3D12_COMMAND_LIST_TYPE_COPY, m_CopyCommandAllocator.Get(), nullptr,
-        IID_PPV_ARGS(m_CopyCommandList.ReleaseAndGetAddressOf())));
-
-    m_CopyCommandList->Close();
 }
 
 void Renderer::initializeScene() { initSceneModels(); }
 
 void Renderer::initSceneModels()
 {
-    ThrowIfFailed(m_CopyCommandAllocator->Reset());
-    ThrowIfFailed(m_CopyCommandList->Reset(m_CopyCommandAllocator.Get(), nullptr));
-
+    ProfileZone init_zone("InitSceneModels");
     ThrowIfFailed(m_MainDirectCommandAllocator->Reset());
     ThrowIfFailed(m_MainDirectCommandList->Reset(m_MainDirectCommandAllocator.Get(), nullptr));
 
@@ -95,33 +83,38 @@ void Renderer::initSceneModels()
 
         const std::string sponza_path = working_path + "assets\\gltfModels\\Sponza\\glTF\\Sponza.gltf";
         const std::string MATEX_path = working_path +  "assets\\gltfModels\\METAX\\untitled.gltf";
+        // written by SceneCooker
+        const std::string sponza_pack_path = working_path + "assets\\gltfModels\\Sponza\\glTF\\Sponza.scenepack";
+
+        m_heapAllocator = std::make_unique<ResourceHeapAllocator>(m_Device.Get());
+        m_geometryPool = std::make_unique<GeometryPool>(*m_heapAllocator, GEOMETRY_POOL_VERTEX_CAPACITY, GEOMETRY_POOL_INDEX_CAPACITY);
+        m_textureCache = std::make_unique<TextureCache>(*m_heapAllocator);
+        m_sponza = std::make_unique<GltfModel>(m_Device.Get(), *m_heapAllocator, *m_geometryPool, *m_textureCache);
+        m_METAX = std::make_unique<GltfModel>(m_Device.Get(), *m_heapAllocator, *m_geometryPool, *m_textureCache);
+
+        // only needed while importing
+        ThreadPool import_thread_pool(IMPORT_THREAD_COUNT);
+        StagingRing staging_ring(m_Device.Get(), m_MainCopyQueue.Get(), *m_heapAllocator);
+
+        if (!m_sponza->LoadFromPack(sponza_pack_path, sponza_path, staging_ring)) {
+            std::cout << "[Renderer] no up to date scene pack, run SceneCooker \"" << sponza_path << "\" \""
+                      << sponza_pack_path << "\" to skip the glTF import next time" << '\n';
+            m_sponza->LoadFromFile(sponza_path, import_thread_pool, staging_ring);
+        }
+        //m_METAX->LoadFromFile(MATEX_path, import_thread_pool, staging_ring);
 
-        m_sponza = std::make_unique<GltfModel>(m_Device.Get(), m_CopyCommandList.Get());
-        m_METAX = std::make_unique<GltfModel>(m_Device.Get(), m_CopyCommandList.Get());
-
-        m_sponza->LoadFromFile(sponza_path);
-        //m_METAX->LoadFromFile(MATEX_path);
+        // the ring and its upload memory are gone once the copy queue is done
+        staging_ring.Flush();
+        staging_ring.LogStats();
     }
 
-    {
-        m_CopyCommandList->Close();
-        const std::array<ID3D12CommandList*, 1> lists_to_submit { m_CopyCommandList.Get() };
-
-        m_MainCopyQueue->ExecuteCommandLists(lists_to_submit.size(), lists_to_submit.data());
-        m_MainCopyQueue->Signal(m_fenceGlobal.Get(), ++m_fenceValueGlobal);
-
-        // Check if the GPU has already completed the work
-        if (m_fenceGlobal->GetCompletedValue() < m_fenceValueGlobal) {
-            // Instruct the fence to signal the event when it reaches the current fence value
-            ThrowIfFailed(m_fenceGlobal->SetEventOnCompletion(m_fenceValueGlobal, m_fenceEventGlobal));
-
-            // Wait for the event (blocks until the GPU completes the work)
-            WaitForSingleObject(m_fenceEventGlobal, INFINITE);
-        }
-    }
+    m_geometryPool->LogStats();
+    m_textureCache->LogStats();
+    m_heapAllocator->LogStats();
     // Layout transition from copy dst or common to SRV()
     // ƺCOPY QUEUEĿǰֻ֧  resource states״̬copy destcopy source common
     {
+        const ProfileZone transition_zone("TransitionTextures");
         m_sponza->TransitionResrouceStateFromCopyToGraphics(m_MainDirectCommandList.Get());
         m_MainDirectCommandList->Close();
         const std::array<ID3D12CommandList*, 1> lists_to_submit { m_MainDirectCommandList.Get() };
@@ -138,6 +131,20 @@ void Renderer::initSceneModels()
             WaitForSingleObject(m_fenceEventGlobal, INFINITE);
         }
     }
+    init_zone.End();
+
+    if constexpr (LOAD_PROFILING) {
+        // a missing report must not keep the scene from showing
+        try {
+            LoadProfiler::Get().LogStats();
+            LoadProfiler::Get().WriteReport(LOAD_PROFILE_REPORT_PATH);
+            if constexpr (LOAD_PROFILE_CHROME_TRACE) {
+                LoadProfiler::Get().WriteChromeTrace(LOAD_PROFILE_TRACE_PATH);
+            }
+        } catch (const std::exception& e) {
+            std::cerr << "[Renderer] failed to write the load profile: " << e.what() << '\n';
+        }
+    }
 }
 
 void Renderer::destroyAPI()
@@ -1049,7 +1056,14 @@ void Renderer::OnRender()
     const float time_elapsed = std::chrono::duration<float, std::milli>(tEnd - tStart).count();
     tStart = std::chrono::high_resolution_clock::now();
 
-    m_frame_resources[m_GlobalFrameNum % FRAME_INFLIGHT_COUNT]->RecordCommandsAndExecute(m_MainDirectQueue.Get());
+    FrameResource& frame_resource = *m_frame_resources[m_GlobalFrameNum % FRAME_INFLIGHT_COUNT];
+    frame_resource.RecordCommandsAndExecute(m_MainDirectQueue.Get());
+
+    if (OBJECT_CULL_LOG_INTERVAL != 0 && m_GlobalFrameNum % OBJECT_CULL_LOG_INTERVAL == 0) {
+        const ObjectCullStats& stats = frame_resource.GetObjectCullStats();
+        std::cout << "[Renderer] frame " << m_GlobalFrameNum << ": " << stats.objects_visible << " of " << stats.objects_tested
+                  << " objects visible, " << stats.objects_culled << " culled, " << stats.ns_per_object << " ns per object" << '\n';
+    }
 
     ++m_GlobalFrameNum;
 }
@@ -94,8 +94,6 @@ protected:
     WRL::ComPtr<ID3D12GraphicsCommandList> m_MainDirectCommandList;
 
     WRL::ComPtr<ID3D12CommandQueue> m_MainCopyQueue;
-    WRL::ComPtr<ID3D12CommandAllocator> m_CopyCommandAllocator;
-    WRL::ComPtr<ID3D12GraphicsCommandList> m_CopyCommandList;
 
     WRL::ComPtr<IDXGISwapChain3> m_Swapchain;
     WRL::ComPtr<ID3D12Resource> m_BackBuffer[BACKBUFFER_COUNT];
@@ -103,6 +101,12 @@ protected:
     WRL::ComPtr<ID3D12DescriptorHeap> m_BackBufferRtvDescHeap;
 
     // Resources
+    // declared before everything placed in it, so it is destroyed last
+    std::unique_ptr<ResourceHeapAllocator> m_heapAllocator;
+    // declared before the models, which free their meshes from it
+    std::unique_ptr<GeometryPool> m_geometryPool;
+    // declared before the models, which keep pointers to its textures
+    std::unique_ptr<TextureCache> m_textureCache;
     std::unique_ptr<GltfModel> m_sponza;
     std::unique_ptr<GltfModel> m_METAX;
 
@@ -0,0 +1,289 @@
+#include "ResourceHeapAllocator.h"
+
+#include <algorithm>
+
+namespace Anni {
+
+namespace {
+
+    const char* GetHeapTypeName(const D3D12_HEAP_TYPE heap_type)
+    {
+        switch (heap_type) {
+        case D3D12_HEAP_TYPE_DEFAULT:
+            return "default";
+        case D3D12_HEAP_TYPE_UPLOAD:
+            return "upload";
+        case D3D12_HEAP_TYPE_READBACK:
+            return "readback";
+        default:
+            return "custom";
+        }
+    }
+
+    const char* GetHeapCategoryName(const HeapCategory category)
+    {
+        switch (category) {
+        case HeapCategory::Buffers:
+            return "buffers";
+        case HeapCategory::Textures:
+            return "textures";
+        case HeapCategory::RenderTargets:
+            return "render targets";
+        }
+        return "";
+    }
+
+    // Picks the smallest placement alignment the device accepts for desc and writes it into desc.Alignment, so the
+    // resource is later created with the same layout the memory was sized for.
+    D3D12_RESOURCE_ALLOCATION_INFO QueryAllocationInfo(ID3D12Device* device, D3D12_RESOURCE_DESC& desc)
+    {
+        const bool small_candidate = desc.Dimension != D3D12_RESOURCE_DIMENSION_BUFFER
+            && (desc.Flags & (D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET | D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL)) == 0
+            && desc.SampleDesc.Count == 1;
+
+        if (small_candidate) {
+            desc.Alignment = D3D12_SMALL_RESOURCE_PLACEMENT_ALIGNMENT;
+            const D3D12_RESOURCE_ALLOCATION_INFO info = device->GetResourceAllocationInfo(0, 1, &desc);
+            if (info.Alignment == D3D12_SMALL_RESOURCE_PLACEMENT_ALIGNMENT && info.SizeInBytes != UINT64_MAX) {
+                return info;
+            }
+        }
+
+        // 64 KB, or 4 MB for MSAA
+        desc.Alignment = 0;
+        const D3D12_RESOURCE_ALLOCATION_INFO info = device->GetResourceAllocationInfo(0, 1, &desc);
+        if (info.SizeInBytes == UINT64_MAX) {
+            throw std::runtime_error("Invalid resource description for a placed resource");
+        }
+        return info;
+    }
+
+}
+
+//> PLACED RESOURCE
+PlacedResource::PlacedResource(ResourceHeapAllocator* allocator, WRL::ComPtr<ID3D12Resource> resource, const HeapAllocation& allocation)
+    : m_allocator(allocator)
+    , m_resource(std::move(resource))
+    , m_allocation(allocation)
+{
+}
+
+PlacedResource::PlacedResource(PlacedResource&& other) noexcept
+    : m_allocator(other.m_allocator)
+    , m_resource(std::move(other.m_resource))
+    , m_allocation(other.m_allocation)
+{
+    other.m_allocator = nullptr;
+    other.m_allocation = {};
+}
+
+PlacedResource& PlacedResource::operator=(PlacedResource&& other) noexcept
+{
+    if (this != &other) {
+        Reset();
+        m_allocator = other.m_allocator;
+        m_resource = std::move(other.m_resource);
+        m_allocation = other.m_allocation;
+        other.m_allocator = nullptr;
+        other.m_allocation = {};
+    }
+    return *this;
+}
+
+PlacedResource::~PlacedResource()
+{
+    Reset();
+}
+
+void PlacedResource::Reset()
+{
+    // the resource goes first, its memory may be handed out again right away
+    m_resource.Reset();
+    if (m_allocator && m_allocation.IsValid()) {
+        m_allocator->Free(m_allocation);
+    }
+    m_allocator = nullptr;
+    m_allocation = {};
+}
+//< placed resource
+
+ResourceHeapAllocator::ResourceHeapAllocator(ID3D12Device* pp_device, const UINT64 heap_block_size)
+    : m_pp_device(pp_device)
+    , m_heapBlockSize(heap_block_size)
+{
+    // a block has to hold at least one 4 MB aligned resource
+    assert(heap_block_size % D3D12_DEFAULT_MSAA_RESOURCE_PLACEMENT_ALIGNMENT == 0);
+}
+
+HeapCategory ResourceHeapAllocator::GetHeapCategory(const D3D12_RESOURCE_DESC& desc)
+{
+    if (desc.Dimension == D3D12_RESOURCE_DIMENSION_BUFFER) {
+        return HeapCategory::Buffers;
+    }
+    if (desc.Flags & (D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET | D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL)) {
+        return HeapCategory::RenderTargets;
+    }
+    return HeapCategory::Textures;
+}
+
+PlacedResource ResourceHeapAllocator::CreateResource(const D3D12_HEAP_TYPE heap_type, const D3D12_RESOURCE_DESC& desc,
+    const D3D12_RESOURCE_STATES initial_state, const D3D12_CLEAR_VALUE* clear_value)
+{
+    D3D12_RESOURCE_DESC placed_desc = desc;
+    const D3D12_RESOURCE_ALLOCATION_INFO info = QueryAllocationInfo(m_pp_device, placed_desc);
+    const HeapAllocation allocation = AllocateMemory(heap_type, GetHeapCategory(desc), info);
+
+    const HeapBlock& block = *m_pools[allocation.pool].blocks[allocation.heap_block];
+    WRL::ComPtr<ID3D12Resource> resource;
+    const HRESULT hr = m_pp_device->CreatePlacedResource(
+        block.heap.Get(), allocation.range.offset, &placed_desc, initial_state, clear_value,
+        IID_PPV_ARGS(resource.ReleaseAndGetAddressOf()));
+    if (FAILED(hr)) {
+        Free(allocation);
+        ThrowIfFailed(hr);
+    }
+    return PlacedResource(this, std::move(resource), allocation);
+}
+
+D3D12_RESOURCE_ALLOCATION_INFO ResourceHeapAllocator::GetAllocationInfo(const D3D12_RESOURCE_DESC& desc) const
+{
+    D3D12_RESOURCE_DESC placed_desc = desc;
+    return QueryAllocationInfo(m_pp_device, placed_desc);
+}
+
+HeapAllocation ResourceHeapAllocator::AllocateMemory(const D3D12_HEAP_TYPE heap_type, const HeapCategory category,
+    const D3D12_RESOURCE_ALLOCATION_INFO& info)
+{
+    // upload and readback heaps only hold buffers
+    assert(heap_type == D3D12_HEAP_TYPE_DEFAULT || category == HeapCategory::Buffers);
+
+    HeapAllocation allocation;
+    allocation.pool = GetPool(heap_type, category);
+    HeapPool& pool = m_pools[allocation.pool];
+
+    const bool dedicated = info.SizeInBytes > m_heapBlockSize;
+    if (!dedicated) {
+        for (UINT32 i = 0; i < pool.blocks.size(); ++i) {
+            if (!pool.blocks[i] || pool.blocks[i]->dedicated) {
+                continue;
+            }
+            allocation.range = pool.blocks[i]->allocator.Allocate(info.SizeInBytes, info.Alignment);
+            if (allocation.range.IsValid()) {
+                allocation.heap_block = i;
+                return allocation;
+            }
+        }
+    }
+
+    // no room left, a new block goes into the first empty slot
+    const UINT64 block_size = dedicated
+        ? (info.SizeInBytes + D3D12_DEFAULT_MSAA_RESOURCE_PLACEMENT_ALIGNMENT - 1) & ~static_cast<UINT64>(D3D12_DEFAULT_MSAA_RESOURCE_PLACEMENT_ALIGNMENT - 1)
+        : m_heapBlockSize;
+    std::unique_ptr<HeapBlock> block = CreateHeapBlock(pool, block_size, dedicated);
+
+    allocation.range = block->allocator.Allocate(info.SizeInBytes, info.Alignment);
+    if (!allocation.range.IsValid()) {
+        throw std::runtime_error("Resource does not fit into a new heap block");
+    }
+
+    const auto empty_slot = std::ranges::find(pool.blocks, nullptr);
+    allocation.heap_block = static_cast<UINT32>(empty_slot - pool.blocks.begin());
+    if (empty_slot != pool.blocks.end()) {
+        *empty_slot = std::move(block);
+    } else {
+        pool.blocks.push_back(std::move(block));
+    }
+    return allocation;
+}
+
+WRL::ComPtr<ID3D12Resource> ResourceHeapAllocator::CreateAliasedResource(const HeapAllocation& allocation,
+    const D3D12_RESOURCE_DESC& desc, const D3D12_RESOURCE_STATES initial_state, const D3D12_CLEAR_VALUE* clear_value)
+{
+    D3D12_RESOURCE_DESC placed_desc = desc;
+    const D3D12_RESOURCE_ALLOCATION_INFO info = QueryAllocationInfo(m_pp_device, placed_desc);
+    assert(info.SizeInBytes <= allocation.range.size && allocation.range.offset % info.Alignment == 0);
+    assert(GetHeapCategory(desc) == m_pools[allocation.pool].category);
+
+    const HeapBlock& block = *m_pools[allocation.pool].blocks[allocation.heap_block];
+    WRL::ComPtr<ID3D12Resource> resource;
+    ThrowIfFailed(m_pp_device->CreatePlacedResource(
+        block.heap.Get(), allocation.range.offset, &placed_desc, initial_state, clear_value,
+        IID_PPV_ARGS(resource.ReleaseAndGetAddressOf())));
+    return resource;
+}
+
+void ResourceHeapAllocator::Free(const HeapAllocation& allocation)
+{
+    HeapPool& pool = m_pools[allocation.pool];
+    std::unique_ptr<HeapBlock>& block = pool.blocks[allocation.heap_block];
+    block->allocator.Free(allocation.range);
+
+    // the first block of a pool stays around, the next load most likely needs it again
+    if (block->allocator.IsEmpty() && (block->dedicated || allocation.heap_block != 0)) {
+        block.reset();
+    }
+}
+
+UINT32 ResourceHeapAllocator::GetPool(const D3D12_HEAP_TYPE heap_type, const HeapCategory category)
+{
+    for (UINT32 i = 0; i < m_pools.size(); ++i) {
+        if (m_pools[i].heap_type == heap_type && m_pools[i].category == category) {
+            return i;
+        }
+    }
+    m_pools.push_back({ heap_type, category, {} });
+    return static_cast<UINT32>(m_pools.size() - 1);
+}
+
+std::unique_ptr<ResourceHeapAllocator::HeapBlock> ResourceHeapAllocator::CreateHeapBlock(const HeapPool& pool,
+    const UINT64 size, const bool dedicated) const
+{
+    D3D12_HEAP_FLAGS flags = D3D12_HEAP_FLAG_NONE;
+    UINT64 alignment = D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT;
+    switch (pool.category) {
+    case HeapCategory::Buffers:
+        flags = D3D12_HEAP_FLAG_ALLOW_ONLY_BUFFERS;
+        break;
+    case HeapCategory::Textures:
+        flags = D3D12_HEAP_FLAG_ALLOW_ONLY_NON_RT_DS_TEXTURES;
+        break;
+    case HeapCategory::RenderTargets:
+        flags = D3D12_HEAP_FLAG_ALLOW_ONLY_RT_DS_TEXTURES;
+        alignment = D3D12_DEFAULT_MSAA_RESOURCE_PLACEMENT_ALIGNMENT;
+        break;
+    }
+
+    const CD3DX12_HEAP_DESC heap_desc(size, pool.heap_type, alignment, flags);
+    WRL::ComPtr<ID3D12Heap> heap;
+    ThrowIfFailed(m_pp_device->CreateHeap(&heap_desc, IID_PPV_ARGS(heap.ReleaseAndGetAddressOf())));
+
+    // the 4 KB small resource alignment is the finest placement there is
+    return std::make_unique<HeapBlock>(HeapBlock { std::move(heap), TlsfAllocator(size, D3D12_SMALL_RESOURCE_PLACEMENT_ALIGNMENT), dedicated });
+}
+
+std::vector<HeapBlockStats> ResourceHeapAllocator::GetStats() const
+{
+    std::vector<HeapBlockStats> stats;
+    for (const HeapPool& pool : m_pools) {
+        for (const auto& block : pool.blocks) {
+            if (block) {
+                stats.push_back({ pool.heap_type, pool.category, block->dedicated, block->allocator.GetStats() });
+            }
+        }
+    }
+    return stats;
+}
+
+void ResourceHeapAllocator::LogStats() const
+{
+    constexpr double MB = 1024.0 * 1024.0;
+    for (const HeapBlockStats& block : GetStats()) {
+        std::cout << "[ResourceHeapAllocator] " << GetHeapTypeName(block.heap_type) << " " << GetHeapCategoryName(block.category)
+                  << (block.dedicated ? " (dedicated)" : "") << ": " << block.allocator.used / MB << " / " << block.allocator.size / MB
+                  << " MB used (" << 100.0 * block.allocator.used / block.allocator.size << "%), "
+                  << block.allocator.allocation_count << " resources, " << block.allocator.free_block_count << " free ranges, "
+                  << "fragmentation " << block.allocator.fragmentation * 100.0f << "%" << '\n';
+    }
+}
+
+}
@@ -0,0 +1,115 @@
+#pragma once
+
+#include "AnniUtils.h"
+#include "TlsfAllocator.h"
+
+#include <memory>
+
+namespace Anni {
+
+// Resource heap tier 1 hardware can't mix these in one heap, so each gets heap blocks of its own.
+enum class HeapCategory {
+    Buffers,
+    Textures,
+    RenderTargets,
+};
+
+// Memory inside one of the heap blocks of a ResourceHeapAllocator.
+struct HeapAllocation {
+    UINT32 pool { UINT32_MAX };
+    UINT32 heap_block { UINT32_MAX };
+    TlsfAllocator::Allocation range;
+
+    bool IsValid() const { return range.IsValid(); }
+};
+
+class ResourceHeapAllocator;
+
+// A placed resource together with the memory it sits in, the memory goes back to the allocator with the resource.
+class PlacedResource {
+public:
+    PlacedResource() = default;
+    PlacedResource(ResourceHeapAllocator* allocator, WRL::ComPtr<ID3D12Resource> resource, const HeapAllocation& allocation);
+    PlacedResource(const PlacedResource&) = delete;
+    PlacedResource(PlacedResource&& other) noexcept;
+    PlacedResource& operator=(const PlacedResource&) = delete;
+    PlacedResource& operator=(PlacedResource&& other) noexcept;
+    ~PlacedResource();
+
+    ID3D12Resource* Get() const { return m_resource.Get(); }
+    ID3D12Resource* operator->() const { return m_resource.Get(); }
+    explicit operator bool() const { return m_resource != nullptr; }
+
+    void Reset();
+
+private:
+    ResourceHeapAllocator* m_allocator { nullptr };
+    WRL::ComPtr<ID3D12Resource> m_resource;
+    HeapAllocation m_allocation;
+};
+
+struct HeapBlockStats {
+    D3D12_HEAP_TYPE heap_type;
+    HeapCategory category;
+    bool dedicated;
+    TlsfAllocator::Stats allocator;
+};
+
+// Carves placed resources out of large ID3D12Heap blocks instead of giving every resource an implicit heap of its own.
+// Blocks are grouped by heap type and category, resources larger than a block get a dedicated heap.
+// Not thread safe, resources are created from the loading thread only.
+class ResourceHeapAllocator {
+public:
+    explicit ResourceHeapAllocator(ID3D12Device* pp_device, UINT64 heap_block_size = RESOURCE_HEAP_BLOCK_SIZE);
+    ResourceHeapAllocator() = delete;
+    ResourceHeapAllocator(const ResourceHeapAllocator&) = delete;
+    ResourceHeapAllocator(ResourceHeapAllocator&&) = delete;
+    ResourceHeapAllocator& operator=(const ResourceHeapAllocator&) = delete;
+    ResourceHeapAllocator& operator=(ResourceHeapAllocator&&) = delete;
+    ~ResourceHeapAllocator() = default;
+
+    // Drop in for CreateCommittedResource. Small textures get the 4 KB placement alignment when the device allows
+    // it, everything else the 64 KB or, for MSAA, the 4 MB one.
+    PlacedResource CreateResource(D3D12_HEAP_TYPE heap_type, const D3D12_RESOURCE_DESC& desc,
+        D3D12_RESOURCE_STATES initial_state, const D3D12_CLEAR_VALUE* clear_value = nullptr);
+
+    // Aliasing of transient resources: reserve memory large enough for the biggest of them (see
+    // GetAllocationInfo) and place each one with CreateAliasedResource. Only one of them may be in use at a time,
+    // the caller issues the aliasing barriers and frees the memory after the aliased resources are released.
+    D3D12_RESOURCE_ALLOCATION_INFO GetAllocationInfo(const D3D12_RESOURCE_DESC& desc) const;
+    HeapAllocation AllocateMemory(D3D12_HEAP_TYPE heap_type, HeapCategory category, const D3D12_RESOURCE_ALLOCATION_INFO& info);
+    WRL::ComPtr<ID3D12Resource> CreateAliasedResource(const HeapAllocation& allocation, const D3D12_RESOURCE_DESC& desc,
+        D3D12_RESOURCE_STATES initial_state, const D3D12_CLEAR_VALUE* clear_value = nullptr);
+    void Free(const HeapAllocation& allocation);
+
+    static HeapCategory GetHeapCategory(const D3D12_RESOURCE_DESC& desc);
+
+    std::vector<HeapBlockStats> GetStats() const;
+    void LogStats() const;
+
+private:
+    struct HeapBlock {
+        WRL::ComPtr<ID3D12Heap> heap;
+        TlsfAllocator allocator;
+        bool dedicated;
+    };
+
+    struct HeapPool {
+        D3D12_HEAP_TYPE heap_type;
+        HeapCategory category;
+        // freed blocks are kept as null entries, so the indices in HeapAllocation stay valid
+        std::vector<std::unique_ptr<HeapBlock>> blocks;
+    };
+
+    UINT32 GetPool(D3D12_HEAP_TYPE heap_type, HeapCategory category);
+    std::unique_ptr<HeapBlock> CreateHeapBlock(const HeapPool& pool, UINT64 size, bool dedicated) const;
+
+private:
+    // Observer pointer of device
+    ID3D12Device* m_pp_device;
+    UINT64 m_heapBlockSize;
+
+    std::vector<HeapPool> m_pools;
+};
+
+}
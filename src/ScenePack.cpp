@@ -0,0 +1,292 @@
+#include "ScenePack.h"
+#include "LoadProfiler.h"
+
+#include <cstring>
+#include <limits>
+
+namespace Anni {
+
+namespace {
+
+    constexpr char SCENE_PACK_MAGIC[4] = { 'A', 'N', 'P', 'K' };
+    // every blob starts aligned, so vertex, index and pixel data can be read in place
+    constexpr size_t SCENE_PACK_BLOB_ALIGNMENT = 16;
+
+    struct ScenePackHeader {
+        char magic[4];
+        UINT32 version;
+        UINT32 sampler_count;
+        UINT32 texture_count;
+        UINT32 material_count;
+        UINT32 mesh_count;
+        UINT32 node_count;
+        UINT32 padding0;
+        // the glTF the pack was cooked from, an edited source makes the pack stale
+        UINT64 source_size;
+        INT64 source_write_time;
+    };
+
+    struct SourceStamp {
+        UINT64 size;
+        INT64 write_time;
+    };
+
+    // size and last write time of the source, both 0 when it can't be read
+    SourceStamp GetSourceStamp(const std::filesystem::path& source_file_path)
+    {
+        std::error_code error;
+        const auto size = std::filesystem::file_size(source_file_path, error);
+        if (error) {
+            return {};
+        }
+        const auto write_time = std::filesystem::last_write_time(source_file_path, error);
+        if (error) {
+            return {};
+        }
+        return { static_cast<UINT64>(size), static_cast<INT64>(write_time.time_since_epoch().count()) };
+    }
+
+    class ScenePackWriter {
+    public:
+        explicit ScenePackWriter(const std::filesystem::path& pack_file_path)
+            : m_file(pack_file_path, std::ios::binary | std::ios::trunc)
+            , m_offset(0)
+        {
+            if (!m_file) {
+                throw std::runtime_error("failed to open scene pack for writing!");
+            }
+        }
+
+        void WriteBytes(const void* data, const size_t size)
+        {
+            m_file.write(static_cast<const char*>(data), static_cast<std::streamsize>(size));
+            if (!m_file) {
+                throw std::runtime_error("failed to write scene pack!");
+            }
+            m_offset += size;
+        }
+
+        template <typename T>
+        void Write(const T& value)
+        {
+            WriteBytes(&value, sizeof(T));
+        }
+
+        void WriteString(const std::string& str)
+        {
+            Write(static_cast<UINT32>(str.size()));
+            WriteBytes(str.data(), str.size());
+        }
+
+        void Align()
+        {
+            constexpr char zeros[SCENE_PACK_BLOB_ALIGNMENT] = {};
+            WriteBytes(zeros, (SCENE_PACK_BLOB_ALIGNMENT - m_offset % SCENE_PACK_BLOB_ALIGNMENT) % SCENE_PACK_BLOB_ALIGNMENT);
+        }
+
+        template <typename T>
+        void WriteBlob(const std::vector<T>& elements)
+        {
+            Write(static_cast<UINT64>(elements.size()));
+            Align();
+            WriteBytes(elements.data(), elements.size() * sizeof(T));
+        }
+
+    private:
+        std::ofstream m_file;
+        size_t m_offset;
+    };
+
+    class ScenePackReader {
+    public:
+        explicit ScenePackReader(const MappedFile& pack_file)
+            : m_data(pack_file.GetData())
+            , m_size(pack_file.GetSize())
+            , m_offset(0)
+        {
+        }
+
+        const std::byte* ReadBytes(const size_t size)
+        {
+            if (size > m_size - m_offset) {
+                throw std::runtime_error("scene pack is truncated!");
+            }
+            const std::byte* bytes = m_data + m_offset;
+            m_offset += size;
+            return bytes;
+        }
+
+        template <typename T>
+        T Read()
+        {
+            T value;
+            memcpy(&value, ReadBytes(sizeof(T)), sizeof(T));
+            return value;
+        }
+
+        std::string ReadString()
+        {
+            const UINT32 size = Read<UINT32>();
+            const std::byte* chars = ReadBytes(size);
+            return std::string(reinterpret_cast<const char*>(chars), size);
+        }
+
+        void Align()
+        {
+            ReadBytes((SCENE_PACK_BLOB_ALIGNMENT - m_offset % SCENE_PACK_BLOB_ALIGNMENT) % SCENE_PACK_BLOB_ALIGNMENT);
+        }
+
+        template <typename T>
+        void ReadBlob(std::vector<T>& elements)
+        {
+            const UINT64 count = Read<UINT64>();
+            if (count > std::numeric_limits<size_t>::max() / sizeof(T)) {
+                throw std::runtime_error("scene pack blob is too large!");
+            }
+            Align();
+            const std::byte* bytes = ReadBytes(count * sizeof(T));
+            elements.resize(count);
+            memcpy(elements.data(), bytes, count * sizeof(T));
+        }
+
+    private:
+        const std::byte* m_data;
+        size_t m_size;
+        size_t m_offset;
+    };
+
+}
+
+void WriteScenePack(const ModelData& model_data, const std::filesystem::path& source_file_path, const std::filesystem::path& pack_file_path)
+{
+    const SourceStamp source_stamp = GetSourceStamp(source_file_path);
+    if (source_stamp.size == 0) {
+        throw std::runtime_error("failed to stat the source of the scene pack!");
+    }
+    ScenePackWriter writer(pack_file_path);
+
+    ScenePackHeader header = {};
+    memcpy(header.magic, SCENE_PACK_MAGIC, sizeof(SCENE_PACK_MAGIC));
+    header.version = SCENE_PACK_VERSION;
+    header.sampler_count = static_cast<UINT32>(model_data.samplers.size());
+    header.texture_count = static_cast<UINT32>(model_data.textures.size());
+    header.material_count = static_cast<UINT32>(model_data.materials.size());
+    header.mesh_count = static_cast<UINT32>(model_data.meshes.size());
+    header.node_count = static_cast<UINT32>(model_data.nodes.size());
+    header.source_size = source_stamp.size;
+    header.source_write_time = source_stamp.write_time;
+    writer.Write(header);
+
+    writer.WriteBlob(model_data.samplers);
+    writer.WriteBlob(model_data.materials);
+
+    for (const TextureData& texture : model_data.textures) {
+        writer.WriteString(texture.name);
+        writer.Write(texture.width);
+        writer.Write(texture.height);
+        writer.Write(texture.mip_levels);
+        writer.Write(texture.format);
+        writer.Write(texture.content_hash);
+        writer.Write(static_cast<UINT32>(texture.subresources.size()));
+        for (const D3D12_SUBRESOURCE_DATA& subresource : texture.subresources) {
+            writer.Write(static_cast<UINT64>(subresource.RowPitch));
+            writer.Write(static_cast<UINT64>(subresource.SlicePitch));
+            writer.Align();
+            writer.WriteBytes(subresource.pData, subresource.SlicePitch);
+        }
+    }
+
+    for (const MeshData& mesh : model_data.meshes) {
+        writer.WriteString(mesh.name);
+        writer.WriteBlob(mesh.surfaces);
+        writer.WriteBlob(mesh.vertices);
+        writer.WriteBlob(mesh.indices);
+        writer.WriteBlob(mesh.meshlets);
+    }
+
+    for (const NodeData& node : model_data.nodes) {
+        writer.Write(node.parent_index);
+        writer.Write(node.mesh_index);
+        writer.Write(node.local_transform);
+        writer.WriteBlob(node.children);
+    }
+}
+
+bool ReadScenePack(const std::filesystem::path& pack_file_path, const std::filesystem::path& source_file_path, ModelData& model_data)
+{
+    const ProfileZone read_zone("ReadScenePack");
+
+    if (!std::filesystem::exists(pack_file_path)) {
+        return false;
+    }
+
+    // a truncated or corrupt pack throws from the reader, it is as stale as one from another version
+    try {
+        // shared by every texture that points into it
+        const auto pack_file = std::make_shared<MappedFile>(pack_file_path);
+        ScenePackReader reader(*pack_file);
+
+        if (pack_file->GetSize() < sizeof(ScenePackHeader)) {
+            std::cerr << "Scene pack " << pack_file_path << " is truncated, cook it again" << '\n';
+            return false;
+        }
+        const auto header = reader.Read<ScenePackHeader>();
+        const SourceStamp source_stamp = GetSourceStamp(source_file_path);
+        if (memcmp(header.magic, SCENE_PACK_MAGIC, sizeof(SCENE_PACK_MAGIC)) != 0 || header.version != SCENE_PACK_VERSION
+            || header.source_size != source_stamp.size || header.source_write_time != source_stamp.write_time) {
+            std::cerr << "Scene pack " << pack_file_path << " is stale, cook it again" << '\n';
+            return false;
+        }
+
+        reader.ReadBlob(model_data.samplers);
+        reader.ReadBlob(model_data.materials);
+        if (model_data.samplers.size() != header.sampler_count || model_data.materials.size() != header.material_count) {
+            std::cerr << "Scene pack " << pack_file_path << " is corrupt, cook it again" << '\n';
+            model_data = ModelData {};
+            return false;
+        }
+
+        model_data.textures.resize(header.texture_count);
+        for (TextureData& texture : model_data.textures) {
+            texture.name = reader.ReadString();
+            texture.width = reader.Read<UINT>();
+            texture.height = reader.Read<UINT>();
+            texture.mip_levels = reader.Read<UINT16>();
+            texture.format = reader.Read<DXGI_FORMAT>();
+            texture.content_hash = reader.Read<UINT64>();
+            texture.subresources.resize(reader.Read<UINT32>());
+            for (D3D12_SUBRESOURCE_DATA& subresource : texture.subresources) {
+                subresource.RowPitch = static_cast<LONG_PTR>(reader.Read<UINT64>());
+                subresource.SlicePitch = static_cast<LONG_PTR>(reader.Read<UINT64>());
+                reader.Align();
+                subresource.pData = reader.ReadBytes(subresource.SlicePitch);
+            }
+            texture.storage = pack_file;
+        }
+
+        model_data.meshes.resize(header.mesh_count);
+        for (MeshData& mesh : model_data.meshes) {
+            mesh.name = reader.ReadString();
+            reader.ReadBlob(mesh.surfaces);
+            reader.ReadBlob(mesh.vertices);
+            reader.ReadBlob(mesh.indices);
+            reader.ReadBlob(mesh.meshlets);
+        }
+
+        model_data.nodes.resize(header.node_count);
+        for (NodeData& node : model_data.nodes) {
+            node.parent_index = reader.Read<INT32>();
+            node.mesh_index = reader.Read<INT32>();
+            node.local_transform = reader.Read<glm::mat4>();
+            reader.ReadBlob(node.children);
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Scene pack " << pack_file_path << " can't be read (" << e.what() << "), cook it again" << '\n';
+        model_data = ModelData {};
+        return false;
+    }
+
+    return true;
+}
+
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include "ModelData.h"
+
+#include <filesystem>
+
+namespace Anni {
+
+// Cooked, GPU ready ModelData. Blobs are stored in the exact layout CreateResources consumes, so loading a pack is
+// a file mapping plus a few copies instead of json parsing, accessor conversion and image decoding.
+// Bump the version whenever ModelData, StandardVertex or MaterialConstants change layout, or the importer output changes.
+constexpr UINT32 SCENE_PACK_VERSION = 11;
+
+// Stamps the pack with the size and last write time of the glTF it was cooked from.
+// Throws std::runtime_error when the file can't be written.
+void WriteScenePack(const ModelData& model_data, const std::filesystem::path& source_file_path, const std::filesystem::path& pack_file_path);
+
+// Returns false when the pack doesn't exist, is truncated or corrupt, was cooked by another version or from another
+// state of the glTF at source_file_path, the caller should import the glTF instead. Texture subresources point
+// straight into the mapped pack, which is kept alive by TextureData::storage.
+bool ReadScenePack(const std::filesystem::path& pack_file_path, const std::filesystem::path& source_file_path, ModelData& model_data);
+
+}
@@ -0,0 +1,200 @@
+#include "StagingRing.h"
+#include "LoadProfiler.h"
+
+#include <algorithm>
+
+namespace Anni {
+
+StagingRing::StagingRing(ID3D12Device* pp_device, ID3D12CommandQueue* pp_copy_queue, ResourceHeapAllocator& heap_allocator,
+    const UINT64 size)
+    : m_pp_device(pp_device)
+    , m_pp_copy_queue(pp_copy_queue)
+    , m_mapped(nullptr)
+    , m_size(size)
+    , m_head(0)
+    , m_used(0)
+    , m_pendingBytes(0)
+    , m_hasPendingCopies(false)
+    , m_fenceValue(0)
+    , m_fenceEvent(nullptr)
+    , m_bytesUploaded(0)
+    , m_submissionCount(0)
+    , m_stallCount(0)
+{
+    m_buffer = heap_allocator.CreateResource(
+        D3D12_HEAP_TYPE_UPLOAD,
+        CD3DX12_RESOURCE_DESC::Buffer(m_size),
+        D3D12_RESOURCE_STATE_GENERIC_READ);
+    m_buffer->SetName(L"Staging Ring");
+
+    // stays mapped for the lifetime of the ring
+    const CD3DX12_RANGE read_range(0, 0); // We do not intend to read from this resource on the CPU.
+    ThrowIfFailed(m_buffer->Map(0, &read_range, reinterpret_cast<void**>(&m_mapped)));
+
+    ThrowIfFailed(m_pp_device->CreateCommandAllocator(
+        D3D12_COMMAND_LIST_TYPE_COPY,
+        IID_PPV_ARGS(m_currentAllocator.ReleaseAndGetAddressOf())));
+    ThrowIfFailed(m_pp_device->CreateCommandList(
+        0, D3D12_COMMAND_LIST_TYPE_COPY, m_currentAllocator.Get(), nullptr,
+        IID_PPV_ARGS(m_commandList.ReleaseAndGetAddressOf())));
+
+    ThrowIfFailed(m_pp_device->CreateFence(m_fenceValue, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(m_fence.ReleaseAndGetAddressOf())));
+    m_fenceEvent = CreateEvent(nullptr, FALSE, FALSE, nullptr);
+    if (!m_fenceEvent) {
+        ThrowIfFailed(HRESULT_FROM_WIN32(GetLastError()));
+    }
+}
+
+StagingRing::~StagingRing()
+{
+    if (!m_inFlight.empty()) {
+        WaitForFence(m_inFlight.back().fence_value);
+    }
+    m_commandList->Close();
+    m_buffer->Unmap(0, nullptr);
+    CloseHandle(m_fenceEvent);
+}
+
+void StagingRing::CopyBuffer(ID3D12Resource* dest, const UINT64 dest_offset, const void* data, const UINT64 size)
+{
+    // smaller chunks let the copy queue start on the first part while the rest is still being written
+    const UINT64 max_chunk = m_size / 4;
+    const UINT8* src = static_cast<const UINT8*>(data);
+
+    for (UINT64 copied = 0; copied < size;) {
+        const UINT64 chunk = std::min(size - copied, max_chunk);
+        const UINT64 offset = Allocate(chunk, 16);
+        memcpy(m_mapped + offset, src + copied, chunk);
+        m_commandList->CopyBufferRegion(dest, dest_offset + copied, m_buffer.Get(), offset, chunk);
+        copied += chunk;
+    }
+    m_bytesUploaded += size;
+}
+
+void StagingRing::CopyTexture(ID3D12Resource* dest, const std::vector<D3D12_SUBRESOURCE_DATA>& subresources)
+{
+    const UINT subresource_count = static_cast<UINT>(subresources.size());
+    const UINT64 chain_size = GetRequiredIntermediateSize(dest, 0, subresource_count);
+
+    if (chain_size <= m_size / 2) {
+        const UINT64 offset = Allocate(chain_size, D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT);
+        if (UpdateSubresources(m_commandList.Get(), dest, m_buffer.Get(), offset, 0, subresource_count, subresources.data()) == 0) {
+            throw std::runtime_error("Failed to stage texture upload");
+        }
+    } else {
+        for (UINT i = 0; i < subresource_count; ++i) {
+            const UINT64 level_size = GetRequiredIntermediateSize(dest, i, 1);
+            if (level_size > m_size) {
+                throw std::runtime_error("Texture level larger than the staging ring");
+            }
+            const UINT64 offset = Allocate(level_size, D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT);
+            if (UpdateSubresources(m_commandList.Get(), dest, m_buffer.Get(), offset, i, 1, &subresources[i]) == 0) {
+                throw std::runtime_error("Failed to stage texture upload");
+            }
+        }
+    }
+    m_bytesUploaded += chain_size;
+}
+
+void StagingRing::Flush()
+{
+    Submit();
+    if (!m_inFlight.empty()) {
+        WaitForFence(m_inFlight.back().fence_value);
+    }
+    RetireCompleted();
+}
+
+void StagingRing::LogStats() const
+{
+    std::cout << "[StagingRing] " << m_bytesUploaded / (1024 * 1024) << " MB uploaded through a "
+              << m_size / (1024 * 1024) << " MB ring in " << m_submissionCount << " submissions, "
+              << m_stallCount << " waits for free space" << '\n';
+}
+
+UINT64 StagingRing::Allocate(const UINT64 size, const UINT64 alignment)
+{
+    assert(size <= m_size);
+
+    for (;;) {
+        RetireCompleted();
+
+        // an empty ring starts over at the front, fewer wraps
+        if (m_used == 0) {
+            m_head = 0;
+        }
+
+        UINT64 offset = (m_head + alignment - 1) & ~(alignment - 1);
+        UINT64 needed = offset + size - m_head;
+        if (offset + size > m_size) {
+            // wrap, the tail end of the ring is skipped
+            offset = 0;
+            needed = m_size - m_head + size;
+        }
+
+        if (m_used + needed <= m_size) {
+            m_head = offset + size;
+            m_used += needed;
+            m_pendingBytes += needed;
+            m_hasPendingCopies = true;
+            return offset;
+        }
+
+        // full: hand the recorded copies to the GPU and wait for the oldest ones
+        Submit();
+        ++m_stallCount;
+        WaitForFence(m_inFlight.front().fence_value);
+    }
+}
+
+void StagingRing::Submit()
+{
+    if (!m_hasPendingCopies) {
+        return;
+    }
+
+    ThrowIfFailed(m_commandList->Close());
+    ID3D12CommandList* lists[] = { m_commandList.Get() };
+    m_pp_copy_queue->ExecuteCommandLists(1, lists);
+    ThrowIfFailed(m_pp_copy_queue->Signal(m_fence.Get(), ++m_fenceValue));
+
+    m_inFlight.push_back({ m_fenceValue, m_pendingBytes, std::move(m_currentAllocator) });
+    m_pendingBytes = 0;
+    m_hasPendingCopies = false;
+    ++m_submissionCount;
+
+    // reopen on an allocator the GPU is done with
+    RetireCompleted();
+    if (!m_freeAllocators.empty()) {
+        m_currentAllocator = std::move(m_freeAllocators.back());
+        m_freeAllocators.pop_back();
+        ThrowIfFailed(m_currentAllocator->Reset());
+    } else {
+        ThrowIfFailed(m_pp_device->CreateCommandAllocator(
+            D3D12_COMMAND_LIST_TYPE_COPY,
+            IID_PPV_ARGS(m_currentAllocator.ReleaseAndGetAddressOf())));
+    }
+    ThrowIfFailed(m_commandList->Reset(m_currentAllocator.Get(), nullptr));
+}
+
+void StagingRing::RetireCompleted()
+{
+    const UINT64 completed = m_fence->GetCompletedValue();
+    while (!m_inFlight.empty() && m_inFlight.front().fence_value <= completed) {
+        m_used -= m_inFlight.front().bytes;
+        m_freeAllocators.push_back(std::move(m_inFlight.front().allocator));
+        m_inFlight.pop_front();
+    }
+}
+
+void StagingRing::WaitForFence(const UINT64 fence_value)
+{
+    if (m_fence->GetCompletedValue() < fence_value) {
+        // the loader blocking on the copy queue, either for ring space or in Flush
+        const ProfileZone wait_zone("WaitCopyQueue");
+        ThrowIfFailed(m_fence->SetEventOnCompletion(fence_value, m_fenceEvent));
+        WaitForSingleObject(m_fenceEvent, INFINITE);
+    }
+}
+
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include "AnniUtils.h"
+#include "ResourceHeapAllocator.h"
+
+#include <deque>
+
+namespace Anni {
+
+// Fixed size, persistently mapped upload buffer used as a ring for loading. Copies are recorded on a command list
+// owned by the ring. When the ring runs out of space, the recorded copies are submitted to the copy queue and the
+// oldest submissions are waited for, so loading a scene needs a bounded amount of upload memory instead of one
+// upload buffer per resource. The caller can drop its CPU copy of the data as soon as a Copy call returns.
+class StagingRing {
+public:
+    StagingRing(ID3D12Device* pp_device, ID3D12CommandQueue* pp_copy_queue, ResourceHeapAllocator& heap_allocator,
+        UINT64 size = STAGING_RING_SIZE);
+    StagingRing() = delete;
+    StagingRing(const StagingRing&) = delete;
+    StagingRing(StagingRing&&) = delete;
+    StagingRing& operator=(const StagingRing&) = delete;
+    StagingRing& operator=(StagingRing&&) = delete;
+    // Waits for everything submitted, never destroy the ring with copies still in flight.
+    ~StagingRing();
+
+    // Buffers are copied in chunks of at most a quarter of the ring.
+    void CopyBuffer(ID3D12Resource* dest, UINT64 dest_offset, const void* data, UINT64 size);
+    // One subresource per entry. Whole mip chains go in one piece when they take at most half the ring, otherwise
+    // level by level.
+    void CopyTexture(ID3D12Resource* dest, const std::vector<D3D12_SUBRESOURCE_DATA>& subresources);
+
+    // Submits the recorded copies and blocks until the copy queue finished all of them.
+    void Flush();
+
+    void LogStats() const;
+
+private:
+    // one ExecuteCommandLists worth of copies
+    struct Submission {
+        UINT64 fence_value;
+        // ring space it occupies, alignment and wrap padding included
+        UINT64 bytes;
+        WRL::ComPtr<ID3D12CommandAllocator> allocator;
+    };
+
+    // Reserves size bytes at an aligned offset, submitting and waiting when the ring is full.
+    UINT64 Allocate(UINT64 size, UINT64 alignment);
+    void Submit();
+    void RetireCompleted();
+    void WaitForFence(UINT64 fence_value);
+
+private:
+    // Observer pointers
+    ID3D12Device* m_pp_device;
+    ID3D12CommandQueue* m_pp_copy_queue;
+
+    PlacedResource m_buffer;
+    UINT8* m_mapped;
+    UINT64 m_size;
+
+    // next write position and bytes between the oldest unretired copy and m_head
+    UINT64 m_head;
+    UINT64 m_used;
+    // ring space taken by copies recorded since the last submit
+    UINT64 m_pendingBytes;
+    bool m_hasPendingCopies;
+
+    WRL::ComPtr<ID3D12GraphicsCommandList> m_commandList;
+    WRL::ComPtr<ID3D12CommandAllocator> m_currentAllocator;
+    std::vector<WRL::ComPtr<ID3D12CommandAllocator>> m_freeAllocators;
+    std::deque<Submission> m_inFlight;
+
+    WRL::ComPtr<ID3D12Fence> m_fence;
+    UINT64 m_fenceValue;
+    HANDLE m_fenceEvent;
+
+    // stats
+    UINT64 m_bytesUploaded;
+    UINT32 m_submissionCount;
+    UINT32 m_stallCount;
+};
+
+}
@@ -0,0 +1,73 @@
+#include "TextureCache.h"
+
+#include <codecvt>
+
+namespace Anni {
+
+size_t TextureCache::KeyHash::operator()(const Key& key) const
+{
+    // the content hash already covers the pixels, the description only separates equal bytes in other shapes
+    return static_cast<size_t>(key.content_hash ^ (static_cast<UINT64>(key.width) << 32) ^ key.height
+        ^ (static_cast<UINT64>(key.mip_levels) << 48) ^ (static_cast<UINT64>(key.format) << 16));
+}
+
+TextureCache::TextureCache(ResourceHeapAllocator& heap_allocator)
+    : m_heapAllocator(&heap_allocator)
+{
+}
+
+ID3D12Resource* TextureCache::Acquire(const TextureData& texture, StagingRing& staging_ring, bool& created)
+{
+    created = false;
+    // images that failed to decode get a null SRV
+    if (texture.subresources.empty()) {
+        return nullptr;
+    }
+    ++m_stats.requests;
+
+    const Key key { texture.content_hash, texture.width, texture.height, texture.mip_levels, texture.format };
+    if (const auto it = m_textures.find(key); it != m_textures.end()) {
+        ++m_stats.shared;
+        for (const D3D12_SUBRESOURCE_DATA& subresource : texture.subresources) {
+            m_stats.bytes_shared += subresource.SlicePitch;
+        }
+        return it->second.Get();
+    }
+
+    constexpr UINT16 depth_or_array_size = 1;
+    const CD3DX12_RESOURCE_DESC tex_desc(
+        D3D12_RESOURCE_DIMENSION_TEXTURE2D, 0, texture.width,
+        texture.height, depth_or_array_size, texture.mip_levels,
+        texture.format, 1, 0, D3D12_TEXTURE_LAYOUT_UNKNOWN,
+        D3D12_RESOURCE_FLAG_NONE);
+
+    PlacedResource resource = m_heapAllocator->CreateResource(
+        D3D12_HEAP_TYPE_DEFAULT, tex_desc,
+        D3D12_RESOURCE_STATE_COPY_DEST);
+
+    // Convert std::string to std::wstring
+    std::wstring_convert<std::codecvt_utf8<wchar_t>> converter;
+    const std::wstring wide_string = converter.from_bytes(texture.name);
+    resource->SetName(wide_string.c_str());
+
+    staging_ring.CopyTexture(resource.Get(), texture.subresources);
+
+    ID3D12Resource* result = resource.Get();
+    m_textures.emplace(key, std::move(resource));
+    ++m_stats.textures;
+    created = true;
+    return result;
+}
+
+TextureCacheStats TextureCache::GetStats() const
+{
+    return m_stats;
+}
+
+void TextureCache::LogStats() const
+{
+    std::cout << "[TextureCache] " << m_stats.textures << " textures for " << m_stats.requests << " requests, "
+              << m_stats.shared << " shared between models (" << m_stats.bytes_shared / 1024 << " KB not uploaded again)" << '\n';
+}
+
+}
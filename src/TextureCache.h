@@ -0,0 +1,63 @@
+#pragma once
+
+#include "AnniUtils.h"
+#include "ModelData.h"
+#include "ResourceHeapAllocator.h"
+#include "StagingRing.h"
+
+#include <unordered_map>
+
+namespace Anni {
+
+struct TextureCacheStats {
+    UINT32 requests { 0 };
+    UINT32 textures { 0 };
+    // requests served by a texture another request created
+    UINT32 shared { 0 };
+    UINT64 bytes_shared { 0 };
+};
+
+// Textures of every model of a renderer, keyed by content (TextureData::content_hash and the resource description).
+// Identical images in different models are created and uploaded once. The cache owns the textures, models keep
+// observer pointers and must not outlive it.
+class TextureCache {
+public:
+    explicit TextureCache(ResourceHeapAllocator& heap_allocator);
+    TextureCache() = delete;
+    TextureCache(const TextureCache&) = delete;
+    TextureCache(TextureCache&&) = delete;
+    TextureCache& operator=(const TextureCache&) = delete;
+    TextureCache& operator=(TextureCache&&) = delete;
+    ~TextureCache() = default;
+
+    // Returns the texture with the content of texture, nullptr when it failed to decode. The first request creates it
+    // in COPY_DEST and records its upload on staging_ring, created is true for that request only and the caller
+    // transitions the texture once the copy queue is done.
+    ID3D12Resource* Acquire(const TextureData& texture, StagingRing& staging_ring, bool& created);
+
+    TextureCacheStats GetStats() const;
+    void LogStats() const;
+
+private:
+    struct Key {
+        UINT64 content_hash;
+        UINT width;
+        UINT height;
+        UINT16 mip_levels;
+        DXGI_FORMAT format;
+
+        bool operator==(const Key&) const = default;
+    };
+
+    struct KeyHash {
+        size_t operator()(const Key& key) const;
+    };
+
+    // Outlives the cache (observer pointer)
+    ResourceHeapAllocator* m_heapAllocator;
+
+    std::unordered_map<Key, PlacedResource, KeyHash> m_textures;
+    TextureCacheStats m_stats;
+};
+
+}
@@ -0,0 +1,378 @@
+#include "TextureContainer.h"
+
+#include <zstd.h>
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+namespace Anni {
+
+namespace {
+
+    constexpr uint8_t KTX2_IDENTIFIER[12] { 0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n' };
+
+    constexpr uint32_t FourCC(const char a, const char b, const char c, const char d)
+    {
+        return static_cast<uint32_t>(a) | static_cast<uint32_t>(b) << 8 | static_cast<uint32_t>(c) << 16 | static_cast<uint32_t>(d) << 24;
+    }
+
+    // Unaligned little endian read, offset + sizeof(T) must be within the data.
+    template <typename T>
+    T ReadAt(const std::byte* data, const size_t offset)
+    {
+        T value;
+        memcpy(&value, data + offset, sizeof(T));
+        return value;
+    }
+
+    DXGI_FORMAT ToUnorm(const DXGI_FORMAT format)
+    {
+        switch (format) {
+        case DXGI_FORMAT_BC1_UNORM_SRGB:
+            return DXGI_FORMAT_BC1_UNORM;
+        case DXGI_FORMAT_BC2_UNORM_SRGB:
+            return DXGI_FORMAT_BC2_UNORM;
+        case DXGI_FORMAT_BC3_UNORM_SRGB:
+            return DXGI_FORMAT_BC3_UNORM;
+        case DXGI_FORMAT_BC7_UNORM_SRGB:
+            return DXGI_FORMAT_BC7_UNORM;
+        case DXGI_FORMAT_R8G8B8A8_UNORM_SRGB:
+            return DXGI_FORMAT_R8G8B8A8_UNORM;
+        default:
+            return format;
+        }
+    }
+
+    // Bytes per 4x4 block, 0 for the formats that are not block compressed.
+    UINT BytesPerBlock(const DXGI_FORMAT format)
+    {
+        switch (format) {
+        case DXGI_FORMAT_BC1_UNORM:
+        case DXGI_FORMAT_BC4_UNORM:
+        case DXGI_FORMAT_BC4_SNORM:
+            return 8;
+        case DXGI_FORMAT_BC2_UNORM:
+        case DXGI_FORMAT_BC3_UNORM:
+        case DXGI_FORMAT_BC5_UNORM:
+        case DXGI_FORMAT_BC5_SNORM:
+        case DXGI_FORMAT_BC6H_UF16:
+        case DXGI_FORMAT_BC6H_SF16:
+        case DXGI_FORMAT_BC7_UNORM:
+            return 16;
+        default:
+            return 0;
+        }
+    }
+
+    bool IsSupportedFormat(const DXGI_FORMAT format)
+    {
+        return BytesPerBlock(format) != 0 || format == DXGI_FORMAT_R8G8B8A8_UNORM;
+    }
+
+    D3D12_SUBRESOURCE_DATA GetLevelLayout(const UINT width, const UINT height, const DXGI_FORMAT format)
+    {
+        D3D12_SUBRESOURCE_DATA level {};
+        if (const UINT block_bytes = BytesPerBlock(format); block_bytes != 0) {
+            level.RowPitch = static_cast<LONG_PTR>(std::max(1u, (width + 3) / 4)) * block_bytes;
+            level.SlicePitch = level.RowPitch * std::max(1u, (height + 3) / 4);
+        } else {
+            level.RowPitch = static_cast<LONG_PTR>(width) * 4;
+            level.SlicePitch = level.RowPitch * height;
+        }
+        return level;
+    }
+
+    // Checks the description and sizes the subresources, their data is set by the caller.
+    bool SetDescription(const UINT width, const UINT height, const UINT mip_levels, const DXGI_FORMAT format,
+        TextureData& texture, std::string& error)
+    {
+        if (width == 0 || height == 0 || width > D3D12_REQ_TEXTURE2D_U_OR_V_DIMENSION || height > D3D12_REQ_TEXTURE2D_U_OR_V_DIMENSION) {
+            error = "unsupported size " + std::to_string(width) + "x" + std::to_string(height);
+            return false;
+        }
+        if (!IsSupportedFormat(format)) {
+            error = "unsupported format " + std::to_string(format);
+            return false;
+        }
+        // D3D12 only creates block compressed textures whose base level is made of whole 4x4 blocks
+        if (BytesPerBlock(format) != 0 && (width % 4 != 0 || height % 4 != 0)) {
+            error = "block compressed size " + std::to_string(width) + "x" + std::to_string(height) + " is not a multiple of 4";
+            return false;
+        }
+        const UINT full_chain = static_cast<UINT>(std::bit_width(std::max(width, height)));
+        if (mip_levels == 0 || mip_levels > full_chain) {
+            error = "invalid mip count " + std::to_string(mip_levels);
+            return false;
+        }
+
+        texture.width = width;
+        texture.height = height;
+        texture.mip_levels = static_cast<UINT16>(mip_levels);
+        texture.format = format;
+        texture.subresources.resize(mip_levels);
+        for (UINT level = 0; level < mip_levels; ++level) {
+            texture.subresources[level] = GetLevelLayout(std::max(1u, width >> level), std::max(1u, height >> level), format);
+        }
+        return true;
+    }
+
+    //> dds
+    bool ParseDds(const std::byte* data, const size_t size, TextureData& texture, std::string& error)
+    {
+        // magic, DDS_HEADER
+        constexpr size_t header_size = 4 + 124;
+        constexpr uint32_t DDSD_MIPMAPCOUNT = 0x20000;
+        constexpr uint32_t DDPF_FOURCC = 0x4;
+        constexpr uint32_t DDPF_RGB = 0x40;
+        constexpr uint32_t DDSCAPS2_CUBEMAP = 0x200;
+        constexpr uint32_t DDSCAPS2_VOLUME = 0x200000;
+        if (size < header_size) {
+            error = "truncated DDS header";
+            return false;
+        }
+
+        const uint32_t flags = ReadAt<uint32_t>(data, 8);
+        const uint32_t height = ReadAt<uint32_t>(data, 12);
+        const uint32_t width = ReadAt<uint32_t>(data, 16);
+        const uint32_t mip_map_count = ReadAt<uint32_t>(data, 28);
+        const uint32_t pixel_flags = ReadAt<uint32_t>(data, 80);
+        const uint32_t four_cc = ReadAt<uint32_t>(data, 84);
+        const uint32_t caps2 = ReadAt<uint32_t>(data, 112);
+        if (caps2 & (DDSCAPS2_CUBEMAP | DDSCAPS2_VOLUME)) {
+            error = "DDS cube maps and volumes are not supported";
+            return false;
+        }
+
+        size_t offset = header_size;
+        DXGI_FORMAT format = DXGI_FORMAT_UNKNOWN;
+        if (pixel_flags & DDPF_FOURCC) {
+            switch (four_cc) {
+            case FourCC('D', 'X', 'T', '1'):
+                format = DXGI_FORMAT_BC1_UNORM;
+                break;
+            case FourCC('D', 'X', 'T', '2'):
+            case FourCC('D', 'X', 'T', '3'):
+                format = DXGI_FORMAT_BC2_UNORM;
+                break;
+            case FourCC('D', 'X', 'T', '4'):
+            case FourCC('D', 'X', 'T', '5'):
+                format = DXGI_FORMAT_BC3_UNORM;
+                break;
+            case FourCC('A', 'T', 'I', '1'):
+            case FourCC('B', 'C', '4', 'U'):
+                format = DXGI_FORMAT_BC4_UNORM;
+                break;
+            case FourCC('B', 'C', '4', 'S'):
+                format = DXGI_FORMAT_BC4_SNORM;
+                break;
+            case FourCC('A', 'T', 'I', '2'):
+            case FourCC('B', 'C', '5', 'U'):
+                format = DXGI_FORMAT_BC5_UNORM;
+                break;
+            case FourCC('B', 'C', '5', 'S'):
+                format = DXGI_FORMAT_BC5_SNORM;
+                break;
+            case FourCC('D', 'X', '1', '0'): {
+                // DDS_HEADER_DXT10
+                if (size < header_size + 20) {
+                    error = "truncated DDS DX10 header";
+                    return false;
+                }
+                constexpr uint32_t DDS_DIMENSION_TEXTURE2D = 3;
+                constexpr uint32_t DDS_RESOURCE_MISC_TEXTURECUBE = 0x4;
+                if (ReadAt<uint32_t>(data, header_size + 4) != DDS_DIMENSION_TEXTURE2D
+                    || (ReadAt<uint32_t>(data, header_size + 8) & DDS_RESOURCE_MISC_TEXTURECUBE)
+                    || ReadAt<uint32_t>(data, header_size + 12) > 1) {
+                    error = "only single 2D DDS textures are supported";
+                    return false;
+                }
+                format = static_cast<DXGI_FORMAT>(ReadAt<uint32_t>(data, header_size));
+                offset += 20;
+                break;
+            }
+            default:
+                break;
+            }
+        } else if ((pixel_flags & DDPF_RGB) && ReadAt<uint32_t>(data, 88) == 32
+            && ReadAt<uint32_t>(data, 92) == 0x000000FF && ReadAt<uint32_t>(data, 96) == 0x0000FF00
+            && ReadAt<uint32_t>(data, 100) == 0x00FF0000 && ReadAt<uint32_t>(data, 104) == 0xFF000000) {
+            format = DXGI_FORMAT_R8G8B8A8_UNORM;
+        }
+
+        const UINT mip_levels = (flags & DDSD_MIPMAPCOUNT) ? std::max(1u, mip_map_count) : 1;
+        if (!SetDescription(width, height, mip_levels, ToUnorm(format), texture, error)) {
+            return false;
+        }
+
+        // the levels follow the header tightly packed, largest first
+        for (D3D12_SUBRESOURCE_DATA& level : texture.subresources) {
+            if (offset + level.SlicePitch > size) {
+                error = "truncated DDS data";
+                return false;
+            }
+            level.pData = data + offset;
+            offset += level.SlicePitch;
+        }
+        return true;
+    }
+    //< dds
+
+    //> ktx2
+    DXGI_FORMAT VkFormatToDxgi(const uint32_t vk_format)
+    {
+        switch (vk_format) {
+        case 37: // VK_FORMAT_R8G8B8A8_UNORM
+        case 43: // VK_FORMAT_R8G8B8A8_SRGB
+            return DXGI_FORMAT_R8G8B8A8_UNORM;
+        case 131: // VK_FORMAT_BC1_RGB_UNORM_BLOCK
+        case 132: // VK_FORMAT_BC1_RGB_SRGB_BLOCK
+        case 133: // VK_FORMAT_BC1_RGBA_UNORM_BLOCK
+        case 134: // VK_FORMAT_BC1_RGBA_SRGB_BLOCK
+            return DXGI_FORMAT_BC1_UNORM;
+        case 135: // VK_FORMAT_BC2_UNORM_BLOCK
+        case 136: // VK_FORMAT_BC2_SRGB_BLOCK
+            return DXGI_FORMAT_BC2_UNORM;
+        case 137: // VK_FORMAT_BC3_UNORM_BLOCK
+        case 138: // VK_FORMAT_BC3_SRGB_BLOCK
+            return DXGI_FORMAT_BC3_UNORM;
+        case 139: // VK_FORMAT_BC4_UNORM_BLOCK
+            return DXGI_FORMAT_BC4_UNORM;
+        case 140: // VK_FORMAT_BC4_SNORM_BLOCK
+            return DXGI_FORMAT_BC4_SNORM;
+        case 141: // VK_FORMAT_BC5_UNORM_BLOCK
+            return DXGI_FORMAT_BC5_UNORM;
+        case 142: // VK_FORMAT_BC5_SNORM_BLOCK
+            return DXGI_FORMAT_BC5_SNORM;
+        case 143: // VK_FORMAT_BC6H_UFLOAT_BLOCK
+            return DXGI_FORMAT_BC6H_UF16;
+        case 144: // VK_FORMAT_BC6H_SFLOAT_BLOCK
+            return DXGI_FORMAT_BC6H_SF16;
+        case 145: // VK_FORMAT_BC7_UNORM_BLOCK
+        case 146: // VK_FORMAT_BC7_SRGB_BLOCK
+            return DXGI_FORMAT_BC7_UNORM;
+        default:
+            return DXGI_FORMAT_UNKNOWN;
+        }
+    }
+
+    bool ParseKtx2(const std::byte* data, const size_t size, TextureData& texture, std::string& error)
+    {
+        // identifier, header, index
+        constexpr size_t header_size = 80;
+        constexpr size_t level_index_entry_size = 24;
+        if (size < header_size) {
+            error = "truncated KTX2 header";
+            return false;
+        }
+
+        const uint32_t vk_format = ReadAt<uint32_t>(data, 12);
+        const uint32_t width = ReadAt<uint32_t>(data, 20);
+        const uint32_t height = ReadAt<uint32_t>(data, 24);
+        const uint32_t depth = ReadAt<uint32_t>(data, 28);
+        const uint32_t layer_count = ReadAt<uint32_t>(data, 32);
+        const uint32_t face_count = ReadAt<uint32_t>(data, 36);
+        const uint32_t level_count = std::max(1u, ReadAt<uint32_t>(data, 40));
+        const uint32_t supercompression_scheme = ReadAt<uint32_t>(data, 44);
+
+        constexpr uint32_t SUPERCOMPRESSION_BASIS_LZ = 1;
+        constexpr uint32_t SUPERCOMPRESSION_ZSTD = 2;
+        if (supercompression_scheme != 0 && supercompression_scheme != SUPERCOMPRESSION_ZSTD) {
+            error = supercompression_scheme == SUPERCOMPRESSION_BASIS_LZ ? "KTX2 BasisLZ supercompression needs a transcoder"
+                                                                         : "KTX2 supercompression scheme " + std::to_string(supercompression_scheme) + " is not supported";
+            return false;
+        }
+        if (vk_format == 0) {
+            error = "KTX2 Basis Universal payloads need a transcoder";
+            return false;
+        }
+        if (depth > 1 || layer_count > 1 || face_count != 1) {
+            error = "only single 2D KTX2 textures are supported";
+            return false;
+        }
+        if (size < header_size + level_count * level_index_entry_size) {
+            error = "truncated KTX2 level index";
+            return false;
+        }
+
+        if (!SetDescription(width, height, level_count, VkFormatToDxgi(vk_format), texture, error)) {
+            return false;
+        }
+
+        // zstd levels are inflated into one block the texture owns, the others stay in the file
+        std::shared_ptr<std::vector<std::byte>> inflated;
+        std::unique_ptr<ZSTD_DCtx, decltype(&ZSTD_freeDCtx)> zstd_context(nullptr, &ZSTD_freeDCtx);
+        if (supercompression_scheme == SUPERCOMPRESSION_ZSTD) {
+            size_t inflated_size = 0;
+            for (const D3D12_SUBRESOURCE_DATA& subresource : texture.subresources) {
+                inflated_size += subresource.SlicePitch;
+            }
+            inflated = std::make_shared<std::vector<std::byte>>(inflated_size);
+            zstd_context.reset(ZSTD_createDCtx());
+            if (!zstd_context) {
+                error = "failed to create a zstd context";
+                return false;
+            }
+        }
+
+        // level 0 is the base level, each one at its own offset
+        size_t inflated_offset = 0;
+        for (uint32_t level = 0; level < level_count; ++level) {
+            const size_t entry = header_size + level * level_index_entry_size;
+            const uint64_t byte_offset = ReadAt<uint64_t>(data, entry);
+            const uint64_t byte_length = ReadAt<uint64_t>(data, entry + 8);
+            const uint64_t uncompressed_byte_length = ReadAt<uint64_t>(data, entry + 16);
+            D3D12_SUBRESOURCE_DATA& subresource = texture.subresources[level];
+            const uint64_t level_size = inflated ? uncompressed_byte_length : byte_length;
+            if (level_size != static_cast<uint64_t>(subresource.SlicePitch) || byte_offset > size || byte_length > size - byte_offset) {
+                error = "KTX2 level " + std::to_string(level) + " does not match its format";
+                return false;
+            }
+            if (!inflated) {
+                subresource.pData = data + byte_offset;
+                continue;
+            }
+
+            std::byte* level_data = inflated->data() + inflated_offset;
+            const size_t inflated_length = ZSTD_decompressDCtx(zstd_context.get(), level_data, subresource.SlicePitch, data + byte_offset, byte_length);
+            if (ZSTD_isError(inflated_length)) {
+                error = "KTX2 level " + std::to_string(level) + " failed to inflate: " + ZSTD_getErrorName(inflated_length);
+                return false;
+            }
+            if (inflated_length != static_cast<size_t>(subresource.SlicePitch)) {
+                error = "KTX2 level " + std::to_string(level) + " inflated to " + std::to_string(inflated_length) + " bytes instead of " + std::to_string(subresource.SlicePitch);
+                return false;
+            }
+            subresource.pData = level_data;
+            inflated_offset += subresource.SlicePitch;
+        }
+        texture.storage = std::move(inflated);
+        return true;
+    }
+    //< ktx2
+
+}
+
+bool IsTextureContainer(const std::byte* data, const size_t size)
+{
+    return (size >= sizeof(KTX2_IDENTIFIER) && memcmp(data, KTX2_IDENTIFIER, sizeof(KTX2_IDENTIFIER)) == 0)
+        || (size >= 4 && ReadAt<uint32_t>(data, 0) == FourCC('D', 'D', 'S', ' '));
+}
+
+bool ParseTextureContainer(const std::byte* data, const size_t size, TextureData& texture, std::string& error)
+{
+    texture.subresources.clear();
+    texture.storage.reset();
+    const bool parsed = size >= 4 && ReadAt<uint32_t>(data, 0) == FourCC('D', 'D', 'S', ' ')
+        ? ParseDds(data, size, texture, error)
+        : ParseKtx2(data, size, texture, error);
+    if (!parsed) {
+        texture.subresources.clear();
+        texture.storage.reset();
+    }
+    return parsed;
+}
+
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include "ModelData.h"
+
+#include <cstddef>
+#include <string>
+
+namespace Anni {
+
+// DDS and KTX2 files prepared offline already hold the compressed mip chain the GPU samples, their levels are handed
+// to the upload as they are in the file, without decoding a pixel. KTX2 levels supercompressed with zstd are only
+// inflated back to their blocks.
+
+// Checks the magic bytes only.
+bool IsTextureContainer(const std::byte* data, size_t size);
+
+// Fills width, height, mip_levels, format and one subresource per level pointing into data, the caller keeps data
+// alive through texture.storage. Zstd supercompressed levels point into an inflated copy that is already set as
+// texture.storage instead. Only 2D textures in R8G8B8A8, or in BC1 to BC7 with a base level of whole 4x4 blocks,
+// are accepted. Anything else, KTX2 with Basis Universal supercompression included, returns false with the reason
+// in error.
+// sRGB formats are loaded as their UNORM twins, like the textures the importer compresses itself.
+bool ParseTextureContainer(const std::byte* data, size_t size, TextureData& texture, std::string& error);
+
+}
@@ -0,0 +1,109 @@
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <latch>
+
+namespace Anni {
+
+ThreadPool::ThreadPool(const uint32_t thread_count)
+    : m_stop(false)
+{
+    uint32_t total_threads = thread_count;
+    if (total_threads == 0) {
+        total_threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    // the caller of ParallelFor is one of the threads
+    m_workers.reserve(total_threads - 1);
+    for (uint32_t i = 1; i < total_threads; ++i) {
+        m_workers.emplace_back(&ThreadPool::WorkerLoop, this);
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard lock(m_mutex);
+        m_stop = true;
+    }
+    m_cv.notify_all();
+
+    for (auto& worker : m_workers) {
+        worker.join();
+    }
+}
+
+uint32_t ThreadPool::GetThreadCount() const
+{
+    return static_cast<uint32_t>(m_workers.size()) + 1;
+}
+
+void ThreadPool::WorkerLoop()
+{
+    for (;;) {
+        std::function<void()> task;
+        {
+            std::unique_lock lock(m_mutex);
+            m_cv.wait(lock, [this] { return m_stop || !m_tasks.empty(); });
+            if (m_stop && m_tasks.empty()) {
+                return;
+            }
+            task = std::move(m_tasks.front());
+            m_tasks.pop_front();
+        }
+        task();
+    }
+}
+
+void ThreadPool::ParallelFor(const size_t count, const std::function<void(size_t)>& job)
+{
+    if (count == 0) {
+        return;
+    }
+
+    std::atomic<size_t> next_index { 0 };
+    std::exception_ptr first_exception;
+    std::mutex exception_mutex;
+
+    // every participating thread pulls indices until the range is exhausted
+    const auto drain = [&]() {
+        for (size_t i = next_index.fetch_add(1); i < count; i = next_index.fetch_add(1)) {
+            try {
+                job(i);
+            } catch (...) {
+                std::lock_guard lock(exception_mutex);
+                if (!first_exception) {
+                    first_exception = std::current_exception();
+                }
+            }
+        }
+    };
+
+    const size_t helper_count = std::min(m_workers.size(), count - 1);
+
+    // the helpers reference locals of this frame, so we must not return before all of them are done
+    std::latch helpers_done(static_cast<std::ptrdiff_t>(helper_count));
+    if (helper_count > 0) {
+        {
+            std::lock_guard lock(m_mutex);
+            for (size_t i = 0; i < helper_count; ++i) {
+                m_tasks.emplace_back([&drain, &helpers_done]() {
+                    drain();
+                    helpers_done.count_down();
+                });
+            }
+        }
+        m_cv.notify_all();
+    }
+
+    drain();
+    helpers_done.wait();
+
+    if (first_exception) {
+        std::rethrow_exception(first_exception);
+    }
+}
+
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Anni {
+
+// Fixed-size worker pool used by the asset import path.
+// The thread calling ParallelFor always takes part in the work, so a pool created with
+// thread_count == 1 has no workers at all and runs every job serially on the caller.
+class ThreadPool {
+public:
+    // thread_count == 0 means one thread per hardware thread.
+    explicit ThreadPool(uint32_t thread_count = 0);
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool(ThreadPool&&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+    ThreadPool& operator=(ThreadPool&&) = delete;
+    ~ThreadPool();
+
+    // Runs job(i) for every i in [0, count) and blocks until all of them are done.
+    // Jobs are handed out in increasing index order; the first exception thrown by a job is rethrown here.
+    void ParallelFor(size_t count, const std::function<void(size_t)>& job);
+
+    // Number of threads doing work inside ParallelFor, including the calling thread.
+    uint32_t GetThreadCount() const;
+
+private:
+    void WorkerLoop();
+
+private:
+    std::vector<std::thread> m_workers;
+
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    std::deque<std::function<void()>> m_tasks;
+    bool m_stop;
+};
+
+}
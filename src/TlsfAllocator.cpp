@@ -0,0 +1,263 @@
+#include "TlsfAllocator.h"
+
+#include <algorithm>
+#include <bit>
+#include <cassert>
+
+namespace Anni {
+
+TlsfAllocator::TlsfAllocator(const uint64_t size, const uint64_t granularity)
+    : m_granularity(granularity)
+    , m_granularityLog2(static_cast<uint32_t>(std::countr_zero(granularity)))
+    , m_size(size / granularity)
+    , m_used(0)
+    , m_allocationCount(0)
+    , m_flBitmap(0)
+{
+    assert(std::has_single_bit(granularity));
+    assert(m_size > 0);
+
+    std::fill(std::begin(m_slBitmap), std::end(m_slBitmap), 0u);
+    for (auto& heads : m_freeHeads) {
+        std::fill(std::begin(heads), std::end(heads), INVALID_BLOCK);
+    }
+
+    // block 0 always starts at offset 0: merges only ever remove the later block
+    InsertFree(NewBlock(0, m_size));
+}
+
+void TlsfAllocator::MapSize(const uint64_t size, uint32_t& fl, uint32_t& sl)
+{
+    if (size < SL_COUNT) {
+        // the first level is linear, one list per size
+        fl = 0;
+        sl = static_cast<uint32_t>(size);
+        return;
+    }
+    const uint32_t msb = static_cast<uint32_t>(std::bit_width(size)) - 1;
+    sl = static_cast<uint32_t>(size >> (msb - SL_LOG2)) - SL_COUNT;
+    fl = msb - SL_LOG2 + 1;
+}
+
+uint32_t TlsfAllocator::NewBlock(const uint64_t offset, const uint64_t size)
+{
+    uint32_t index;
+    if (!m_unusedBlocks.empty()) {
+        index = m_unusedBlocks.back();
+        m_unusedBlocks.pop_back();
+    } else {
+        index = static_cast<uint32_t>(m_blocks.size());
+        m_blocks.emplace_back();
+    }
+
+    Block& block = m_blocks[index];
+    block.offset = offset;
+    block.size = size;
+    block.free = true;
+    block.prev_physical = INVALID_BLOCK;
+    block.next_physical = INVALID_BLOCK;
+    block.prev_free = INVALID_BLOCK;
+    block.next_free = INVALID_BLOCK;
+    return index;
+}
+
+void TlsfAllocator::DeleteBlock(const uint32_t block)
+{
+    m_blocks[block].size = 0;
+    m_unusedBlocks.push_back(block);
+}
+
+void TlsfAllocator::InsertFree(const uint32_t block)
+{
+    uint32_t fl, sl;
+    MapSize(m_blocks[block].size, fl, sl);
+
+    const uint32_t head = m_freeHeads[fl][sl];
+    m_blocks[block].free = true;
+    m_blocks[block].prev_free = INVALID_BLOCK;
+    m_blocks[block].next_free = head;
+    if (head != INVALID_BLOCK) {
+        m_blocks[head].prev_free = block;
+    }
+    m_freeHeads[fl][sl] = block;
+
+    m_flBitmap |= 1ull << fl;
+    m_slBitmap[fl] |= 1u << sl;
+}
+
+void TlsfAllocator::RemoveFree(const uint32_t block)
+{
+    uint32_t fl, sl;
+    MapSize(m_blocks[block].size, fl, sl);
+
+    const uint32_t prev = m_blocks[block].prev_free;
+    const uint32_t next = m_blocks[block].next_free;
+    if (prev != INVALID_BLOCK) {
+        m_blocks[prev].next_free = next;
+    } else {
+        m_freeHeads[fl][sl] = next;
+    }
+    if (next != INVALID_BLOCK) {
+        m_blocks[next].prev_free = prev;
+    }
+
+    if (m_freeHeads[fl][sl] == INVALID_BLOCK) {
+        m_slBitmap[fl] &= ~(1u << sl);
+        if (m_slBitmap[fl] == 0) {
+            m_flBitmap &= ~(1ull << fl);
+        }
+    }
+    m_blocks[block].free = false;
+}
+
+uint32_t TlsfAllocator::FindFree(const uint64_t size) const
+{
+    // round up to the next list boundary, every block of the list found is then large enough
+    uint64_t rounded_size = size;
+    if (size >= SL_COUNT) {
+        const uint32_t msb = static_cast<uint32_t>(std::bit_width(size)) - 1;
+        rounded_size += (1ull << (msb - SL_LOG2)) - 1;
+    }
+    uint32_t fl, sl;
+    MapSize(rounded_size, fl, sl);
+    if (fl < FL_COUNT) {
+        uint32_t sl_map = m_slBitmap[fl] & (~0u << sl);
+        if (sl_map == 0) {
+            const uint64_t fl_map = fl + 1 < 64 ? m_flBitmap & (~0ull << (fl + 1)) : 0;
+            fl = static_cast<uint32_t>(std::countr_zero(fl_map));
+            sl_map = fl_map != 0 ? m_slBitmap[fl] : 0;
+        }
+        if (sl_map != 0) {
+            return m_freeHeads[fl][std::countr_zero(sl_map)];
+        }
+    }
+
+    // nothing in the larger classes, the list size itself maps to may still hold a block that fits (a heap sized
+    // exactly for one resource)
+    MapSize(size, fl, sl);
+    for (uint32_t block = m_freeHeads[fl][sl]; block != INVALID_BLOCK; block = m_blocks[block].next_free) {
+        if (m_blocks[block].size >= size) {
+            return block;
+        }
+    }
+    return INVALID_BLOCK;
+}
+
+void TlsfAllocator::Split(const uint32_t block, const uint64_t size)
+{
+    // NewBlock may grow m_blocks, no references across it
+    const uint32_t rest = NewBlock(m_blocks[block].offset + size, m_blocks[block].size - size);
+    const uint32_t next = m_blocks[block].next_physical;
+
+    m_blocks[rest].prev_physical = block;
+    m_blocks[rest].next_physical = next;
+    if (next != INVALID_BLOCK) {
+        m_blocks[next].prev_physical = rest;
+    }
+    m_blocks[block].next_physical = rest;
+    m_blocks[block].size = size;
+}
+
+void TlsfAllocator::Merge(const uint32_t block, const uint32_t next)
+{
+    assert(m_blocks[block].next_physical == next);
+
+    const uint32_t after = m_blocks[next].next_physical;
+    m_blocks[block].size += m_blocks[next].size;
+    m_blocks[block].next_physical = after;
+    if (after != INVALID_BLOCK) {
+        m_blocks[after].prev_physical = block;
+    }
+    DeleteBlock(next);
+}
+
+TlsfAllocator::Allocation TlsfAllocator::Allocate(const uint64_t size, const uint64_t alignment)
+{
+    assert(std::has_single_bit(alignment));
+
+    const uint64_t granules = std::max<uint64_t>(1, (size + m_granularity - 1) >> m_granularityLog2);
+    const uint64_t alignment_granules = std::max(alignment, m_granularity) >> m_granularityLog2;
+
+    // a block of the right size class that happens to be aligned already (a fresh heap, say) is taken as it is,
+    // otherwise the worst case padding is reserved up front so the block found always fits once aligned
+    uint32_t block = FindFree(granules);
+    if (block == INVALID_BLOCK || (m_blocks[block].offset & (alignment_granules - 1)) != 0) {
+        block = FindFree(granules + alignment_granules - 1);
+    }
+    if (block == INVALID_BLOCK) {
+        return {};
+    }
+    RemoveFree(block);
+
+    // the physical neighbours of a free block are never free, so the leftovers need no merging
+    const uint64_t offset = m_blocks[block].offset;
+    const uint64_t padding = ((offset + alignment_granules - 1) & ~(alignment_granules - 1)) - offset;
+    if (padding > 0) {
+        Split(block, padding);
+        const uint32_t aligned = m_blocks[block].next_physical;
+        InsertFree(block);
+        block = aligned;
+        m_blocks[block].free = false;
+    }
+    if (m_blocks[block].size > granules) {
+        Split(block, granules);
+        InsertFree(m_blocks[block].next_physical);
+    }
+
+    m_used += granules;
+    ++m_allocationCount;
+
+    Allocation allocation;
+    allocation.offset = m_blocks[block].offset << m_granularityLog2;
+    allocation.size = granules << m_granularityLog2;
+    allocation.block = block;
+    return allocation;
+}
+
+void TlsfAllocator::Free(const Allocation& allocation)
+{
+    uint32_t block = allocation.block;
+    assert(allocation.IsValid() && !m_blocks[block].free && m_blocks[block].size > 0);
+
+    m_used -= m_blocks[block].size;
+    --m_allocationCount;
+
+    const uint32_t next = m_blocks[block].next_physical;
+    if (next != INVALID_BLOCK && m_blocks[next].free) {
+        RemoveFree(next);
+        Merge(block, next);
+    }
+    const uint32_t prev = m_blocks[block].prev_physical;
+    if (prev != INVALID_BLOCK && m_blocks[prev].free) {
+        RemoveFree(prev);
+        Merge(prev, block);
+        block = prev;
+    }
+    InsertFree(block);
+}
+
+bool TlsfAllocator::IsEmpty() const
+{
+    return m_allocationCount == 0;
+}
+
+TlsfAllocator::Stats TlsfAllocator::GetStats() const
+{
+    Stats stats {};
+    stats.size = m_size << m_granularityLog2;
+    stats.used = m_used << m_granularityLog2;
+    stats.allocation_count = m_allocationCount;
+
+    for (uint32_t block = 0; block != INVALID_BLOCK; block = m_blocks[block].next_physical) {
+        if (m_blocks[block].free) {
+            ++stats.free_block_count;
+            stats.largest_free_block = std::max(stats.largest_free_block, m_blocks[block].size << m_granularityLog2);
+        }
+    }
+
+    const uint64_t free_space = stats.size - stats.used;
+    stats.fragmentation = free_space == 0 ? 0.0f : 1.0f - static_cast<float>(stats.largest_free_block) / static_cast<float>(free_space);
+    return stats;
+}
+
+}
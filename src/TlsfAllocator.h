@@ -0,0 +1,94 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+namespace Anni {
+
+// Two level segregated fit allocator over an abstract [0, size) range: allocate and free are O(1), free neighbours
+// are merged immediately. It only does the bookkeeping and knows nothing about D3D12, ResourceHeapAllocator maps
+// the offsets into ID3D12Heap blocks. Sizes and offsets are multiples of the granularity.
+class TlsfAllocator {
+public:
+    static constexpr uint64_t INVALID_OFFSET = UINT64_MAX;
+    static constexpr uint32_t INVALID_BLOCK = UINT32_MAX;
+
+    struct Allocation {
+        uint64_t offset { INVALID_OFFSET };
+        uint64_t size { 0 };
+        uint32_t block { INVALID_BLOCK };
+
+        bool IsValid() const { return block != INVALID_BLOCK; }
+    };
+
+    struct Stats {
+        uint64_t size;
+        uint64_t used;
+        uint32_t allocation_count;
+        uint32_t free_block_count;
+        uint64_t largest_free_block;
+        // 1 - largest free block / all free space, 0 while the free space is in one piece
+        float fragmentation;
+    };
+
+    // granularity has to be a power of two
+    TlsfAllocator(uint64_t size, uint64_t granularity);
+
+    // alignment has to be a power of two, alignments below the granularity are free.
+    // Returns an invalid allocation when no free block fits.
+    Allocation Allocate(uint64_t size, uint64_t alignment);
+    void Free(const Allocation& allocation);
+
+    bool IsEmpty() const;
+    Stats GetStats() const;
+
+private:
+    // 32 second level lists per power of two
+    static constexpr uint32_t SL_LOG2 = 5;
+    static constexpr uint32_t SL_COUNT = 1u << SL_LOG2;
+    static constexpr uint32_t FL_COUNT = 64 - SL_LOG2 + 1;
+
+    struct Block {
+        // in granules
+        uint64_t offset;
+        uint64_t size;
+        bool free;
+
+        // neighbours in address order
+        uint32_t prev_physical;
+        uint32_t next_physical;
+        // neighbours in the free list of the size class
+        uint32_t prev_free;
+        uint32_t next_free;
+    };
+
+    static void MapSize(uint64_t size, uint32_t& fl, uint32_t& sl);
+
+    uint32_t NewBlock(uint64_t offset, uint64_t size);
+    void DeleteBlock(uint32_t block);
+
+    void InsertFree(uint32_t block);
+    void RemoveFree(uint32_t block);
+    uint32_t FindFree(uint64_t size) const;
+
+    // cuts the first size granules off a free block, the rest becomes a new free block
+    void Split(uint32_t block, uint64_t size);
+    // absorbs the physically following block into block
+    void Merge(uint32_t block, uint32_t next);
+
+private:
+    uint64_t m_granularity;
+    uint32_t m_granularityLog2;
+    uint64_t m_size;
+    uint64_t m_used;
+    uint32_t m_allocationCount;
+
+    std::vector<Block> m_blocks;
+    std::vector<uint32_t> m_unusedBlocks;
+
+    uint64_t m_flBitmap;
+    uint32_t m_slBitmap[FL_COUNT];
+    uint32_t m_freeHeads[FL_COUNT][SL_COUNT];
+};
+
+}
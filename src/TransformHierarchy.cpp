@@ -0,0 +1,138 @@
+#include "TransformHierarchy.h"
+
+#include "MatrixKernels.h"
+
+#include <algorithm>
+
+namespace Anni {
+
+std::vector<uint32_t> TransformHierarchy::Build(const std::vector<NodeData>& nodes)
+{
+    m_parents.clear();
+    m_localTransforms.clear();
+    m_dirtyNodes.clear();
+    m_parents.reserve(nodes.size());
+    m_localTransforms.reserve(nodes.size());
+
+    std::vector<uint32_t> node_indices(nodes.size(), UINT32_MAX);
+
+    // depth first, children are pushed in reverse to come off the stack in order
+    std::vector<uint32_t> pending_nodes;
+    for (size_t top_node = 0; top_node < nodes.size(); ++top_node) {
+        if (nodes[top_node].parent_index >= 0) {
+            continue;
+        }
+
+        pending_nodes.push_back(static_cast<uint32_t>(top_node));
+        while (!pending_nodes.empty()) {
+            const uint32_t source_index = pending_nodes.back();
+            pending_nodes.pop_back();
+
+            const NodeData& node_data = nodes[source_index];
+            node_indices[source_index] = static_cast<uint32_t>(m_parents.size());
+            m_parents.push_back(node_data.parent_index >= 0 ? static_cast<INT32>(node_indices[node_data.parent_index]) : NO_PARENT);
+            m_localTransforms.push_back(node_data.local_transform);
+
+            for (auto c = node_data.children.rbegin(); c != node_data.children.rend(); ++c) {
+                pending_nodes.push_back(*c);
+            }
+        }
+    }
+    // every node is reachable from a top node, glTF forbids cycles
+    assert(m_parents.size() == nodes.size());
+
+    // children come after their parent, so walking backwards every subtree is complete before its parent is reached
+    m_subtreeEnds.resize(m_parents.size());
+    for (uint32_t node = 0; node < m_subtreeEnds.size(); ++node) {
+        m_subtreeEnds[node] = node + 1;
+    }
+    for (size_t node = m_parents.size(); node-- > 0;) {
+        if (m_parents[node] != NO_PARENT) {
+            m_subtreeEnds[m_parents[node]] = std::max(m_subtreeEnds[m_parents[node]], m_subtreeEnds[node]);
+        }
+    }
+
+    m_dirty.assign(m_parents.size(), 0);
+    // a node is marked once per update, so neither list grows past the node count
+    m_dirtyNodes.reserve(m_parents.size());
+    m_updatedRanges.reserve(m_parents.size());
+    m_worldTransforms.resize(m_localTransforms.size());
+    UpdateAllWorldTransforms();
+    return node_indices;
+}
+
+uint32_t TransformHierarchy::GetNodeCount() const
+{
+    return static_cast<uint32_t>(m_parents.size());
+}
+
+INT32 TransformHierarchy::GetParent(const uint32_t node) const
+{
+    return m_parents[node];
+}
+
+const glm::mat4& TransformHierarchy::GetLocalTransform(const uint32_t node) const
+{
+    return m_localTransforms[node];
+}
+
+const glm::mat4& TransformHierarchy::GetWorldTransform(const uint32_t node) const
+{
+    return m_worldTransforms[node];
+}
+
+const glm::mat4* TransformHierarchy::GetWorldTransforms() const
+{
+    return m_worldTransforms.data();
+}
+
+TransformHierarchy::NodeRange TransformHierarchy::GetSubtree(const uint32_t node) const
+{
+    return { node, m_subtreeEnds[node] };
+}
+
+void TransformHierarchy::SetLocalTransform(const uint32_t node, const glm::mat4& local_transform)
+{
+    m_localTransforms[node] = local_transform;
+    if (!m_dirty[node]) {
+        m_dirty[node] = 1;
+        m_dirtyNodes.push_back(node);
+    }
+}
+
+const std::vector<TransformHierarchy::NodeRange>& TransformHierarchy::UpdateDirtyWorldTransforms()
+{
+    m_updatedRanges.clear();
+
+    // A marked node inside the subtree of an earlier one is covered by that subtree. Parents come first, so the
+    // parent of every range start is either clean or was recomputed by an earlier range.
+    std::ranges::sort(m_dirtyNodes);
+    for (const uint32_t node : m_dirtyNodes) {
+        m_dirty[node] = 0;
+        if (!m_updatedRanges.empty() && node < m_updatedRanges.back().end) {
+            continue;
+        }
+        m_updatedRanges.push_back(GetSubtree(node));
+        UpdateWorldTransforms(m_updatedRanges.back());
+    }
+    m_dirtyNodes.clear();
+
+    return m_updatedRanges;
+}
+
+void TransformHierarchy::UpdateAllWorldTransforms()
+{
+    UpdateWorldTransforms({ 0, GetNodeCount() });
+    for (const uint32_t node : m_dirtyNodes) {
+        m_dirty[node] = 0;
+    }
+    m_dirtyNodes.clear();
+}
+
+void TransformHierarchy::UpdateWorldTransforms(const NodeRange range)
+{
+    // the parent's world transform is always final by the time its children are reached
+    ConcatenateTransforms(m_parents.data(), m_localTransforms.data(), range.begin, range.end, m_worldTransforms.data());
+}
+
+}
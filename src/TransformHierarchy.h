@@ -0,0 +1,68 @@
+#pragma once
+
+#include "ModelData.h"
+
+#include <vector>
+
+namespace Anni {
+
+// The nodes of a model flattened into arrays. Nodes are stored in depth first order, a parent always comes before its
+// children, so the world transforms resolve in one linear pass over the arrays instead of a walk down the tree.
+// Nodes are referred to by their index in this order.
+//
+// The subtree of a node is the range right after it. Setting a local transform marks only that node, the next
+// UpdateDirtyWorldTransforms recomputes the subtrees of the marked nodes and nothing else.
+class TransformHierarchy {
+public:
+    static constexpr INT32 NO_PARENT = -1;
+
+    // [begin, end) in hierarchy order
+    struct NodeRange {
+        uint32_t begin;
+        uint32_t end;
+    };
+
+    TransformHierarchy() = default;
+    TransformHierarchy(const TransformHierarchy&) = delete;
+    TransformHierarchy(TransformHierarchy&&) = delete;
+    TransformHierarchy& operator=(const TransformHierarchy&) = delete;
+    TransformHierarchy& operator=(TransformHierarchy&&) = delete;
+    ~TransformHierarchy() = default;
+
+    // Top nodes in the order of nodes, children in the order they are listed. Returns the index every entry of nodes
+    // got and resolves the world transforms.
+    std::vector<uint32_t> Build(const std::vector<NodeData>& nodes);
+
+    uint32_t GetNodeCount() const;
+    // NO_PARENT or an index below node
+    INT32 GetParent(uint32_t node) const;
+    const glm::mat4& GetLocalTransform(uint32_t node) const;
+    const glm::mat4& GetWorldTransform(uint32_t node) const;
+    const glm::mat4* GetWorldTransforms() const;
+    // the node and everything below it
+    NodeRange GetSubtree(uint32_t node) const;
+
+    // Marks the subtree of node, its world transforms are stale until the next update.
+    void SetLocalTransform(uint32_t node, const glm::mat4& local_transform);
+    // Recomputes the subtrees marked since the last update. Returns them sorted and disjoint, the ranges stay valid
+    // until the next call. The cost follows the number of nodes that moved, not the size of the hierarchy.
+    const std::vector<NodeRange>& UpdateDirtyWorldTransforms();
+    void UpdateAllWorldTransforms();
+
+private:
+    void UpdateWorldTransforms(NodeRange range);
+
+    std::vector<INT32> m_parents;
+    // one past the last node of the subtree
+    std::vector<uint32_t> m_subtreeEnds;
+    std::vector<glm::mat4> m_localTransforms;
+    std::vector<glm::mat4> m_worldTransforms;
+
+    // roots of the stale subtrees, each once. m_dirty is the flag per node, the lists keep their capacity across
+    // updates.
+    std::vector<uint8_t> m_dirty;
+    std::vector<uint32_t> m_dirtyNodes;
+    std::vector<NodeRange> m_updatedRanges;
+};
+
+}
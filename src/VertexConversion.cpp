@@ -0,0 +1,447 @@
+#include "VertexConversion.h"
+
+#include <immintrin.h>
+
+#include <algorithm>
+#include <cstring>
+
+namespace Anni {
+
+namespace {
+
+    static_assert(sizeof(StandardVertex) == 28 && offsetof(StandardVertex, position) == 0 && offsetof(StandardVertex, normal) == 12
+            && offsetof(StandardVertex, tangent) == 16 && offsetof(StandardVertex, uv) == 20 && offsetof(StandardVertex, color) == 24,
+        "StoreVertices writes the vertex as seven consecutive 32 bit words");
+
+    struct DefaultAttributes {
+        UINT32 normal { PackOctahedral({ 0, 1, 0 }) };
+        UINT32 tangent { PackOctahedral({ 1, 0, 0 }) };
+        UINT32 uv { PackHalf2({ 0.f, 0.f }) };
+        UINT32 color { PackUNorm4(glm::vec4 { 1.f }) };
+    };
+
+    UINT32 GetComponentSize(const AttributeComponent component)
+    {
+        switch (component) {
+        case AttributeComponent::Float:
+            return 4;
+        case AttributeComponent::UNorm16:
+        case AttributeComponent::SNorm16:
+        case AttributeComponent::UInt16:
+        case AttributeComponent::SInt16:
+            return 2;
+        default:
+            return 1;
+        }
+    }
+
+    //> scalar
+    // glTF: unsigned normalized c / max, signed normalized max(c / max, -1)
+    float LoadComponent(const AttributeStream& stream, const size_t vertex, const uint32_t component)
+    {
+        const std::byte* element = stream.data + vertex * stream.stride + component * GetComponentSize(stream.component);
+        switch (stream.component) {
+        case AttributeComponent::Float: {
+            float value;
+            memcpy(&value, element, sizeof(value));
+            return value;
+        }
+        case AttributeComponent::UNorm8:
+            return static_cast<float>(static_cast<uint8_t>(*element)) / 255.0f;
+        case AttributeComponent::SNorm8:
+            return std::max(static_cast<float>(static_cast<int8_t>(*element)) / 127.0f, -1.0f);
+        case AttributeComponent::UInt8:
+            return static_cast<float>(static_cast<uint8_t>(*element));
+        case AttributeComponent::SInt8:
+            return static_cast<float>(static_cast<int8_t>(*element));
+        default:
+            break;
+        }
+
+        uint16_t bits;
+        memcpy(&bits, element, sizeof(bits));
+        switch (stream.component) {
+        case AttributeComponent::UNorm16:
+            return static_cast<float>(bits) / 65535.0f;
+        case AttributeComponent::SNorm16:
+            return std::max(static_cast<float>(static_cast<int16_t>(bits)) / 32767.0f, -1.0f);
+        case AttributeComponent::UInt16:
+            return static_cast<float>(bits);
+        default:
+            return static_cast<float>(static_cast<int16_t>(bits));
+        }
+    }
+
+    glm::vec3 LoadVec3(const AttributeStream& stream, const size_t vertex)
+    {
+        return { LoadComponent(stream, vertex, 0), LoadComponent(stream, vertex, 1), LoadComponent(stream, vertex, 2) };
+    }
+
+    void ConvertVerticesScalar(const VertexStreams& streams, const size_t first, const size_t count, StandardVertex* vertices)
+    {
+        const DefaultAttributes defaults;
+        for (size_t i = first; i < count; ++i) {
+            StandardVertex& vertex = vertices[i];
+            vertex.position = LoadVec3(streams.position, i);
+            vertex.normal = streams.normal.data ? PackOctahedral(LoadVec3(streams.normal, i)) : defaults.normal;
+            vertex.tangent = streams.tangent.data ? PackOctahedral(LoadVec3(streams.tangent, i)) : defaults.tangent;
+            vertex.uv = streams.uv.data
+                ? PackHalf2({ LoadComponent(streams.uv, i, 0), LoadComponent(streams.uv, i, 1) })
+                : defaults.uv;
+            vertex.color = streams.color.data
+                ? PackUNorm4({ LoadVec3(streams.color, i), streams.color.component_count == 4 ? LoadComponent(streams.color, i, 3) : 1.0f })
+                : defaults.color;
+        }
+    }
+    //< scalar
+
+    //> simd
+    // The kernels are written once against these two lane sets: 4 lanes of SSE4.1 or 8 lanes of AVX2.
+    struct Sse41 {
+        static constexpr size_t WIDTH = 4;
+        using Float = __m128;
+        using Int = __m128i;
+
+        // the 32 bits at offset of WIDTH consecutive elements
+        static Int Gather(const std::byte* element, const size_t stride)
+        {
+            int lanes[WIDTH];
+            for (size_t lane = 0; lane < WIDTH; ++lane) {
+                memcpy(&lanes[lane], element + lane * stride, sizeof(int));
+            }
+            return _mm_loadu_si128(reinterpret_cast<const __m128i*>(lanes));
+        }
+
+        static Float Set(const float value) { return _mm_set1_ps(value); }
+        static Float Add(const Float a, const Float b) { return _mm_add_ps(a, b); }
+        static Float Sub(const Float a, const Float b) { return _mm_sub_ps(a, b); }
+        static Float Mul(const Float a, const Float b) { return _mm_mul_ps(a, b); }
+        static Float Div(const Float a, const Float b) { return _mm_div_ps(a, b); }
+        static Float Min(const Float a, const Float b) { return _mm_min_ps(a, b); }
+        static Float Max(const Float a, const Float b) { return _mm_max_ps(a, b); }
+        static Float Abs(const Float a) { return _mm_andnot_ps(_mm_set1_ps(-0.0f), a); }
+        static Float Trunc(const Float a) { return _mm_round_ps(a, _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC); }
+        static Float Less(const Float a, const Float b) { return _mm_cmplt_ps(a, b); }
+        static Float LessEqual(const Float a, const Float b) { return _mm_cmple_ps(a, b); }
+        static Float Equal(const Float a, const Float b) { return _mm_cmpeq_ps(a, b); }
+        // mask ? a : b
+        static Float Select(const Float mask, const Float a, const Float b) { return _mm_blendv_ps(b, a, mask); }
+        static Float And(const Float mask, const Float a) { return _mm_and_ps(mask, a); }
+
+        static Int SetInt(const UINT32 value) { return _mm_set1_epi32(static_cast<int>(value)); }
+        static Int ToInt(const Float a) { return _mm_cvttps_epi32(a); }
+        static Float ToFloat(const Int a) { return _mm_cvtepi32_ps(a); }
+        static Int AsInt(const Float a) { return _mm_castps_si128(a); }
+        static Float AsFloat(const Int a) { return _mm_castsi128_ps(a); }
+        static Int AddInt(const Int a, const Int b) { return _mm_add_epi32(a, b); }
+        static Int AndInt(const Int a, const Int b) { return _mm_and_si128(a, b); }
+        static Int OrInt(const Int a, const Int b) { return _mm_or_si128(a, b); }
+        static Int XorInt(const Int a, const Int b) { return _mm_xor_si128(a, b); }
+        static Int LessInt(const Int a, const Int b) { return _mm_cmplt_epi32(a, b); }
+        static Int EqualInt(const Int a, const Int b) { return _mm_cmpeq_epi32(a, b); }
+        static Int SelectInt(const Int mask, const Int a, const Int b) { return _mm_blendv_epi8(b, a, mask); }
+        template <int N>
+        static Int ShiftLeft(const Int a) { return _mm_slli_epi32(a, N); }
+        template <int N>
+        static Int ShiftRight(const Int a) { return _mm_srli_epi32(a, N); }
+        template <int N>
+        static Int ShiftRightArithmetic(const Int a) { return _mm_srai_epi32(a, N); }
+
+        // Two 4x4 transposes turn the lanes into vertices. The second half of a vertex is stored 16 bytes wide, its
+        // last 4 bytes land on the position of the next vertex and are overwritten by it. The caller leaves at least
+        // one vertex after the last group to absorb the final spill.
+        static void StoreVertices(StandardVertex* vertices, const Float x, const Float y, const Float z, const Int normal, const Int tangent, const Int uv, const Int color)
+        {
+            __m128 a0 = x, a1 = y, a2 = z, a3 = _mm_castsi128_ps(normal);
+            __m128 b0 = _mm_castsi128_ps(tangent), b1 = _mm_castsi128_ps(uv), b2 = _mm_castsi128_ps(color), b3 = _mm_setzero_ps();
+            _MM_TRANSPOSE4_PS(a0, a1, a2, a3);
+            _MM_TRANSPOSE4_PS(b0, b1, b2, b3);
+            float* words = reinterpret_cast<float*>(vertices);
+            _mm_storeu_ps(words, a0);
+            _mm_storeu_ps(words + 4, b0);
+            _mm_storeu_ps(words + 7, a1);
+            _mm_storeu_ps(words + 11, b1);
+            _mm_storeu_ps(words + 14, a2);
+            _mm_storeu_ps(words + 18, b2);
+            _mm_storeu_ps(words + 21, a3);
+            _mm_storeu_ps(words + 25, b3);
+        }
+    };
+
+    struct Avx2 {
+        static constexpr size_t WIDTH = 8;
+        using Float = __m256;
+        using Int = __m256i;
+
+        static Int Gather(const std::byte* element, const size_t stride)
+        {
+            const int s = static_cast<int>(stride);
+            const __m256i offsets = _mm256_setr_epi32(0, s, 2 * s, 3 * s, 4 * s, 5 * s, 6 * s, 7 * s);
+            return _mm256_i32gather_epi32(reinterpret_cast<const int*>(element), offsets, 1);
+        }
+
+        static Float Set(const float value) { return _mm256_set1_ps(value); }
+        static Float Add(const Float a, const Float b) { return _mm256_add_ps(a, b); }
+        static Float Sub(const Float a, const Float b) { return _mm256_sub_ps(a, b); }
+        static Float Mul(const Float a, const Float b) { return _mm256_mul_ps(a, b); }
+        static Float Div(const Float a, const Float b) { return _mm256_div_ps(a, b); }
+        static Float Min(const Float a, const Float b) { return _mm256_min_ps(a, b); }
+        static Float Max(const Float a, const Float b) { return _mm256_max_ps(a, b); }
+        static Float Abs(const Float a) { return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), a); }
+        static Float Trunc(const Float a) { return _mm256_round_ps(a, _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC); }
+        static Float Less(const Float a, const Float b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+        static Float LessEqual(const Float a, const Float b) { return _mm256_cmp_ps(a, b, _CMP_LE_OQ); }
+        static Float Equal(const Float a, const Float b) { return _mm256_cmp_ps(a, b, _CMP_EQ_OQ); }
+        static Float Select(const Float mask, const Float a, const Float b) { return _mm256_blendv_ps(b, a, mask); }
+        static Float And(const Float mask, const Float a) { return _mm256_and_ps(mask, a); }
+
+        static Int SetInt(const UINT32 value) { return _mm256_set1_epi32(static_cast<int>(value)); }
+        static Int ToInt(const Float a) { return _mm256_cvttps_epi32(a); }
+        static Float ToFloat(const Int a) { return _mm256_cvtepi32_ps(a); }
+        static Int AsInt(const Float a) { return _mm256_castps_si256(a); }
+        static Float AsFloat(const Int a) { return _mm256_castsi256_ps(a); }
+        static Int AddInt(const Int a, const Int b) { return _mm256_add_epi32(a, b); }
+        static Int AndInt(const Int a, const Int b) { return _mm256_and_si256(a, b); }
+        static Int OrInt(const Int a, const Int b) { return _mm256_or_si256(a, b); }
+        static Int XorInt(const Int a, const Int b) { return _mm256_xor_si256(a, b); }
+        static Int LessInt(const Int a, const Int b) { return _mm256_cmpgt_epi32(b, a); }
+        static Int EqualInt(const Int a, const Int b) { return _mm256_cmpeq_epi32(a, b); }
+        static Int SelectInt(const Int mask, const Int a, const Int b) { return _mm256_blendv_epi8(b, a, mask); }
+        template <int N>
+        static Int ShiftLeft(const Int a) { return _mm256_slli_epi32(a, N); }
+        template <int N>
+        static Int ShiftRight(const Int a) { return _mm256_srli_epi32(a, N); }
+        template <int N>
+        static Int ShiftRightArithmetic(const Int a) { return _mm256_srai_epi32(a, N); }
+
+        // the lower and upper four lanes go through the SSE transposes
+        static void StoreVertices(StandardVertex* vertices, const Float x, const Float y, const Float z, const Int normal, const Int tangent, const Int uv, const Int color)
+        {
+            Sse41::StoreVertices(vertices,
+                _mm256_castps256_ps128(x), _mm256_castps256_ps128(y), _mm256_castps256_ps128(z),
+                _mm256_castsi256_si128(normal), _mm256_castsi256_si128(tangent), _mm256_castsi256_si128(uv), _mm256_castsi256_si128(color));
+            Sse41::StoreVertices(vertices + 4,
+                _mm256_extractf128_ps(x, 1), _mm256_extractf128_ps(y, 1), _mm256_extractf128_ps(z, 1),
+                _mm256_extracti128_si256(normal, 1), _mm256_extracti128_si256(tangent, 1), _mm256_extracti128_si256(uv, 1), _mm256_extracti128_si256(color, 1));
+        }
+    };
+
+    // One component of WIDTH consecutive elements, converted like LoadComponent. Reads the 4 bytes at the component,
+    // past its end for 8 and 16 bit components, so the last elements of a stream are left to the scalar path.
+
+    // The elements at the end of stream whose 4 byte reads would run past the last element, 1 unless the stride is
+    // tighter than 4 bytes.
+    size_t GetTailCount(const AttributeStream& stream)
+    {
+        const size_t component_size = GetComponentSize(stream.component);
+        if (!stream.data || component_size == 4) {
+            return 0;
+        }
+        return (4 - component_size + stream.stride - 1) / stream.stride;
+    }
+
+    template <typename Isa>
+    typename Isa::Float LoadLanes(const AttributeStream& stream, const size_t first, const uint32_t component)
+    {
+        using Int = typename Isa::Int;
+        const Int raw = Isa::Gather(stream.data + first * stream.stride + component * GetComponentSize(stream.component), stream.stride);
+        switch (stream.component) {
+        case AttributeComponent::Float:
+            return Isa::AsFloat(raw);
+        case AttributeComponent::UNorm8:
+            return Isa::Div(Isa::ToFloat(Isa::AndInt(raw, Isa::SetInt(0xFF))), Isa::Set(255.0f));
+        case AttributeComponent::UNorm16:
+            return Isa::Div(Isa::ToFloat(Isa::AndInt(raw, Isa::SetInt(0xFFFF))), Isa::Set(65535.0f));
+        case AttributeComponent::SNorm8:
+            return Isa::Max(Isa::Div(Isa::ToFloat(Isa::template ShiftRightArithmetic<24>(Isa::template ShiftLeft<24>(raw))), Isa::Set(127.0f)), Isa::Set(-1.0f));
+        case AttributeComponent::SNorm16:
+            return Isa::Max(Isa::Div(Isa::ToFloat(Isa::template ShiftRightArithmetic<16>(Isa::template ShiftLeft<16>(raw))), Isa::Set(32767.0f)), Isa::Set(-1.0f));
+        case AttributeComponent::UInt8:
+            return Isa::ToFloat(Isa::AndInt(raw, Isa::SetInt(0xFF)));
+        case AttributeComponent::UInt16:
+            return Isa::ToFloat(Isa::AndInt(raw, Isa::SetInt(0xFFFF)));
+        case AttributeComponent::SInt8:
+            return Isa::ToFloat(Isa::template ShiftRightArithmetic<24>(Isa::template ShiftLeft<24>(raw)));
+        default:
+            return Isa::ToFloat(Isa::template ShiftRightArithmetic<16>(Isa::template ShiftLeft<16>(raw)));
+        }
+    }
+
+    // std::round, halfway cases away from zero. The fraction x - trunc(x) is exact, adding 0.5 first is not.
+    template <typename Isa>
+    typename Isa::Int RoundToInt(const typename Isa::Float x)
+    {
+        const typename Isa::Float whole = Isa::Trunc(x);
+        const typename Isa::Float fraction = Isa::Sub(x, whole);
+        const typename Isa::Float up = Isa::And(Isa::LessEqual(Isa::Set(0.5f), fraction), Isa::Set(1.0f));
+        const typename Isa::Float down = Isa::And(Isa::LessEqual(fraction, Isa::Set(-0.5f)), Isa::Set(1.0f));
+        return Isa::ToInt(Isa::Sub(Isa::Add(whole, up), down));
+    }
+
+    // glm::packSnorm2x16. The clamp keeps NaN like glm's does, min and max return their second operand for it, and
+    // the NaN lanes convert to 0x80000000 whose low half is 0, what the scalar conversion to int16 gives.
+    template <typename Isa>
+    typename Isa::Int PackSnorm2x16(const typename Isa::Float x, const typename Isa::Float y)
+    {
+        const auto quantize = [](const typename Isa::Float v) {
+            return RoundToInt<Isa>(Isa::Mul(Isa::Min(Isa::Set(1.0f), Isa::Max(Isa::Set(-1.0f), v)), Isa::Set(32767.0f)));
+        };
+        return Isa::OrInt(Isa::AndInt(quantize(x), Isa::SetInt(0xFFFF)), Isa::template ShiftLeft<16>(quantize(y)));
+    }
+
+    // PackOctahedral
+    template <typename Isa>
+    typename Isa::Int PackOctahedralLanes(const typename Isa::Float x, const typename Isa::Float y, const typename Isa::Float z)
+    {
+        using Float = typename Isa::Float;
+        const Float zero = Isa::Set(0.0f);
+        const Float one = Isa::Set(1.0f);
+        const Float l1_norm = Isa::Add(Isa::Add(Isa::Abs(x), Isa::Abs(y)), Isa::Abs(z));
+        const Float px = Isa::Div(x, l1_norm);
+        const Float py = Isa::Div(y, l1_norm);
+
+        const Float sign_x = Isa::Select(Isa::LessEqual(zero, px), one, Isa::Set(-1.0f));
+        const Float sign_y = Isa::Select(Isa::LessEqual(zero, py), one, Isa::Set(-1.0f));
+        const Float folded_x = Isa::Mul(Isa::Sub(one, Isa::Abs(py)), sign_x);
+        const Float folded_y = Isa::Mul(Isa::Sub(one, Isa::Abs(px)), sign_y);
+        const Float lower = Isa::Less(z, zero);
+
+        const typename Isa::Int packed = PackSnorm2x16<Isa>(Isa::Select(lower, folded_x, px), Isa::Select(lower, folded_y, py));
+        // packSnorm2x16(0, 0) is 0
+        return Isa::AndInt(packed, Isa::XorInt(Isa::AsInt(Isa::Equal(l1_norm, zero)), Isa::SetInt(0xFFFFFFFF)));
+    }
+
+    // glm::packHalf2x16. glm rounds halfway cases away from zero, F16C would round them to even, so the conversion
+    // is done on the bits.
+    template <typename Isa>
+    typename Isa::Int FloatToHalf(const typename Isa::Float value)
+    {
+        using Int = typename Isa::Int;
+        const Int bits = Isa::AsInt(value);
+        const Int sign = Isa::AndInt(bits, Isa::SetInt(0x80000000));
+        const Int magnitude = Isa::XorInt(bits, sign);
+
+        // rebias the exponent, add half an ulp of the half and let the carry run into the exponent
+        const Int normal = Isa::template ShiftRight<13>(Isa::AddInt(magnitude, Isa::SetInt(0xC8001000)));
+        // below 2^-14 the half is a multiple of 2^-24, scaling by 2^24 is exact
+        const Int subnormal = RoundToInt<Isa>(Isa::Mul(Isa::AsFloat(magnitude), Isa::Set(16777216.0f)));
+        // glm keeps the top of a NaN payload and makes sure it stays a NaN
+        const Int payload = Isa::template ShiftRight<13>(Isa::AndInt(magnitude, Isa::SetInt(0x007FFFFF)));
+        const Int nan = Isa::OrInt(Isa::OrInt(Isa::SetInt(0x7C00), payload), Isa::AndInt(Isa::EqualInt(payload, Isa::SetInt(0)), Isa::SetInt(1)));
+
+        Int half = Isa::SelectInt(Isa::LessInt(magnitude, Isa::SetInt(0x38800000)), subnormal, normal);
+        half = Isa::SelectInt(Isa::LessInt(magnitude, Isa::SetInt(0x47800000)), half, Isa::SetInt(0x7C00));
+        half = Isa::SelectInt(Isa::LessInt(Isa::SetInt(0x7F800000), magnitude), nan, half);
+        return Isa::OrInt(half, Isa::template ShiftRight<16>(sign));
+    }
+
+    // glm::packUnorm4x8. NaN is clamped to 0 here, the red lane isn't masked so 0x80000000 would reach the alpha, and
+    // the scalar conversion to uint8 gives 0 for it as well.
+    template <typename Isa>
+    typename Isa::Int PackUNorm4x8(const typename Isa::Float r, const typename Isa::Float g, const typename Isa::Float b, const typename Isa::Float a)
+    {
+        const auto quantize = [](const typename Isa::Float v) {
+            return RoundToInt<Isa>(Isa::Mul(Isa::Min(Isa::Max(v, Isa::Set(0.0f)), Isa::Set(1.0f)), Isa::Set(255.0f)));
+        };
+        return Isa::OrInt(Isa::OrInt(quantize(r), Isa::template ShiftLeft<8>(quantize(g))),
+            Isa::OrInt(Isa::template ShiftLeft<16>(quantize(b)), Isa::template ShiftLeft<24>(quantize(a))));
+    }
+
+    // Converts [0, count) rounded down to whole lane groups, always leaving at least one vertex for the spill of the
+    // last store and the tails of the streams, returns where it stopped.
+    template <typename Isa>
+    size_t ConvertVerticesSimd(const VertexStreams& streams, const size_t count, StandardVertex* vertices)
+    {
+        using Float = typename Isa::Float;
+        using Int = typename Isa::Int;
+        const DefaultAttributes defaults;
+        const size_t tail = std::max({ size_t { 1 }, GetTailCount(streams.position), GetTailCount(streams.normal),
+            GetTailCount(streams.tangent), GetTailCount(streams.uv), GetTailCount(streams.color) });
+        const size_t simd_count = count > tail ? (count - tail) / Isa::WIDTH * Isa::WIDTH : 0;
+
+        for (size_t first = 0; first < simd_count; first += Isa::WIDTH) {
+            const Float x = LoadLanes<Isa>(streams.position, first, 0);
+            const Float y = LoadLanes<Isa>(streams.position, first, 1);
+            const Float z = LoadLanes<Isa>(streams.position, first, 2);
+
+            Int normal = Isa::SetInt(defaults.normal);
+            if (streams.normal.data) {
+                normal = PackOctahedralLanes<Isa>(LoadLanes<Isa>(streams.normal, first, 0), LoadLanes<Isa>(streams.normal, first, 1), LoadLanes<Isa>(streams.normal, first, 2));
+            }
+            Int tangent = Isa::SetInt(defaults.tangent);
+            if (streams.tangent.data) {
+                tangent = PackOctahedralLanes<Isa>(LoadLanes<Isa>(streams.tangent, first, 0), LoadLanes<Isa>(streams.tangent, first, 1), LoadLanes<Isa>(streams.tangent, first, 2));
+            }
+            Int uv = Isa::SetInt(defaults.uv);
+            if (streams.uv.data) {
+                uv = Isa::OrInt(FloatToHalf<Isa>(LoadLanes<Isa>(streams.uv, first, 0)), Isa::template ShiftLeft<16>(FloatToHalf<Isa>(LoadLanes<Isa>(streams.uv, first, 1))));
+            }
+            Int color = Isa::SetInt(defaults.color);
+            if (streams.color.data) {
+                const Float alpha = streams.color.component_count == 4 ? LoadLanes<Isa>(streams.color, first, 3) : Isa::Set(1.0f);
+                color = PackUNorm4x8<Isa>(LoadLanes<Isa>(streams.color, first, 0), LoadLanes<Isa>(streams.color, first, 1), LoadLanes<Isa>(streams.color, first, 2), alpha);
+            }
+
+            Isa::StoreVertices(vertices + first, x, y, z, normal, tangent, uv, color);
+        }
+        return simd_count;
+    }
+    //< simd
+
+}
+
+void ConvertVertices(const VertexStreams& streams, const size_t count, StandardVertex* vertices, const SimdLevel level)
+{
+    assert(streams.position.data);
+    size_t converted = 0;
+    if (level >= SimdLevel::AVX2) {
+        converted = ConvertVerticesSimd<Avx2>(streams, count, vertices);
+    } else if (level == SimdLevel::SSE41) {
+        converted = ConvertVerticesSimd<Sse41>(streams, count, vertices);
+    }
+    // the rest, and the vertex the last group's store spilled into
+    ConvertVerticesScalar(streams, converted, count, vertices);
+}
+
+void ConvertIndices(const std::byte* data, const uint32_t index_size, const size_t count, uint32_t* indices, const SimdLevel level)
+{
+    if (index_size == 4) {
+        memcpy(indices, data, count * sizeof(uint32_t));
+        return;
+    }
+    assert(index_size == 1 || index_size == 2);
+
+    size_t i = 0;
+    if (level >= SimdLevel::AVX2) {
+        for (; i + 8 <= count; i += 8) {
+            const __m128i packed = index_size == 2
+                ? _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i * 2))
+                : _mm_loadl_epi64(reinterpret_cast<const __m128i*>(data + i));
+            const __m256i wide = index_size == 2 ? _mm256_cvtepu16_epi32(packed) : _mm256_cvtepu8_epi32(packed);
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(indices + i), wide);
+        }
+    } else if (level == SimdLevel::SSE41) {
+        for (; i + 4 <= count; i += 4) {
+            int packed_bytes;
+            __m128i wide;
+            if (index_size == 2) {
+                wide = _mm_cvtepu16_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(data + i * 2)));
+            } else {
+                memcpy(&packed_bytes, data + i, sizeof(packed_bytes));
+                wide = _mm_cvtepu8_epi32(_mm_cvtsi32_si128(packed_bytes));
+            }
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(indices + i), wide);
+        }
+    }
+    for (; i < count; ++i) {
+        if (index_size == 2) {
+            uint16_t index;
+            memcpy(&index, data + i * 2, sizeof(index));
+            indices[i] = index;
+        } else {
+            indices[i] = static_cast<uint8_t>(data[i]);
+        }
+    }
+}
+
+}
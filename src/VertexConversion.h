@@ -0,0 +1,51 @@
+#pragma once
+
+#include "AnniUtils.h"
+
+#include <cstddef>
+#include <cstdint>
+
+namespace Anni {
+
+// Bulk conversion of glTF accessor data into StandardVertex. Every attribute of a vertex range is read and packed in
+// one pass that writes whole vertices. The AVX2 and SSE4.1 paths produce the same bits as the scalar path, which packs
+// with PackOctahedral, PackHalf2 and PackUNorm4.
+
+enum class AttributeComponent : uint8_t {
+    Float,
+    UNorm8,
+    UNorm16,
+    SNorm8,
+    SNorm16,
+    // not normalized, KHR_mesh_quantization positions and uvs
+    UInt8,
+    UInt16,
+    SInt8,
+    SInt16,
+};
+
+// The elements of one accessor, element i starts at data + i * stride.
+struct AttributeStream {
+    const std::byte* data { nullptr };
+    size_t stride { 0 };
+    AttributeComponent component { AttributeComponent::Float };
+    uint32_t component_count { 0 };
+};
+
+// An attribute with null data gets the default the importer always used: normal (0, 1, 0), tangent (1, 0, 0),
+// uv (0, 0) and white. The position is required. Tangents and colors may have 3 or 4 components.
+struct VertexStreams {
+    AttributeStream position;
+    AttributeStream normal;
+    AttributeStream tangent;
+    AttributeStream uv;
+    AttributeStream color;
+};
+
+// Every stream holds at least count elements.
+void ConvertVertices(const VertexStreams& streams, size_t count, StandardVertex* vertices, SimdLevel level = GetSimdLevel());
+
+// Widens tightly packed 1, 2 or 4 byte indices.
+void ConvertIndices(const std::byte* data, uint32_t index_size, size_t count, uint32_t* indices, SimdLevel level = GetSimdLevel());
+
+}
@@ -0,0 +1,172 @@
+#include "MatrixKernels.h"
+#include "Test.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <random>
+#include <vector>
+
+using namespace Anni;
+
+namespace {
+
+// not a multiple of any batch width, so every path runs its tail
+constexpr size_t MATRIX_COUNT = 37;
+
+template <typename T>
+bool SameBits(const std::vector<T>& a, const std::vector<T>& b)
+{
+    return a.size() == b.size() && (a.empty() || memcmp(a.data(), b.data(), a.size() * sizeof(T)) == 0);
+}
+
+// every level the CPU runs, the scalar one included
+std::vector<SimdLevel> SupportedLevels()
+{
+    std::vector<SimdLevel> levels;
+    for (uint8_t l = 0; l <= static_cast<uint8_t>(GetSimdLevel()); ++l) {
+        levels.push_back(static_cast<SimdLevel>(l));
+    }
+    return levels;
+}
+
+std::vector<glm::mat4> MakeMatrices(std::mt19937& random, const size_t count)
+{
+    std::uniform_real_distribution<float> value(-4.0f, 4.0f);
+    std::uniform_int_distribution<int> exponent(-20, 20);
+    std::vector<glm::mat4> matrices(count);
+    for (glm::mat4& m : matrices) {
+        for (int c = 0; c < 4; ++c) {
+            for (int r = 0; r < 4; ++r) {
+                // wide exponents make the rounding of every add depend on its order
+                m[c][r] = std::ldexp(value(random), exponent(random));
+            }
+        }
+    }
+    matrices[0] = glm::mat4(1.0f);
+    matrices[1][2][1] = -0.0f;
+    return matrices;
+}
+
+std::vector<Bounds> MakeBounds(std::mt19937& random, const size_t count)
+{
+    std::uniform_real_distribution<float> value(-100.0f, 100.0f);
+    std::vector<Bounds> bounds(count);
+    for (Bounds& b : bounds) {
+        b.origin = glm::vec3(value(random), value(random), value(random));
+        b.extents = glm::abs(glm::vec3(value(random), value(random), value(random)));
+        b.sphereRadius = glm::length(b.extents);
+    }
+    // a point
+    bounds[0].extents = glm::vec3(0.0f);
+    bounds[0].sphereRadius = 0.0f;
+    return bounds;
+}
+
+}
+
+ANNI_TEST(MatrixKernels, ProductsMatchGlm)
+{
+    std::mt19937 random(23);
+    const std::vector<glm::mat4> left = MakeMatrices(random, MATRIX_COUNT);
+    const std::vector<glm::mat4> right = MakeMatrices(random, MATRIX_COUNT);
+
+    std::vector<glm::mat4> each(MATRIX_COUNT);
+    std::vector<glm::mat4> by_left(MATRIX_COUNT);
+    std::vector<glm::mat4> by_right(MATRIX_COUNT);
+    for (size_t i = 0; i < MATRIX_COUNT; ++i) {
+        each[i] = left[i] * right[i];
+        by_left[i] = left[3] * right[i];
+        by_right[i] = left[i] * right[5];
+    }
+
+    for (const SimdLevel level : SupportedLevels()) {
+        std::vector<glm::mat4> out(MATRIX_COUNT);
+        MultiplyMatrices(left.data(), right.data(), MATRIX_COUNT, out.data(), level);
+        ANNI_CHECK(SameBits(out, each));
+        MultiplyMatrices(left[3], right.data(), MATRIX_COUNT, out.data(), level);
+        ANNI_CHECK(SameBits(out, by_left));
+        MultiplyMatrices(left.data(), right[5], MATRIX_COUNT, out.data(), level);
+        ANNI_CHECK(SameBits(out, by_right));
+
+        // in place, the way MeshNode multiplies its top matrix into the node matrices
+        std::vector<glm::mat4> in_place = right;
+        MultiplyMatrices(left[3], in_place.data(), MATRIX_COUNT, in_place.data(), level);
+        ANNI_CHECK(SameBits(in_place, by_left));
+        in_place = left;
+        MultiplyMatrices(in_place.data(), right.data(), MATRIX_COUNT, in_place.data(), level);
+        ANNI_CHECK(SameBits(in_place, each));
+    }
+}
+
+ANNI_TEST(MatrixKernels, TransposeMatchesGlm)
+{
+    std::mt19937 random(24);
+    const std::vector<glm::mat4> matrices = MakeMatrices(random, MATRIX_COUNT);
+    std::vector<glm::mat4> expected(MATRIX_COUNT);
+    for (size_t i = 0; i < MATRIX_COUNT; ++i) {
+        expected[i] = glm::transpose(matrices[i]);
+    }
+
+    for (const SimdLevel level : SupportedLevels()) {
+        std::vector<glm::mat4> transposed = matrices;
+        TransposeMatrices(transposed.data(), MATRIX_COUNT, level);
+        ANNI_CHECK(SameBits(transposed, expected));
+    }
+}
+
+ANNI_TEST(MatrixKernels, ConcatenateMatchesGlm)
+{
+    std::mt19937 random(25);
+    const std::vector<glm::mat4> local = MakeMatrices(random, MATRIX_COUNT);
+    std::vector<INT32> parents(MATRIX_COUNT);
+    for (size_t i = 0; i < MATRIX_COUNT; ++i) {
+        // a few roots, the others below any node before them
+        parents[i] = i % 10 == 0 ? -1 : static_cast<INT32>(random() % i);
+    }
+
+    std::vector<glm::mat4> expected(MATRIX_COUNT);
+    for (size_t i = 0; i < MATRIX_COUNT; ++i) {
+        expected[i] = parents[i] < 0 ? local[i] : expected[parents[i]] * local[i];
+    }
+
+    // the whole tree, then the subtree ranges the hierarchy refreshes on their own
+    std::vector<glm::mat4> world(MATRIX_COUNT);
+    ConcatenateTransforms(parents.data(), local.data(), 0, MATRIX_COUNT, world.data());
+    ANNI_CHECK(SameBits(world, expected));
+    std::vector<glm::mat4> ranges(MATRIX_COUNT);
+    ConcatenateTransforms(parents.data(), local.data(), 0, 20, ranges.data());
+    ConcatenateTransforms(parents.data(), local.data(), 20, MATRIX_COUNT, ranges.data());
+    ANNI_CHECK(SameBits(ranges, expected));
+}
+
+ANNI_TEST(MatrixKernels, BoundsMatchScalar)
+{
+    std::mt19937 random(26);
+    const std::vector<glm::mat4> transforms = MakeMatrices(random, 4);
+
+    for (const glm::mat4& transform : transforms) {
+        // every count up to a few batches, so each path ends in every possible tail
+        for (size_t count = 0; count <= 19; ++count) {
+            const std::vector<Bounds> bounds = MakeBounds(random, std::max<size_t>(count, 1));
+            std::vector<Bounds> expected(count);
+            for (size_t i = 0; i < count; ++i) {
+                expected[i] = TransformBounds(bounds[i], transform);
+            }
+
+            for (const SimdLevel level : SupportedLevels()) {
+                // one more than needed, the last must stay untouched
+                std::vector<Bounds> out(count + 1);
+                out[count].sphereRadius = -1.0f;
+                TransformBounds(bounds.data(), count, transform, out.data(), level);
+                ANNI_CHECK(out[count].sphereRadius == -1.0f);
+                out.pop_back();
+                ANNI_CHECK(SameBits(out, expected));
+
+                std::vector<Bounds> in_place(bounds.begin(), bounds.begin() + count);
+                TransformBounds(in_place.data(), count, transform, in_place.data(), level);
+                ANNI_CHECK(SameBits(in_place, expected));
+            }
+        }
+    }
+}
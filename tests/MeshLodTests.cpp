@@ -0,0 +1,123 @@
+#include "MeshOptimizer.h"
+#include "MeshSimplifier.h"
+#include "Test.h"
+#include "TestMeshes.h"
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+using namespace Anni;
+using namespace Anni::Tests;
+
+namespace {
+
+// The mesh as one surface with its levels of detail appended, like OptimizeMesh leaves it.
+GeoSurface BuildLods(TestMesh& mesh)
+{
+    GeoSurface surface {};
+    surface.startIndex = 0;
+    surface.count = static_cast<uint32_t>(mesh.indices.size());
+    OptimizeVertexCache(mesh.indices.data(), mesh.indices.size());
+    BuildSurfaceLods(surface, mesh.indices, mesh.vertices.data());
+    return surface;
+}
+
+float LargestExtent(const TestMesh& mesh)
+{
+    glm::vec3 bounds_min = mesh.vertices[0].position;
+    glm::vec3 bounds_max = bounds_min;
+    for (const StandardVertex& vertex : mesh.vertices) {
+        bounds_min = glm::min(bounds_min, glm::vec3(vertex.position));
+        bounds_max = glm::max(bounds_max, glm::vec3(vertex.position));
+    }
+    const glm::vec3 extent = bounds_max - bounds_min;
+    return std::max({ extent.x, extent.y, extent.z });
+}
+
+void CheckLodChain(const TestMesh& source)
+{
+    TestMesh mesh = source;
+    const GeoSurface surface = BuildLods(mesh);
+
+    // the mesh is large enough for a chain, or the checks below see nothing
+    ANNI_CHECK(surface.lodCount > 1);
+    ANNI_CHECK(surface.lods[0].startIndex == surface.startIndex);
+    ANNI_CHECK(surface.lods[0].count == surface.count);
+    ANNI_CHECK(surface.lods[0].error == 0.0f);
+
+    const float error_budget = LOD_MAX_RELATIVE_ERROR * LargestExtent(mesh);
+    for (uint32_t level = 1; level < surface.lodCount; ++level) {
+        const SurfaceLod& lod = surface.lods[level];
+        const SurfaceLod& previous = surface.lods[level - 1];
+
+        // coarser and less accurate than the level before, within the budget of the surface
+        ANNI_CHECK(lod.count % 3 == 0);
+        ANNI_CHECK(lod.count > 0);
+        ANNI_CHECK(lod.count <= previous.count * LOD_MIN_REDUCTION);
+        ANNI_CHECK(lod.error >= previous.error);
+        ANNI_CHECK(lod.error <= error_budget * 1.0001f);
+
+        // appended after the level before, indexing the same vertices
+        ANNI_CHECK(lod.startIndex == previous.startIndex + previous.count);
+        ANNI_CHECK(lod.startIndex + lod.count <= mesh.indices.size());
+        for (uint32_t i = lod.startIndex; i < lod.startIndex + lod.count; ++i) {
+            ANNI_CHECK(mesh.indices[i] < mesh.vertices.size());
+        }
+    }
+}
+
+// Same input, same chain: the indices and every level, bit for bit.
+void CheckLodDeterminism(const TestMesh& source)
+{
+    TestMesh first = source;
+    TestMesh second = source;
+    const GeoSurface first_surface = BuildLods(first);
+    const GeoSurface second_surface = BuildLods(second);
+
+    ANNI_CHECK(first.indices == second.indices);
+    ANNI_CHECK(first_surface.lodCount == second_surface.lodCount);
+    for (uint32_t level = 0; level < first_surface.lodCount; ++level) {
+        ANNI_CHECK(first_surface.lods[level].startIndex == second_surface.lods[level].startIndex);
+        ANNI_CHECK(first_surface.lods[level].count == second_surface.lods[level].count);
+        ANNI_CHECK(first_surface.lods[level].error == second_surface.lods[level].error);
+    }
+}
+
+}
+
+ANNI_TEST(MeshLods, ErrorGrowsWithEveryLevel)
+{
+    std::mt19937 random(13);
+    CheckLodChain(MakeSphere(48, 96));
+    CheckLodChain(MakeBumpyGrid(64, random));
+}
+
+ANNI_TEST(MeshLods, Deterministic)
+{
+    std::mt19937 random(14);
+    CheckLodDeterminism(MakeSphere(48, 96));
+    CheckLodDeterminism(MakeBumpyGrid(64, random));
+}
+
+ANNI_TEST(MeshLods, SimplifyRespectsLimits)
+{
+    const TestMesh sphere = MakeSphere(32, 64);
+    std::vector<uint32_t> result;
+
+    // a larger budget never ends with a larger error than the budget, nor with more triangles than a smaller one
+    size_t previous_index_count = sphere.indices.size();
+    for (const float max_error : { 0.001f, 0.01f, 0.05f, 0.2f }) {
+        const float error = SimplifySurface(sphere.indices.data(), sphere.indices.size(), sphere.vertices.data(), 0, max_error, result);
+        ANNI_CHECK(error <= max_error);
+        ANNI_CHECK(result.size() % 3 == 0);
+        ANNI_CHECK(result.size() <= previous_index_count);
+        previous_index_count = result.size();
+    }
+
+    // stops at the target once it is reached
+    const size_t target_index_count = sphere.indices.size() / 2 / 3 * 3;
+    SimplifySurface(sphere.indices.data(), sphere.indices.size(), sphere.vertices.data(), target_index_count, 1.0f, result);
+    ANNI_CHECK(result.size() <= target_index_count);
+    ANNI_CHECK(result.size() > target_index_count / 2);
+}
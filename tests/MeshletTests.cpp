@@ -0,0 +1,130 @@
+#include "ClusterCulling.h"
+#include "MeshOptimizer.h"
+#include "Test.h"
+#include "TestMeshes.h"
+
+#include <algorithm>
+#include <array>
+#include <random>
+#include <set>
+#include <vector>
+
+using namespace Anni;
+using namespace Anni::Tests;
+
+namespace {
+
+std::multiset<std::array<uint32_t, 3>> Triangles(const std::vector<uint32_t>& indices)
+{
+    std::multiset<std::array<uint32_t, 3>> triangles;
+    for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+        // the same triangle whichever vertex it starts with
+        std::array<uint32_t, 3> triangle = { indices[i], indices[i + 1], indices[i + 2] };
+        std::ranges::rotate(triangle, std::ranges::min_element(triangle));
+        triangles.insert(triangle);
+    }
+    return triangles;
+}
+
+std::vector<Meshlet> BuildTestMeshlets(TestMesh& mesh)
+{
+    OptimizeVertexCache(mesh.indices.data(), mesh.indices.size());
+    std::vector<Meshlet> meshlets;
+    BuildMeshlets(mesh.indices.data(), mesh.indices.size(), mesh.vertices.data(), meshlets);
+    return meshlets;
+}
+
+void CheckMeshletLimits(TestMesh mesh)
+{
+    const auto triangles_before = Triangles(mesh.indices);
+    const std::vector<Meshlet> meshlets = BuildTestMeshlets(mesh);
+    ANNI_CHECK(!meshlets.empty());
+
+    // the meshlets tile the index buffer in order and only the triangle order changed
+    ANNI_CHECK(Triangles(mesh.indices) == triangles_before);
+    uint32_t next_index = 0;
+    for (const Meshlet& meshlet : meshlets) {
+        ANNI_CHECK(meshlet.first_index == next_index);
+        ANNI_CHECK(meshlet.triangle_count > 0);
+        ANNI_CHECK(meshlet.triangle_count <= MESHLET_MAX_TRIANGLES);
+        ANNI_CHECK(meshlet.vertex_count <= MESHLET_MAX_VERTICES);
+        next_index += meshlet.triangle_count * 3;
+
+        const auto first = mesh.indices.begin() + meshlet.first_index;
+        const std::set<uint32_t> unique_vertices(first, first + meshlet.triangle_count * 3);
+        ANNI_CHECK(unique_vertices.size() == meshlet.vertex_count);
+        for (const uint32_t vertex : unique_vertices) {
+            const float distance = glm::length(glm::vec3(mesh.vertices[vertex].position) - meshlet.center);
+            ANNI_CHECK(distance <= meshlet.radius * 1.0001f + 1e-6f);
+        }
+    }
+    ANNI_CHECK(next_index == mesh.indices.size());
+}
+
+}
+
+ANNI_TEST(Meshlets, Limits)
+{
+    std::mt19937 random(12);
+    CheckMeshletLimits(MakeSphere(48, 96));
+    CheckMeshletLimits(MakeBumpyGrid(64, random));
+
+    // a mesh smaller than one meshlet
+    TestMesh single;
+    single.vertices = { MakeVertex(glm::vec3(0, 0, 0)), MakeVertex(glm::vec3(1, 0, 0)), MakeVertex(glm::vec3(0, 1, 0)) };
+    single.indices = { 0, 1, 2 };
+    const std::vector<Meshlet> meshlets = BuildTestMeshlets(single);
+    ANNI_CHECK(meshlets.size() == 1);
+    ANNI_CHECK(meshlets[0].triangle_count == 1);
+    ANNI_CHECK(meshlets[0].vertex_count == 3);
+}
+
+ANNI_TEST(Meshlets, ConeCullIsConservative)
+{
+    std::mt19937 random(13);
+    std::uniform_real_distribution<float> coordinate(-4.0f, 68.0f);
+    std::uniform_real_distribution<float> near_coordinate(-1.5f, 1.5f);
+
+    // a frustum no meshlet is outside of, only the cone test culls
+    ClusterCullView view {};
+    view.frustum.planes = { {
+        { 1, 0, 0, 1e6f }, { -1, 0, 0, 1e6f }, { 0, 1, 0, 1e6f }, { 0, -1, 0, 1e6f }, { 0, 0, 1, 1e6f }, { 0, 0, -1, 1e6f },
+    } };
+
+    TestMesh sphere = MakeSphere(48, 96);
+    TestMesh grid = MakeBumpyGrid(64, random);
+    for (TestMesh* mesh : { &sphere, &grid }) {
+        const std::vector<Meshlet> meshlets = BuildTestMeshlets(*mesh);
+        std::vector<uint8_t> masks(meshlets.size());
+
+        uint32_t culled = 0;
+        for (uint32_t eye_index = 0; eye_index < 500; ++eye_index) {
+            // far from the mesh and right next to it
+            view.eye = mesh == &sphere
+                ? glm::vec3(near_coordinate(random), near_coordinate(random), near_coordinate(random)) * (eye_index % 2 == 0 ? 1.0f : 5.0f)
+                : glm::vec3(coordinate(random), coordinate(random) * 0.1f - 1.0f, coordinate(random));
+
+            ClusterCullStats stats;
+            CullMeshlets(meshlets.data(), meshlets.size(), glm::mat4(1.0f), std::span(&view, 1), masks.data(), stats);
+            ANNI_CHECK(stats.frustum_culled == 0);
+
+            // every triangle of a culled meshlet faces away from the eye
+            for (size_t m = 0; m < meshlets.size(); ++m) {
+                if (masks[m] != 0) {
+                    continue;
+                }
+                ++culled;
+                for (uint32_t t = 0; t < meshlets[m].triangle_count; ++t) {
+                    const uint32_t* triangle = mesh->indices.data() + meshlets[m].first_index + t * 3;
+                    const glm::vec3 p0 = mesh->vertices[triangle[0]].position;
+                    const glm::vec3 p1 = mesh->vertices[triangle[1]].position;
+                    const glm::vec3 p2 = mesh->vertices[triangle[2]].position;
+                    const glm::vec3 normal = glm::normalize(glm::cross(p1 - p0, p2 - p0));
+                    ANNI_CHECK(glm::dot(normal, p0 - view.eye) >= -1e-4f);
+                }
+            }
+        }
+        // the test is not vacuous
+        ANNI_CHECK(culled > 0);
+    }
+}
@@ -0,0 +1,91 @@
+#include "MipGenerator.h"
+#include "Test.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+using namespace Anni;
+
+namespace {
+
+std::vector<uint8_t> RandomImage(const UINT width, const UINT height, std::mt19937& random)
+{
+    std::vector<uint8_t> image(size_t(width) * height * 4);
+    for (uint8_t& byte : image) {
+        byte = static_cast<uint8_t>(random());
+    }
+    return image;
+}
+
+// largest difference of a channel between the fast path and the reference
+int DownsampleError(const std::vector<uint8_t>& src, const UINT width, const UINT height, const MipFilter filter)
+{
+    const size_t dst_size = size_t(std::max(1u, width / 2)) * std::max(1u, height / 2) * 4;
+    std::vector<uint8_t> fast(dst_size);
+    std::vector<uint8_t> reference(dst_size);
+    DownsampleRGBA8(src.data(), width, height, fast.data(), filter);
+    DownsampleRGBA8Reference(src.data(), width, height, reference.data(), filter);
+
+    int error = 0;
+    for (size_t i = 0; i < dst_size; ++i) {
+        error = std::max(error, std::abs(fast[i] - reference[i]));
+    }
+    return error;
+}
+
+}
+
+ANNI_TEST(MipGenerator, DownsampleMatchesReference)
+{
+    std::mt19937 random(1);
+    // odd sizes leave a row or column out, 1 wide images only halve the other side
+    for (const UINT width : { 1u, 2u, 3u, 5u, 8u, 13u, 64u, 255u }) {
+        for (const UINT height : { 1u, 2u, 7u, 16u }) {
+            const std::vector<uint8_t> src = RandomImage(width, height, random);
+            ANNI_CHECK(DownsampleError(src, width, height, MipFilter::Linear) == 0);
+            ANNI_CHECK(DownsampleError(src, width, height, MipFilter::SRGB) <= 1);
+        }
+    }
+}
+
+ANNI_TEST(MipGenerator, ConstantImageStaysConstant)
+{
+    for (const MipFilter filter : { MipFilter::Linear, MipFilter::SRGB }) {
+        for (const uint8_t value : { uint8_t(0), uint8_t(1), uint8_t(128), uint8_t(254), uint8_t(255) }) {
+            const std::vector<uint8_t> src(16 * 8 * 4, value);
+            std::vector<uint8_t> dst(8 * 4 * 4);
+            DownsampleRGBA8(src.data(), 16, 8, dst.data(), filter);
+            ANNI_CHECK(std::ranges::all_of(dst, [value](const uint8_t byte) { return byte == value; }));
+        }
+    }
+}
+
+ANNI_TEST(MipGenerator, MipChainLayout)
+{
+    ANNI_CHECK(CountMipLevels(1, 1) == 1);
+    ANNI_CHECK(CountMipLevels(256, 256) == 9);
+    ANNI_CHECK(CountMipLevels(300, 70) == 9);
+
+    std::mt19937 random(2);
+    const std::vector<uint8_t> base = RandomImage(300, 70, random);
+    std::vector<uint8_t> chain(GetMipChainSize(300, 70));
+    std::vector<D3D12_SUBRESOURCE_DATA> subresources;
+    GenerateMipChain(base.data(), 300, 70, MipFilter::SRGB, chain.data(), subresources);
+
+    // levels 1..8 packed back to back, the last one ends where the chain does
+    ANNI_CHECK(subresources.size() == 8);
+    UINT width = 300;
+    UINT height = 70;
+    const uint8_t* level_begin = chain.data();
+    for (const D3D12_SUBRESOURCE_DATA& subresource : subresources) {
+        width = std::max(1u, width / 2);
+        height = std::max(1u, height / 2);
+        ANNI_CHECK(subresource.pData == level_begin);
+        ANNI_CHECK(subresource.RowPitch == LONG_PTR(width) * 4);
+        ANNI_CHECK(subresource.SlicePitch == LONG_PTR(width) * height * 4);
+        level_begin += subresource.SlicePitch;
+    }
+    ANNI_CHECK(level_begin == chain.data() + chain.size());
+}
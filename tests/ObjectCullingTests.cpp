@@ -0,0 +1,153 @@
+#include "ObjectCulling.h"
+#include "Test.h"
+
+#include <cmath>
+#include <random>
+#include <vector>
+
+using namespace Anni;
+
+namespace {
+
+// not multiples of any batch width, each count ends the batches in another place
+constexpr size_t BOX_COUNTS[] = { 0, 1, 3, 4, 5, 7, 8, 9, 15, 16, 17, 23, 31, 33, 47, 1001 };
+
+// A 90 degree frustum looking down +z from the origin, the side planes aren't normalized. The points on them are
+// inside every other plane.
+Frustum MakeFrustum()
+{
+    Frustum frustum;
+    frustum.planes = {
+        glm::vec4(1.0f, 0.0f, 1.0f, 0.0f),
+        glm::vec4(-1.0f, 0.0f, 1.0f, 0.0f),
+        glm::vec4(0.0f, 1.0f, 1.0f, 0.0f),
+        glm::vec4(0.0f, -1.0f, 1.0f, 0.0f),
+        glm::vec4(0.0f, 0.0f, 1.0f, -0.5f),
+        glm::vec4(0.0f, 0.0f, -1.0f, 100.0f),
+    };
+    return frustum;
+}
+
+// a point on each plane of MakeFrustum and the direction out of it
+constexpr float PLANE_POINTS[6][6] = {
+    { -50.0f, 0.0f, 50.0f, -1.0f, 0.0f, 0.0f },
+    { 50.0f, 0.0f, 50.0f, 1.0f, 0.0f, 0.0f },
+    { 0.0f, -50.0f, 50.0f, 0.0f, -1.0f, 0.0f },
+    { 0.0f, 50.0f, 50.0f, 0.0f, 1.0f, 0.0f },
+    { 0.0f, 0.0f, 0.5f, 0.0f, 0.0f, -1.0f },
+    { 0.0f, 0.0f, 100.0f, 0.0f, 0.0f, 1.0f },
+};
+
+// planes in every direction, so the signs of the normals and the order of the adds vary
+Frustum MakeRandomFrustum(std::mt19937& random)
+{
+    std::uniform_real_distribution<float> value(-1.0f, 1.0f);
+    Frustum frustum;
+    for (glm::vec4& plane : frustum.planes) {
+        plane = glm::vec4(value(random), value(random), value(random), 60.0f * value(random));
+    }
+    return frustum;
+}
+
+// Random boxes around the frustum mixed with boxes straddling each plane, boxes touching it from outside and points
+// on it, so they land in every lane of a batch.
+std::vector<Bounds> MakeBounds(std::mt19937& random, const size_t count, const Frustum& frustum)
+{
+    std::uniform_real_distribution<float> position(-120.0f, 120.0f);
+    std::uniform_real_distribution<float> extent(0.0f, 20.0f);
+    std::vector<Bounds> bounds(count);
+    for (Bounds& b : bounds) {
+        const uint32_t kind = random() % 4;
+        const glm::vec4& plane = frustum.planes[random() % frustum.planes.size()];
+        const glm::vec3 normal(plane.x, plane.y, plane.z);
+        const float length2 = normal.x * normal.x + normal.y * normal.y + normal.z * normal.z;
+        b.origin = glm::vec3(position(random), position(random), position(random) + 50.0f);
+        b.extents = kind == 3 ? glm::vec3(0.0f) : glm::vec3(extent(random), extent(random), extent(random));
+        if (kind != 0) {
+            // onto the plane, up to rounding
+            const float distance = normal.x * b.origin.x + normal.y * b.origin.y + normal.z * b.origin.z + plane.w;
+            b.origin = b.origin + normal * (-distance / length2);
+        }
+        if (kind == 2) {
+            // out of the plane by the radius the box projects to, distance + radius rounds to either side of 0
+            const float radius = std::abs(normal.x) * b.extents.x + std::abs(normal.y) * b.extents.y + std::abs(normal.z) * b.extents.z;
+            b.origin = b.origin + normal * (-radius / length2);
+        }
+        b.sphereRadius = glm::length(b.extents);
+    }
+    return bounds;
+}
+
+std::vector<uint32_t> Cull(const std::vector<Bounds>& bounds, const Frustum& frustum, const SimdLevel level)
+{
+    // one more than can be written, it must stay untouched
+    std::vector<uint32_t> indices(bounds.size() + 1, 0xCDCDCDCD);
+    const size_t visible_count = CullBounds(bounds.data(), bounds.size(), frustum, indices.data(), level);
+    ANNI_CHECK(visible_count <= bounds.size());
+    ANNI_CHECK(indices[visible_count] == 0xCDCDCDCD);
+    indices.resize(visible_count);
+    return indices;
+}
+
+void CheckLevelsMatchScalar(const std::vector<Bounds>& bounds, const Frustum& frustum)
+{
+    const std::vector<uint32_t> expected = Cull(bounds, frustum, SimdLevel::Scalar);
+    for (const SimdLevel level : { SimdLevel::SSE41, SimdLevel::AVX2, SimdLevel::AVX512 }) {
+        if (GetSimdLevel() < level) {
+            continue;
+        }
+        ANNI_CHECK(Cull(bounds, frustum, level) == expected);
+    }
+}
+
+}
+
+ANNI_TEST(ObjectCulling, PlanesKeepWhatTheyShould)
+{
+    const Frustum frustum = MakeFrustum();
+    std::vector<Bounds> inside;
+    std::vector<Bounds> outside;
+    for (const float* point : PLANE_POINTS) {
+        const glm::vec3 on_plane(point[0], point[1], point[2]);
+        const glm::vec3 outward(point[3], point[4], point[5]);
+        // a point right on the plane and a box straddling it are kept
+        inside.push_back({ on_plane, glm::vec3(0.0f), 0.0f });
+        inside.push_back({ on_plane + outward * 0.25f, glm::vec3(0.5f), glm::length(glm::vec3(0.5f)) });
+        // a point just outside and a box entirely outside are culled
+        outside.push_back({ on_plane + outward * 0.01f, glm::vec3(0.0f), 0.0f });
+        outside.push_back({ on_plane + outward * 2.0f, glm::vec3(0.5f), glm::length(glm::vec3(0.5f)) });
+    }
+
+    for (uint8_t l = 0; l <= static_cast<uint8_t>(GetSimdLevel()); ++l) {
+        const SimdLevel level = static_cast<SimdLevel>(l);
+        ANNI_CHECK(Cull(inside, frustum, level).size() == inside.size());
+        ANNI_CHECK(Cull(outside, frustum, level).empty());
+    }
+}
+
+ANNI_TEST(ObjectCulling, EveryLevelMatchesScalar)
+{
+    std::mt19937 random(25);
+    const Frustum frustum = MakeFrustum();
+    for (const size_t count : BOX_COUNTS) {
+        CheckLevelsMatchScalar(MakeBounds(random, count, frustum), frustum);
+        const Frustum random_frustum = MakeRandomFrustum(random);
+        CheckLevelsMatchScalar(MakeBounds(random, count, random_frustum), random_frustum);
+    }
+}
+
+ANNI_TEST(ObjectCulling, PointsMatchScalar)
+{
+    // boxes of zero extent everywhere, each is kept on the sign of its distances alone
+    std::mt19937 random(26);
+    std::uniform_real_distribution<float> position(-120.0f, 120.0f);
+    const Frustum frustum = MakeFrustum();
+    for (const size_t count : BOX_COUNTS) {
+        std::vector<Bounds> points(count);
+        for (Bounds& b : points) {
+            b.origin = glm::vec3(position(random), position(random), position(random) + 50.0f);
+        }
+        CheckLevelsMatchScalar(points, frustum);
+        CheckLevelsMatchScalar(points, MakeRandomFrustum(random));
+    }
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// Minimal test registry for the headless SandBoxTests executable. A test is a function registered under a suite name;
+// a failed check is reported and the test runs on, the executable returns non zero when any check failed.
+namespace Anni::Tests {
+
+struct TestCase {
+    const char* suite;
+    const char* name;
+    void (*run)();
+};
+
+std::vector<TestCase>& GetTestCases();
+void ReportFailure(const char* file, int line, const char* expression);
+
+struct TestRegistrar {
+    TestRegistrar(const char* suite, const char* name, void (*run)())
+    {
+        GetTestCases().push_back({ suite, name, run });
+    }
+};
+
+}
+
+#define ANNI_TEST(suite, name)                                                                           \
+    static void suite##_##name();                                                                        \
+    static const ::Anni::Tests::TestRegistrar suite##_##name##_registrar(#suite, #name, &suite##_##name); \
+    static void suite##_##name()
+
+#define ANNI_CHECK(expression)                                                    \
+    do {                                                                          \
+        if (!(expression)) {                                                      \
+            ::Anni::Tests::ReportFailure(__FILE__, __LINE__, #expression);        \
+        }                                                                         \
+    } while (false)
@@ -0,0 +1,55 @@
+#include "Test.h"
+
+#include <cstring>
+#include <iostream>
+
+namespace Anni::Tests {
+
+namespace {
+
+    uint32_t failed_checks = 0;
+
+}
+
+std::vector<TestCase>& GetTestCases()
+{
+    static std::vector<TestCase> test_cases;
+    return test_cases;
+}
+
+void ReportFailure(const char* file, const int line, const char* expression)
+{
+    ++failed_checks;
+    std::cerr << file << '(' << line << "): check failed: " << expression << '\n';
+}
+
+}
+
+// Runs every test, or only the ones of the suites named on the command line.
+int main(int argc, char** argv)
+{
+    using namespace Anni::Tests;
+
+    uint32_t run_tests = 0;
+    uint32_t failed_tests = 0;
+    for (const TestCase& test_case : GetTestCases()) {
+        bool selected = argc < 2;
+        for (int i = 1; i < argc; ++i) {
+            selected |= std::strcmp(argv[i], test_case.suite) == 0;
+        }
+        if (!selected) {
+            continue;
+        }
+
+        const uint32_t failed_before = failed_checks;
+        test_case.run();
+        ++run_tests;
+        if (failed_checks != failed_before) {
+            ++failed_tests;
+            std::cout << "[SandBoxTests] FAILED " << test_case.suite << '.' << test_case.name << '\n';
+        }
+    }
+
+    std::cout << "[SandBoxTests] " << run_tests - failed_tests << " of " << run_tests << " tests passed" << '\n';
+    return failed_tests == 0 && run_tests > 0 ? 0 : 1;
+}
@@ -0,0 +1,65 @@
+#include "TestMeshes.h"
+
+#include <cmath>
+
+namespace Anni::Tests {
+
+namespace {
+
+    constexpr float PI = 3.14159265f;
+
+}
+
+StandardVertex MakeVertex(const glm::vec3& position)
+{
+    StandardVertex vertex {};
+    vertex.position = position;
+    return vertex;
+}
+
+TestMesh MakeSphere(const uint32_t rings, const uint32_t segments)
+{
+    TestMesh mesh;
+    for (uint32_t r = 0; r <= rings; ++r) {
+        const float theta = PI * static_cast<float>(r) / static_cast<float>(rings);
+        for (uint32_t s = 0; s <= segments; ++s) {
+            const float phi = 2.0f * PI * static_cast<float>(s) / static_cast<float>(segments);
+            mesh.vertices.push_back(MakeVertex(glm::vec3(std::sin(theta) * std::cos(phi), std::cos(theta), std::sin(theta) * std::sin(phi))));
+        }
+    }
+    for (uint32_t r = 0; r < rings; ++r) {
+        for (uint32_t s = 0; s < segments; ++s) {
+            const uint32_t a = r * (segments + 1) + s;
+            const uint32_t b = a + segments + 1;
+            // no degenerate triangles at the poles
+            if (r != 0) {
+                mesh.indices.insert(mesh.indices.end(), { a, a + 1, b });
+            }
+            if (r != rings - 1) {
+                mesh.indices.insert(mesh.indices.end(), { a + 1, b + 1, b });
+            }
+        }
+    }
+    return mesh;
+}
+
+TestMesh MakeBumpyGrid(const uint32_t size, std::mt19937& random)
+{
+    std::uniform_real_distribution<float> height(0.0f, 0.3f);
+    TestMesh mesh;
+    for (uint32_t y = 0; y <= size; ++y) {
+        for (uint32_t x = 0; x <= size; ++x) {
+            mesh.vertices.push_back(MakeVertex(glm::vec3(static_cast<float>(x), height(random), static_cast<float>(y))));
+        }
+    }
+    for (uint32_t y = 0; y < size; ++y) {
+        for (uint32_t x = 0; x < size; ++x) {
+            const uint32_t a = y * (size + 1) + x;
+            const uint32_t b = a + size + 1;
+            mesh.indices.insert(mesh.indices.end(), { a, b, a + 1, a + 1, b, b + 1 });
+        }
+    }
+    return mesh;
+}
+
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include "ModelData.h"
+
+#include <cstdint>
+#include <random>
+#include <vector>
+
+// Procedural meshes for the mesh processing tests, only the positions of the vertices are set.
+namespace Anni::Tests {
+
+struct TestMesh {
+    std::vector<StandardVertex> vertices;
+    std::vector<uint32_t> indices;
+};
+
+StandardVertex MakeVertex(const glm::vec3& position);
+
+// Closed unit sphere, cross(p1 - p0, p2 - p0) points out of it.
+TestMesh MakeSphere(uint32_t rings, uint32_t segments);
+
+// size x size quads in the xz plane with random heights, facing up. Its border is open.
+TestMesh MakeBumpyGrid(uint32_t size, std::mt19937& random);
+
+}
@@ -0,0 +1,236 @@
+#include "Test.h"
+#include "TextureContainer.h"
+
+#include <cstring>
+#include <string>
+#include <vector>
+
+using namespace Anni;
+
+namespace {
+
+constexpr uint8_t KTX2_IDENTIFIER[12] { 0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n' };
+constexpr uint32_t KTX2_HEADER_SIZE = 80;
+constexpr uint32_t KTX2_LEVEL_INDEX_ENTRY_SIZE = 24;
+constexpr uint32_t VK_FORMAT_R8G8B8A8_UNORM = 37;
+constexpr uint32_t VK_FORMAT_BC7_SRGB_BLOCK = 146;
+constexpr uint32_t KTX2_SUPERCOMPRESSION_ZSTD = 2;
+
+// the 64 bytes (i * 7) % 16 as the zstd command line compresses them, one compressed block with a repeat
+constexpr uint8_t ZSTD_PATTERN_FRAME[] {
+    0x28, 0xb5, 0x2f, 0xfd, 0x20, 0x40, 0xc5, 0x00, 0x00, 0x88, 0x00, 0x07, 0x0e, 0x05, 0x0c, 0x03, 0x0a,
+    0x01, 0x08, 0x0f, 0x06, 0x0d, 0x04, 0x0b, 0x02, 0x09, 0x00, 0x01, 0x00, 0x99, 0x68, 0x2e, 0x01,
+};
+
+template <typename T>
+void WriteAt(std::vector<std::byte>& file, const size_t offset, const T value)
+{
+    if (file.size() < offset + sizeof(T)) {
+        file.resize(offset + sizeof(T));
+    }
+    memcpy(file.data() + offset, &value, sizeof(T));
+}
+
+// DXT1 to DXT5 header followed by data_size bytes of levels
+std::vector<std::byte> MakeDds(const uint32_t width, const uint32_t height, const uint32_t mip_count, const char* four_cc, const size_t data_size)
+{
+    std::vector<std::byte> file(4 + 124 + data_size);
+    memcpy(file.data(), "DDS ", 4);
+    WriteAt<uint32_t>(file, 4, 124);
+    WriteAt<uint32_t>(file, 8, 0x1007 | 0x20000); // caps, height, width, pixel format, mip map count
+    WriteAt<uint32_t>(file, 12, height);
+    WriteAt<uint32_t>(file, 16, width);
+    WriteAt<uint32_t>(file, 28, mip_count);
+    WriteAt<uint32_t>(file, 76, 32);
+    WriteAt<uint32_t>(file, 80, 0x4); // DDPF_FOURCC
+    memcpy(file.data() + 84, four_cc, 4);
+    return file;
+}
+
+std::vector<std::byte> MakeKtx2Header(const uint32_t vk_format, const uint32_t width, const uint32_t height, const size_t level_count, const uint32_t supercompression_scheme)
+{
+    std::vector<std::byte> file(KTX2_HEADER_SIZE + level_count * KTX2_LEVEL_INDEX_ENTRY_SIZE);
+    memcpy(file.data(), KTX2_IDENTIFIER, sizeof(KTX2_IDENTIFIER));
+    WriteAt<uint32_t>(file, 12, vk_format);
+    WriteAt<uint32_t>(file, 20, width);
+    WriteAt<uint32_t>(file, 24, height);
+    WriteAt<uint32_t>(file, 36, 1); // faces
+    WriteAt<uint32_t>(file, 40, static_cast<uint32_t>(level_count));
+    WriteAt<uint32_t>(file, 44, supercompression_scheme);
+    return file;
+}
+
+// levels holds the byte length of every level, they follow the level index in reverse order like the format asks
+std::vector<std::byte> MakeKtx2(const uint32_t vk_format, const uint32_t width, const uint32_t height, const std::vector<uint64_t>& levels)
+{
+    std::vector<std::byte> file = MakeKtx2Header(vk_format, width, height, levels.size(), 0);
+    for (size_t level = levels.size(); level-- > 0;) {
+        const size_t entry = KTX2_HEADER_SIZE + level * KTX2_LEVEL_INDEX_ENTRY_SIZE;
+        WriteAt<uint64_t>(file, entry, file.size());
+        WriteAt<uint64_t>(file, entry + 8, levels[level]);
+        WriteAt<uint64_t>(file, entry + 16, levels[level]);
+        file.resize(file.size() + levels[level]);
+    }
+    return file;
+}
+
+// every level is a zstd frame that inflates to the matching uncompressed length
+std::vector<std::byte> MakeKtx2Zstd(const uint32_t vk_format, const uint32_t width, const uint32_t height, const std::vector<std::vector<std::byte>>& frames, const std::vector<uint64_t>& uncompressed_lengths)
+{
+    std::vector<std::byte> file = MakeKtx2Header(vk_format, width, height, frames.size(), KTX2_SUPERCOMPRESSION_ZSTD);
+    for (size_t level = frames.size(); level-- > 0;) {
+        const size_t entry = KTX2_HEADER_SIZE + level * KTX2_LEVEL_INDEX_ENTRY_SIZE;
+        WriteAt<uint64_t>(file, entry, file.size());
+        WriteAt<uint64_t>(file, entry + 8, frames[level].size());
+        WriteAt<uint64_t>(file, entry + 16, uncompressed_lengths[level]);
+        file.insert(file.end(), frames[level].begin(), frames[level].end());
+    }
+    return file;
+}
+
+// a single segment frame holding payload as one raw (stored) block, payload is shorter than 256 bytes
+std::vector<std::byte> MakeZstdRawFrame(const std::vector<std::byte>& payload)
+{
+    const uint32_t block_header = 1 | static_cast<uint32_t>(payload.size()) << 3; // last block, raw, size
+    std::vector<std::byte> frame {
+        std::byte { 0x28 }, std::byte { 0xb5 }, std::byte { 0x2f }, std::byte { 0xfd }, // magic
+        std::byte { 0x20 }, // single segment, one byte content size
+        static_cast<std::byte>(payload.size()),
+        static_cast<std::byte>(block_header), static_cast<std::byte>(block_header >> 8), static_cast<std::byte>(block_header >> 16),
+    };
+    frame.insert(frame.end(), payload.begin(), payload.end());
+    return frame;
+}
+
+const std::byte* LevelData(const TextureData& texture, const size_t level)
+{
+    return static_cast<const std::byte*>(texture.subresources[level].pData);
+}
+
+}
+
+ANNI_TEST(TextureContainer, DdsLevels)
+{
+    // BC3 16x8, 5 levels of 8, 2, 1, 1 and 1 blocks
+    const std::vector<std::byte> file = MakeDds(16, 8, 5, "DXT5", 16 * (8 + 2 + 1 + 1 + 1));
+    ANNI_CHECK(IsTextureContainer(file.data(), file.size()));
+
+    TextureData texture;
+    std::string error;
+    ANNI_CHECK(ParseTextureContainer(file.data(), file.size(), texture, error));
+    ANNI_CHECK(texture.width == 16 && texture.height == 8);
+    ANNI_CHECK(texture.format == DXGI_FORMAT_BC3_UNORM);
+    ANNI_CHECK(texture.mip_levels == 5);
+    ANNI_CHECK(texture.subresources.size() == 5);
+    ANNI_CHECK(LevelData(texture, 0) == file.data() + 128);
+    ANNI_CHECK(texture.subresources[0].RowPitch == 4 * 16);
+    ANNI_CHECK(texture.subresources[0].SlicePitch == 8 * 16);
+    ANNI_CHECK(LevelData(texture, 1) == file.data() + 128 + 8 * 16);
+    ANNI_CHECK(texture.subresources[4].SlicePitch == 16);
+
+    // one byte short of the last level
+    const std::vector<std::byte> truncated(file.begin(), file.end() - 1);
+    ANNI_CHECK(!ParseTextureContainer(truncated.data(), truncated.size(), texture, error));
+    ANNI_CHECK(texture.subresources.empty());
+}
+
+ANNI_TEST(TextureContainer, Ktx2Levels)
+{
+    // BC7 sRGB 8x8 with 2 levels, loaded as UNORM
+    const std::vector<std::byte> file = MakeKtx2(VK_FORMAT_BC7_SRGB_BLOCK, 8, 8, { 64, 16 });
+    ANNI_CHECK(IsTextureContainer(file.data(), file.size()));
+
+    TextureData texture;
+    std::string error;
+    ANNI_CHECK(ParseTextureContainer(file.data(), file.size(), texture, error));
+    ANNI_CHECK(texture.format == DXGI_FORMAT_BC7_UNORM);
+    ANNI_CHECK(texture.mip_levels == 2);
+    ANNI_CHECK(texture.subresources[0].SlicePitch == 64);
+    ANNI_CHECK(texture.subresources[1].SlicePitch == 16);
+    // the smaller level comes first in the file
+    ANNI_CHECK(LevelData(texture, 1) < LevelData(texture, 0));
+    ANNI_CHECK(LevelData(texture, 0) + 64 == file.data() + file.size());
+
+    // a level whose length does not match the format
+    const std::vector<std::byte> mismatched = MakeKtx2(VK_FORMAT_BC7_SRGB_BLOCK, 8, 8, { 64, 32 });
+    ANNI_CHECK(!ParseTextureContainer(mismatched.data(), mismatched.size(), texture, error));
+}
+
+ANNI_TEST(TextureContainer, BlockCompressedSizeIsMultipleOf4)
+{
+    TextureData texture;
+    std::string error;
+
+    // 6x8 BC1, the base level ends in half a block
+    const std::vector<std::byte> dds = MakeDds(6, 8, 1, "DXT1", 2 * 2 * 8);
+    ANNI_CHECK(!ParseTextureContainer(dds.data(), dds.size(), texture, error));
+    ANNI_CHECK(error.find("multiple of 4") != std::string::npos);
+
+    const std::vector<std::byte> ktx2 = MakeKtx2(VK_FORMAT_BC7_SRGB_BLOCK, 8, 10, { 2 * 3 * 16 });
+    error.clear();
+    ANNI_CHECK(!ParseTextureContainer(ktx2.data(), ktx2.size(), texture, error));
+    ANNI_CHECK(error.find("multiple of 4") != std::string::npos);
+
+    // levels below the base level may be smaller than a block
+    const std::vector<std::byte> full_chain = MakeDds(4, 4, 3, "DXT1", 3 * 8);
+    ANNI_CHECK(ParseTextureContainer(full_chain.data(), full_chain.size(), texture, error));
+
+    // uncompressed textures have no blocks
+    const std::vector<std::byte> rgba = MakeKtx2(VK_FORMAT_R8G8B8A8_UNORM, 6, 5, { 6 * 5 * 4 });
+    ANNI_CHECK(ParseTextureContainer(rgba.data(), rgba.size(), texture, error));
+}
+
+ANNI_TEST(TextureContainer, Ktx2Zstd)
+{
+    // BC7 8x8 with 2 levels, a compressed frame and a stored one
+    std::vector<std::byte> level0(64);
+    for (size_t i = 0; i < level0.size(); ++i) {
+        level0[i] = static_cast<std::byte>(i * 7 % 16);
+    }
+    std::vector<std::byte> level1(16);
+    for (size_t i = 0; i < level1.size(); ++i) {
+        level1[i] = static_cast<std::byte>(0xF0 + i);
+    }
+    const std::vector<std::byte> pattern_frame(reinterpret_cast<const std::byte*>(ZSTD_PATTERN_FRAME), reinterpret_cast<const std::byte*>(ZSTD_PATTERN_FRAME) + sizeof(ZSTD_PATTERN_FRAME));
+    const std::vector<std::byte> file = MakeKtx2Zstd(VK_FORMAT_BC7_SRGB_BLOCK, 8, 8, { pattern_frame, MakeZstdRawFrame(level1) }, { 64, 16 });
+
+    TextureData texture;
+    std::string error;
+    const bool parsed = ParseTextureContainer(file.data(), file.size(), texture, error);
+    ANNI_CHECK(parsed);
+    if (!parsed) {
+        return;
+    }
+    ANNI_CHECK(texture.mip_levels == 2);
+    ANNI_CHECK(texture.subresources[0].SlicePitch == 64);
+    ANNI_CHECK(texture.subresources[1].SlicePitch == 16);
+    // the levels are inflated into storage the texture owns, not the file
+    ANNI_CHECK(texture.storage != nullptr);
+    ANNI_CHECK(LevelData(texture, 0) < file.data() || LevelData(texture, 0) >= file.data() + file.size());
+    ANNI_CHECK(memcmp(LevelData(texture, 0), level0.data(), level0.size()) == 0);
+    ANNI_CHECK(memcmp(LevelData(texture, 1), level1.data(), level1.size()) == 0);
+
+    // the uncompressed length has to match the format
+    const std::vector<std::byte> mismatched = MakeKtx2Zstd(VK_FORMAT_BC7_SRGB_BLOCK, 8, 8, { pattern_frame, MakeZstdRawFrame(level1) }, { 64, 32 });
+    ANNI_CHECK(!ParseTextureContainer(mismatched.data(), mismatched.size(), texture, error));
+    ANNI_CHECK(texture.subresources.empty() && texture.storage == nullptr);
+
+    // a frame that inflates to fewer bytes than the level
+    const std::vector<std::byte> short_frame = MakeKtx2Zstd(VK_FORMAT_BC7_SRGB_BLOCK, 4, 4, { MakeZstdRawFrame(std::vector<std::byte>(8)) }, { 16 });
+    error.clear();
+    ANNI_CHECK(!ParseTextureContainer(short_frame.data(), short_frame.size(), texture, error));
+    ANNI_CHECK(!error.empty());
+
+    // a corrupt frame
+    std::vector<std::byte> corrupt_frame = pattern_frame;
+    corrupt_frame[9] = std::byte { 0xFF };
+    const std::vector<std::byte> corrupt = MakeKtx2Zstd(VK_FORMAT_BC7_SRGB_BLOCK, 8, 8, { corrupt_frame, MakeZstdRawFrame(level1) }, { 64, 16 });
+    error.clear();
+    ANNI_CHECK(!ParseTextureContainer(corrupt.data(), corrupt.size(), texture, error));
+    ANNI_CHECK(error.find("failed to inflate") != std::string::npos);
+
+    // Basis Universal still needs a transcoder
+    std::vector<std::byte> basis = MakeKtx2(VK_FORMAT_BC7_SRGB_BLOCK, 8, 8, { 64 });
+    WriteAt<uint32_t>(basis, 44, 1);
+    ANNI_CHECK(!ParseTextureContainer(basis.data(), basis.size(), texture, error));
+}
@@ -0,0 +1,231 @@
+#include "Test.h"
+#include "TlsfAllocator.h"
+
+#include <cstddef>
+#include <vector>
+
+using Anni::TlsfAllocator;
+
+namespace {
+
+constexpr uint64_t KB = 1024;
+constexpr uint64_t MB = 1024 * KB;
+
+// the placement alignments of D3D12 resources: buffers and textures, MSAA textures
+constexpr uint64_t DEFAULT_ALIGNMENT = 64 * KB;
+constexpr uint64_t MSAA_ALIGNMENT = 4 * MB;
+
+bool Overlap(const TlsfAllocator::Allocation& a, const TlsfAllocator::Allocation& b)
+{
+    return a.offset < b.offset + b.size && b.offset < a.offset + a.size;
+}
+
+}
+
+ANNI_TEST(TlsfAllocator, AlignmentClasses)
+{
+    TlsfAllocator allocator(64 * MB, DEFAULT_ALIGNMENT);
+
+    // sizes round up to whole granules
+    const TlsfAllocator::Allocation small = allocator.Allocate(100 * KB, DEFAULT_ALIGNMENT);
+    ANNI_CHECK(small.IsValid());
+    ANNI_CHECK(small.offset == 0);
+    ANNI_CHECK(small.size == 128 * KB);
+
+    // the padding in front of the 4 MB aligned allocation stays free
+    const TlsfAllocator::Allocation msaa = allocator.Allocate(1 * MB, MSAA_ALIGNMENT);
+    ANNI_CHECK(msaa.IsValid());
+    ANNI_CHECK(msaa.offset % MSAA_ALIGNMENT == 0);
+    ANNI_CHECK(msaa.offset == 4 * MB);
+    ANNI_CHECK(msaa.size == 1 * MB);
+
+    const TlsfAllocator::Allocation in_padding = allocator.Allocate(64 * KB, DEFAULT_ALIGNMENT);
+    ANNI_CHECK(in_padding.IsValid());
+    ANNI_CHECK(in_padding.offset % DEFAULT_ALIGNMENT == 0);
+    ANNI_CHECK(in_padding.offset + in_padding.size <= msaa.offset);
+
+    // alignments below the granularity are free
+    const TlsfAllocator::Allocation byte_aligned = allocator.Allocate(1, 1);
+    ANNI_CHECK(byte_aligned.IsValid());
+    ANNI_CHECK(byte_aligned.offset % DEFAULT_ALIGNMENT == 0);
+    ANNI_CHECK(byte_aligned.size == DEFAULT_ALIGNMENT);
+
+    for (uint32_t i = 0; i < 4; ++i) {
+        const TlsfAllocator::Allocation aligned = allocator.Allocate(64 * KB, MSAA_ALIGNMENT);
+        ANNI_CHECK(aligned.IsValid());
+        ANNI_CHECK(aligned.offset % MSAA_ALIGNMENT == 0);
+    }
+}
+
+ANNI_TEST(TlsfAllocator, SplitAndMergeOnFree)
+{
+    TlsfAllocator allocator(1 * MB, DEFAULT_ALIGNMENT);
+
+    const TlsfAllocator::Allocation a = allocator.Allocate(64 * KB, DEFAULT_ALIGNMENT);
+    const TlsfAllocator::Allocation b = allocator.Allocate(64 * KB, DEFAULT_ALIGNMENT);
+    const TlsfAllocator::Allocation c = allocator.Allocate(64 * KB, DEFAULT_ALIGNMENT);
+    ANNI_CHECK(a.offset == 0);
+    ANNI_CHECK(b.offset == 64 * KB);
+    ANNI_CHECK(c.offset == 128 * KB);
+    // the rest of the heap was split off into one free block
+    ANNI_CHECK(allocator.GetStats().free_block_count == 1);
+
+    // a hole between two allocations
+    allocator.Free(b);
+    ANNI_CHECK(allocator.GetStats().free_block_count == 2);
+
+    // merges with the hole after it
+    allocator.Free(a);
+    TlsfAllocator::Stats stats = allocator.GetStats();
+    ANNI_CHECK(stats.free_block_count == 2);
+    ANNI_CHECK(stats.largest_free_block == 1 * MB - 192 * KB);
+
+    // merges with both neighbours, the heap is in one piece again
+    allocator.Free(c);
+    stats = allocator.GetStats();
+    ANNI_CHECK(allocator.IsEmpty());
+    ANNI_CHECK(stats.free_block_count == 1);
+    ANNI_CHECK(stats.largest_free_block == 1 * MB);
+    ANNI_CHECK(stats.used == 0);
+
+    // and is handed out whole
+    const TlsfAllocator::Allocation whole = allocator.Allocate(1 * MB, DEFAULT_ALIGNMENT);
+    ANNI_CHECK(whole.IsValid());
+    ANNI_CHECK(whole.offset == 0);
+}
+
+ANNI_TEST(TlsfAllocator, Exhaustion)
+{
+    TlsfAllocator allocator(1 * MB, DEFAULT_ALIGNMENT);
+
+    ANNI_CHECK(!allocator.Allocate(2 * MB, DEFAULT_ALIGNMENT).IsValid());
+
+    std::vector<TlsfAllocator::Allocation> allocations;
+    for (uint32_t i = 0; i < 16; ++i) {
+        allocations.push_back(allocator.Allocate(64 * KB, DEFAULT_ALIGNMENT));
+        ANNI_CHECK(allocations.back().IsValid());
+    }
+    const TlsfAllocator::Stats stats = allocator.GetStats();
+    ANNI_CHECK(stats.used == stats.size);
+    ANNI_CHECK(stats.free_block_count == 0);
+    ANNI_CHECK(stats.fragmentation == 0.0f);
+
+    // a full heap fails instead of overlapping anything
+    const TlsfAllocator::Allocation failed = allocator.Allocate(64 * KB, DEFAULT_ALIGNMENT);
+    ANNI_CHECK(!failed.IsValid());
+    ANNI_CHECK(failed.offset == TlsfAllocator::INVALID_OFFSET);
+
+    allocator.Free(allocations[5]);
+    const TlsfAllocator::Allocation refilled = allocator.Allocate(64 * KB, DEFAULT_ALIGNMENT);
+    ANNI_CHECK(refilled.IsValid());
+    ANNI_CHECK(refilled.offset == allocations[5].offset);
+
+    // enough free space in total but not in one piece
+    allocator.Free(allocations[1]);
+    allocator.Free(allocations[3]);
+    ANNI_CHECK(!allocator.Allocate(128 * KB, DEFAULT_ALIGNMENT).IsValid());
+
+    // no 4 MB aligned offset but 0 in the heap, and 0 is taken
+    TlsfAllocator small_heap(4 * MB, DEFAULT_ALIGNMENT);
+    ANNI_CHECK(small_heap.Allocate(64 * KB, DEFAULT_ALIGNMENT).IsValid());
+    ANNI_CHECK(!small_heap.Allocate(64 * KB, MSAA_ALIGNMENT).IsValid());
+}
+
+ANNI_TEST(TlsfAllocator, Aliasing)
+{
+    TlsfAllocator allocator(16 * MB, DEFAULT_ALIGNMENT);
+
+    // transient resources alias one allocation sized for the largest of them, the memory is reused at the same offset
+    // once it is freed
+    const TlsfAllocator::Allocation first = allocator.Allocate(64 * KB, DEFAULT_ALIGNMENT);
+    const TlsfAllocator::Allocation transient = allocator.Allocate(3 * MB, DEFAULT_ALIGNMENT);
+    const TlsfAllocator::Allocation last = allocator.Allocate(64 * KB, DEFAULT_ALIGNMENT);
+    ANNI_CHECK(transient.IsValid());
+    allocator.Free(transient);
+    const TlsfAllocator::Allocation reused = allocator.Allocate(3 * MB, DEFAULT_ALIGNMENT);
+    ANNI_CHECK(reused.offset == transient.offset);
+    ANNI_CHECK(reused.size == transient.size);
+    allocator.Free(reused);
+    allocator.Free(first);
+    allocator.Free(last);
+    ANNI_CHECK(allocator.IsEmpty());
+
+    // live allocations never share memory, whatever order they come and go in
+    std::vector<TlsfAllocator::Allocation> live;
+    uint32_t random = 12345;
+    for (uint32_t step = 0; step < 2000; ++step) {
+        random = random * 1664525u + 1013904223u;
+        if (live.empty() || (random >> 16) % 3 != 0) {
+            const uint64_t size = (1 + (random >> 8) % 16) * 48 * KB;
+            const uint64_t alignment = (random >> 4) % 8 == 0 ? MSAA_ALIGNMENT : DEFAULT_ALIGNMENT;
+            const TlsfAllocator::Allocation allocation = allocator.Allocate(size, alignment);
+            if (!allocation.IsValid()) {
+                continue;
+            }
+            ANNI_CHECK(allocation.offset % alignment == 0);
+            ANNI_CHECK(allocation.offset + allocation.size <= 16 * MB);
+            for (const TlsfAllocator::Allocation& other : live) {
+                ANNI_CHECK(!Overlap(allocation, other));
+            }
+            live.push_back(allocation);
+        } else {
+            const size_t index = (random >> 8) % live.size();
+            allocator.Free(live[index]);
+            live[index] = live.back();
+            live.pop_back();
+        }
+    }
+
+    uint64_t live_size = 0;
+    for (const TlsfAllocator::Allocation& allocation : live) {
+        live_size += allocation.size;
+    }
+    ANNI_CHECK(allocator.GetStats().used == live_size);
+    ANNI_CHECK(allocator.GetStats().allocation_count == live.size());
+
+    for (const TlsfAllocator::Allocation& allocation : live) {
+        allocator.Free(allocation);
+    }
+    ANNI_CHECK(allocator.IsEmpty());
+    ANNI_CHECK(allocator.GetStats().free_block_count == 1);
+}
+
+ANNI_TEST(TlsfAllocator, FragmentationStats)
+{
+    TlsfAllocator allocator(1 * MB, DEFAULT_ALIGNMENT);
+
+    TlsfAllocator::Stats stats = allocator.GetStats();
+    ANNI_CHECK(stats.size == 1 * MB);
+    ANNI_CHECK(stats.used == 0);
+    ANNI_CHECK(stats.allocation_count == 0);
+    ANNI_CHECK(stats.free_block_count == 1);
+    ANNI_CHECK(stats.largest_free_block == 1 * MB);
+    ANNI_CHECK(stats.fragmentation == 0.0f);
+
+    TlsfAllocator::Allocation quarters[4];
+    for (TlsfAllocator::Allocation& quarter : quarters) {
+        quarter = allocator.Allocate(256 * KB, DEFAULT_ALIGNMENT);
+    }
+
+    // two free quarters that cannot merge: half of the free space is out of reach of a single allocation
+    allocator.Free(quarters[0]);
+    allocator.Free(quarters[2]);
+    stats = allocator.GetStats();
+    ANNI_CHECK(stats.used == 512 * KB);
+    ANNI_CHECK(stats.allocation_count == 2);
+    ANNI_CHECK(stats.free_block_count == 2);
+    ANNI_CHECK(stats.largest_free_block == 256 * KB);
+    ANNI_CHECK(stats.fragmentation == 0.5f);
+
+    // three quarters in one piece
+    allocator.Free(quarters[1]);
+    stats = allocator.GetStats();
+    ANNI_CHECK(stats.free_block_count == 1);
+    ANNI_CHECK(stats.largest_free_block == 768 * KB);
+    ANNI_CHECK(stats.fragmentation == 0.0f);
+
+    allocator.Free(quarters[3]);
+    stats = allocator.GetStats();
+    ANNI_CHECK(stats.used == 0);
+    ANNI_CHECK(stats.fragmentation == 0.0f);
+}
@@ -0,0 +1,233 @@
+#include "Test.h"
+#include "VertexConversion.h"
+
+#include <cmath>
+#include <cstring>
+#include <random>
+#include <vector>
+
+using namespace Anni;
+
+namespace {
+
+constexpr AttributeComponent ALL_COMPONENTS[] = {
+    AttributeComponent::Float,
+    AttributeComponent::UNorm8,
+    AttributeComponent::UNorm16,
+    AttributeComponent::SNorm8,
+    AttributeComponent::SNorm16,
+    AttributeComponent::UInt8,
+    AttributeComponent::UInt16,
+    AttributeComponent::SInt8,
+    AttributeComponent::SInt16,
+};
+
+// not a multiple of either width, each count ends the SIMD groups in another place
+constexpr size_t VERTEX_COUNTS[] = { 1, 2, 3, 4, 5, 7, 8, 9, 15, 16, 17, 33 };
+
+// Float components the packing rounds in special ways: octahedral and unorm clamps, half rounding ties (to the
+// nearest, away from zero), half subnormals and their ties, float subnormals, overflow, infinities and NaNs.
+const std::vector<uint32_t>& SpecialFloats()
+{
+    static const std::vector<uint32_t> bits = {
+        0x00000000, 0x80000000, 0x3F800000, 0xBF800000, 0x3F000000,
+        0x3F801000, 0xBF801000, 0x3F803000, // 1 + 2^-11 and 1 + 3 * 2^-11, halfway between two halves
+        0x33000000, 0x33400000, 0xB3400000, // 2^-25 and 1.5 * 2^-24, halfway between two half subnormals
+        0x38800000, 0x387FE000, 0x387FF000, // smallest normal half, largest subnormal half and halfway past it
+        0x00000001, 0x807FFFFF, // float subnormals
+        0x477FE000, 0x477FF000, 0x477FEFFF, 0x47800000, // 65504, halfway to the next half, just under, 65536
+        0x7F800000, 0xFF800000, // infinities
+        0x7FC00000, 0xFFC00001, 0x7F800001, 0x7FA00000, // quiet NaN, NaN with a low payload, signaling NaNs
+        0x3B808081, 0x3C008081, // 1 / 255 and 2 / 255, right at the unorm steps
+    };
+    return bits;
+}
+
+size_t GetComponentSize(const AttributeComponent component)
+{
+    switch (component) {
+    case AttributeComponent::Float:
+        return 4;
+    case AttributeComponent::UNorm16:
+    case AttributeComponent::SNorm16:
+    case AttributeComponent::UInt16:
+    case AttributeComponent::SInt16:
+        return 2;
+    default:
+        return 1;
+    }
+}
+
+// One attribute in a buffer of its own, the buffer ends right after the last element so reading past it is caught.
+struct TestStream {
+    std::vector<std::byte> bytes;
+    AttributeStream stream;
+};
+
+// odd_stride pads the elements to a stride that is not a multiple of 4
+TestStream MakeStream(std::mt19937& random, const AttributeComponent component, const uint32_t component_count, const size_t count, const bool odd_stride)
+{
+    const size_t element_size = GetComponentSize(component) * component_count;
+    size_t stride = element_size;
+    if (odd_stride) {
+        stride += (element_size + 1) % 4 == 0 ? 2 : 1;
+    }
+
+    TestStream test_stream;
+    test_stream.bytes.resize((count - 1) * stride + element_size);
+    for (std::byte& b : test_stream.bytes) {
+        b = static_cast<std::byte>(random());
+    }
+    if (component == AttributeComponent::Float) {
+        std::uniform_real_distribution<float> value(-1.5f, 1.5f);
+        const std::vector<uint32_t>& specials = SpecialFloats();
+        for (size_t i = 0; i < count; ++i) {
+            for (uint32_t c = 0; c < component_count; ++c) {
+                uint32_t bits;
+                if (random() % 4 == 0) {
+                    bits = specials[random() % specials.size()];
+                } else {
+                    const float f = value(random);
+                    memcpy(&bits, &f, sizeof(bits));
+                }
+                memcpy(test_stream.bytes.data() + i * stride + c * 4, &bits, sizeof(bits));
+            }
+        }
+    }
+    test_stream.stream = { test_stream.bytes.data(), stride, component, component_count };
+    return test_stream;
+}
+
+void CheckLevelsMatchScalar(const VertexStreams& streams, const size_t count)
+{
+    // one vertex more than converted, nothing may be written to it
+    std::vector<StandardVertex> expected(count + 1);
+    memset(static_cast<void*>(expected.data()), 0xCD, expected.size() * sizeof(StandardVertex));
+    ConvertVertices(streams, count, expected.data(), SimdLevel::Scalar);
+
+    for (const SimdLevel level : { SimdLevel::SSE41, SimdLevel::AVX2 }) {
+        if (GetSimdLevel() < level) {
+            continue;
+        }
+        std::vector<StandardVertex> vertices(count + 1);
+        memset(static_cast<void*>(vertices.data()), 0xCD, vertices.size() * sizeof(StandardVertex));
+        ConvertVertices(streams, count, vertices.data(), level);
+        ANNI_CHECK(memcmp(vertices.data(), expected.data(), vertices.size() * sizeof(StandardVertex)) == 0);
+    }
+}
+
+}
+
+ANNI_TEST(VertexConversion, EveryComponentMatchesScalar)
+{
+    std::mt19937 random(18);
+    for (const AttributeComponent component : ALL_COMPONENTS) {
+        for (const size_t count : VERTEX_COUNTS) {
+            for (const bool odd_stride : { false, true }) {
+                const TestStream position = MakeStream(random, component, 3, count, odd_stride);
+                const TestStream normal = MakeStream(random, component, 3, count, odd_stride);
+                const TestStream tangent = MakeStream(random, component, 4, count, odd_stride);
+                const TestStream uv = MakeStream(random, component, 2, count, odd_stride);
+                const TestStream color = MakeStream(random, component, odd_stride ? 3 : 4, count, odd_stride);
+
+                VertexStreams streams;
+                streams.position = position.stream;
+                streams.normal = normal.stream;
+                streams.tangent = tangent.stream;
+                streams.uv = uv.stream;
+                streams.color = color.stream;
+                CheckLevelsMatchScalar(streams, count);
+
+                // only the position, every other attribute is the default
+                VertexStreams position_only;
+                position_only.position = position.stream;
+                CheckLevelsMatchScalar(position_only, count);
+            }
+        }
+    }
+}
+
+ANNI_TEST(VertexConversion, InterleavedOddStride)
+{
+    // position float3, normal snorm16x3, tangent snorm8x4, uv unorm16x2 and color unorm8x3: 29 bytes
+    constexpr size_t stride = 12 + 6 + 4 + 4 + 3;
+    std::mt19937 random(19);
+    std::uniform_real_distribution<float> value(-100.0f, 100.0f);
+
+    for (size_t count = 1; count <= 40; ++count) {
+        std::vector<std::byte> buffer(count * stride);
+        for (std::byte& b : buffer) {
+            b = static_cast<std::byte>(random());
+        }
+        for (size_t i = 0; i < count; ++i) {
+            for (int c = 0; c < 3; ++c) {
+                const float f = value(random);
+                memcpy(buffer.data() + i * stride + c * 4, &f, sizeof(f));
+            }
+        }
+
+        VertexStreams streams;
+        streams.position = { buffer.data(), stride, AttributeComponent::Float, 3 };
+        streams.normal = { buffer.data() + 12, stride, AttributeComponent::SNorm16, 3 };
+        streams.tangent = { buffer.data() + 18, stride, AttributeComponent::SNorm8, 4 };
+        streams.uv = { buffer.data() + 22, stride, AttributeComponent::UNorm16, 2 };
+        streams.color = { buffer.data() + 26, stride, AttributeComponent::UNorm8, 3 };
+        CheckLevelsMatchScalar(streams, count);
+    }
+}
+
+ANNI_TEST(VertexConversion, HalfRoundingMatchesScalar)
+{
+    // every special value in every lane, then a sweep over the float bit patterns
+    std::vector<uint32_t> values;
+    for (const uint32_t special : SpecialFloats()) {
+        for (uint32_t lane = 0; lane < 9; ++lane) {
+            values.push_back(special);
+        }
+    }
+    for (uint64_t bits = 0; bits <= 0xFFFFFFFF; bits += 65521) {
+        values.push_back(static_cast<uint32_t>(bits));
+        // the same exponent with the bits below the half's significand exactly at half of its last place
+        values.push_back((static_cast<uint32_t>(bits) & 0xFFFFE000) | 0x1000);
+    }
+    if (values.size() % 2 != 0) {
+        values.push_back(0);
+    }
+
+    const size_t count = values.size() / 2;
+    const std::vector<float> positions(count * 3, 0.0f);
+    VertexStreams streams;
+    streams.position = { reinterpret_cast<const std::byte*>(positions.data()), 12, AttributeComponent::Float, 3 };
+    streams.uv = { reinterpret_cast<const std::byte*>(values.data()), 8, AttributeComponent::Float, 2 };
+    CheckLevelsMatchScalar(streams, count);
+}
+
+ANNI_TEST(VertexConversion, IndicesMatchScalar)
+{
+    std::mt19937 random(20);
+    for (const uint32_t index_size : { 1u, 2u, 4u }) {
+        for (size_t count = 1; count <= 40; ++count) {
+            // sized exactly, a wide load past the end is caught
+            std::vector<std::byte> data(count * index_size);
+            for (std::byte& b : data) {
+                b = static_cast<std::byte>(random());
+            }
+
+            std::vector<uint32_t> expected(count + 1, 0xCDCDCDCD);
+            for (size_t i = 0; i < count; ++i) {
+                uint32_t index = 0;
+                memcpy(&index, data.data() + i * index_size, index_size);
+                expected[i] = index;
+            }
+
+            for (const SimdLevel level : { SimdLevel::Scalar, SimdLevel::SSE41, SimdLevel::AVX2 }) {
+                if (GetSimdLevel() < level) {
+                    continue;
+                }
+                std::vector<uint32_t> indices(count + 1, 0xCDCDCDCD);
+                ConvertIndices(data.data(), index_size, count, indices.data(), level);
+                ANNI_CHECK(indices == expected);
+            }
+        }
+    }
+}
@@ -0,0 +1,121 @@
+#include "AnniUtils.h"
+#include "Test.h"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+using namespace Anni;
+
+namespace {
+
+// 16 bit snorm octahedral coordinates, the worst case over the sphere is just under 0.004 degrees (7e-5 radians)
+constexpr float OCTAHEDRAL_MAX_ANGLE = 0.0001f;
+// round to nearest half, the 11 bit significand is off by at most half a unit in the last place
+constexpr float HALF_MAX_RELATIVE_ERROR = 1.0f / 2048.0f;
+// half the smallest subnormal half, for the values below the normal range
+constexpr float HALF_MAX_SUBNORMAL_ERROR = 1.0f / 33554432.0f;
+constexpr float HALF_MIN_NORMAL = 1.0f / 16384.0f;
+// half a step of 8 bit unorm, and a little for the float math
+constexpr float UNORM8_MAX_ERROR = 0.5f / 255.0f + 1e-6f;
+
+float AngleBetween(const glm::vec3& a, const glm::vec3& b)
+{
+    // atan2 of the cross and dot products stays accurate for tiny angles, acos of the dot does not
+    return std::atan2(glm::length(glm::cross(a, b)), glm::dot(a, b));
+}
+
+}
+
+ANNI_TEST(VertexPacking, OctahedralRoundTrip)
+{
+    std::mt19937 random(6);
+    std::normal_distribution<float> gaussian;
+
+    std::vector<glm::vec3> directions = {
+        { 1, 0, 0 }, { -1, 0, 0 }, { 0, 1, 0 }, { 0, -1, 0 }, { 0, 0, 1 }, { 0, 0, -1 },
+        glm::normalize(glm::vec3(1, 1, 1)), glm::normalize(glm::vec3(-1, -1, -1)),
+        // on the folded seams of the lower hemisphere
+        glm::normalize(glm::vec3(1, 0, -1)), glm::normalize(glm::vec3(0, -1, -1)), glm::normalize(glm::vec3(1e-4f, 1e-4f, -1)),
+    };
+    // uniform on the sphere
+    for (uint32_t i = 0; i < 100000; ++i) {
+        const glm::vec3 v(gaussian(random), gaussian(random), gaussian(random));
+        if (glm::length(v) > 1e-3f) {
+            directions.push_back(glm::normalize(v));
+        }
+    }
+
+    float max_angle = 0.0f;
+    for (const glm::vec3& direction : directions) {
+        const glm::vec3 decoded = UnpackOctahedral(PackOctahedral(direction));
+        ANNI_CHECK(std::abs(glm::length(decoded) - 1.0f) < 1e-5f);
+        max_angle = std::max(max_angle, AngleBetween(direction, decoded));
+    }
+    ANNI_CHECK(max_angle <= OCTAHEDRAL_MAX_ANGLE);
+
+    // a degenerate normal still decodes to a unit vector
+    ANNI_CHECK(std::abs(glm::length(UnpackOctahedral(PackOctahedral(glm::vec3(0.0f)))) - 1.0f) < 1e-5f);
+}
+
+ANNI_TEST(VertexPacking, Half2RoundTrip)
+{
+    // exactly representable, texture coordinates on texel corners and wrapped ones
+    for (const float exact : { 0.0f, -0.0f, 0.25f, 0.5f, 1.0f, -1.0f, 2.0f, 0.125f, 1024.0f, -3.5f, 65504.0f }) {
+        const glm::vec2 decoded = UnpackHalf2(PackHalf2(glm::vec2(exact, -exact)));
+        ANNI_CHECK(decoded.x == exact);
+        ANNI_CHECK(decoded.y == -exact);
+    }
+
+    std::mt19937 random(7);
+    std::uniform_real_distribution<float> significand(1.0f, 2.0f);
+    std::uniform_int_distribution<int> exponent(-24, 15);
+    for (uint32_t i = 0; i < 100000; ++i) {
+        const float sign = random() % 2 == 0 ? 1.0f : -1.0f;
+        const glm::vec2 v(sign * std::ldexp(significand(random), exponent(random)), std::uniform_real_distribution<float>(-4.0f, 4.0f)(random));
+        if (std::abs(v.x) > 65504.0f) {
+            continue;
+        }
+
+        const glm::vec2 decoded = UnpackHalf2(PackHalf2(v));
+        for (int c = 0; c < 2; ++c) {
+            const float value = c == 0 ? v.x : v.y;
+            const float error = std::abs((c == 0 ? decoded.x : decoded.y) - value);
+            if (std::abs(value) >= HALF_MIN_NORMAL) {
+                ANNI_CHECK(error <= std::abs(value) * HALF_MAX_RELATIVE_ERROR);
+            } else {
+                ANNI_CHECK(error <= HALF_MAX_SUBNORMAL_ERROR);
+            }
+        }
+    }
+}
+
+ANNI_TEST(VertexPacking, UNorm4RoundTrip)
+{
+    // the stored steps come back exactly
+    for (uint32_t step = 0; step < 256; ++step) {
+        const float value = static_cast<float>(step) / 255.0f;
+        const glm::vec4 decoded = UnpackUNorm4(PackUNorm4(glm::vec4(value, 1.0f - value, value, 1.0f)));
+        ANNI_CHECK(std::abs(decoded.x - value) <= 1e-6f);
+        ANNI_CHECK(std::abs(decoded.y - (1.0f - value)) <= 1e-6f);
+        ANNI_CHECK(decoded.w == 1.0f);
+    }
+
+    std::mt19937 random(8);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    for (uint32_t i = 0; i < 100000; ++i) {
+        const glm::vec4 v(unit(random), unit(random), unit(random), unit(random));
+        const glm::vec4 decoded = UnpackUNorm4(PackUNorm4(v));
+        for (int c = 0; c < 4; ++c) {
+            ANNI_CHECK(std::abs(decoded[c] - v[c]) <= UNORM8_MAX_ERROR);
+        }
+    }
+
+    // colors out of range are clamped, not wrapped
+    const glm::vec4 clamped = UnpackUNorm4(PackUNorm4(glm::vec4(-0.5f, 2.0f, -100.0f, 1.5f)));
+    ANNI_CHECK(clamped.x == 0.0f);
+    ANNI_CHECK(clamped.y == 1.0f);
+    ANNI_CHECK(clamped.z == 0.0f);
+    ANNI_CHECK(clamped.w == 1.0f);
+}
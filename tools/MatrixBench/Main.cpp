@@ -0,0 +1,158 @@
+#include "MatrixKernels.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+// Microbenchmark of the MatrixKernels batches against plain glm loops, in ns per matrix or bounds.
+// Every SIMD level the CPU supports is timed through the same entry points the renderer calls, so a row shows what
+// the dispatch picks at that level, and the glm row is the loop the kernels replaced.
+// MatrixBench [count] [repeats], 4096 matrices and 200 repeats by default.
+
+namespace {
+
+using namespace Anni;
+
+struct Workload {
+    std::vector<glm::mat4> left;
+    std::vector<glm::mat4> right;
+    std::vector<glm::mat4> out;
+    std::vector<INT32> parents;
+    std::vector<Bounds> bounds;
+    std::vector<Bounds> bounds_out;
+};
+
+Workload MakeWorkload(const size_t count)
+{
+    std::mt19937 random(23);
+    std::uniform_real_distribution<float> value(-2.0f, 2.0f);
+
+    Workload workload;
+    workload.left.resize(count);
+    workload.right.resize(count);
+    workload.out.resize(count);
+    workload.parents.resize(count);
+    workload.bounds.resize(count);
+    workload.bounds_out.resize(count);
+    for (size_t i = 0; i < count; ++i) {
+        for (int c = 0; c < 4; ++c) {
+            workload.left[i][c] = glm::vec4(value(random), value(random), value(random), value(random));
+            workload.right[i][c] = glm::vec4(value(random), value(random), value(random), value(random));
+        }
+        // a shallow tree, every parent comes before its children
+        workload.parents[i] = i == 0 ? -1 : static_cast<INT32>(random() % i);
+        workload.bounds[i].origin = glm::vec3(value(random), value(random), value(random));
+        workload.bounds[i].extents = glm::abs(glm::vec3(value(random), value(random), value(random)));
+        workload.bounds[i].sphereRadius = glm::length(workload.bounds[i].extents);
+    }
+    return workload;
+}
+
+// best of repeats, in ns per item
+template <typename Run>
+double Time(const size_t count, const uint32_t repeats, Run run)
+{
+    double best = 1e30;
+    for (uint32_t r = 0; r < repeats; ++r) {
+        const auto begin = std::chrono::steady_clock::now();
+        run();
+        const auto end = std::chrono::steady_clock::now();
+        best = std::min(best, std::chrono::duration<double, std::nano>(end - begin).count() / static_cast<double>(count));
+    }
+    return best;
+}
+
+void PrintRow(const char* name, const double nxn, const double one_by_n, const double transpose, const double concat, const double bounds)
+{
+    std::cout << std::left << std::setw(10) << name << std::right << std::fixed << std::setprecision(2)
+              << std::setw(9) << nxn << std::setw(9) << one_by_n << std::setw(11) << transpose << std::setw(9) << concat << std::setw(9) << bounds << '\n';
+}
+
+// reads the outputs so the loops can't be dropped
+float Checksum(const Workload& workload)
+{
+    return workload.out.back()[3][3] + workload.bounds_out.back().extents.x;
+}
+
+}
+
+int main(int argc, char** argv)
+{
+    const size_t count = argc > 1 ? std::stoul(argv[1]) : 4096;
+    const uint32_t repeats = argc > 2 ? static_cast<uint32_t>(std::stoul(argv[2])) : 200;
+    if (count == 0 || repeats == 0) {
+        std::cerr << "usage: MatrixBench [count] [repeats]" << '\n';
+        return 1;
+    }
+
+    Workload workload = MakeWorkload(count);
+    float checksum = 0.0f;
+
+    std::cout << "[MatrixBench] " << count << " items, best of " << repeats << " runs, ns per item" << '\n';
+    std::cout << std::setw(10) << "" << std::setw(9) << "NxN" << std::setw(9) << "1xN" << std::setw(11) << "transpose"
+              << std::setw(9) << "concat" << std::setw(9) << "bounds" << '\n';
+
+    //> glm
+    {
+        const double nxn = Time(count, repeats, [&] {
+            for (size_t i = 0; i < count; ++i) {
+                workload.out[i] = workload.left[i] * workload.right[i];
+            }
+        });
+        const double one_by_n = Time(count, repeats, [&] {
+            const glm::mat4 a = workload.left[0];
+            for (size_t i = 0; i < count; ++i) {
+                workload.out[i] = a * workload.right[i];
+            }
+        });
+        const double transpose = Time(count, repeats, [&] {
+            for (size_t i = 0; i < count; ++i) {
+                workload.out[i] = glm::transpose(workload.out[i]);
+            }
+        });
+        const double concat = Time(count, repeats, [&] {
+            for (size_t i = 0; i < count; ++i) {
+                workload.out[i] = workload.parents[i] < 0 ? workload.left[i] : workload.out[workload.parents[i]] * workload.left[i];
+            }
+        });
+        const double bounds = Time(count, repeats, [&] {
+            for (size_t i = 0; i < count; ++i) {
+                workload.bounds_out[i] = TransformBounds(workload.bounds[i], workload.right[0]);
+            }
+        });
+        checksum += Checksum(workload);
+        PrintRow("glm", nxn, one_by_n, transpose, concat, bounds);
+    }
+    //< glm
+
+    //> kernels
+    for (uint8_t l = static_cast<uint8_t>(SimdLevel::SSE41); l <= static_cast<uint8_t>(GetSimdLevel()); ++l) {
+        const SimdLevel level = static_cast<SimdLevel>(l);
+        const double nxn = Time(count, repeats, [&] {
+            MultiplyMatrices(workload.left.data(), workload.right.data(), count, workload.out.data(), level);
+        });
+        const double one_by_n = Time(count, repeats, [&] {
+            MultiplyMatrices(workload.left[0], workload.right.data(), count, workload.out.data(), level);
+        });
+        const double transpose = Time(count, repeats, [&] {
+            TransposeMatrices(workload.out.data(), count, level);
+        });
+        // one path for every level
+        const double concat = Time(count, repeats, [&] {
+            ConcatenateTransforms(workload.parents.data(), workload.left.data(), 0, count, workload.out.data());
+        });
+        const double bounds = Time(count, repeats, [&] {
+            TransformBounds(workload.bounds.data(), count, workload.right[0], workload.bounds_out.data(), level);
+        });
+        checksum += Checksum(workload);
+        PrintRow(GetSimdLevelName(level), nxn, one_by_n, transpose, concat, bounds);
+    }
+    //< kernels
+
+    std::cout << "[MatrixBench] checksum " << std::defaultfloat << checksum << '\n';
+    return 0;
+}
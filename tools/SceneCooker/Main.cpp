@@ -0,0 +1,59 @@
+#include "GltfImporter.h"
+#include "LoadProfiler.h"
+#include "ScenePack.h"
+
+#include <chrono>
+
+// Offline cooker: imports a glTF with the same code path the renderer uses and writes the result as a scene pack.
+// The renderer picks up <model>.scenepack next to the .gltf when it exists.
+// --profile and --trace write the LoadProfiler report and Chrome trace of the import, to track it across releases.
+int main(int argc, char** argv)
+{
+    std::string profile_path;
+    std::string trace_path;
+    std::vector<std::string> paths;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg == "--profile" && i + 1 < argc) {
+            profile_path = argv[++i];
+        } else if (arg == "--trace" && i + 1 < argc) {
+            trace_path = argv[++i];
+        } else {
+            paths.push_back(arg);
+        }
+    }
+
+    if (paths.size() != 2) {
+        std::cerr << "usage: SceneCooker <input.gltf> <output.scenepack> [--profile <report.json>] [--trace <trace.json>]" << '\n';
+        return 1;
+    }
+
+    try {
+        const auto cook_begin = std::chrono::steady_clock::now();
+
+        {
+            const Anni::ProfileAsset profile_asset(paths[0]);
+            Anni::ThreadPool thread_pool(Anni::IMPORT_THREAD_COUNT);
+            Anni::ModelData model_data;
+            Anni::ImportGltf(paths[0], thread_pool, Anni::BufferLoadMode::MemoryMapped, model_data);
+            const Anni::ProfileZone write_zone("WriteScenePack");
+            Anni::WriteScenePack(model_data, paths[0], paths[1]);
+        }
+
+        const auto cook_end = std::chrono::steady_clock::now();
+        std::cout << "[SceneCooker] cooked " << paths[0] << " into " << paths[1] << " in "
+                  << std::chrono::duration<double, std::milli>(cook_end - cook_begin).count() << " ms" << '\n';
+
+        if (!profile_path.empty()) {
+            Anni::LoadProfiler::Get().WriteReport(profile_path);
+        }
+        if (!trace_path.empty()) {
+            Anni::LoadProfiler::Get().WriteChromeTrace(trace_path);
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "[SceneCooker] failed to cook " << paths[0] << ": " << e.what() << '\n';
+        return 1;
+    }
+
+    return 0;
+}